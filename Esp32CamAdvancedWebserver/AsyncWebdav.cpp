@@ -51,14 +51,13 @@ AsyncWebdav::AsyncWebdav(const String& url, fs::FS &fs) : _fs(fs) {
 
 
 bool AsyncWebdav::canHandle(AsyncWebServerRequest *request) const{
-    if(request->url().startsWith(this->_url)){
+    // Asked for every request no route takes, without copying the URL
+    if(request->urlLength() >= this->_url.length() && !memcmp(request->urlData(), this->_url.c_str(), this->_url.length())){
         if(request->method() == HTTP_PROPFIND 
             || request->method() == HTTP_PROPPATCH){
-            request->addInterestingHeader("depth");
             return true;
         }
         if(request->method() == HTTP_MOVE){
-            request->addInterestingHeader("destination");
             return true;
         }
         if(request->method() == HTTP_GET 
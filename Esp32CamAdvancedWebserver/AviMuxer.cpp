@@ -0,0 +1,160 @@
+#include "AviMuxer.h"
+#include <string.h>
+
+#define AVIF_HASINDEX    0x00000010
+#define AVIIF_KEYFRAME   0x00000010
+#define AVI_DEFAULT_RATE 10
+
+namespace {
+// Little endian writer over a fixed buffer
+class Out {
+public:
+  explicit Out(uint8_t *buf) : _p(buf) {}
+  void fourcc(const char *c) {
+    memcpy(_p, c, 4);
+    _p += 4;
+  }
+  void u32(uint32_t v) {
+    _p[0] = v;
+    _p[1] = v >> 8;
+    _p[2] = v >> 16;
+    _p[3] = v >> 24;
+    _p += 4;
+  }
+  void u16(uint16_t v) {
+    _p[0] = v;
+    _p[1] = v >> 8;
+    _p += 2;
+  }
+
+private:
+  uint8_t *_p;
+};
+}  // namespace
+
+void AviMuxer::begin(uint16_t width, uint16_t height) {
+  _width = width;
+  _height = height;
+  _moviBytes = 0;
+  _maxFrame = 0;
+  _first = 0;
+  _last = 0;
+  _index.clear();
+}
+
+void AviMuxer::frameHeader(uint32_t len, int64_t timestamp, uint8_t out[AVI_CHUNK_HEADER_SIZE]) {
+  if (_index.empty()) {
+    _first = timestamp;
+  }
+  _last = timestamp;
+  _index.push_back({_moviBytes + 4, len});
+  _moviBytes += AVI_CHUNK_HEADER_SIZE + len + padding(len);
+  if (len > _maxFrame) {
+    _maxFrame = len;
+  }
+
+  Out o(out);
+  o.fourcc("00dc");
+  o.u32(len);
+}
+
+void AviMuxer::indexHeader(uint8_t out[AVI_CHUNK_HEADER_SIZE]) const {
+  Out o(out);
+  o.fourcc("idx1");
+  o.u32(_index.size() * AVI_INDEX_ENTRY_SIZE);
+}
+
+void AviMuxer::indexEntry(size_t frame, uint8_t out[AVI_INDEX_ENTRY_SIZE]) const {
+  Out o(out);
+  o.fourcc("00dc");
+  o.u32(AVIIF_KEYFRAME);
+  o.u32(_index[frame].offset);
+  o.u32(_index[frame].len);
+}
+
+uint32_t AviMuxer::frameInterval() const {
+  if (_index.size() < 2 || _last <= _first) {
+    return 1000000 / AVI_DEFAULT_RATE;
+  }
+  return (uint32_t)((_last - _first) / (_index.size() - 1));
+}
+
+void AviMuxer::header(uint8_t out[AVI_HEADER_SIZE]) const {
+  uint32_t frames = _index.size();
+  uint32_t interval = frameInterval();
+  uint32_t bytesPerSec = interval ? (uint32_t)((uint64_t)(_moviBytes / (frames ? frames : 1)) * 1000000 / interval) : 0;
+
+  memset(out, 0, AVI_HEADER_SIZE);
+  Out o(out);
+  o.fourcc("RIFF");
+  o.u32(size() - 8);
+  o.fourcc("AVI ");
+
+  o.fourcc("LIST");
+  o.u32(4 + (8 + 56) + (12 + (8 + 56) + (8 + 40)));
+  o.fourcc("hdrl");
+
+  o.fourcc("avih");
+  o.u32(56);
+  o.u32(interval);      // dwMicroSecPerFrame
+  o.u32(bytesPerSec);   // dwMaxBytesPerSec
+  o.u32(0);             // dwPaddingGranularity
+  o.u32(AVIF_HASINDEX); // dwFlags
+  o.u32(frames);        // dwTotalFrames
+  o.u32(0);             // dwInitialFrames
+  o.u32(1);             // dwStreams
+  o.u32(_maxFrame);     // dwSuggestedBufferSize
+  o.u32(_width);
+  o.u32(_height);
+  o.u32(0);
+  o.u32(0);
+  o.u32(0);
+  o.u32(0);
+
+  o.fourcc("LIST");
+  o.u32(4 + (8 + 56) + (8 + 40));
+  o.fourcc("strl");
+
+  o.fourcc("strh");
+  o.u32(56);
+  o.fourcc("vids");
+  o.fourcc("MJPG");
+  o.u32(0);          // dwFlags
+  o.u16(0);          // wPriority
+  o.u16(0);          // wLanguage
+  o.u32(0);          // dwInitialFrames
+  o.u32(interval);   // dwScale
+  o.u32(1000000);    // dwRate, frames per second = dwRate / dwScale
+  o.u32(0);          // dwStart
+  o.u32(frames);     // dwLength
+  o.u32(_maxFrame);  // dwSuggestedBufferSize
+  o.u32(0xFFFFFFFF); // dwQuality
+  o.u32(0);          // dwSampleSize
+  o.u16(0);          // rcFrame
+  o.u16(0);
+  o.u16(_width);
+  o.u16(_height);
+
+  o.fourcc("strf");
+  o.u32(40);
+  o.u32(40);  // biSize
+  o.u32(_width);
+  o.u32(_height);
+  o.u16(1);   // biPlanes
+  o.u16(24);  // biBitCount
+  o.fourcc("MJPG");
+  o.u32((uint32_t)_width * _height * 3);
+  o.u32(0);
+  o.u32(0);
+  o.u32(0);
+  o.u32(0);
+
+  // 12 + 8 + 192 bytes so far, pad up to the movi list
+  o.fourcc("JUNK");
+  o.u32(AVI_HEADER_SIZE - 12 - 8 - 192 - 8 - 12);
+
+  Out movi(out + AVI_HEADER_SIZE - 12);
+  movi.fourcc("LIST");
+  movi.u32(4 + _moviBytes);
+  movi.fourcc("movi");
+}
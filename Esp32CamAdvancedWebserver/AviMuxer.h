@@ -0,0 +1,66 @@
+#ifndef AVI_MUXER_H
+#define AVI_MUXER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Fixed size of everything in front of the first frame. The hdrl list is
+// padded with a JUNK chunk so that frame data starts at a sector boundary and
+// the header can be rewritten in place when the file is closed.
+#define AVI_HEADER_SIZE 512
+#define AVI_CHUNK_HEADER_SIZE 8
+#define AVI_INDEX_ENTRY_SIZE 16
+
+// Builds an AVI 1.0 (RIFF) container for one MJPEG video stream. It does no
+// I/O itself: the caller writes the bytes it hands out strictly in order
+//
+//   header()  placeholder, rewritten at the end
+//   for each frame: frameHeader(), the JPEG data, padding(len) zero bytes
+//   indexHeader(), indexEntry(0..frames()-1)
+//
+// and finally seeks back to 0 and writes header() again. The idx1 entries are
+// kept in RAM (8 bytes per frame) so the file is never seeked while frames
+// are appended.
+class AviMuxer {
+public:
+  void begin(uint16_t width, uint16_t height);
+
+  // Fills in the chunk header for a frame of len bytes and records it in the
+  // index. timestamp is in microseconds and only used for the frame rate.
+  void frameHeader(uint32_t len, int64_t timestamp, uint8_t out[AVI_CHUNK_HEADER_SIZE]);
+  static size_t padding(uint32_t len) {
+    return len & 1;
+  }
+
+  void indexHeader(uint8_t out[AVI_CHUNK_HEADER_SIZE]) const;
+  void indexEntry(size_t frame, uint8_t out[AVI_INDEX_ENTRY_SIZE]) const;
+  // Valid once all frames were added, the sizes include the index.
+  void header(uint8_t out[AVI_HEADER_SIZE]) const;
+
+  size_t frames() const {
+    return _index.size();
+  }
+  // File size once the index is written.
+  uint64_t size() const {
+    return AVI_HEADER_SIZE + _moviBytes + AVI_CHUNK_HEADER_SIZE + (uint64_t)_index.size() * AVI_INDEX_ENTRY_SIZE;
+  }
+  // Average frame interval in microseconds, from the first and last timestamp.
+  uint32_t frameInterval() const;
+
+private:
+  struct IndexEntry {
+    uint32_t offset;  // of the chunk header, relative to the 'movi' fourcc
+    uint32_t len;
+  };
+
+  uint16_t _width = 0;
+  uint16_t _height = 0;
+  uint32_t _moviBytes = 0;
+  uint32_t _maxFrame = 0;
+  int64_t _first = 0;
+  int64_t _last = 0;
+  std::vector<IndexEntry> _index;
+};
+
+#endif
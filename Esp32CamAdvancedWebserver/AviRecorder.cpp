@@ -0,0 +1,182 @@
+#include "AviRecorder.h"
+#include "SD_MMC.h"
+#include <time.h>
+
+AviRecorder aviRecorder;
+
+static const uint8_t zero_pad[1] = {0};
+
+bool AviFile::open(fs::FS &fs, const char *path) {
+  close();
+  _file = fs.open(path, FILE_WRITE);
+  if (!_file) {
+    log_e("Cannot create %s", path);
+    return false;
+  }
+  if (!_writer.begin(_file)) {
+    _file.close();
+    return false;
+  }
+
+  // Placeholder, the real header needs the frame count and sizes
+  uint8_t header[AVI_HEADER_SIZE];
+  _muxer.begin(0, 0);
+  _muxer.header(header);
+  _writer.write(header, sizeof(header));
+  _width = 0;
+  _height = 0;
+  _open = true;
+  return true;
+}
+
+bool AviFile::addFrame(const uint8_t *data, uint32_t len, uint16_t width, uint16_t height, int64_t timestamp) {
+  if (!_open || _writer.failed()) {
+    return false;
+  }
+  if (!_muxer.frames()) {
+    _muxer.begin(width, height);
+    _width = width;
+    _height = height;
+  } else if (width != _width || height != _height) {
+    return false;
+  }
+
+  uint8_t chunk[AVI_CHUNK_HEADER_SIZE];
+  _muxer.frameHeader(len, timestamp, chunk);
+  _writer.write(chunk, sizeof(chunk));
+  _writer.write(data, len);
+  _writer.write(zero_pad, AviMuxer::padding(len));
+  return !_writer.failed();
+}
+
+bool AviFile::close() {
+  if (!_open) {
+    return false;
+  }
+  _open = false;
+
+  uint8_t entry[AVI_INDEX_ENTRY_SIZE];
+  _muxer.indexHeader(entry);
+  _writer.write(entry, AVI_CHUNK_HEADER_SIZE);
+  for (size_t i = 0; i < _muxer.frames(); i++) {
+    _muxer.indexEntry(i, entry);
+    _writer.write(entry, sizeof(entry));
+  }
+  _writer.end();
+  bool ok = !_writer.failed();
+
+  uint8_t header[AVI_HEADER_SIZE];
+  _muxer.header(header);
+  if (!_file.seek(0) || _file.write(header, sizeof(header)) != sizeof(header)) {
+    log_e("Cannot write AVI header");
+    ok = false;
+  }
+  _file.close();
+  return ok;
+}
+
+bool AviRecorder::start(uint8_t fps) {
+  if (_task) {
+    return false;
+  }
+
+  time_t now;
+  struct tm tm;
+  time(&now);
+  localtime_r(&now, &tm);
+  strftime(_file, sizeof(_file), AVI_RECORD_DIR "/rec-%Y%m%d-%H%M%S.avi", &tm);
+
+  _fps = fps;
+  _frames = 0;
+  _skipped = 0;
+  _bytes = 0;
+  _stop = false;
+  if (xTaskCreate(_recorderTask, "avi_recorder", AVI_RECORDER_STACK_SIZE, this, 2, &_task) != pdPASS) {
+    log_e("Failed to start recorder");
+    _task = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void AviRecorder::stop() {
+  _stop = true;
+}
+
+void AviRecorder::_recorderTask(void *arg) {
+  AviRecorder *recorder = static_cast<AviRecorder *>(arg);
+  recorder->_record();
+  recorder->_task = nullptr;
+  vTaskDelete(NULL);
+}
+
+void AviRecorder::_record() {
+  SD_MMC.mkdir(AVI_RECORD_DIR);
+  AviFile avi;
+  if (!avi.open(SD_MMC, _file)) {
+    return;
+  }
+  log_i("Recording to %s", _file);
+
+  uint32_t seq = 0;
+  int64_t last = 0;
+  TickType_t lastWake = xTaskGetTickCount();
+  while (!_stop) {
+    // Without the producer wait() grabs right away and comes back empty while
+    // stream clients hold the buffers, pace the grabs like MotionDetector
+    bool paced = !frameBroker.producing();
+    if (paced) {
+      vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(1000 / (_fps ? _fps : AVI_RECORDER_GRAB_FPS)));
+    }
+    FrameLease frame = frameBroker.wait(seq, 1000);
+    if (!frame) {
+      continue;
+    }
+    seq = frame->seq;
+    if (_fps && !paced && frame->grabbed - last < 1000000 / _fps) {
+      continue;
+    }
+    last = frame->grabbed;
+
+    camera_fb_t *fb = frame->fb;
+    if (fb->format != PIXFORMAT_JPEG || !avi.addFrame(fb->buf, fb->len, fb->width, fb->height, frame->grabbed)) {
+      _skipped++;
+      continue;
+    }
+    _frames = avi.frames();
+    _bytes = avi.size();
+    if (_bytes >= AVI_MAX_BYTES) {
+      log_w("Recording reached the size limit");
+      break;
+    }
+  }
+
+  if (!avi.close()) {
+    log_e("Recording %s is incomplete", _file);
+  }
+  log_i("Recorded %u frames", _frames);
+}
+
+void AviRecorder::status(Print &out) {
+  out.printf(
+    "{\"recording\":%s,\"file\":\"%s\",\"frames\":%u,\"skipped\":%u,\"bytes\":%llu,\"fps\":%u}", recording() ? "true" : "false", _file, _frames,
+    _skipped, (unsigned long long)_bytes, _fps
+  );
+}
+
+void record_handler(AsyncWebServerRequest *request) {
+  if (request->hasParam("start")) {
+    int fps = request->hasParam("fps") ? request->getParam("fps")->value().toInt() : 0;
+    if (fps < 0 || fps > 60 || !aviRecorder.start(fps)) {
+      request->send(500, "text/plain", "Recorder not started.");
+      return;
+    }
+  } else if (request->hasParam("stop")) {
+    aviRecorder.stop();
+  }
+
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  aviRecorder.status(*response);
+  request->send(response);
+}
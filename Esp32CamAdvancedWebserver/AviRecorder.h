@@ -0,0 +1,90 @@
+#ifndef AVI_RECORDER_H
+#define AVI_RECORDER_H
+
+#include <Arduino.h>
+#include "FS.h"
+#include <ESPAsyncWebServer.h>
+#include "AviMuxer.h"
+#include "FrameBroker.h"
+#include "SdBlockWriter.h"
+
+#ifndef AVI_RECORD_DIR
+#define AVI_RECORD_DIR "/recordings"
+#endif
+// Recordings are closed at this size, RIFF chunk sizes are 32 bit and many
+// players give up on AVI 1.0 files past 1 GB.
+#ifndef AVI_MAX_BYTES
+#define AVI_MAX_BYTES (1000UL * 1024 * 1024)
+#endif
+// Frame rate the recorder grabs at without the producer task when started
+// with fps = 0.
+#ifndef AVI_RECORDER_GRAB_FPS
+#define AVI_RECORDER_GRAB_FPS 10
+#endif
+#ifndef AVI_RECORDER_STACK_SIZE
+#define AVI_RECORDER_STACK_SIZE 6144
+#endif
+
+// An AVI file on the SD card. Frames are appended through an SdBlockWriter,
+// the index and final header are written by close().
+class AviFile {
+public:
+  ~AviFile() {
+    close();
+  }
+
+  bool open(fs::FS &fs, const char *path);
+  // Frames with a different size than the first one are rejected.
+  bool addFrame(const uint8_t *data, uint32_t len, uint16_t width, uint16_t height, int64_t timestamp);
+  bool close();
+
+  bool isOpen() const {
+    return _open;
+  }
+  size_t frames() const {
+    return _muxer.frames();
+  }
+  uint64_t size() const {
+    return _muxer.size();
+  }
+
+private:
+  File _file;
+  SdBlockWriter _writer;
+  AviMuxer _muxer;
+  uint16_t _width = 0;
+  uint16_t _height = 0;
+  bool _open = false;
+};
+
+// Records the camera stream into AVI_RECORD_DIR until stopped or the file
+// reaches AVI_MAX_BYTES. Frames are taken from the frame broker by a
+// recorder task, so the SD card never holds up the producer.
+class AviRecorder {
+public:
+  // fps = 0 records every frame the producer publishes.
+  bool start(uint8_t fps = 0);
+  void stop();
+  bool recording() const {
+    return _task != nullptr;
+  }
+  void status(Print &out);
+
+private:
+  static void _recorderTask(void *arg);
+  void _record();
+
+  TaskHandle_t _task = nullptr;
+  volatile bool _stop = false;
+  uint8_t _fps = 0;
+  uint32_t _frames = 0;
+  uint32_t _skipped = 0;  // frames that were not JPEG or changed size
+  uint64_t _bytes = 0;
+  char _file[48] = "";
+};
+
+extern AviRecorder aviRecorder;
+
+void record_handler(AsyncWebServerRequest *request);
+
+#endif
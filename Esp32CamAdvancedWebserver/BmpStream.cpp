@@ -0,0 +1,133 @@
+#include "BmpStream.h"
+#include <string.h>
+#include <algorithm>
+
+static void le16(uint8_t *p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static void le32(uint8_t *p, uint32_t v) {
+  le16(p, v);
+  le16(p + 2, v >> 16);
+}
+
+static inline uint8_t clamp8(int v) {
+  return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+bool BmpStream::begin(const camera_fb_t *fb) {
+  switch (fb->format) {
+    case PIXFORMAT_GRAYSCALE:
+      _bpp = 1;
+      break;
+    case PIXFORMAT_RGB565:
+    case PIXFORMAT_RGB888:
+    case PIXFORMAT_YUV422:
+      _bpp = 3;
+      break;
+    default:
+      return false;
+  }
+
+  _fb = fb;
+  _stride = (fb->width * _bpp + 3) & ~3;
+  _dataOffset = sizeof(_header) + (_bpp == 1 ? 256 * 4 : 0);
+  _size = _dataOffset + _stride * fb->height;
+
+  memset(_header, 0, sizeof(_header));
+  _header[0] = 'B';
+  _header[1] = 'M';
+  le32(_header + 2, _size);
+  le32(_header + 10, _dataOffset);
+  le32(_header + 14, 40);  // BITMAPINFOHEADER
+  le32(_header + 18, fb->width);
+  le32(_header + 22, fb->height);  // positive, rows are bottom up
+  le16(_header + 26, 1);
+  le16(_header + 28, _bpp * 8);
+  le32(_header + 34, _stride * fb->height);
+  le32(_header + 38, 2835);  // 72 dpi
+  le32(_header + 42, 2835);
+  le32(_header + 46, _bpp == 1 ? 256 : 0);
+  return true;
+}
+
+void BmpStream::_pixels(int y, int x, int count, uint8_t *out) const {
+  size_t srcBpp = _fb->format == PIXFORMAT_RGB888 ? 3 : _fb->format == PIXFORMAT_GRAYSCALE ? 1 : 2;
+  const uint8_t *row = _fb->buf + y * _fb->width * srcBpp;
+
+  switch (_fb->format) {
+    case PIXFORMAT_GRAYSCALE:
+      memcpy(out, row + x, count);
+      break;
+    case PIXFORMAT_RGB888:  // already stored as BGR
+      memcpy(out, row + x * 3, count * 3);
+      break;
+    case PIXFORMAT_RGB565:
+      for (const uint8_t *p = row + x * 2, *end = p + count * 2; p < end; p += 2, out += 3) {
+        // Big endian, the top bits are repeated to reach full scale
+        uint8_t r = p[0] & 0xF8;
+        uint8_t g = ((p[0] & 0x07) << 5) | ((p[1] & 0xE0) >> 3);
+        uint8_t b = (p[1] & 0x1F) << 3;
+        out[0] = b | (b >> 5);
+        out[1] = g | (g >> 6);
+        out[2] = r | (r >> 5);
+      }
+      break;
+    case PIXFORMAT_YUV422:
+      for (int i = x; i < x + count; i++, out += 3) {
+        // Y0 U Y1 V
+        const uint8_t *pair = row + (i & ~1) * 2;
+        int luma = row[i * 2];
+        int u = pair[1] - 128;
+        int v = pair[3] - 128;
+        out[0] = clamp8(luma + ((116130 * u) >> 16));
+        out[1] = clamp8(luma - ((22554 * u + 46802 * v) >> 16));
+        out[2] = clamp8(luma + ((91881 * v) >> 16));
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+size_t BmpStream::read(uint8_t *buf, size_t len, size_t index) const {
+  size_t n = 0;
+
+  for (; n < len && index < _dataOffset; n++, index++) {
+    if (index < sizeof(_header)) {
+      buf[n] = _header[index];
+    } else {
+      size_t entry = index - sizeof(_header);  // grey palette, B G R 0
+      buf[n] = (entry & 3) == 3 ? 0 : entry >> 2;
+    }
+  }
+
+  size_t rowBytes = _fb->width * _bpp;
+  while (n < len && index < _size) {
+    size_t pos = index - _dataOffset;
+    size_t col = pos % _stride;
+    int y = _fb->height - 1 - pos / _stride;
+    size_t count;
+
+    if (col >= rowBytes) {
+      count = std::min(_stride - col, len - n);
+      memset(buf + n, 0, count);
+    } else if (col % _bpp == 0 && len - n >= _bpp) {
+      // Whole pixels are converted in place
+      int x = col / _bpp;
+      int pixels = std::min((rowBytes - col) / _bpp, (len - n) / _bpp);
+      _pixels(y, x, pixels, buf + n);
+      count = pixels * _bpp;
+    } else {
+      // A pixel split between two calls
+      uint8_t px[3];
+      _pixels(y, col / _bpp, 1, px);
+      count = std::min<size_t>(_bpp - col % _bpp, len - n);
+      memcpy(buf + n, px + col % _bpp, count);
+    }
+    n += count;
+    index += count;
+  }
+  return n;
+}
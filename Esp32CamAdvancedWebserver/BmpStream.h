@@ -0,0 +1,40 @@
+#ifndef BMP_STREAM_H
+#define BMP_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_camera.h"
+
+// BMP file of a camera frame that is produced on demand. read() converts
+// only the pixels that fall into the requested byte range, straight from the
+// frame buffer, so a response filler can hand out the image row by row as
+// the TCP window opens without an intermediate copy of the frame.
+//
+// RGB565, RGB888 and YUV422 frames become 24 bit BMPs, greyscale frames 8 bit
+// with a grey palette. The frame buffer has to stay valid while reading.
+class BmpStream {
+public:
+  // Returns false for formats without a row conversion (JPEG, RAW, ...).
+  bool begin(const camera_fb_t *fb);
+
+  // Size of the complete file
+  size_t size() const {
+    return _size;
+  }
+
+  // Copies up to len bytes starting at file offset index, returns the count.
+  size_t read(uint8_t *buf, size_t len, size_t index) const;
+
+private:
+  // Converts pixels [x, x + count) of source row y to BGR
+  void _pixels(int y, int x, int count, uint8_t *out) const;
+
+  const camera_fb_t *_fb = nullptr;
+  uint8_t _header[54];
+  uint8_t _bpp = 3;           // bytes per BMP pixel
+  uint32_t _dataOffset = 0;   // header and palette
+  uint32_t _stride = 0;       // BMP row including padding
+  size_t _size = 0;
+};
+
+#endif
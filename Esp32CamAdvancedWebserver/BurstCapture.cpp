@@ -0,0 +1,217 @@
+#include "BurstCapture.h"
+#include "AviRecorder.h"
+#include "FrameBroker.h"
+#include "SD_MMC.h"
+#include "esp_heap_caps.h"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define BURST_BOUNDARY "burst0123456789burst"
+
+static const char *_BURST_CONTENT_TYPE = "multipart/mixed; boundary=" BURST_BOUNDARY;
+static const char *_BURST_PART = "\r\n--" BURST_BOUNDARY "\r\nContent-Type: %s\r\nContent-Length: %u\r\nX-Timestamp: %lld.%06ld\r\n\r\n";
+static const char *_BURST_END = "\r\n--" BURST_BOUNDARY "--\r\n";
+
+struct BurstFrame {
+  uint8_t *data = nullptr;  // PSRAM copy of the frame
+  size_t len = 0;
+  char part[160];  // boundary and part header
+  size_t partLen = 0;
+
+  ~BurstFrame() {
+    free(data);
+  }
+};
+
+struct BurstJob {
+  AsyncWebServerRequest *request;  // nullptr once the client is gone
+  uint16_t count;
+  uint32_t interval;  // ms
+  bool sd;
+
+  uint16_t captured = 0;
+  std::vector<std::unique_ptr<BurstFrame>> frames;
+  size_t size = 0;  // multipart body
+  char file[48] = "";
+};
+
+// Guards BurstJob::request and is held while the response is sent, so a
+// disconnect cannot delete the request in between
+static std::mutex burstLock;
+static bool burstRunning = false;
+
+static bool burst_keep(BurstJob &job, camera_fb_t *fb) {
+  std::unique_ptr<BurstFrame> frame(new (std::nothrow) BurstFrame());
+  if (!frame) {
+    return false;
+  }
+  frame->data = (uint8_t *)heap_caps_malloc(fb->len, MALLOC_CAP_SPIRAM);
+  if (!frame->data) {
+    return false;
+  }
+  memcpy(frame->data, fb->buf, fb->len);
+  frame->len = fb->len;
+  frame->partLen = snprintf(
+    frame->part, sizeof(frame->part), _BURST_PART, fb->format == PIXFORMAT_JPEG ? "image/jpeg" : "application/octet-stream", fb->len,
+    fb->timestamp.tv_sec, fb->timestamp.tv_usec
+  );
+
+  job.size += frame->partLen + frame->len;
+  job.frames.push_back(std::move(frame));
+  return true;
+}
+
+static void burst_capture(BurstJob &job) {
+  AviFile avi;
+  if (job.sd) {
+    time_t now;
+    struct tm tm;
+    time(&now);
+    localtime_r(&now, &tm);
+    strftime(job.file, sizeof(job.file), AVI_RECORD_DIR "/burst-%Y%m%d-%H%M%S.avi", &tm);
+    SD_MMC.mkdir(AVI_RECORD_DIR);
+    if (!avi.open(SD_MMC, job.file)) {
+      return;
+    }
+  }
+
+  // Only frames grabbed after the request
+  uint32_t seq = frameBroker.sequence();
+  int64_t last = 0;
+  while (job.captured < job.count) {
+    FrameLease frame = frameBroker.wait(seq, 1000);
+    if (!frame) {
+      log_e("Camera capture failed");
+      break;
+    }
+    seq = frame->seq;
+    if (last && frame->grabbed - last < job.interval * 1000LL) {
+      continue;
+    }
+    last = frame->grabbed;
+
+    camera_fb_t *fb = frame->fb;
+    bool kept;
+    if (job.sd) {
+      kept = fb->format == PIXFORMAT_JPEG && avi.addFrame(fb->buf, fb->len, fb->width, fb->height, frame->grabbed);
+    } else {
+      kept = burst_keep(job, fb);
+    }
+    if (!kept) {
+      log_e("Burst stopped after %u frames", job.captured);
+      break;
+    }
+    job.captured++;
+  }
+
+  if (job.sd && !avi.close()) {
+    log_e("Burst %s is incomplete", job.file);
+  }
+  job.size += strlen(_BURST_END);
+}
+
+static size_t burst_read(const BurstJob &job, uint8_t *buf, size_t len, size_t index) {
+  size_t n = 0;
+  size_t pos = 0;  // start of the current segment in the body
+
+  auto copy = [&](const void *segment, size_t segmentLen) {
+    if (n < len && index < pos + segmentLen) {
+      size_t count = std::min(pos + segmentLen - index, len - n);
+      memcpy(buf + n, (const uint8_t *)segment + (index - pos), count);
+      n += count;
+      index += count;
+    }
+    pos += segmentLen;
+  };
+
+  for (const std::unique_ptr<BurstFrame> &frame : job.frames) {
+    copy(frame->part, frame->partLen);
+    copy(frame->data, frame->len);
+  }
+  copy(_BURST_END, strlen(_BURST_END));
+  return n;
+}
+
+static void burst_send(std::shared_ptr<BurstJob> job) {
+  AsyncWebServerRequest *request = job->request;
+
+  if (job->sd) {
+    if (!job->file[0] || !job->captured) {
+      request->send(500, "text/plain", "Burst not recorded.");
+      return;
+    }
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    response->printf("{\"file\":\"%s\",\"frames\":%u}", job->file, job->captured);
+    request->send(response);
+    return;
+  }
+
+  if (!job->captured) {
+    request->send(500, "text/plain", "Camera capture failed");
+    return;
+  }
+  // The job owns the frame copies until the last byte has been sent
+  AsyncWebServerResponse *response = request->beginResponse(_BURST_CONTENT_TYPE, job->size, [job](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+    return burst_read(*job, buffer, maxLen, index);
+  });
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  response->addHeader("X-Frames", String(job->captured));
+  request->send(response);
+}
+
+static void burst_task(void *arg) {
+  std::shared_ptr<BurstJob> *ref = static_cast<std::shared_ptr<BurstJob> *>(arg);
+  std::shared_ptr<BurstJob> job = *ref;
+  delete ref;
+
+  burst_capture(*job);
+
+  {
+    std::lock_guard<std::mutex> lock(burstLock);
+    if (job->request) {
+      burst_send(job);
+    }
+    burstRunning = false;
+  }
+  job.reset();
+  vTaskDelete(NULL);
+}
+
+void burst_handler(AsyncWebServerRequest *request) {
+  int count = request->hasParam("n") ? request->getParam("n")->value().toInt() : 10;
+  int interval = request->hasParam("interval") ? request->getParam("interval")->value().toInt() : 0;
+  if (count < 1 || count > BURST_MAX_FRAMES || interval < 0 || interval > 60000) {
+    request->send(400, "text/plain", "n must be 1.." + String(BURST_MAX_FRAMES) + ", interval 0..60000 ms");
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(burstLock);
+  if (burstRunning) {
+    request->send(409, "text/plain", "Burst already running");
+    return;
+  }
+
+  std::shared_ptr<BurstJob> job = std::make_shared<BurstJob>();
+  job->request = request;
+  job->count = count;
+  job->interval = interval;
+  job->sd = request->hasParam("sd");
+
+  std::shared_ptr<BurstJob> *ref = new (std::nothrow) std::shared_ptr<BurstJob>(job);
+  if (!ref || xTaskCreate(burst_task, "burst", BURST_STACK_SIZE, ref, 2, NULL) != pdPASS) {
+    delete ref;
+    log_e("Failed to start burst");
+    request->send(500, "text/plain", "Burst not started.");
+    return;
+  }
+  burstRunning = true;
+
+  request->pause();
+  request->onDisconnect([job]() {
+    std::lock_guard<std::mutex> lock(burstLock);
+    job->request = nullptr;
+  });
+}
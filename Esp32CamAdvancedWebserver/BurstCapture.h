@@ -0,0 +1,26 @@
+#ifndef BURST_CAPTURE_H
+#define BURST_CAPTURE_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#ifndef BURST_MAX_FRAMES
+#define BURST_MAX_FRAMES 50
+#endif
+#ifndef BURST_STACK_SIZE
+#define BURST_STACK_SIZE 6144
+#endif
+
+// GET /cam/burst?n=10&interval=50[&sd]
+//
+// Captures n consecutive frames at least interval ms apart and returns them
+// as one multipart/mixed response, one image/jpeg part per frame with its
+// X-Timestamp. The request is paused while a task collects the frames into
+// PSRAM, so capturing runs at the sensor rate regardless of the network and
+// async_tcp is not blocked. With sd the frames go into one AVI file in
+// AVI_RECORD_DIR instead and the response names the file.
+//
+// One burst runs at a time, a second request gets 409.
+void burst_handler(AsyncWebServerRequest *request);
+
+#endif
@@ -0,0 +1,206 @@
+#include "CameraMetrics.h"
+#include "MjpegResponse.h"
+#include <list>
+#include <mutex>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+typedef struct {
+  size_t size;   //number of values used for filtering
+  size_t index;  //current value index
+  size_t count;  //value count
+  int sum;
+  int *values;  //array to be filled with values
+} ra_filter_t;
+
+static ra_filter_t ra_filter[METRIC_COUNT];
+static portMUX_TYPE ra_filter_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static MetricHistogram histograms[METRIC_COUNT];
+static std::atomic<uint32_t> dropped_frames{0};
+static std::atomic<uint16_t> motion_score{0};
+static std::atomic<uint32_t> motion_events{0};
+
+static std::mutex streams_lock;
+static std::list<StreamStats *> streams;
+
+static const char *metric_names[METRIC_COUNT] = {"grab_ms", "jpeg_size", "send_ms", "ack_ms", "motion_us"};
+
+static ra_filter_t *ra_filter_init(ra_filter_t *filter, size_t sample_size) {
+  memset(filter, 0, sizeof(ra_filter_t));
+
+  filter->values = (int *)malloc(sample_size * sizeof(int));
+  if (!filter->values) {
+    return NULL;
+  }
+  memset(filter->values, 0, sample_size * sizeof(int));
+
+  filter->size = sample_size;
+  return filter;
+}
+
+static int ra_filter_run(ra_filter_t *filter, int value) {
+  if (!filter->values) {
+    return value;
+  }
+  filter->sum -= filter->values[filter->index];
+  filter->values[filter->index] = value;
+  filter->sum += filter->values[filter->index];
+  filter->index++;
+  filter->index = filter->index % filter->size;
+  if (filter->count < filter->size) {
+    filter->count++;
+  }
+  return filter->sum / filter->count;
+}
+
+static int ra_filter_average(ra_filter_t *filter) {
+  return filter->count ? filter->sum / (int)filter->count : 0;
+}
+
+size_t MetricHistogram::_bucket(uint32_t value) {
+  if (value < 4) {
+    return value;
+  }
+  uint32_t msb = 31 - __builtin_clz(value);
+  return (msb - 1) * 4 + ((value >> (msb - 2)) & 3);
+}
+
+uint32_t MetricHistogram::_upperBound(size_t bucket) {
+  if (bucket < 4) {
+    return bucket;
+  }
+  uint32_t msb = bucket / 4 + 1;
+  uint64_t lower = (uint64_t)(4 + bucket % 4) << (msb - 2);
+  uint64_t upper = lower + ((uint64_t)1 << (msb - 2)) - 1;
+  return upper > UINT32_MAX ? UINT32_MAX : (uint32_t)upper;
+}
+
+void MetricHistogram::record(uint32_t value) {
+  _buckets[_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+  _count.fetch_add(1, std::memory_order_relaxed);
+  uint32_t max = _max.load(std::memory_order_relaxed);
+  while (value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+void MetricHistogram::reset() {
+  for (size_t i = 0; i < BUCKETS; i++) {
+    _buckets[i].store(0, std::memory_order_relaxed);
+  }
+  _count.store(0, std::memory_order_relaxed);
+  _max.store(0, std::memory_order_relaxed);
+}
+
+uint32_t MetricHistogram::percentile(uint8_t p) const {
+  uint32_t total = count();
+  if (!total) {
+    return 0;
+  }
+  uint32_t rank = ((uint64_t)total * p + 99) / 100;
+  uint32_t seen = 0;
+  for (size_t i = 0; i < BUCKETS; i++) {
+    seen += _buckets[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      uint32_t upper = _upperBound(i);
+      return upper < max() ? upper : max();
+    }
+  }
+  return max();
+}
+
+void metrics_init() {
+  for (size_t i = 0; i < METRIC_COUNT; i++) {
+    ra_filter_init(&ra_filter[i], METRICS_AVERAGE_SAMPLES);
+  }
+}
+
+void metrics_record(camera_metric_t metric, uint32_t value) {
+  histograms[metric].record(value);
+  portENTER_CRITICAL(&ra_filter_mux);
+  ra_filter_run(&ra_filter[metric], value);
+  portEXIT_CRITICAL(&ra_filter_mux);
+}
+
+void metrics_dropped(uint32_t frames) {
+  dropped_frames.fetch_add(frames, std::memory_order_relaxed);
+}
+
+void metrics_frame_done(StreamStats *stats, uint32_t latency) {
+  int64_t now = esp_timer_get_time();
+  if (stats->lastFrame && now > stats->lastFrame) {
+    uint32_t fps_x10 = 10000000 / (uint32_t)(now - stats->lastFrame);
+    stats->fps_x10 = stats->fps_x10 ? (stats->fps_x10 * 7 + fps_x10) / 8 : fps_x10;
+  }
+  stats->lastFrame = now;
+  stats->latency = stats->latency ? (stats->latency * 3 + latency) / 4 : latency;
+  stats->frames++;
+}
+
+void metrics_motion(uint16_t score, bool event) {
+  motion_score.store(score, std::memory_order_relaxed);
+  if (event) {
+    motion_events.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void metrics_register(StreamStats *stats) {
+  std::lock_guard<std::mutex> lock(streams_lock);
+  streams.push_back(stats);
+}
+
+void metrics_unregister(StreamStats *stats) {
+  std::lock_guard<std::mutex> lock(streams_lock);
+  streams.remove(stats);
+}
+
+void metrics_handler(AsyncWebServerRequest *request) {
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  response->addHeader("Cache-Control", "no-store");
+
+  response->print('{');
+  for (size_t i = 0; i < METRIC_COUNT; i++) {
+    const MetricHistogram &h = histograms[i];
+    int avg;
+    portENTER_CRITICAL(&ra_filter_mux);
+    avg = ra_filter_average(&ra_filter[i]);
+    portEXIT_CRITICAL(&ra_filter_mux);
+    response->printf(
+      "\"%s\":{\"avg\":%d,\"count\":%u,\"p50\":%u,\"p95\":%u,\"p99\":%u,\"max\":%u},", metric_names[i], avg, h.count(), h.percentile(50),
+      h.percentile(95), h.percentile(99), h.max()
+    );
+  }
+  response->printf(
+    "\"dropped\":%u,\"motion\":{\"score\":%u,\"events\":%u},\"static\":{\"tolerance\":%u,\"refresh\":%u},\"streams\":[",
+    dropped_frames.load(std::memory_order_relaxed), motion_score.load(std::memory_order_relaxed), motion_events.load(std::memory_order_relaxed),
+    AsyncMjpegResponse::staticTolerance(), AsyncMjpegResponse::staticRefresh() / 1000
+  );
+
+  {
+    std::lock_guard<std::mutex> lock(streams_lock);
+    bool first = true;
+    for (const StreamStats *stats : streams) {
+      response->printf(
+        "%s{\"fps\":%u.%u,\"frames\":%u,\"dropped\":%u,\"latency\":%u,\"level\":%u,\"suppressed\":%u,\"saved\":%llu}", first ? "" : ",",
+        stats->fps_x10 / 10, stats->fps_x10 % 10, stats->frames, stats->dropped, stats->latency, stats->level, stats->suppressed, (unsigned long long)stats->saved
+      );
+      first = false;
+    }
+  }
+  // Low water marks since boot, what streaming cost at its peak
+  response->printf(
+    "],\"heap\":{\"free\":%u,\"min\":%u,\"psram\":%u,\"psram_min\":%u}}", (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+    (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL), (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM),
+    (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM)
+  );
+
+  if (request->hasParam("reset")) {
+    for (size_t i = 0; i < METRIC_COUNT; i++) {
+      histograms[i].reset();
+    }
+    dropped_frames.store(0, std::memory_order_relaxed);
+  }
+
+  request->send(response);
+}
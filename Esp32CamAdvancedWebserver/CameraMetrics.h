@@ -0,0 +1,73 @@
+#ifndef CAMERA_METRICS_H
+#define CAMERA_METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <ESPAsyncWebServer.h>
+
+// Number of samples in the rolling averages.
+#ifndef METRICS_AVERAGE_SAMPLES
+#define METRICS_AVERAGE_SAMPLES 20
+#endif
+
+// Fixed-size, lock-free histogram with four sub-buckets per power of two
+// (values 0..3 have a bucket of their own). Recording is a couple of relaxed
+// atomic increments, percentiles are accurate to about 12%.
+class MetricHistogram {
+public:
+  static const size_t BUCKETS = 124;
+
+  void record(uint32_t value);
+  void reset();
+
+  uint32_t count() const {
+    return _count.load(std::memory_order_relaxed);
+  }
+  uint32_t max() const {
+    return _max.load(std::memory_order_relaxed);
+  }
+  // Upper bound of the bucket holding the p-th percentile (0..100).
+  uint32_t percentile(uint8_t p) const;
+
+private:
+  static size_t _bucket(uint32_t value);
+  static uint32_t _upperBound(size_t bucket);
+
+  std::atomic<uint32_t> _buckets[BUCKETS] = {};
+  std::atomic<uint32_t> _count{0};
+  std::atomic<uint32_t> _max{0};
+};
+
+typedef enum {
+  METRIC_GRAB_MS,    // esp_camera_fb_get() duration
+  METRIC_JPEG_SIZE,  // bytes per frame
+  METRIC_SEND_MS,    // first to last byte of a frame handed to TCP
+  METRIC_ACK_MS,     // last byte handed to TCP until it is acked
+  METRIC_MOTION_US,  // motion detection per frame
+  METRIC_COUNT
+} camera_metric_t;
+
+// Per stream client counters. Owned by the client, registered while it is
+// connected so /cam/metrics can list it.
+struct StreamStats {
+  uint32_t frames = 0;   // frames fully acked
+  uint32_t dropped = 0;  // newer frames the client skipped
+  uint32_t fps_x10 = 0;  // smoothed frame rate * 10
+  uint32_t latency = 0;  // smoothed grab-to-ack latency in ms
+  uint8_t level = 0;     // rate control level
+  uint32_t suppressed = 0;  // static frames not sent
+  uint64_t saved = 0;       // bytes of those frames
+  int64_t lastFrame = 0;
+};
+
+void metrics_init();
+void metrics_record(camera_metric_t metric, uint32_t value);
+void metrics_dropped(uint32_t frames);
+void metrics_frame_done(StreamStats *stats, uint32_t latency);
+void metrics_motion(uint16_t score, bool event);
+void metrics_register(StreamStats *stats);
+void metrics_unregister(StreamStats *stats);
+
+void metrics_handler(AsyncWebServerRequest *request);
+
+#endif
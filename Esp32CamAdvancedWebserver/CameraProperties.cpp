@@ -0,0 +1,430 @@
+#include "CameraProperties.h"
+#include "camera_pins.h"
+#include "FrameBroker.h"
+#include "MjpegResponse.h"
+#include "MotionDetector.h"
+#include "RegisterShadow.h"
+
+#if defined(LED_GPIO_NUM)
+extern int led_duty;
+extern bool isStreaming;
+void enable_led(bool en);
+#endif
+
+static constexpr CameraProperty properties[] = {
+  {"xclk", PROP_INT, 0, 0, nullptr,
+   [](sensor_t *s) -> int {
+     return s->xclk_freq_hz / 1000000;
+   }},
+  {"pixformat", PROP_ENUM, 0, 0, nullptr,
+   [](sensor_t *s) -> int {
+     return s->pixformat;
+   }},
+  {"framesize", PROP_ENUM, 0, FRAMESIZE_INVALID - 1,
+   [](sensor_t *s, int v) -> int {
+     // Only JPEG frames can change size on the fly
+     return s->pixformat == PIXFORMAT_JPEG ? s->set_framesize(s, (framesize_t)v) : 0;
+   },
+   [](sensor_t *s) -> int {
+     return s->status.framesize;
+   }},
+  {"quality", PROP_INT, 0, 63,
+   [](sensor_t *s, int v) -> int {
+     int res = s->set_quality(s, v);
+     if (!res) {
+       frameBroker.setQuality(v);
+     }
+     return res;
+   },
+   [](sensor_t *s) -> int {
+     return s->status.quality;
+   }},
+  {"brightness", PROP_INT, -3, 3,
+   [](sensor_t *s, int v) -> int {
+     return s->set_brightness(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.brightness;
+   }},
+  {"contrast", PROP_INT, -3, 3,
+   [](sensor_t *s, int v) -> int {
+     return s->set_contrast(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.contrast;
+   }},
+  {"saturation", PROP_INT, -4, 4,
+   [](sensor_t *s, int v) -> int {
+     return s->set_saturation(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.saturation;
+   }},
+  {"sharpness", PROP_INT, 0, 0, nullptr,
+   [](sensor_t *s) -> int {
+     return s->status.sharpness;
+   }},
+  {"special_effect", PROP_ENUM, 0, 6,
+   [](sensor_t *s, int v) -> int {
+     return s->set_special_effect(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.special_effect;
+   }},
+  {"wb_mode", PROP_ENUM, 0, 4,
+   [](sensor_t *s, int v) -> int {
+     return s->set_wb_mode(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.wb_mode;
+   }},
+  {"awb", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_whitebal(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.awb;
+   }},
+  {"awb_gain", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_awb_gain(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.awb_gain;
+   }},
+  {"aec", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_exposure_ctrl(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.aec;
+   }},
+  {"aec2", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_aec2(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.aec2;
+   }},
+  {"ae_level", PROP_INT, -5, 5,
+   [](sensor_t *s, int v) -> int {
+     return s->set_ae_level(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.ae_level;
+   }},
+  {"aec_value", PROP_INT, 0, 1920,
+   [](sensor_t *s, int v) -> int {
+     return s->set_aec_value(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.aec_value;
+   }},
+  {"agc", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_gain_ctrl(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.agc;
+   }},
+  {"agc_gain", PROP_INT, 0, 64,
+   [](sensor_t *s, int v) -> int {
+     return s->set_agc_gain(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.agc_gain;
+   }},
+  {"gainceiling", PROP_ENUM, 0, 6,
+   [](sensor_t *s, int v) -> int {
+     return s->set_gainceiling(s, (gainceiling_t)v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.gainceiling;
+   }},
+  {"bpc", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_bpc(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.bpc;
+   }},
+  {"wpc", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_wpc(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.wpc;
+   }},
+  {"raw_gma", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_raw_gma(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.raw_gma;
+   }},
+  {"lenc", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_lenc(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.lenc;
+   }},
+  {"hmirror", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_hmirror(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.hmirror;
+   }},
+  {"vflip", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_vflip(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.vflip;
+   }},
+  {"dcw", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_dcw(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.dcw;
+   }},
+  {"colorbar", PROP_BOOL, 0, 1,
+   [](sensor_t *s, int v) -> int {
+     return s->set_colorbar(s, v);
+   },
+   [](sensor_t *s) -> int {
+     return s->status.colorbar;
+   }},
+  {"fps", PROP_INT, 0, 60,
+   [](sensor_t *, int v) -> int {
+     frameBroker.setFrameRate(v);
+     return 0;
+   },
+   [](sensor_t *) -> int {
+     return frameBroker.frameRate();
+   },
+   true},
+  {"latency", PROP_INT, 1, 30000,
+   [](sensor_t *, int v) -> int {
+     AsyncMjpegResponse::setLatencyTarget(v);
+     return 0;
+   },
+   [](sensor_t *) -> int {
+     return AsyncMjpegResponse::latencyTarget();
+   },
+   true},
+  {"static", PROP_INT, 0, 1000,
+   [](sensor_t *, int v) -> int {
+     AsyncMjpegResponse::setStaticTolerance(v);
+     return 0;
+   },
+   [](sensor_t *) -> int {
+     return AsyncMjpegResponse::staticTolerance();
+   },
+   true},
+  {"static_refresh", PROP_INT, 1, 3600,
+   [](sensor_t *, int v) -> int {
+     AsyncMjpegResponse::setStaticRefresh(v * 1000);
+     return 0;
+   },
+   [](sensor_t *) -> int {
+     return AsyncMjpegResponse::staticRefresh() / 1000;
+   },
+   true},
+  {"motion", PROP_INT, 0, 1000,
+   [](sensor_t *, int v) -> int {
+     motionDetector.setTrigger(v);
+     return 0;
+   },
+   [](sensor_t *) -> int {
+     return motionDetector.trigger();
+   },
+   true},
+#if defined(LED_GPIO_NUM)
+  {"led_intensity", PROP_INT, 0, 255,
+   [](sensor_t *, int v) -> int {
+     led_duty = v;
+     if (isStreaming) {
+       enable_led(true);
+     }
+     return 0;
+   },
+   [](sensor_t *) -> int {
+     return led_duty;
+   },
+   true},
+#else
+  {"led_intensity", PROP_INT, 0, 0, nullptr,
+   [](sensor_t *s) -> int {
+     return -1;
+   }},
+#endif
+};
+
+#define PROPERTY_COUNT (sizeof(properties) / sizeof(properties[0]))
+
+// Perfect hash over the property names: FNV-1a with a seed that is searched
+// at compile time so that every name lands in its own slot.
+#define PROPERTY_SLOTS 256
+
+static constexpr uint32_t property_hash(const char *name, uint32_t seed) {
+  uint32_t hash = 2166136261 ^ seed;
+  while (*name) {
+    hash = (hash ^ (uint8_t)*name++) * 16777619;
+  }
+  return hash % PROPERTY_SLOTS;
+}
+
+static constexpr uint32_t property_seed() {
+  for (uint32_t seed = 0; seed < 100000; seed++) {
+    bool used[PROPERTY_SLOTS] = {};
+    bool collision = false;
+    for (const CameraProperty &p : properties) {
+      uint32_t slot = property_hash(p.name, seed);
+      if (used[slot]) {
+        collision = true;
+        break;
+      }
+      used[slot] = true;
+    }
+    if (!collision) {
+      return seed;
+    }
+  }
+  return UINT32_MAX;
+}
+
+static constexpr uint32_t PROPERTY_SEED = property_seed();
+static_assert(PROPERTY_SEED != UINT32_MAX, "no perfect hash seed for the property names");
+
+struct PropertySlots {
+  int8_t index[PROPERTY_SLOTS];
+};
+
+static constexpr PropertySlots property_slots() {
+  PropertySlots slots = {};
+  for (size_t i = 0; i < PROPERTY_SLOTS; i++) {
+    slots.index[i] = -1;
+  }
+  for (size_t i = 0; i < PROPERTY_COUNT; i++) {
+    slots.index[property_hash(properties[i].name, PROPERTY_SEED)] = i;
+  }
+  return slots;
+}
+
+static constexpr PropertySlots slots = property_slots();
+
+const CameraProperty *camera_property_find(const char *name) {
+  int8_t index = slots.index[property_hash(name, PROPERTY_SEED)];
+  if (index < 0 || strcmp(properties[index].name, name)) {
+    return nullptr;
+  }
+  return &properties[index];
+}
+
+int camera_property_set(sensor_t *s, const char *name, int value) {
+  const CameraProperty *p = camera_property_find(name);
+  if (!p || !p->set) {
+    log_i("Unknown command: %s", name);
+    return -1;
+  }
+  if (value < p->min || value > p->max) {
+    log_i("%s out of range: %d", name, value);
+    return -1;
+  }
+  return p->set(s, value);
+}
+
+namespace {
+// Writes up to len bytes and counts everything, so the same pass sizes the output.
+class StatusWriter {
+public:
+  StatusWriter(uint8_t *buf, size_t len) : _buf(buf), _len(len) {}
+
+  void write(const void *data, size_t n) {
+    if (_pos < _len) {
+      memcpy(_buf + _pos, data, std::min(n, _len - _pos));
+    }
+    _pos += n;
+  }
+  void write(uint8_t c) {
+    write(&c, 1);
+  }
+  size_t size() const {
+    return _pos;
+  }
+
+  void jsonMember(const char *key, int value) {
+    char text[48];
+    write(text, snprintf(text, sizeof(text), "%s\"%s\":%d", _pos > 1 ? "," : "", key, value));
+  }
+
+  void msgpackMapHeader(uint16_t count) {
+    if (count < 16) {
+      write(0x80 | count);
+    } else {
+      uint8_t h[] = {0xde, (uint8_t)(count >> 8), (uint8_t)count};
+      write(h, sizeof(h));
+    }
+  }
+  void msgpackString(const char *s) {
+    size_t n = strlen(s);
+    if (n < 32) {
+      write(0xa0 | n);
+    } else {
+      uint8_t h[] = {0xd9, (uint8_t)n};
+      write(h, sizeof(h));
+    }
+    write(s, n);
+  }
+  void msgpackInt(int32_t v) {
+    if (v >= 0 && v < 128) {
+      write(v);
+    } else if (v < 0 && v >= -32) {
+      write((uint8_t)(int8_t)v);
+    } else if (v >= INT16_MIN && v <= INT16_MAX) {
+      uint8_t h[] = {0xd1, (uint8_t)(v >> 8), (uint8_t)v};
+      write(h, sizeof(h));
+    } else {
+      uint8_t h[] = {0xd2, (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v};
+      write(h, sizeof(h));
+    }
+  }
+
+private:
+  uint8_t *_buf;
+  size_t _len;
+  size_t _pos = 0;
+};
+}  // namespace
+
+size_t camera_status_serialize(sensor_t *s, status_format_t format, uint8_t *buf, size_t len) {
+  StatusWriter out(buf, len);
+  char key[8];
+
+  if (format == STATUS_MSGPACK) {
+    out.msgpackMapHeader(registerShadow.size() + PROPERTY_COUNT);
+    for (size_t i = 0; i < registerShadow.size(); i++) {
+      snprintf(key, sizeof(key), "0x%x", registerShadow.reg(i));
+      out.msgpackString(key);
+      out.msgpackInt(registerShadow.value(i));
+    }
+    for (const CameraProperty &p : properties) {
+      out.msgpackString(p.name);
+      out.msgpackInt(p.get(s));
+    }
+  } else {
+    out.write('{');
+    for (size_t i = 0; i < registerShadow.size(); i++) {
+      snprintf(key, sizeof(key), "0x%x", registerShadow.reg(i));
+      out.jsonMember(key, registerShadow.value(i));
+    }
+    for (const CameraProperty &p : properties) {
+      out.jsonMember(p.name, p.get(s));
+    }
+    out.write('}');
+  }
+  return out.size();
+}
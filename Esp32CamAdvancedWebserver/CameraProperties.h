@@ -0,0 +1,43 @@
+#ifndef CAMERA_PROPERTIES_H
+#define CAMERA_PROPERTIES_H
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+typedef enum {
+  PROP_INT,
+  PROP_BOOL,
+  PROP_ENUM,  // index into a sensor table (framesize, wb_mode, ...)
+} camera_prop_type_t;
+
+// One camera setting as seen by /cam/control and /cam/status. Read-only
+// properties have no setter.
+struct CameraProperty {
+  const char *name;
+  camera_prop_type_t type;
+  int16_t min;
+  int16_t max;
+  int (*set)(sensor_t *s, int value);  // 0 on success, like the sensor setters
+  int (*get)(sensor_t *s);
+  bool local = false;  // a setting of this firmware, the setter writes no sensor register
+};
+
+typedef enum {
+  STATUS_JSON,
+  STATUS_MSGPACK,
+} status_format_t;
+
+// Looks a property up by name through a perfect hash, nullptr if unknown.
+const CameraProperty *camera_property_find(const char *name);
+
+// Checks the range and applies the value. Returns 0 on success and a negative
+// value for unknown or read-only properties, values out of range and values
+// the sensor rejected.
+int camera_property_set(sensor_t *s, const char *name, int value);
+
+// Serializes the shadowed registers and all properties as one JSON object or
+// MessagePack map. Writes at most len bytes and returns the full size, call
+// with buf = nullptr to size the buffer.
+size_t camera_status_serialize(sensor_t *s, status_format_t format, uint8_t *buf, size_t len);
+
+#endif
@@ -0,0 +1,119 @@
+#include "CameraSimulator.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <algorithm>
+
+CameraSimulator cameraSimulator;
+
+CameraSimulator::~CameraSimulator() {
+  for (Clip &clip : _clips) {
+    free(clip.data);
+  }
+  if (_free) {
+    vSemaphoreDelete(_free);
+  }
+}
+
+bool CameraSimulator::begin(fs::FS &fs, const char *dir, uint8_t fps, size_t fbCount) {
+  File root = fs.open(dir);
+  if (!root || !root.isDirectory()) {
+    log_w("No frames to simulate in %s", dir);
+    return false;
+  }
+  std::vector<String> names;
+  for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+    String name = file.name();
+    if (!file.isDirectory() && (name.endsWith(".jpg") || name.endsWith(".jpeg"))) {
+      names.push_back(String(dir) + "/" + name);
+    }
+  }
+  std::sort(names.begin(), names.end());
+
+  for (const String &name : names) {
+    if (_clips.size() >= CAMERA_SIM_MAX_FRAMES) {
+      break;
+    }
+    File file = fs.open(name);
+    size_t len = file.size();
+    uint8_t *data = (uint8_t *)heap_caps_malloc(len, MALLOC_CAP_SPIRAM);
+    if (!data) {
+      log_w("PSRAM full, simulating %u frames", (unsigned)_clips.size());
+      break;
+    }
+    Clip clip = {data, len, 0, 0};
+    if (file.read(data, len) != len || !_jpegSize(data, len, clip.width, clip.height)) {
+      log_w("Skipping %s", name.c_str());
+      free(data);
+      continue;
+    }
+    _clips.push_back(clip);
+  }
+  if (_clips.empty()) {
+    log_w("No frames to simulate in %s", dir);
+    return false;
+  }
+
+  fbCount = fbCount ? fbCount : 1;
+  _fbs.assign(fbCount, camera_fb_t());
+  _used.assign(fbCount, false);
+  _free = xSemaphoreCreateCounting(fbCount, fbCount);
+  setFps(fps);
+  log_i("Simulating camera with %u frames from %s at %u fps", (unsigned)_clips.size(), dir, fps);
+  return true;
+}
+
+camera_fb_t *CameraSimulator::get() {
+  // Like the driver: wait for a returned buffer, then for the next frame
+  if (xSemaphoreTake(_free, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    return nullptr;
+  }
+  int64_t now = esp_timer_get_time();
+  if (_due > now) {
+    vTaskDelay(pdMS_TO_TICKS((_due - now + 999) / 1000));
+    now = esp_timer_get_time();
+  }
+  _due = std::max(_due + _interval, now);
+
+  std::lock_guard<std::mutex> lock(_lock);
+  size_t i = std::find(_used.begin(), _used.end(), false) - _used.begin();
+  _used[i] = true;
+
+  const Clip &clip = _clips[_next];
+  _next = (_next + 1) % _clips.size();
+  camera_fb_t &fb = _fbs[i];
+  fb.buf = clip.data;
+  fb.len = clip.len;
+  fb.width = clip.width;
+  fb.height = clip.height;
+  fb.format = PIXFORMAT_JPEG;
+  fb.timestamp.tv_sec = now / 1000000;
+  fb.timestamp.tv_usec = now % 1000000;
+  return &fb;
+}
+
+void CameraSimulator::put(camera_fb_t *fb) {
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    _used[fb - _fbs.data()] = false;
+  }
+  xSemaphoreGive(_free);
+}
+
+// Size from the start of frame segment
+bool CameraSimulator::_jpegSize(const uint8_t *data, size_t len, uint16_t &width, uint16_t &height) {
+  if (len < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+    return false;
+  }
+  size_t pos = 2;
+  while (pos + 9 <= len && data[pos] == 0xFF) {
+    uint8_t marker = data[pos + 1];
+    size_t segment = (data[pos + 2] << 8) | data[pos + 3];
+    if (marker >= 0xC0 && marker <= 0xC2) {
+      height = (data[pos + 5] << 8) | data[pos + 6];
+      width = (data[pos + 7] << 8) | data[pos + 8];
+      return width && height;
+    }
+    pos += 2 + segment;
+  }
+  return false;
+}
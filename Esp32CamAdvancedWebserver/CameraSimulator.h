@@ -0,0 +1,73 @@
+#ifndef CAMERA_SIMULATOR_H
+#define CAMERA_SIMULATOR_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "esp_camera.h"
+
+// Build with -DCAMERA_SIMULATOR to stream recorded frames instead of the
+// sensor. The JPEG files in CAMERA_SIM_DIR on the SD card are replayed in
+// name order at CAMERA_SIM_FPS, the frame size is the size of the files, so
+// a directory per resolution gives repeatable streaming benchmarks without
+// depending on light and scene. The sensor is still initialised, settings
+// are accepted but do not change the frames.
+#ifndef CAMERA_SIM_DIR
+#define CAMERA_SIM_DIR "/sim"
+#endif
+#ifndef CAMERA_SIM_FPS
+#define CAMERA_SIM_FPS 25
+#endif
+// Files are preloaded into PSRAM, later ones are ignored
+#ifndef CAMERA_SIM_MAX_FRAMES
+#define CAMERA_SIM_MAX_FRAMES 100
+#endif
+
+// Stand-in for esp_camera_fb_get() / esp_camera_fb_return(). Hands out at
+// most fbCount frame buffers like the driver, get() blocks until one is
+// returned and until the next frame is due.
+class CameraSimulator {
+public:
+  ~CameraSimulator();
+
+  // false if the directory holds no usable JPEG, the sensor is used then
+  bool begin(fs::FS &fs, const char *dir, uint8_t fps, size_t fbCount);
+
+  bool active() const {
+    return !_clips.empty();
+  }
+
+  // Replay rate, e.g. from a host benchmark after camera_cfg()
+  void setFps(uint8_t fps) {
+    _interval = 1000000 / (fps ? fps : 1);
+  }
+
+  camera_fb_t *get();
+  void put(camera_fb_t *fb);
+
+private:
+  struct Clip {
+    uint8_t *data;
+    size_t len;
+    uint16_t width;
+    uint16_t height;
+  };
+
+  static bool _jpegSize(const uint8_t *data, size_t len, uint16_t &width, uint16_t &height);
+
+  std::vector<Clip> _clips;
+  std::vector<camera_fb_t> _fbs;
+  std::vector<bool> _used;
+  size_t _next = 0;
+  std::atomic<int64_t> _interval{0};  // us
+  int64_t _due = 0;
+
+  std::mutex _lock;
+  SemaphoreHandle_t _free = nullptr;  // counts returned buffers
+};
+
+extern CameraSimulator cameraSimulator;
+
+#endif
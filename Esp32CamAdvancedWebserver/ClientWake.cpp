@@ -0,0 +1,23 @@
+#include "ClientWake.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcp_priv.h"
+
+// Runs on the tcpip thread, where pcbs may be looked at. AsyncTCP's poll
+// callback queues a poll event for async_tcp like the periodic lwIP poll.
+static void _wake(void *arg) {
+  for (struct tcp_pcb *pcb = tcp_active_pcbs; pcb; pcb = pcb->next) {
+    if (pcb == arg) {
+      if (pcb->poll) {
+        pcb->poll(pcb->callback_arg, pcb);
+      }
+      return;
+    }
+  }
+}
+
+void async_client_wake(AsyncClient *client) {
+  struct tcp_pcb *pcb = client->pcb();
+  if (pcb) {
+    tcpip_try_callback(_wake, pcb);
+  }
+}
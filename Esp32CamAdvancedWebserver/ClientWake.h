@@ -0,0 +1,13 @@
+#ifndef CLIENT_WAKE_H
+#define CLIENT_WAKE_H
+
+#include <AsyncTCP.h>
+
+// Makes async_tcp run the client's poll handler soon, which for a web
+// request calls _ack() on its response. For tasks that have new data for a
+// response but must not write to the AsyncClient themselves. Never blocks,
+// a wake for a client that has disconnected in the meantime is ignored.
+// The client object itself must still exist when this is called.
+void async_client_wake(AsyncClient *client);
+
+#endif
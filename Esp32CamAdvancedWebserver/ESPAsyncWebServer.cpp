@@ -20,6 +20,7 @@ bool ON_STA_FILTER(AsyncWebServerRequest *request) {
 #if SOC_WIFI_SUPPORTED || CONFIG_ESP_WIFI_REMOTE_ENABLED || LT_ARD_HAS_WIFI
   return WiFi.localIP() == request->client()->localIP();
 #else
+  (void)request;
   return false;
 #endif
 }
@@ -28,6 +29,7 @@ bool ON_AP_FILTER(AsyncWebServerRequest *request) {
 #if SOC_WIFI_SUPPORTED || CONFIG_ESP_WIFI_REMOTE_ENABLED || LT_ARD_HAS_WIFI
   return WiFi.localIP() != request->client()->localIP();
 #else
+  (void)request;
   return false;
 #endif
 }
@@ -45,7 +47,7 @@ AsyncWebServer::AsyncWebServer(uint16_t port) : _server(port) {
       if (c == NULL) {
         return;
       }
-      c->setRxTimeout(3);
+      c->setRxTimeout(ASYNCWEBSERVER_RX_TIMEOUT);
       AsyncWebServerRequest *r = new AsyncWebServerRequest((AsyncWebServer *)s, c);
       if (r == NULL) {
         c->abort();
@@ -94,6 +96,7 @@ AsyncWebRewrite &AsyncWebServer::rewrite(const char *from, const char *to) {
 
 AsyncWebHandler &AsyncWebServer::addHandler(AsyncWebHandler *handler) {
   _handlers.emplace_back(handler);
+  _routesDirty = true;
   return *(_handlers.back().get());
 }
 
@@ -101,6 +104,7 @@ bool AsyncWebServer::removeHandler(AsyncWebHandler *handler) {
   for (auto i = _handlers.begin(); i != _handlers.end(); ++i) {
     if (i->get() == handler) {
       _handlers.erase(i);
+      _routesDirty = true;
       return true;
     }
   }
@@ -108,6 +112,7 @@ bool AsyncWebServer::removeHandler(AsyncWebHandler *handler) {
 }
 
 void AsyncWebServer::begin() {
+  _compileRoutes();
   _server.setNoDelay(true);
   _server.begin();
 }
@@ -136,15 +141,164 @@ void AsyncWebServer::_rewriteRequest(AsyncWebServerRequest *request) {
   for (const auto &r : _rewrites) {
     if (r->match(request)) {
       request->_url = r->toUrl();
+      request->_urlBuilt = true;
       request->_addGetParams(r->params());
     }
   }
 }
 
-void AsyncWebServer::_attachHandler(AsyncWebServerRequest *request) {
+void AsyncWebServer::_compileRoutes() {
+  _routeNodes.clear();
+  _routes.clear();
+  _routeText.clear();
+  _unroutedHandlers.clear();
+  _routeNodes.push_back({0, 0, 0, 0, -1, -1});  // root, empty label
+
+  uint16_t order = 0;
   for (auto &h : _handlers) {
+    AsyncCallbackWebHandler *handler = h->_routable();
+    const String *uri = handler ? &handler->_uri : nullptr;
+#ifdef ASYNCWEBSERVER_REGEX
+    if (handler && handler->_isRegex) {
+      uri = nullptr;
+    }
+#endif
+    if (!uri || uri->startsWith("/*.")) {
+      _unroutedHandlers.push_back(h.get());
+    } else if (!handler->_template.empty()) {
+      // Filed under its literal head, the rest is checked by _bestRoute()
+      const AsyncCallbackWebHandler::PathPart &head = handler->_template.front();
+      uint16_t node = head.type == AsyncCallbackWebHandler::PATH_LITERAL ? _insertRoute(uri->c_str(), head.len) : 0;
+      _addRoute(_routeNodes[node].prefix, handler, order);
+    } else if (uri->endsWith("*")) {
+      uint16_t node = _insertRoute(uri->c_str(), uri->length() - 1);
+      _addRoute(_routeNodes[node].prefix, handler, order);
+    } else if (!uri->length()) {
+      _addRoute(_routeNodes[0].prefix, handler, order);  // matches everything
+    } else {
+      uint16_t node = _insertRoute(uri->c_str(), uri->length());
+      _addRoute(_routeNodes[node].exact, handler, order);
+    }
+    order++;
+  }
+  _routesDirty = false;
+}
+
+// Returns the node the path ends at, splitting an edge if it ends inside one
+uint16_t AsyncWebServer::_insertRoute(const char *uri, size_t len) {
+  uint16_t node = 0;
+  size_t pos = 0;
+  while (pos < len) {
+    uint16_t child = _routeNodes[node].child;
+    while (child && _routeText[_routeNodes[child].label] != uri[pos]) {
+      child = _routeNodes[child].sibling;
+    }
+
+    if (!child) {
+      RouteNode leaf = {(uint16_t)_routeText.size(), (uint16_t)(len - pos), 0, _routeNodes[node].child, -1, -1};
+      _routeText.insert(_routeText.end(), uri + pos, uri + len);
+      _routeNodes.push_back(leaf);
+      _routeNodes[node].child = _routeNodes.size() - 1;
+      return _routeNodes.size() - 1;
+    }
+
+    uint16_t common = 0;
+    while (common < _routeNodes[child].labelLen && pos + common < len && _routeText[_routeNodes[child].label + common] == uri[pos + common]) {
+      common++;
+    }
+    if (common < _routeNodes[child].labelLen) {
+      // The tail of the edge moves to a new node below it
+      RouteNode tail = _routeNodes[child];
+      tail.label += common;
+      tail.labelLen -= common;
+      tail.sibling = 0;
+      _routeNodes.push_back(tail);
+
+      RouteNode &head = _routeNodes[child];
+      head.labelLen = common;
+      head.child = _routeNodes.size() - 1;
+      head.exact = -1;
+      head.prefix = -1;
+    }
+    node = child;
+    pos += common;
+  }
+  return node;
+}
+
+void AsyncWebServer::_addRoute(int16_t &list, AsyncCallbackWebHandler *handler, uint16_t order) {
+  _routes.push_back({handler, order, -1});
+  int16_t *tail = &list;
+  while (*tail >= 0) {
+    tail = &_routes[*tail].next;
+  }
+  *tail = _routes.size() - 1;
+}
+
+// First route of the list that takes the request and was registered before best
+const AsyncWebServer::Route *AsyncWebServer::_bestRoute(int16_t list, AsyncWebServerRequest *request, const Route *best) {
+  for (; list >= 0; list = _routes[list].next) {
+    const Route &route = _routes[list];
+    if (best && route.order > best->order) {
+      break;
+    }
+    AsyncCallbackWebHandler *h = route.handler;
+    if (h->_onRequest && request->isHTTP() && (h->_method & request->method()) && (h->_template.empty() || h->_matchTemplate(request, false))
+        && h->filter(request)) {
+      return &route;
+    }
+  }
+  return best;
+}
+
+// One walk along the URL. A plain URI matches the URL itself and everything
+// below it ("/a" takes "/a" and "/a/b", not "/ab"), a '*' URI every URL it
+// is a prefix of.
+AsyncCallbackWebHandler *AsyncWebServer::_matchRoute(AsyncWebServerRequest *request) {
+  const char *url = request->urlData();
+  size_t len = request->urlLength();
+  const Route *best = nullptr;
+
+  uint16_t node = 0;
+  size_t pos = 0;
+  for (;;) {
+    const RouteNode &n = _routeNodes[node];
+    best = _bestRoute(n.prefix, request, best);
+    if (pos == len || url[pos] == '/') {
+      best = _bestRoute(n.exact, request, best);
+    }
+    if (pos == len) {
+      break;
+    }
+
+    uint16_t child = n.child;
+    while (child && _routeText[_routeNodes[child].label] != url[pos]) {
+      child = _routeNodes[child].sibling;
+    }
+    if (!child || len - pos < _routeNodes[child].labelLen || memcmp(&_routeText[_routeNodes[child].label], url + pos, _routeNodes[child].labelLen)) {
+      break;
+    }
+    pos += _routeNodes[child].labelLen;
+    node = child;
+  }
+  return best ? best->handler : nullptr;
+}
+
+void AsyncWebServer::_attachHandler(AsyncWebServerRequest *request) {
+  if (_routesDirty) {
+    _compileRoutes();
+  }
+  AsyncCallbackWebHandler *route = _matchRoute(request);
+  if (route) {
+    if (!route->_template.empty()) {
+      route->_matchTemplate(request, true);
+    }
+    request->setHandler(route);
+    return;
+  }
+  for (AsyncWebHandler *h : _unroutedHandlers) {
     if (h->filter(request) && h->canHandle(request)) {
-      request->setHandler(h.get());
+      request->setHandler(h);
       return;
     }
   }
@@ -190,12 +344,25 @@ AsyncWebHandler &AsyncWebServer::catchAllHandler() const {
 void AsyncWebServer::reset() {
   _rewrites.clear();
   _handlers.clear();
+  _routesDirty = true;
 
   _catchAllHandler->onRequest(NULL);
   _catchAllHandler->onUpload(NULL);
   _catchAllHandler->onBody(NULL);
 }
 
+bool AsyncWebServer::_interestingHeader(const char *name) const {
+  if (_interestingHeaders.empty()) {
+    return true;
+  }
+  for (const String &h : _interestingHeaders) {
+    if (h.equalsIgnoreCase(name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // *** WebResponses.cpp ***
 // SPDX-License-Identifier: LGPL-3.0-or-later
 // Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
@@ -445,6 +612,15 @@ bool AsyncWebServerResponse::_failed() const {
 bool AsyncWebServerResponse::_sourceValid() const {
   return false;
 }
+void AsyncWebServerResponse::_setConnection(AsyncWebServerRequest *request) {
+  // The connection outlives the response only if the client can tell where
+  // the body ends without the connection closing
+  const AsyncWebHeader *connection = getHeader(T_Connection);
+  _keepAlive = (_chunked || _sendContentLength) && request->_keepAlive() && !(connection && connection->value().equalsIgnoreCase(T_close));
+  if (!_keepAlive) {
+    addHeader(T_Connection, T_close, false);
+  }
+}
 void AsyncWebServerResponse::_respond(AsyncWebServerRequest *request) {
   _state = RESPONSE_END;
   request->client()->close();
@@ -469,10 +645,10 @@ AsyncBasicResponse::AsyncBasicResponse(int code, const char *contentType, const
       _contentType = T_text_plain;
     }
   }
-  addHeader(T_Connection, T_close, false);
 }
 
 void AsyncBasicResponse::_respond(AsyncWebServerRequest *request) {
+  _setConnection(request);
   _state = RESPONSE_HEADERS;
   String out;
   _assembleHead(out, request->version());
@@ -548,7 +724,7 @@ AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback) : _c
 }
 
 void AsyncAbstractResponse::_respond(AsyncWebServerRequest *request) {
-  addHeader(T_Connection, T_close, false);
+  _setConnection(request);
   _assembleHead(_head, request->version());
   _state = RESPONSE_HEADERS;
   _ack(request, 0, 0);
@@ -652,7 +828,7 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
         free(buf);
         return 0;
       }
-      outLen = sprintf((char *)buf + headLen, "%04x", readLen) + headLen;
+      outLen = sprintf((char *)buf + headLen, "%04x", (unsigned)readLen) + headLen;
       buf[outLen++] = '\r';
       buf[outLen++] = '\n';
       outLen += readLen;
@@ -1183,9 +1359,11 @@ enum {
 
 AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer *s, AsyncClient *c)
   : _client(c), _server(s), _handler(NULL), _response(NULL), _onDisconnectfn(NULL), _temp(), _parseState(PARSE_REQ_START), _version(0), _method(HTTP_ANY),
-    _url(), _host(), _contentType(), _boundary(), _authorization(), _reqconntype(RCT_HTTP), _authMethod(AsyncAuthType::AUTH_NONE), _isMultipart(false),
+    _url(), _host(), _contentType(), _reqconntype(RCT_HTTP), _authMethod(AsyncAuthType::AUTH_NONE), _isMultipart(false),
     _isPlainPost(false), _expectingContinue(false), _contentLength(0), _parsedLength(0), _multiParseState(0), _boundaryPosition(0), _itemStartIndex(0),
     _itemSize(0), _itemName(), _itemFilename(), _itemType(), _itemValue(), _itemBuffer(0), _itemBufferIndex(0), _itemIsFile(false), _tempObject(NULL) {
+  // Kept across keep-alive requests, cleared but not freed by _recycle()
+  _headerSpans.reserve(ASYNCWEBSERVER_HEADERS_RESERVE);
   c->onError(
     [](void *r, AsyncClient *c, int8_t error) {
       (void)c;
@@ -1266,9 +1444,24 @@ AsyncWebServerRequest::~AsyncWebServerRequest() {
   if (_itemBuffer) {
     free(_itemBuffer);
   }
+
+  free(_headBuf);
 }
 
 void AsyncWebServerRequest::_onData(void *buf, size_t len) {
+  if (_parseState == PARSE_REQ_END) {
+    // The next request on a persistent connection usually comes in right
+    // after the ack that finished the response. Pipelining is not supported,
+    // data arriving earlier, also in the segment that ended the request, is
+    // dropped and the connection closed after the response.
+    if (_response && _response->_persistent() && _response->_finished() && !_response->_failed() && !_pipelined) {
+      _recycle();
+    } else {
+      _pipelined = true;
+      return;
+    }
+  }
+
   // SSL/TLS handshake detection
 #ifndef ASYNC_TCP_SSL_ENABLED
   if (_parseState == PARSE_REQ_START && len && ((uint8_t *)buf)[0] == 0x16) {  // 0x16 indicates a Handshake message (SSL/TLS).
@@ -1285,40 +1478,42 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len) {
   while (true) {
 
     if (_parseState < PARSE_REQ_BODY) {
-      // Find new line in buf
-      char *str = (char *)buf;
-      for (i = 0; i < len; i++) {
-        // Check for null characters in header
-        if (!str[i]) {
-          _parseState = PARSE_REQ_FAIL;
-          abort();
-          return;
+      // Up to and including the next new line goes into the head arena
+      const char *str = (const char *)buf;
+      const char *newline = (const char *)memchr(str, '\n', len);
+      i = newline ? newline - str + 1 : len;
+      // Check for null characters in header
+      if (memchr(str, 0, i) || !_appendHead(str, i)) {
+        _parseState = PARSE_REQ_FAIL;
+        abort();
+        return;
+      }
+      if (newline) {
+        uint16_t start = _headLine;
+        char *line = _headBuf + start;
+        size_t lineLen = _headLen - 1 - start;
+        _headLine = _headLen;
+        while (lineLen && isspace((uint8_t)line[lineLen - 1])) {
+          lineLen--;
         }
-        if (str[i] == '\n') {
-          break;
+        while (lineLen && isspace((uint8_t)*line)) {
+          line++;
+          lineLen--;
         }
-      }
-      if (i == len) {  // No new line, just add the buffer in _temp
-        char ch = str[len - 1];
-        str[len - 1] = 0;
-        if (!_temp.reserve(_temp.length() + len)) {
-#ifdef ESP32
-          log_e("Failed to allocate");
-#endif
-          _parseState = PARSE_REQ_FAIL;
-          abort();
-          return;
+        line[lineLen] = 0;
+        if (!lineLen) {
+          // The end of the head, nothing in it to keep. Bytes behind it that
+          // are no body belong to a pipelined request.
+          _headLen = _headLine = start;
+          _pipelined = i < len && !_contentLength;
+        }
+        if (!_parseLine(line, lineLen) && _parseState == PARSE_REQ_HEADERS) {
+          // A header nobody reads, its room is taken by the next line
+          _headLen = _headLine = start;
         }
-        _temp.concat(str);
-        _temp.concat(ch);
-      } else {       // Found new line - extract it and parse
-        str[i] = 0;  // Terminate the string at the end of the line.
-        _temp.concat(str);
-        _temp.trim();
-        _parseLine();
-        if (++i < len) {
+        if (i < len) {
           // Still have more buffer to process
-          buf = str + i;
+          buf = (char *)buf + i;
           len -= i;
           continue;
         }
@@ -1328,7 +1523,10 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len) {
       // If handler does nothing (_onRequest is NULL), we don't need to really parse the body.
       const bool needParse = _handler && !_handler->isRequestHandlerTrivial();
       // Discard any bytes after content length; handlers may overrun their buffers
-      len = std::min(len, _contentLength - _parsedLength);
+      if (len > _contentLength - _parsedLength) {
+        len = _contentLength - _parsedLength;
+        _pipelined = true;
+      }
       if (_isMultipart) {
         if (needParse) {
           size_t i;
@@ -1341,9 +1539,9 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len) {
         }
       } else {
         if (_parsedLength == 0) {
-          if (_contentType.startsWith(T_app_xform_urlencoded)) {
+          if (_spanIs(_contentTypeSpan, T_app_xform_urlencoded, true)) {
             _isPlainPost = true;
-          } else if (_contentType == T_text_plain && __is_param_char(((char *)buf)[0])) {
+          } else if (_spanIs(_contentTypeSpan, T_text_plain) && __is_param_char(((char *)buf)[0])) {
             size_t i = 0;
             while (i < len && __is_param_char(((char *)buf)[i++]));
             if (i < len && ((char *)buf)[i - 1] == '=') {
@@ -1383,11 +1581,7 @@ void AsyncWebServerRequest::_onPoll() {
     if (!_response->_finished()) {
       _response->_ack(this, 0, 0);
     } else {
-      AsyncWebServerResponse *r = _response;
-      _response = NULL;
-      delete r;
-
-      _client->close();
+      _responseDone();
     }
   }
 }
@@ -1398,15 +1592,102 @@ void AsyncWebServerRequest::_onAck(size_t len, uint32_t time) {
     if (!_response->_finished()) {
       _response->_ack(this, len, time);
     } else if (_response->_finished()) {
-      AsyncWebServerResponse *r = _response;
-      _response = NULL;
-      delete r;
-
-      _client->close();
+      _responseDone();
     }
   }
 }
 
+void AsyncWebServerRequest::_responseDone() {
+  if (_response->_persistent() && !_response->_failed() && !_pipelined) {
+    _recycle();
+    return;
+  }
+  AsyncWebServerResponse *r = _response;
+  _response = NULL;
+  delete r;
+
+  _client->close();
+}
+
+bool AsyncWebServerRequest::_keepAlive() const {
+  return _version == 1 && !_closeRequested && !_pipelined && _parseState == PARSE_REQ_END && _method != HTTP_HEAD && isHTTP()
+         && _served + 1 < ASYNCWEBSERVER_KEEPALIVE_MAX;
+}
+
+// Resets the request for the next one on the same connection. The client
+// callbacks stay bound to this object, so neither is allocated again.
+void AsyncWebServerRequest::_recycle() {
+  AsyncWebServerResponse *r = _response;
+  _response = NULL;
+  delete r;
+
+  // pause() observers of the finished request must not see the next one
+  _this.reset();
+  _sent = false;
+  _paused = false;
+  _handler = NULL;
+  _onDisconnectfn = NULL;
+
+  _temp = emptyString;
+  // The head buffer stays for the next request
+  _headLen = 0;
+  _headLine = 0;
+  _parseState = PARSE_REQ_START;
+  _version = 0;
+  _method = HTTP_ANY;
+  _urlSpan = {0, 0};
+  _url = emptyString;
+  _urlBuilt = false;
+  _host = emptyString;
+  _contentType = emptyString;
+  _contentTypeSpan = {0, 0};
+  _boundary = {0, 0};
+  _authorization = {0, 0};
+  _reqconntype = RCT_HTTP;
+  _authMethod = AsyncAuthType::AUTH_NONE;
+  _isMultipart = false;
+  _isPlainPost = false;
+  _expectingContinue = false;
+  _contentLength = 0;
+  _parsedLength = 0;
+  _closeRequested = false;
+
+  _headerSpans.clear();
+  _headers.clear();
+  _query.clear();
+  _params.clear();
+  _pathParams.clear();
+  _pathViewCount = 0;
+  _attributes.clear();
+
+  _multiParseState = 0;
+  _boundaryPosition = 0;
+  _itemStartIndex = 0;
+  _itemSize = 0;
+  _itemName = emptyString;
+  _itemFilename = emptyString;
+  _itemType = emptyString;
+  _itemValue = emptyString;
+  if (_itemBuffer) {
+    free(_itemBuffer);
+    _itemBuffer = NULL;
+  }
+  _itemBufferIndex = 0;
+  _itemIsFile = false;
+
+  if (_tempObject != NULL) {
+    free(_tempObject);
+    _tempObject = NULL;
+  }
+  if (_tempFile) {
+    _tempFile.close();
+  }
+
+  _served++;
+  // Like a new connection, which gets no longer to send its request
+  _client->setRxTimeout(ASYNCWEBSERVER_RX_TIMEOUT);
+}
+
 void AsyncWebServerRequest::_onError(int8_t error) {
   (void)error;
 }
@@ -1434,148 +1715,209 @@ void AsyncWebServerRequest::_addPathParam(const char *p) {
 }
 
 void AsyncWebServerRequest::_addGetParams(const String &params) {
-  size_t start = 0;
-  while (start < params.length()) {
-    int end = params.indexOf('&', start);
-    if (end < 0) {
-      end = params.length();
-    }
-    int equal = params.indexOf('=', start);
-    if (equal < 0 || equal > end) {
-      equal = end;
-    }
-    String name = urlDecode(params.substring(start, equal));
-    String value = urlDecode(equal + 1 < end ? params.substring(equal + 1, end) : emptyString);
+  const char *p = params.c_str();
+  const char *end = p + params.length();
+  while (p < end) {
+    const char *next = (const char *)memchr(p, '&', end - p);
+    if (!next) {
+      next = end;
+    }
+    const char *equal = (const char *)memchr(p, '=', next - p);
+    if (!equal) {
+      equal = next;
+    }
+    String name = _urlDecode(p, equal - p);
     if (name.length()) {
-      _params.emplace_back(name, value);
-    }
-    start = end + 1;
-  }
-}
-
-bool AsyncWebServerRequest::_parseReqHead() {
-  // Split the head into method, url and version
-  int index = _temp.indexOf(' ');
-  String m = _temp.substring(0, index);
-  index = _temp.indexOf(' ', index + 1);
-  String u = _temp.substring(m.length() + 1, index);
-  _temp = _temp.substring(index + 1);
-
-  if (m == T_GET) {
-    _method = HTTP_GET;
-  } else if (m == T_POST) {
-    _method = HTTP_POST;
-  } else if (m == T_DELETE) {
-    _method = HTTP_DELETE;
-  } else if (m == T_PUT) {
-    _method = HTTP_PUT;
-  } else if (m == T_PATCH) {
-    _method = HTTP_PATCH;
-  } else if (m == T_HEAD) {
-    _method = HTTP_HEAD;
-  } else if (m == T_OPTIONS) {
-    _method = HTTP_OPTIONS;
-  } else if (m == T_PROPFIND) {
-    _method = HTTP_PROPFIND;
-  } else if (m == T_LOCK) {
-    _method = HTTP_LOCK;
-  } else if (m == T_UNLOCK) {
-    _method = HTTP_UNLOCK;
-  } else if (m == T_PROPPATCH) {
-    _method = HTTP_PROPPATCH;
-  } else if (m == T_MKCOL) {
-    _method = HTTP_MKCOL;
-  } else if (m == T_MOVE) {
-    _method = HTTP_MOVE;
-  } else if (m == T_COPY) {
-    _method = HTTP_COPY;
-  } else if (m == T_RESERVED) {
-    _method = HTTP_RESERVED;
-  } else {
+      _params.emplace_back(name, equal < next ? _urlDecode(equal + 1, next - equal - 1) : emptyString);
+    }
+    p = next + 1;
+  }
+}
+
+// Each name and value is decoded in place and NUL terminated
+void AsyncWebServerRequest::_parseQuery(char *query, size_t len) {
+  char *end = query + len;
+  while (query < end) {
+    char *next = (char *)memchr(query, '&', end - query);
+    if (!next) {
+      next = end;
+    }
+    char *equal = (char *)memchr(query, '=', next - query);
+    if (!equal) {
+      equal = next;
+    }
+    char *value = equal < next ? equal + 1 : next;
+    size_t nameLen = _urlDecodeInPlace(query, equal - query);
+    size_t valueLen = _urlDecodeInPlace(value, next - value);
+    if (nameLen) {
+      query[nameLen] = 0;
+      value[valueLen] = 0;
+      _query.push_back({_span(query, nameLen), _span(value, valueLen)});
+    }
+    query = next + 1;
+  }
+}
+
+bool AsyncWebServerRequest::_appendHead(const char *data, size_t len) {
+  if (_headSize < ASYNCWEBSERVER_HEAD_SIZE) {
+    char *head = (char *)realloc(_headBuf, ASYNCWEBSERVER_HEAD_SIZE);
+    if (!head) {
+#ifdef ESP32
+      log_e("Failed to allocate");
+#endif
+      return false;
+    }
+    _headBuf = head;
+    _headSize = ASYNCWEBSERVER_HEAD_SIZE;
+  }
+  if (len > (size_t)ASYNCWEBSERVER_HEAD_SIZE - _headLen) {
+#ifdef ESP32
+    log_w("Request head exceeds %u bytes", ASYNCWEBSERVER_HEAD_SIZE);
+#endif
     return false;
   }
+  memcpy(_headBuf + _headLen, data, len);
+  _headLen += len;
+  return true;
+}
 
-  String g;
-  index = u.indexOf('?');
-  if (index > 0) {
-    g = u.substring(index + 1);
-    u = u.substring(0, index);
+// The spans are offsets, they stay valid when the buffer moves
+void AsyncWebServerRequest::_shrinkHead() {
+  if (!_headLen || _headLen == _headSize) {
+    return;
+  }
+  char *head = (char *)realloc(_headBuf, _headLen);
+  if (head) {
+    _headBuf = head;
+    _headSize = _headLen;
   }
-  _url = urlDecode(u);
-  _addGetParams(g);
+}
+
+bool AsyncWebServerRequest::_parseReqHead(char *line, size_t len) {
+  static const struct {
+    const char *name;
+    WebRequestMethodComposite method;
+  } methods[] = {
+    {T_GET, HTTP_GET},         {T_POST, HTTP_POST},         {T_DELETE, HTTP_DELETE},     {T_PUT, HTTP_PUT},   {T_PATCH, HTTP_PATCH},
+    {T_HEAD, HTTP_HEAD},       {T_OPTIONS, HTTP_OPTIONS},   {T_PROPFIND, HTTP_PROPFIND}, {T_LOCK, HTTP_LOCK}, {T_UNLOCK, HTTP_UNLOCK},
+    {T_PROPPATCH, HTTP_PROPPATCH}, {T_MKCOL, HTTP_MKCOL},   {T_MOVE, HTTP_MOVE},         {T_COPY, HTTP_COPY}, {T_RESERVED, HTTP_RESERVED},
+  };
 
-  if (!_url.length()) {
+  // Split the head into method, url and version spans
+  char *end = line + len;
+  char *url = (char *)memchr(line, ' ', len);
+  if (!url) {
     return false;
   }
+  size_t methodLen = url++ - line;
+  char *version = (char *)memchr(url, ' ', end - url);
+  size_t urlLen = (version ? version : end) - url;
+  version = version ? version + 1 : end;
 
-  if (!_temp.startsWith(T_HTTP_1_0)) {
+  bool known = false;
+  for (const auto &m : methods) {
+    if (strlen(m.name) == methodLen && !memcmp(line, m.name, methodLen)) {
+      _method = m.method;
+      known = true;
+      break;
+    }
+  }
+  if (!known) {
+    return false;
+  }
+  if (strncmp(version, T_HTTP_1_0, strlen(T_HTTP_1_0))) {
     _version = 1;
   }
 
-  _temp = emptyString;
-  return true;
+  // Decoding never makes the text longer, the URL and the parameters are
+  // decoded where they are
+  char *query = (char *)memchr(url, '?', urlLen);
+  if (query == url) {
+    query = nullptr;
+  }
+  if (query) {
+    _parseQuery(query + 1, url + urlLen - query - 1);
+  }
+  size_t decoded = _urlDecodeInPlace(url, query ? query - url : urlLen);
+  url[decoded] = 0;
+  _urlSpan = _span(url, decoded);
+  return decoded != 0;
 }
 
-bool AsyncWebServerRequest::_parseReqHeader() {
-  AsyncWebHeader header = AsyncWebHeader::parse(_temp);
-  if (header) {
-    const String &name = header.name();
-    const String &value = header.value();
-    if (name.equalsIgnoreCase(T_Host)) {
-      _host = value;
-    } else if (name.equalsIgnoreCase(T_Content_Type)) {
-      _contentType = value.substring(0, value.indexOf(';'));
-      if (value.startsWith(T_MULTIPART_)) {
-        _boundary = value.substring(value.indexOf('=') + 1);
-        _boundary.replace(String('"'), String());
-        _isMultipart = true;
+// False for a header that is not kept
+bool AsyncWebServerRequest::_parseReqHeader(char *line, size_t len) {
+  char *colon = (char *)memchr(line, ':', len);
+  if (!colon || colon == line) {
+    return false;
+  }
+  *colon = 0;
+  char *value = colon + 1;
+  while (*value == ' ' || *value == '\t') {
+    value++;
+  }
+  size_t valueLen = line + len - value;
+  AsyncWebHeader::Id id = AsyncWebHeader::intern(line, colon - line);
+  if (id == AsyncWebHeader::Id::Unknown && !_server->_interestingHeader(line)) {
+    return false;
+  }
+
+  if (id == AsyncWebHeader::Id::ContentType) {
+    const char *semicolon = (const char *)memchr(value, ';', valueLen);
+    _contentTypeSpan = _span(value, semicolon ? semicolon - value : valueLen);
+    if (!strncmp(value, T_MULTIPART_, strlen(T_MULTIPART_))) {
+      const char *equal = (const char *)memchr(value, '=', valueLen);
+      const char *boundary = equal ? equal + 1 : value;
+      const char *boundaryEnd = value + valueLen;
+      while (boundary < boundaryEnd && *boundary == '"') {
+        boundary++;
       }
-    } else if (name.equalsIgnoreCase(T_Content_Length)) {
-      _contentLength = atoi(value.c_str());
-    } else if (name.equalsIgnoreCase(T_EXPECT) && value.equalsIgnoreCase(T_100_CONTINUE)) {
-      _expectingContinue = true;
-    } else if (name.equalsIgnoreCase(T_AUTH)) {
-      int space = value.indexOf(' ');
-      if (space == -1) {
-        _authorization = value;
-        _authMethod = AsyncAuthType::AUTH_OTHER;
+      while (boundaryEnd > boundary && boundaryEnd[-1] == '"') {
+        boundaryEnd--;
+      }
+      _boundary = _span(boundary, boundaryEnd - boundary);
+      _isMultipart = true;
+    }
+  } else if (id == AsyncWebHeader::Id::ContentLength) {
+    _contentLength = atoi(value);
+  } else if (id == AsyncWebHeader::Id::Expect && !strcasecmp(value, T_100_CONTINUE)) {
+    _expectingContinue = true;
+  } else if (id == AsyncWebHeader::Id::Authorization) {
+    const char *space = (const char *)memchr(value, ' ', valueLen);
+    if (!space) {
+      _authorization = _span(value, valueLen);
+      _authMethod = AsyncAuthType::AUTH_OTHER;
+    } else {
+      size_t schemeLen = space - value;
+      auto scheme = [value, schemeLen](const char *name) {
+        return strlen(name) == schemeLen && !strncasecmp(value, name, schemeLen);
+      };
+      if (scheme(T_BASIC)) {
+        _authMethod = AsyncAuthType::AUTH_BASIC;
+      } else if (scheme(T_DIGEST)) {
+        _authMethod = AsyncAuthType::AUTH_DIGEST;
+      } else if (scheme(T_BEARER)) {
+        _authMethod = AsyncAuthType::AUTH_BEARER;
       } else {
-        String method = value.substring(0, space);
-        if (method.equalsIgnoreCase(T_BASIC)) {
-          _authMethod = AsyncAuthType::AUTH_BASIC;
-        } else if (method.equalsIgnoreCase(T_DIGEST)) {
-          _authMethod = AsyncAuthType::AUTH_DIGEST;
-        } else if (method.equalsIgnoreCase(T_BEARER)) {
-          _authMethod = AsyncAuthType::AUTH_BEARER;
-        } else {
-          _authMethod = AsyncAuthType::AUTH_OTHER;
-        }
-        _authorization = value.substring(space + 1);
+        _authMethod = AsyncAuthType::AUTH_OTHER;
       }
-    } else if (name.equalsIgnoreCase(T_UPGRADE) && value.equalsIgnoreCase(T_WS)) {
-      // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
-      _reqconntype = RCT_WS;
-    } else if (name.equalsIgnoreCase(T_ACCEPT)) {
-      String lowcase(value);
-      lowcase.toLowerCase();
-#ifndef ESP8266
-      const char *substr = strstr(lowcase.c_str(), T_text_event_stream);
-#else
-      const char *substr = std::strstr(lowcase.c_str(), String(T_text_event_stream).c_str());
-#endif
-      if (substr != NULL) {
+      _authorization = _span(space + 1, value + valueLen - space - 1);
+    }
+  } else if (id == AsyncWebHeader::Id::Connection && !strcasecmp(value, T_close)) {
+    _closeRequested = true;
+  } else if (id == AsyncWebHeader::Id::Upgrade && !strcasecmp(value, T_WS)) {
+    // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
+    _reqconntype = RCT_WS;
+  } else if (id == AsyncWebHeader::Id::Accept) {
+    size_t n = strlen(T_text_event_stream);
+    for (const char *p = value; (size_t)(value + valueLen - p) >= n; p++) {
+      if (!strncasecmp(p, T_text_event_stream, n)) {
         // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
         _reqconntype = RCT_EVENT;
+        break;
       }
     }
-    _headers.emplace_back(std::move(header));
   }
-#if defined(TARGET_RP2040) || defined(TARGET_RP2350) || defined(PICO_RP2040) || defined(PICO_RP2350) || defined(LIBRETINY)
-  // Ancient PRI core does not have String::clear() method 8-()
-  _temp = emptyString;
-#else
-  _temp.clear();
-#endif
+  _headerSpans.push_back({id, _span(line, colon - line), _span(value, valueLen)});
   return true;
 }
 
@@ -1658,13 +2000,13 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last) {
     if (_parsedLength < 2 && data != '-') {
       _multiParseState = PARSE_ERROR;
       return;
-    } else if (_parsedLength - 2 < _boundary.length() && _boundary.c_str()[_parsedLength - 2] != data) {
+    } else if (_parsedLength - 2 < _boundary.len && _text(_boundary)[_parsedLength - 2] != data) {
       _multiParseState = PARSE_ERROR;
       return;
-    } else if (_parsedLength - 2 == _boundary.length() && data != '\r') {
+    } else if (_parsedLength - 2 == _boundary.len && data != '\r') {
       _multiParseState = PARSE_ERROR;
       return;
-    } else if (_parsedLength - 3 == _boundary.length()) {
+    } else if (_parsedLength - 3 == _boundary.len) {
       if (data != '\n') {
         _multiParseState = PARSE_ERROR;
         return;
@@ -1756,7 +2098,7 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last) {
       _boundaryPosition = 0;
     }
   } else if (_multiParseState == BOUNDARY_OR_DATA) {
-    if (_boundaryPosition < _boundary.length() && _boundary.c_str()[_boundaryPosition] != data) {
+    if (_boundaryPosition < _boundary.len && _text(_boundary)[_boundaryPosition] != data) {
       _multiParseState = WAIT_FOR_RETURN1;
       itemWriteByte('\r');
       itemWriteByte('\n');
@@ -1764,10 +2106,10 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last) {
       itemWriteByte('-');
       uint8_t i;
       for (i = 0; i < _boundaryPosition; i++) {
-        itemWriteByte(_boundary.c_str()[i]);
+        itemWriteByte(_text(_boundary)[i]);
       }
       _parseMultipartPostByte(data, last);
-    } else if (_boundaryPosition == _boundary.length() - 1) {
+    } else if (_boundaryPosition == _boundary.len - 1) {
       _multiParseState = DASH3_OR_RETURN2;
       if (!_itemIsFile) {
         _params.emplace_back(_itemName, _itemValue, true);
@@ -1802,8 +2144,8 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last) {
       itemWriteByte('-');
       itemWriteByte('-');
       uint8_t i;
-      for (i = 0; i < _boundary.length(); i++) {
-        itemWriteByte(_boundary.c_str()[i]);
+      for (i = 0; i < _boundary.len; i++) {
+        itemWriteByte(_text(_boundary)[i]);
       }
       _parseMultipartPostByte(data, last);
     }
@@ -1818,8 +2160,8 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last) {
       itemWriteByte('-');
       itemWriteByte('-');
       uint8_t i;
-      for (i = 0; i < _boundary.length(); i++) {
-        itemWriteByte(_boundary.c_str()[i]);
+      for (i = 0; i < _boundary.len; i++) {
+        itemWriteByte(_text(_boundary)[i]);
       }
       itemWriteByte('\r');
       _parseMultipartPostByte(data, last);
@@ -1827,24 +2169,26 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last) {
   }
 }
 
-void AsyncWebServerRequest::_parseLine() {
+// False if nothing of the line is kept
+bool AsyncWebServerRequest::_parseLine(char *line, size_t len) {
   if (_parseState == PARSE_REQ_START) {
-    if (!_temp.length()) {
+    if (!len) {
       _parseState = PARSE_REQ_FAIL;
       abort();
     } else {
-      if (_parseReqHead()) {
+      if (_parseReqHead(line, len)) {
         _parseState = PARSE_REQ_HEADERS;
+        return true;
       } else {
         _parseState = PARSE_REQ_FAIL;
         abort();
       }
     }
-    return;
+    return false;
   }
 
   if (_parseState == PARSE_REQ_HEADERS) {
-    if (!_temp.length()) {
+    if (!len) {
       // end of headers
       _server->_rewriteRequest(this);
       _server->_attachHandler(this);
@@ -1860,9 +2204,10 @@ void AsyncWebServerRequest::_parseLine() {
         _send();
       }
     } else {
-      _parseReqHeader();
+      return _parseReqHeader(line, len);
     }
   }
+  return false;
 }
 
 void AsyncWebServerRequest::_runMiddlewareChain() {
@@ -1899,6 +2244,11 @@ void AsyncWebServerRequest::_send() {
     _client->setRxTimeout(0);
     _response->_respond(this);
     _sent = true;
+    // no request follows on this connection and a stream may run for hours,
+    // keep only what the head needs
+    if (!_response->_persistent()) {
+      _shrinkHead();
+    }
   }
 }
 
@@ -1924,17 +2274,106 @@ void AsyncWebServerRequest::abort() {
   }
 }
 
-size_t AsyncWebServerRequest::headers() const {
-  return _headers.size();
+String AsyncWebServerRequest::_string(Span s) const {
+  String text;
+  if (s.len) {
+    text.concat(_text(s), s.len);
+  }
+  return text;
 }
 
-bool AsyncWebServerRequest::hasHeader(const char *name) const {
-  for (const auto &h : _headers) {
-    if (h.name().equalsIgnoreCase(name)) {
-      return true;
+bool AsyncWebServerRequest::_spanIs(Span s, const char *text, bool prefix) const {
+  size_t len = strlen(text);
+  return (prefix ? s.len >= len : s.len == len) && !memcmp(_text(s), text, len);
+}
+
+// Known names compare by id, only the others by name
+int AsyncWebServerRequest::_headerIndex(const char *name) const {
+  AsyncWebHeader::Id id = AsyncWebHeader::intern(name, strlen(name));
+  if (id != AsyncWebHeader::Id::Unknown) {
+    return _headerIndex(id);
+  }
+  for (size_t i = 0; i < _headerSpans.size(); i++) {
+    const HeaderSpan &h = _headerSpans[i];
+    if (h.id == id && !strcasecmp(_text(h.name), name)) {
+      return i;
     }
   }
-  return false;
+  return -1;
+}
+
+int AsyncWebServerRequest::_headerIndex(AsyncWebHeader::Id id) const {
+  for (size_t i = 0; i < _headerSpans.size(); i++) {
+    if (_headerSpans[i].id == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int AsyncWebServerRequest::_queryIndex(const char *name) const {
+  for (size_t i = 0; i < _query.size(); i++) {
+    if (_spanIs(_query[i].name, name)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// All at once, the vector handed out by getHeaders() does not move after
+void AsyncWebServerRequest::_buildHeaders() const {
+  if (_headers.size() == _headerSpans.size()) {
+    return;
+  }
+  _headers.reserve(_headerSpans.size());
+  for (const HeaderSpan &h : _headerSpans) {
+    _headers.emplace_back(_text(h.name), _text(h.value), h.id);
+  }
+}
+
+// The query parameters go in front of the ones of a rewrite and the body
+void AsyncWebServerRequest::_buildParams() const {
+  if (_query.empty()) {
+    return;
+  }
+  auto first = _params.begin();
+  for (const ParamSpan &p : _query) {
+    _params.emplace(first, _string(p.name), _string(p.value));
+  }
+  _query.clear();
+}
+
+const String &AsyncWebServerRequest::url() const {
+  if (!_urlBuilt) {
+    _url = _headBuf ? _string(_urlSpan) : emptyString;
+    _urlBuilt = true;
+  }
+  return _url;
+}
+
+const String &AsyncWebServerRequest::host() const {
+  if (!_host.length()) {
+    int i = _headerIndex(AsyncWebHeader::Id::Host);
+    if (i >= 0) {
+      _host = _string(_headerSpans[i].value);
+    }
+  }
+  return _host;
+}
+
+const String &AsyncWebServerRequest::contentType() const {
+  if (!_contentType.length() && _contentTypeSpan.len) {
+    _contentType = _string(_contentTypeSpan);
+  }
+  return _contentType;
+}
+
+size_t AsyncWebServerRequest::headers() const {
+  return _headerSpans.size();
+}
+
+bool AsyncWebServerRequest::hasHeader(const char *name) const {
+  return _headerIndex(name) >= 0;
 }
 
 #ifdef ESP8266
@@ -1944,10 +2383,8 @@ bool AsyncWebServerRequest::hasHeader(const __FlashStringHelper *data) const {
 #endif
 
 const AsyncWebHeader *AsyncWebServerRequest::getHeader(const char *name) const {
-  auto iter = std::find_if(std::begin(_headers), std::end(_headers), [&name](const AsyncWebHeader &header) {
-    return header.name().equalsIgnoreCase(name);
-  });
-  return (iter == std::end(_headers)) ? nullptr : &(*iter);
+  int i = _headerIndex(name);
+  return i < 0 ? nullptr : getHeader((size_t)i);
 }
 
 #ifdef ESP8266
@@ -1967,33 +2404,42 @@ const AsyncWebHeader *AsyncWebServerRequest::getHeader(const __FlashStringHelper
 #endif
 
 const AsyncWebHeader *AsyncWebServerRequest::getHeader(size_t num) const {
-  if (num >= _headers.size()) {
+  if (num >= _headerSpans.size()) {
     return nullptr;
   }
-  return &(*std::next(_headers.cbegin(), num));
+  _buildHeaders();
+  return &_headers[num];
 }
 
 size_t AsyncWebServerRequest::getHeaderNames(std::vector<const char *> &names) const {
   const size_t size = names.size();
-  for (const auto &h : _headers) {
-    names.push_back(h.name().c_str());
+  for (const HeaderSpan &h : _headerSpans) {
+    names.push_back(_text(h.name));
   }
   return names.size() - size;
 }
 
 bool AsyncWebServerRequest::removeHeader(const char *name) {
-  const size_t size = _headers.size();
-  _headers.remove_if([name](const AsyncWebHeader &header) {
-    return header.name().equalsIgnoreCase(name);
-  });
-  return size != _headers.size();
+  bool removed = false;
+  int i;
+  while ((i = _headerIndex(name)) >= 0) {
+    _headerSpans.erase(_headerSpans.begin() + i);
+    if (!_headers.empty()) {
+      _headers.erase(_headers.begin() + i);
+    }
+    removed = true;
+  }
+  return removed;
 }
 
 size_t AsyncWebServerRequest::params() const {
-  return _params.size();
+  return _query.size() + _params.size();
 }
 
 bool AsyncWebServerRequest::hasParam(const char *name, bool post, bool file) const {
+  if (!post && !file && _queryIndex(name) >= 0) {
+    return true;
+  }
   for (const auto &p : _params) {
     if (p.name().equals(name) && p.isPost() == post && p.isFile() == file) {
       return true;
@@ -2003,6 +2449,7 @@ bool AsyncWebServerRequest::hasParam(const char *name, bool post, bool file) con
 }
 
 const AsyncWebParameter *AsyncWebServerRequest::getParam(const char *name, bool post, bool file) const {
+  _buildParams();
   for (const auto &p : _params) {
     if (p.name() == name && p.isPost() == post && p.isFile() == file) {
       return &p;
@@ -2018,10 +2465,11 @@ const AsyncWebParameter *AsyncWebServerRequest::getParam(const __FlashStringHelp
 #endif
 
 const AsyncWebParameter *AsyncWebServerRequest::getParam(size_t num) const {
+  _buildParams();
   if (num >= _params.size()) {
     return nullptr;
   }
-  return &(*std::next(_params.cbegin(), num));
+  return &*std::next(_params.begin(), num);
 }
 
 const String &AsyncWebServerRequest::getAttribute(const char *name, const String &defaultValue) const {
@@ -2123,21 +2571,23 @@ void AsyncWebServerRequest::redirect(const char *url, int code) {
   send(response);
 }
 
+// The credentials run to the end of the header value, they are NUL terminated
 bool AsyncWebServerRequest::authenticate(const char *username, const char *password, const char *realm, bool passwordIsHash) const {
-  if (_authorization.length()) {
+  if (_authorization.len) {
+    const char *authorization = _text(_authorization);
     if (_authMethod == AsyncAuthType::AUTH_DIGEST) {
-      return checkDigestAuthentication(_authorization.c_str(), methodToString(), username, password, realm, passwordIsHash, NULL, NULL, NULL);
+      return checkDigestAuthentication(authorization, methodToString(), username, password, realm, passwordIsHash, NULL, NULL, NULL);
     } else if (!passwordIsHash) {
-      return checkBasicAuthentication(_authorization.c_str(), username, password);
+      return checkBasicAuthentication(authorization, username, password);
     } else {
-      return _authorization.equals(password);
+      return !strcmp(authorization, password);
     }
   }
   return false;
 }
 
 bool AsyncWebServerRequest::authenticate(const char *hash) const {
-  if (!_authorization.length() || hash == NULL) {
+  if (!_authorization.len || hash == NULL) {
     return false;
   }
 
@@ -2155,11 +2605,11 @@ bool AsyncWebServerRequest::authenticate(const char *hash) const {
     }
     String realm = hStr.substring(0, separator);
     hStr = hStr.substring(separator + 1);
-    return checkDigestAuthentication(_authorization.c_str(), methodToString(), username.c_str(), hStr.c_str(), realm.c_str(), true, NULL, NULL, NULL);
+    return checkDigestAuthentication(_text(_authorization), methodToString(), username.c_str(), hStr.c_str(), realm.c_str(), true, NULL, NULL, NULL);
   }
 
   // Basic Auth, Bearer Auth, or other
-  return (_authorization.equals(hash));
+  return !strcmp(_text(_authorization), hash);
 }
 
 void AsyncWebServerRequest::requestAuthentication(AsyncAuthType method, const char *realm, const char *_authFailMsg) {
@@ -2220,6 +2670,9 @@ void AsyncWebServerRequest::requestAuthentication(AsyncAuthType method, const ch
 }
 
 bool AsyncWebServerRequest::hasArg(const char *name) const {
+  if (_queryIndex(name) >= 0) {
+    return true;
+  }
   for (const auto &arg : _params) {
     if (arg.name() == name) {
       return true;
@@ -2235,6 +2688,7 @@ bool AsyncWebServerRequest::hasArg(const __FlashStringHelper *data) const {
 #endif
 
 const String &AsyncWebServerRequest::arg(const char *name) const {
+  _buildParams();
   for (const auto &arg : _params) {
     if (arg.name() == name) {
       return arg.value();
@@ -2258,6 +2712,13 @@ const String &AsyncWebServerRequest::argName(size_t i) const {
 }
 
 const String &AsyncWebServerRequest::pathArg(size_t i) const {
+  if (_pathParams.empty()) {
+    for (uint8_t n = 0; n < _pathViewCount; n++) {
+      String param;
+      param.concat(urlData() + _pathViews[n].offset, _pathViews[n].len);
+      _pathParams.push_back(std::move(param));
+    }
+  }
   if (i >= _pathParams.size()) {
     return emptyString;
   }
@@ -2266,6 +2727,12 @@ const String &AsyncWebServerRequest::pathArg(size_t i) const {
   return *it;
 }
 
+const String &AsyncWebServerRequest::pathArg(const char *name) const {
+  AsyncCallbackWebHandler *handler = _handler ? _handler->_routable() : nullptr;
+  int i = handler ? handler->pathArgIndex(name) : -1;
+  return i < 0 ? emptyString : pathArg((size_t)i);
+}
+
 const String &AsyncWebServerRequest::header(const char *name) const {
   const AsyncWebHeader *h = getHeader(name);
   return h ? h->value() : emptyString;
@@ -2277,6 +2744,11 @@ const String &AsyncWebServerRequest::header(const __FlashStringHelper *data) con
 };
 #endif
 
+const String &AsyncWebServerRequest::header(AsyncWebHeader::Id id) const {
+  const AsyncWebHeader *h = getHeader(id);
+  return h ? h->value() : emptyString;
+}
+
 const String &AsyncWebServerRequest::header(size_t i) const {
   const AsyncWebHeader *h = getHeader(i);
   return h ? h->value() : emptyString;
@@ -2288,8 +2760,11 @@ const String &AsyncWebServerRequest::headerName(size_t i) const {
 }
 
 String AsyncWebServerRequest::urlDecode(const String &text) const {
+  return _urlDecode(text.c_str(), text.length());
+}
+
+String AsyncWebServerRequest::_urlDecode(const char *text, size_t len) {
   char temp[] = "0x00";
-  unsigned int len = text.length();
   unsigned int i = 0;
   String decoded;
   // Allocate the string internal buffer - never longer from source text
@@ -2301,10 +2776,10 @@ String AsyncWebServerRequest::urlDecode(const String &text) const {
   }
   while (i < len) {
     char decodedChar;
-    char encodedChar = text.charAt(i++);
+    char encodedChar = text[i++];
     if ((encodedChar == '%') && (i + 1 < len)) {
-      temp[2] = text.charAt(i++);
-      temp[3] = text.charAt(i++);
+      temp[2] = text[i++];
+      temp[3] = text[i++];
       decodedChar = strtol(temp, NULL, 16);
     } else if (encodedChar == '+') {
       decodedChar = ' ';
@@ -2316,6 +2791,27 @@ String AsyncWebServerRequest::urlDecode(const String &text) const {
   return decoded;
 }
 
+size_t AsyncWebServerRequest::_urlDecodeInPlace(char *text, size_t len) {
+  char temp[] = "0x00";
+  size_t i = 0;
+  size_t decoded = 0;
+  while (i < len) {
+    char decodedChar;
+    char encodedChar = text[i++];
+    if ((encodedChar == '%') && (i + 1 < len)) {
+      temp[2] = text[i++];
+      temp[3] = text[i++];
+      decodedChar = strtol(temp, NULL, 16);
+    } else if (encodedChar == '+') {
+      decodedChar = ' ';
+    } else {
+      decodedChar = encodedChar;
+    }
+    text[decoded++] = decodedChar;
+  }
+  return decoded;
+}
+
 const char *AsyncWebServerRequest::methodToString() const {
   if (_method == HTTP_ANY) {
     return T_ANY;
@@ -2486,7 +2982,8 @@ AsyncStaticWebHandler &AsyncStaticWebHandler::setLastModified() {
 }
 
 bool AsyncStaticWebHandler::canHandle(AsyncWebServerRequest *request) const {
-  return request->isHTTP() && request->method() == HTTP_GET && request->url().startsWith(_uri) && _getFile(request);
+  return request->isHTTP() && request->method() == HTTP_GET && request->urlLength() >= _uri.length()
+         && !memcmp(request->urlData(), _uri.c_str(), _uri.length()) && _getFile(request);
 }
 
 bool AsyncStaticWebHandler::_getFile(AsyncWebServerRequest *request) const {
@@ -2613,10 +3110,10 @@ void AsyncStaticWebHandler::handleRequest(AsyncWebServerRequest *request) {
   bool not_modified = false;
 
   // if-none-match has precedence over if-modified-since
-  if (request->hasHeader(T_INM)) {
-    not_modified = request->header(T_INM).equals(etag);
+  if (request->hasHeader(AsyncWebHeader::Id::IfNoneMatch)) {
+    not_modified = request->header(AsyncWebHeader::Id::IfNoneMatch).equals(etag);
   } else if (_last_modified.length()) {
-    not_modified = request->header(T_IMS).equals(_last_modified);
+    not_modified = request->header(AsyncWebHeader::Id::IfModifiedSince).equals(_last_modified);
   }
 
   AsyncWebServerResponse *response;
@@ -2656,6 +3153,108 @@ AsyncStaticWebHandler &AsyncStaticWebHandler::setTemplateProcessor(AwsTemplatePr
 void AsyncCallbackWebHandler::setUri(const String &uri) {
   _uri = uri;
   _isRegex = uri.startsWith("^") && uri.endsWith("$");
+#ifdef ASYNCWEBSERVER_REGEX
+  if (_isRegex) {
+    _pattern = std::regex(_uri.c_str());
+  }
+#endif
+  _compileTemplate();
+}
+
+void AsyncCallbackWebHandler::_compileTemplate() {
+  _template.clear();
+  if (_isRegex || _uri.startsWith("/*.")) {
+    return;
+  }
+
+  const char *uri = _uri.c_str();
+  size_t len = _uri.length();
+  std::vector<PathPart> parts;
+  size_t literal = 0;  // start of the pending literal part
+  for (size_t i = 0; i < len; i++) {
+    PathPart param;
+    if (uri[i] == '{') {
+      const char *close = strchr(uri + i, '}');
+      if (!close) {
+        return;
+      }
+      param = {(uint16_t)(i + 1), (uint16_t)(close - uri - i - 1), PATH_SEGMENT};
+    } else if (uri[i] == '*' && i && uri[i - 1] == '/' && i + 1 < len) {
+      param = {(uint16_t)(i + 1), (uint16_t)(len - i - 1), PATH_REST};
+    } else {
+      continue;
+    }
+    if (i > literal) {
+      parts.push_back({(uint16_t)literal, (uint16_t)(i - literal), PATH_LITERAL});
+    }
+    parts.push_back(param);
+    if (param.type == PATH_REST) {
+      literal = len;
+      break;
+    }
+    i = param.start + param.len;
+    literal = i + 1;
+  }
+  if (parts.empty()) {
+    return;  // a plain URI
+  }
+  if (literal < len) {
+    parts.push_back({(uint16_t)literal, (uint16_t)(len - literal), PATH_LITERAL});
+  }
+  _template = std::move(parts);
+}
+
+// Without capture it only tells whether the URL matches, the router asks
+// every candidate this way and captures for the one it picks
+bool AsyncCallbackWebHandler::_matchTemplate(AsyncWebServerRequest *request, bool capture) const {
+  const char *url = request->urlData();
+  size_t len = request->urlLength();
+  size_t pos = 0;
+  uint8_t count = 0;
+  for (const PathPart &part : _template) {
+    if (part.type == PATH_LITERAL) {
+      if (len - pos < part.len || memcmp(url + pos, _uri.c_str() + part.start, part.len)) {
+        return false;
+      }
+      pos += part.len;
+      continue;
+    }
+
+    size_t end = len;
+    if (part.type == PATH_SEGMENT) {
+      const char *slash = (const char *)memchr(url + pos, '/', len - pos);
+      end = slash ? slash - url : len;
+      if (end == pos) {
+        return false;
+      }
+    }
+    if (capture && count < ASYNCWEBSERVER_MAX_PATH_PARAMS) {
+      request->_pathViews[count++] = {(uint16_t)pos, (uint16_t)(end - pos)};
+    }
+    pos = end;
+  }
+  if (pos != len) {
+    return false;
+  }
+  if (capture) {
+    request->_pathViewCount = count;
+    request->_pathParams.clear();
+  }
+  return true;
+}
+
+int AsyncCallbackWebHandler::pathArgIndex(const char *name) const {
+  int index = 0;
+  for (const PathPart &part : _template) {
+    if (part.type == PATH_LITERAL) {
+      continue;
+    }
+    if (strlen(name) == part.len && !memcmp(name, _uri.c_str() + part.start, part.len)) {
+      return index;
+    }
+    index++;
+  }
+  return -1;
 }
 
 bool AsyncCallbackWebHandler::canHandle(AsyncWebServerRequest *request) const {
@@ -2663,12 +3262,14 @@ bool AsyncCallbackWebHandler::canHandle(AsyncWebServerRequest *request) const {
     return false;
   }
 
+  if (!_template.empty()) {
+    return _matchTemplate(request, true);
+  }
 #ifdef ASYNCWEBSERVER_REGEX
   if (_isRegex) {
-    std::regex pattern(_uri.c_str());
     std::smatch matches;
-    std::string s(request->url().c_str());
-    if (std::regex_search(s, matches, pattern)) {
+    std::string s(request->urlData(), request->urlLength());
+    if (std::regex_search(s, matches, _pattern)) {
       for (size_t i = 1; i < matches.size(); ++i) {  // start from 1
         request->_addPathParam(matches[i].str().c_str());
       }
@@ -3108,22 +3709,21 @@ void AsyncAuthenticationMiddleware::run(AsyncWebServerRequest *request, ArMiddle
 }
 
 void AsyncHeaderFreeMiddleware::run(AsyncWebServerRequest *request, ArMiddlewareNext next) {
-  std::list<const char *> toRemove;
-  for (auto &h : request->getHeaders()) {
+  // The names stay where they are when a header is removed
+  std::vector<const char *> names;
+  request->getHeaderNames(names);
+  for (const char *name : names) {
     bool keep = false;
     for (const char *k : _toKeep) {
-      if (strcasecmp(h.name().c_str(), k) == 0) {
+      if (strcasecmp(name, k) == 0) {
         keep = true;
         break;
       }
     }
     if (!keep) {
-      toRemove.push_back(h.name().c_str());
+      request->removeHeader(name);
     }
   }
-  for (const char *h : toRemove) {
-    request->removeHeader(h);
-  }
   next();
 }
 
@@ -3206,7 +3806,7 @@ void AsyncCorsMiddleware::addCORSHeaders(AsyncWebServerResponse *response) {
 
 void AsyncCorsMiddleware::run(AsyncWebServerRequest *request, ArMiddlewareNext next) {
   // Origin header ? => CORS handling
-  if (request->hasHeader(asyncsrv::T_CORS_O)) {
+  if (request->hasHeader(AsyncWebHeader::Id::Origin)) {
     // check if this is a preflight request => handle it and return
     if (request->method() == HTTP_OPTIONS) {
       AsyncWebServerResponse *response = request->beginResponse(200);
@@ -4901,11 +5501,11 @@ const char __WS_STR_UUID[] PROGMEM = {"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"};
 #define WS_STR_UUID       FPSTR(__WS_STR_UUID)
 
 bool AsyncWebSocket::canHandle(AsyncWebServerRequest *request) const {
-  return _enabled && request->isWebSocketUpgrade() && request->url().equals(_url);
+  return _enabled && request->isWebSocketUpgrade() && request->urlLength() == _url.length() && !memcmp(request->urlData(), _url.c_str(), _url.length());
 }
 
 void AsyncWebSocket::handleRequest(AsyncWebServerRequest *request) {
-  if (!request->hasHeader(WS_STR_VERSION) || !request->hasHeader(WS_STR_KEY)) {
+  if (!request->hasHeader(AsyncWebHeader::Id::SecWebSocketVersion) || !request->hasHeader(AsyncWebHeader::Id::SecWebSocketKey)) {
     request->send(400);
     return;
   }
@@ -4915,14 +5515,14 @@ void AsyncWebSocket::handleRequest(AsyncWebServerRequest *request) {
       return;
     }
   }
-  const AsyncWebHeader *version = request->getHeader(WS_STR_VERSION);
+  const AsyncWebHeader *version = request->getHeader(AsyncWebHeader::Id::SecWebSocketVersion);
   if (version->value().toInt() != 13) {
     AsyncWebServerResponse *response = request->beginResponse(400);
     response->addHeader(WS_STR_VERSION, T_13);
     request->send(response);
     return;
   }
-  const AsyncWebHeader *key = request->getHeader(WS_STR_KEY);
+  const AsyncWebHeader *key = request->getHeader(AsyncWebHeader::Id::SecWebSocketKey);
   AsyncWebServerResponse *response = new AsyncWebSocketResponse(key->value(), this);
   if (response == NULL) {
 #ifdef ESP32
@@ -4931,8 +5531,8 @@ void AsyncWebSocket::handleRequest(AsyncWebServerRequest *request) {
     request->abort();
     return;
   }
-  if (request->hasHeader(WS_STR_PROTOCOL)) {
-    const AsyncWebHeader *protocol = request->getHeader(WS_STR_PROTOCOL);
+  if (request->hasHeader(AsyncWebHeader::Id::SecWebSocketProtocol)) {
+    const AsyncWebHeader *protocol = request->getHeader(AsyncWebHeader::Id::SecWebSocketProtocol);
     // ToDo: check protocol
     response->addHeader(WS_STR_PROTOCOL, protocol->value());
   }
@@ -5055,7 +5655,7 @@ void AsyncWebServerRequest::send(FS &fs, const String &path, const char *content
   }
 
   // ETag validation
-  if (this->hasHeader(asyncsrv::T_INM)) {
+  if (this->hasHeader(AsyncWebHeader::Id::IfNoneMatch)) {
     // Generate server ETag from CRC in gzip trailer
     uint8_t crcInTrailer[4];
     gzFile.read(crcInTrailer, 4);
@@ -5063,7 +5663,7 @@ void AsyncWebServerRequest::send(FS &fs, const String &path, const char *content
     _getEtag(crcInTrailer, serverETag);
 
     // Compare with client's ETag
-    const AsyncWebHeader *inmHeader = this->getHeader(asyncsrv::T_INM);
+    const AsyncWebHeader *inmHeader = this->getHeader(AsyncWebHeader::Id::IfNoneMatch);
     if (inmHeader && inmHeader->value() == serverETag) {
       gzFile.close();
       this->send(304);  // Not Modified
@@ -5108,6 +5708,37 @@ void AsyncWebServerRequest::_getEtag(uint8_t trailer[4], char *serverETag) {
 
 //#include <ESPAsyncWebServer.h>
 
+static_assert(sizeof(T_known_headers) / sizeof(*T_known_headers) == T_known_headers_len, "T_known_headers_len");
+static_assert((uint8_t)AsyncWebHeader::Id::SecWebSocketProtocol == T_known_headers_len - 1, "AsyncWebHeader::Id out of sync with T_known_headers");
+
+// Length and first letter leave at most one candidate, one compare confirms it
+AsyncWebHeader::Id AsyncWebHeader::intern(const char *name, size_t len) {
+  if (!len) {
+    return Id::Unknown;
+  }
+  char c = tolower((unsigned char)name[0]);
+  Id id = Id::Unknown;
+  switch (len) {
+    case 4:  id = c == 'h' ? Id::Host : Id::Unknown; break;
+    case 6:
+      id = c == 'e'   ? Id::Expect
+           : c == 'a' ? Id::Accept
+           : c == 'c' ? Id::Cookie
+           : c == 'o' ? Id::Origin
+                      : Id::Unknown;
+      break;
+    case 7:  id = c == 'u' ? Id::Upgrade : Id::Unknown; break;
+    case 10: id = c == 'c' ? Id::Connection : Id::Unknown; break;
+    case 12: id = c == 'c' ? Id::ContentType : Id::Unknown; break;
+    case 13: id = c == 'a' ? Id::Authorization : c == 'i' ? Id::IfNoneMatch : c == 'l' ? Id::LastEventId : Id::Unknown; break;
+    case 14: id = c == 'c' ? Id::ContentLength : Id::Unknown; break;
+    case 17: id = c == 'i' ? Id::IfModifiedSince : c == 's' ? Id::SecWebSocketKey : Id::Unknown; break;
+    case 21: id = c == 's' ? Id::SecWebSocketVersion : Id::Unknown; break;
+    case 22: id = c == 's' ? Id::SecWebSocketProtocol : Id::Unknown; break;
+  }
+  return id != Id::Unknown && !strncasecmp(name, T_known_headers[(uint8_t)id], len) ? id : Id::Unknown;
+}
+
 const AsyncWebHeader AsyncWebHeader::parse(const char *data) {
   // https://developer.mozilla.org/en-US/docs/Web/HTTP/Reference/Headers
   // In HTTP/1.X, a header is a case-insensitive name followed by a colon, then optional whitespace which will be ignored, and finally by its value
@@ -5120,14 +5751,14 @@ const AsyncWebHeader AsyncWebHeader::parse(const char *data) {
   if (strchr(data, '\n') || strchr(data, '\r')) {
     return AsyncWebHeader();  // Invalid header format
   }
-  char *colon = strchr(data, ':');
+  const char *colon = strchr(data, ':');
   if (!colon) {
     return AsyncWebHeader();  // separator not found
   }
   if (colon == data) {
     return AsyncWebHeader();  // Header name cannot be empty
   }
-  char *startOfValue = colon + 1;  // Skip the colon
+  const char *startOfValue = colon + 1;  // Skip the colon
   // skip one optional whitespace after the colon
   if (*startOfValue == ' ') {
     startOfValue++;
@@ -5148,8 +5779,6 @@ const AsyncWebHeader AsyncWebHeader::parse(const char *data) {
 // SPDX-License-Identifier: LGPL-3.0-or-later
 // Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
 
-#pragma once
-
 /*
    server.on("/msg_pack", HTTP_ANY, [](AsyncWebServerRequest * request) {
     AsyncMessagePackResponse * response = new AsyncMessagePackResponse();
@@ -5397,125 +6026,7 @@ void AsyncCallbackMessagePackWebHandler::handleBody(AsyncWebServerRequest *reque
 // Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
 
 //#include "AsyncJson.h"
-// *** AsyncJson.h ***
-// SPDX-License-Identifier: LGPL-3.0-or-later
-// Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
-
-#ifndef ASYNC_JSON_H_
-#define ASYNC_JSON_H_
-
-#if __has_include("ArduinoJson.h")
-#include <ArduinoJson.h>
-#if ARDUINOJSON_VERSION_MAJOR >= 5
-#define ASYNC_JSON_SUPPORT 1
-#else
-#define ASYNC_JSON_SUPPORT 0
-#endif  // ARDUINOJSON_VERSION_MAJOR >= 5
-#endif  // __has_include("ArduinoJson.h")
-
-#if ASYNC_JSON_SUPPORT == 1
-//#include <ESPAsyncWebServer.h>
-
-//#include "ChunkPrint.h"
-
-#if ARDUINOJSON_VERSION_MAJOR == 6
-#ifndef DYNAMIC_JSON_DOCUMENT_SIZE
-#define DYNAMIC_JSON_DOCUMENT_SIZE 1024
-#endif
-#endif
-
-class AsyncJsonResponse : public AsyncAbstractResponse {
-protected:
-#if ARDUINOJSON_VERSION_MAJOR == 5
-  DynamicJsonBuffer _jsonBuffer;
-#elif ARDUINOJSON_VERSION_MAJOR == 6
-  DynamicJsonDocument _jsonBuffer;
-#else
-  JsonDocument _jsonBuffer;
-#endif
-
-  JsonVariant _root;
-  bool _isValid;
-
-public:
-#if ARDUINOJSON_VERSION_MAJOR == 6
-  AsyncJsonResponse(bool isArray = false, size_t maxJsonBufferSize = DYNAMIC_JSON_DOCUMENT_SIZE);
-#else
-  AsyncJsonResponse(bool isArray = false);
-#endif
-  JsonVariant &getRoot() {
-    return _root;
-  }
-  bool _sourceValid() const {
-    return _isValid;
-  }
-  size_t setLength();
-  size_t getSize() const {
-    return _jsonBuffer.size();
-  }
-  size_t _fillBuffer(uint8_t *data, size_t len);
-#if ARDUINOJSON_VERSION_MAJOR >= 6
-  bool overflowed() const {
-    return _jsonBuffer.overflowed();
-  }
-#endif
-};
-
-class PrettyAsyncJsonResponse : public AsyncJsonResponse {
-public:
-#if ARDUINOJSON_VERSION_MAJOR == 6
-  PrettyAsyncJsonResponse(bool isArray = false, size_t maxJsonBufferSize = DYNAMIC_JSON_DOCUMENT_SIZE);
-#else
-  PrettyAsyncJsonResponse(bool isArray = false);
-#endif
-  size_t setLength();
-  size_t _fillBuffer(uint8_t *data, size_t len);
-};
-
-typedef std::function<void(AsyncWebServerRequest *request, JsonVariant &json)> ArJsonRequestHandlerFunction;
-
-class AsyncCallbackJsonWebHandler : public AsyncWebHandler {
-protected:
-  String _uri;
-  WebRequestMethodComposite _method;
-  ArJsonRequestHandlerFunction _onRequest;
-#if ARDUINOJSON_VERSION_MAJOR == 6
-  size_t maxJsonBufferSize;
-#endif
-  size_t _maxContentLength;
-
-public:
-#if ARDUINOJSON_VERSION_MAJOR == 6
-  AsyncCallbackJsonWebHandler(const String &uri, ArJsonRequestHandlerFunction onRequest = nullptr, size_t maxJsonBufferSize = DYNAMIC_JSON_DOCUMENT_SIZE);
-#else
-  AsyncCallbackJsonWebHandler(const String &uri, ArJsonRequestHandlerFunction onRequest = nullptr);
-#endif
-
-  void setMethod(WebRequestMethodComposite method) {
-    _method = method;
-  }
-  void setMaxContentLength(int maxContentLength) {
-    _maxContentLength = maxContentLength;
-  }
-  void onRequest(ArJsonRequestHandlerFunction fn) {
-    _onRequest = fn;
-  }
-
-  bool canHandle(AsyncWebServerRequest *request) const override final;
-  void handleRequest(AsyncWebServerRequest *request) override final;
-  void handleUpload(
-    __unused AsyncWebServerRequest *request, __unused const String &filename, __unused size_t index, __unused uint8_t *data, __unused size_t len,
-    __unused bool final
-  ) override final {}
-  void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) override final;
-  bool isRequestHandlerTrivial() const override final {
-    return !_onRequest;
-  }
-};
-
-#endif  // ASYNC_JSON_SUPPORT == 1
-
-#endif  // ASYNC_JSON_H_
+// AsyncJson.h is part of ESPAsyncWebServer.h
 
 #if ASYNC_JSON_SUPPORT == 1
 
@@ -5857,8 +6368,8 @@ size_t AsyncEventSourceMessage::send(AsyncClient *client) {
 
 AsyncEventSourceClient::AsyncEventSourceClient(AsyncWebServerRequest *request, AsyncEventSource *server) : _client(request->client()), _server(server) {
 
-  if (request->hasHeader(T_Last_Event_ID)) {
-    _lastId = atoi(request->getHeader(T_Last_Event_ID)->value().c_str());
+  if (request->hasHeader(AsyncWebHeader::Id::LastEventId)) {
+    _lastId = atoi(request->getHeader(AsyncWebHeader::Id::LastEventId)->value().c_str());
   }
 
   _client->setRxTimeout(0);
@@ -6171,7 +6682,7 @@ size_t AsyncEventSource::count() const {
 }
 
 bool AsyncEventSource::canHandle(AsyncWebServerRequest *request) const {
-  return request->isSSE() && request->url().equals(_url);
+  return request->isSSE() && request->urlLength() == _url.length() && !memcmp(request->urlData(), _url.c_str(), _url.length());
 }
 
 void AsyncEventSource::handleRequest(AsyncWebServerRequest *request) {
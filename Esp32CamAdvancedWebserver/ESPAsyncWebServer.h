@@ -32,18 +32,42 @@
 //#include "AsyncWebServerVersion.h"
 #define ASYNCWEBSERVER_FORK_ESP32Async
 
-#ifdef ASYNCWEBSERVER_REGEX
-#define ASYNCWEBSERVER_REGEX_ATTRIBUTE
-#else
-#define ASYNCWEBSERVER_REGEX_ATTRIBUTE __attribute__((warning("ASYNCWEBSERVER_REGEX not defined")))
-#endif
-
 // See https://github.com/ESP32Async/ESPAsyncWebServer/commit/3d3456e9e81502a477f6498c44d0691499dda8f9#diff-646b25b11691c11dce25529e3abce843f0ba4bd07ab75ec9eee7e72b06dbf13fR388-R392
 // This setting slowdown chunk serving but avoids crashing or deadlocks in the case where slow chunk responses are created, like file serving form SD Card
 #ifndef ASYNCWEBSERVER_USE_CHUNK_INFLIGHT
 #define ASYNCWEBSERVER_USE_CHUNK_INFLIGHT 1
 #endif
 
+// HTTP/1.1 persistent connections: requests answered on one connection before
+// it is closed (0 closes after every response)
+#ifndef ASYNCWEBSERVER_KEEPALIVE_MAX
+#define ASYNCWEBSERVER_KEEPALIVE_MAX 100
+#endif
+// Seconds a connection may sit idle waiting for a request, the first one on a
+// new connection as well as the next one on a persistent connection
+#ifndef ASYNCWEBSERVER_RX_TIMEOUT
+#define ASYNCWEBSERVER_RX_TIMEOUT 3
+#endif
+
+// Longest request head (request line and headers) a connection accepts. The
+// head is collected in a buffer of this size, which a persistent connection
+// keeps for its next requests. A response that ends the connection, a stream
+// for example, shrinks it to the lines kept.
+#ifndef ASYNCWEBSERVER_HEAD_SIZE
+#define ASYNCWEBSERVER_HEAD_SIZE 2048
+#endif
+
+// Request headers room is reserved for when a connection is accepted, so a
+// typical browser request fills them without growing the vector
+#ifndef ASYNCWEBSERVER_HEADERS_RESERVE
+#define ASYNCWEBSERVER_HEADERS_RESERVE 16
+#endif
+
+// Path parameters captured per request by URI templates, see setUri()
+#ifndef ASYNCWEBSERVER_MAX_PATH_PARAMS
+#define ASYNCWEBSERVER_MAX_PATH_PARAMS 8
+#endif
+
 class AsyncWebServer;
 class AsyncWebServerRequest;
 class AsyncWebServerResponse;
@@ -138,15 +162,40 @@ public:
  * */
 
 class AsyncWebHeader {
+public:
+  // Request header names the server reads itself, interned when the request
+  // is parsed so that lookups compare ids. Same order as T_known_headers.
+  enum class Id : uint8_t {
+    Unknown = 0,
+    Host,
+    ContentType,
+    ContentLength,
+    Expect,
+    Authorization,
+    Connection,
+    Upgrade,
+    Accept,
+    Cookie,
+    Origin,
+    IfModifiedSince,
+    IfNoneMatch,
+    LastEventId,
+    SecWebSocketKey,
+    SecWebSocketVersion,
+    SecWebSocketProtocol,
+  };
+
 private:
   String _name;
   String _value;
+  Id _id = Id::Unknown;
 
 public:
   AsyncWebHeader() {}
   AsyncWebHeader(const AsyncWebHeader &) = default;
   AsyncWebHeader(AsyncWebHeader &&) = default;
   AsyncWebHeader(const char *name, const char *value) : _name(name), _value(value) {}
+  AsyncWebHeader(const char *name, const char *value, Id id) : _name(name), _value(value), _id(id) {}
   AsyncWebHeader(const String &name, const String &value) : _name(name), _value(value) {}
 
 #ifndef ESP8266
@@ -164,6 +213,14 @@ public:
   const String &value() const {
     return _value;
   }
+  // only set on request headers
+  Id id() const {
+    return _id;
+  }
+
+  // Id of a known header name, Id::Unknown for any other name. Callers that
+  // know the header pass its Id to the request lookups and skip this.
+  static Id intern(const char *name, size_t len);
 
   String toString() const;
 
@@ -212,6 +269,7 @@ class AsyncWebServerRequest {
   friend class AsyncWebServer;
   friend class AsyncCallbackWebHandler;
   friend class AsyncFileResponse;
+  friend class AsyncWebServerResponse;
 
 private:
   AsyncClient *_client;
@@ -224,16 +282,41 @@ private:
   bool _paused = false;                          // request is paused (request continuation)
   std::shared_ptr<AsyncWebServerRequest> _this;  // shared pointer to this request
 
-  String _temp;
+  String _temp;  // body parser state
   uint8_t _parseState;
 
+  // The request head is copied from the TCP buffers into this arena and its
+  // lines are parsed in place. Header lines nobody reads are dropped as they
+  // come, the rest is referred to by offsets until a handler asks for Strings.
+  char *_headBuf = nullptr;
+  uint16_t _headSize = 0;  // allocated, below ASYNCWEBSERVER_HEAD_SIZE once shrunk
+  uint16_t _headLen = 0;   // bytes kept
+  uint16_t _headLine = 0;  // start of the line being received
+
+  struct Span {
+    uint16_t offset;
+    uint16_t len;
+  };
+  struct ParamSpan {
+    Span name;
+    Span value;
+  };
+  struct HeaderSpan {
+    AsyncWebHeader::Id id;
+    Span name;
+    Span value;
+  };
+
   uint8_t _version;
   WebRequestMethodComposite _method;
-  String _url;
-  String _host;
-  String _contentType;
-  String _boundary;
-  String _authorization;
+  Span _urlSpan = {0, 0};
+  mutable String _url;             // built on first use, or set by a rewrite
+  mutable bool _urlBuilt = false;  // _url holds the URL
+  mutable String _host;
+  mutable String _contentType;
+  Span _contentTypeSpan = {0, 0};  // without the parameters
+  Span _boundary = {0, 0};
+  Span _authorization = {0, 0};    // without the scheme
   RequestedConnectionType _reqconntype;
   AsyncAuthType _authMethod = AsyncAuthType::AUTH_NONE;
   bool _isMultipart;
@@ -242,9 +325,19 @@ private:
   size_t _contentLength;
   size_t _parsedLength;
 
-  std::list<AsyncWebHeader> _headers;
-  std::list<AsyncWebParameter> _params;
-  std::list<String> _pathParams;
+  std::vector<HeaderSpan> _headerSpans;
+  mutable std::vector<AsyncWebHeader> _headers;  // empty, or all of _headerSpans as Strings
+  mutable std::vector<ParamSpan> _query;         // moved to the front of _params on first use
+  mutable std::list<AsyncWebParameter> _params;  // a list, getParam() pointers outlive later params
+  mutable std::list<String> _pathParams;  // regex groups, or built from _pathViews on first use
+
+  // Template parameters as offsets into the URL, no copies until asked for
+  struct PathView {
+    uint16_t offset;
+    uint16_t len;
+  };
+  PathView _pathViews[ASYNCWEBSERVER_MAX_PATH_PARAMS];
+  uint8_t _pathViewCount = 0;
 
   std::unordered_map<const char *, String, std::hash<const char *>, std::equal_to<const char *>> _attributes;
 
@@ -260,6 +353,10 @@ private:
   size_t _itemBufferIndex;
   bool _itemIsFile;
 
+  bool _closeRequested = false;  // client sent Connection: close
+  bool _pipelined = false;       // data arrived before the response was done
+  uint16_t _served = 0;          // requests answered on this connection so far
+
   void _onPoll();
   void _onAck(size_t len, uint32_t time);
   void _onError(int8_t error);
@@ -269,12 +366,31 @@ private:
 
   void _addPathParam(const char *param);
 
-  bool _parseReqHead();
-  bool _parseReqHeader();
-  void _parseLine();
+  bool _appendHead(const char *data, size_t len);
+  void _shrinkHead();
+  bool _parseReqHead(char *line, size_t len);
+  bool _parseReqHeader(char *line, size_t len);
+  bool _parseLine(char *line, size_t len);
+  void _parseQuery(char *query, size_t len);
   void _parsePlainPostChar(uint8_t data);
   void _parseMultipartPostByte(uint8_t data, bool last);
   void _addGetParams(const String &params);
+  static String _urlDecode(const char *text, size_t len);
+  static size_t _urlDecodeInPlace(char *text, size_t len);
+
+  Span _span(const char *text, size_t len) const {
+    return {(uint16_t)(text - _headBuf), (uint16_t)len};
+  }
+  const char *_text(Span s) const {
+    return _headBuf + s.offset;
+  }
+  String _string(Span s) const;
+  bool _spanIs(Span s, const char *text, bool prefix = false) const;
+  int _headerIndex(const char *name) const;
+  int _headerIndex(AsyncWebHeader::Id id) const;
+  int _queryIndex(const char *name) const;
+  void _buildHeaders() const;
+  void _buildParams() const;
 
   void _handleUploadStart();
   void _handleUploadByte(uint8_t data, bool last);
@@ -283,6 +399,10 @@ private:
   void _send();
   void _runMiddlewareChain();
 
+  bool _keepAlive() const;
+  void _responseDone();
+  void _recycle();
+
   static void _getEtag(uint8_t trailer[4], char *serverETag);
 
 public:
@@ -301,15 +421,16 @@ public:
   WebRequestMethodComposite method() const {
     return _method;
   }
-  const String &url() const {
-    return _url;
-  }
-  const String &host() const {
-    return _host;
+  const String &url() const;
+  // The URL without a copy, as url() but not necessarily NUL terminated
+  const char *urlData() const {
+    return _urlBuilt ? _url.c_str() : _headBuf ? _text(_urlSpan) : asyncsrv::empty;
   }
-  const String &contentType() const {
-    return _contentType;
+  size_t urlLength() const {
+    return _urlBuilt ? _url.length() : _urlSpan.len;
   }
+  const String &host() const;
+  const String &contentType() const;
   size_t contentLength() const {
     return _contentLength;
   }
@@ -354,12 +475,12 @@ public:
   }
 
 #ifndef ESP8266
-  [[deprecated("All headers are now collected. Use removeHeader(name) or AsyncHeaderFreeMiddleware if you really need to free some headers.")]]
+  [[deprecated("Headers are filtered while parsing, before any handler runs. Use AsyncWebServer::addInterestingHeader(name) instead.")]]
 #endif
   void addInterestingHeader(__unused const char *name) {
   }
 #ifndef ESP8266
-  [[deprecated("All headers are now collected. Use removeHeader(name) or AsyncHeaderFreeMiddleware if you really need to free some headers.")]]
+  [[deprecated("Headers are filtered while parsing, before any handler runs. Use AsyncWebServer::addInterestingHeader(name) instead.")]]
 #endif
   void addInterestingHeader(__unused const String &name) {
   }
@@ -594,10 +715,12 @@ public:
   bool hasArg(const __FlashStringHelper *data) const;  // check if F(argument) exists
 #endif
 
-  const String &ASYNCWEBSERVER_REGEX_ATTRIBUTE pathArg(size_t i) const;
-  const String &ASYNCWEBSERVER_REGEX_ATTRIBUTE pathArg(int i) const {
+  // Path parameters of a "/cam/{id}" template, or the groups of a regex URI
+  const String &pathArg(size_t i) const;
+  const String &pathArg(int i) const {
     return i < 0 ? emptyString : pathArg((size_t)i);
   }
+  const String &pathArg(const char *name) const;  // template parameters only
 
   // get request header value by name
   const String &header(const char *name) const;
@@ -609,6 +732,7 @@ public:
   const String &header(const __FlashStringHelper *data) const;  // get request header value by F(name)
 #endif
 
+  const String &header(AsyncWebHeader::Id id) const;  // get a known request header value
   const String &header(size_t i) const;  // get request header value by number
   const String &header(int i) const {
     return i < 0 ? emptyString : header((size_t)i);
@@ -628,6 +752,9 @@ public:
 #ifdef ESP8266
   bool hasHeader(const __FlashStringHelper *data) const;  // check if header exists
 #endif
+  bool hasHeader(AsyncWebHeader::Id id) const {
+    return _headerIndex(id) >= 0;
+  }
 
   const AsyncWebHeader *getHeader(const char *name) const;
   const AsyncWebHeader *getHeader(const String &name) const {
@@ -636,23 +763,30 @@ public:
 #ifdef ESP8266
   const AsyncWebHeader *getHeader(const __FlashStringHelper *data) const;
 #endif
+  const AsyncWebHeader *getHeader(AsyncWebHeader::Id id) const {
+    int i = _headerIndex(id);
+    return i < 0 ? nullptr : getHeader((size_t)i);
+  }
 
   const AsyncWebHeader *getHeader(size_t num) const;
   const AsyncWebHeader *getHeader(int num) const {
     return num < 0 ? nullptr : getHeader((size_t)num);
   };
 
-  const std::list<AsyncWebHeader> &getHeaders() const {
+  const std::vector<AsyncWebHeader> &getHeaders() const {
+    _buildHeaders();
     return _headers;
   }
 
+  // Names stay valid until the request is done, they are not copied
   size_t getHeaderNames(std::vector<const char *> &names) const;
 
   // Remove a header from the request.
-  // It will free the memory and prevent the header to be seen during request processing.
+  // It prevents the header to be seen during the rest of request processing.
   bool removeHeader(const char *name);
   // Remove all request headers.
   void removeHeaders() {
+    _headerSpans.clear();
     _headers.clear();
   }
 
@@ -968,7 +1102,7 @@ public:
     return _params;
   }
   virtual bool match(AsyncWebServerRequest *request) {
-    return from() == request->url() && filter(request);
+    return from().length() == request->urlLength() && !memcmp(from().c_str(), request->urlData(), from().length()) && filter(request);
   }
 };
 
@@ -1016,6 +1150,10 @@ public:
   virtual bool isRequestHandlerTrivial() const {
     return true;
   }
+  // Non-null for handlers the server can route by URI without canHandle()
+  virtual AsyncCallbackWebHandler *_routable() {
+    return nullptr;
+  }
 };
 
 /*
@@ -1044,8 +1182,10 @@ protected:
   size_t _ackedLength;
   size_t _writtenLength;
   WebResponseState _state;
+  bool _keepAlive = false;
 
   static bool headerMustBePresentOnce(const String &name);
+  void _setConnection(AsyncWebServerRequest *request);
 
 public:
   static const char *responseCodeToString(int code);
@@ -1097,6 +1237,9 @@ public:
   virtual bool _finished() const;
   virtual bool _failed() const;
   virtual bool _sourceValid() const;
+  bool _persistent() const {
+    return _keepAlive;
+  }
   virtual void _respond(AsyncWebServerRequest *request);
   virtual size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
 };
@@ -1117,6 +1260,38 @@ protected:
   std::list<std::unique_ptr<AsyncWebHandler>> _handlers;
   AsyncCallbackWebHandler *_catchAllHandler;
 
+  // Callback handlers with a plain or trailing '*' URI, compiled into a radix
+  // tree over the URIs by _compileRoutes(). Every other handler (static
+  // files, WebDAV, regex and "/*.ext" URIs, WebSocket, SSE) is asked with
+  // canHandle() in registration order, but only if no route matched.
+  struct RouteNode {
+    uint16_t label;     // edge label, offset into _routeText
+    uint16_t labelLen;
+    uint16_t child;     // first child, 0 = none
+    uint16_t sibling;   // next child of the parent, 0 = none
+    int16_t exact;      // first route ending here, -1 = none
+    int16_t prefix;     // first route ending here with '*', -1 = none
+  };
+  struct Route {
+    AsyncCallbackWebHandler *handler;
+    uint16_t order;  // registration order, the lowest match wins
+    int16_t next;    // next route of the same node, -1 = none
+  };
+  std::vector<RouteNode> _routeNodes;
+  std::vector<Route> _routes;
+  std::vector<char> _routeText;
+  std::vector<AsyncWebHandler *> _unroutedHandlers;
+  bool _routesDirty = true;
+
+  // Names of unknown request headers to keep, all are kept while empty
+  std::vector<String> _interestingHeaders;
+
+  void _compileRoutes();
+  uint16_t _insertRoute(const char *uri, size_t len);
+  void _addRoute(int16_t &list, AsyncCallbackWebHandler *handler, uint16_t order);
+  const Route *_bestRoute(int16_t list, AsyncWebServerRequest *request, const Route *best);
+  AsyncCallbackWebHandler *_matchRoute(AsyncWebServerRequest *request);
+
 public:
   AsyncWebServer(uint16_t port);
   ~AsyncWebServer();
@@ -1200,6 +1375,14 @@ public:
 
   void reset();  // remove all writers and handlers, with onNotFound/onFileUpload/onRequestBody
 
+  // Request headers the server does not read itself (see AsyncWebHeader::Id)
+  // are dropped while parsing unless named here. Until the first call every
+  // header is kept.
+  void addInterestingHeader(const char *name) {
+    _interestingHeaders.emplace_back(name);
+  }
+  bool _interestingHeader(const char *name) const;
+
   void _handleDisconnect(AsyncWebServerRequest *request);
   void _attachHandler(AsyncWebServerRequest *request);
   void _rewriteRequest(AsyncWebServerRequest *request);
@@ -2129,6 +2312,8 @@ public:
 };
 
 class AsyncCallbackWebHandler : public AsyncWebHandler {
+  friend class AsyncWebServer;
+
 private:
 protected:
   String _uri;
@@ -2137,10 +2322,36 @@ protected:
   ArUploadHandlerFunction _onUpload;
   ArBodyHandlerFunction _onBody;
   bool _isRegex;
+#ifdef ASYNCWEBSERVER_REGEX
+  std::regex _pattern;
+#endif
+
+  // Compiled URI template, empty if the URI has no parameters. Literal parts
+  // and parameter names are ranges of _uri.
+  enum PathPartType : uint8_t {
+    PATH_LITERAL,
+    PATH_SEGMENT,  // {name}, one non-empty segment
+    PATH_REST      // *name, the rest of the path
+  };
+  struct PathPart {
+    uint16_t start;
+    uint16_t len;
+    PathPartType type;
+  };
+  std::vector<PathPart> _template;
+
+  void _compileTemplate();
+  bool _matchTemplate(AsyncWebServerRequest *request, bool capture) const;
 
 public:
   AsyncCallbackWebHandler() : _uri(), _method(HTTP_ANY), _onRequest(NULL), _onUpload(NULL), _onBody(NULL), _isRegex(false) {}
+  // Besides plain, "prefix*", "/*.ext" and (with ASYNCWEBSERVER_REGEX)
+  // "^regex$" URIs this takes templates: "/cam/{id}/capture" matches one
+  // segment per {name}, "/dav/*path" the rest of the path after "/dav/".
+  // A template matches the whole URL, the parameters are read with pathArg().
   void setUri(const String &uri);
+  // Index of the template parameter, -1 if there is none of that name
+  int pathArgIndex(const char *name) const;
   void setMethod(WebRequestMethodComposite method) {
     _method = method;
   }
@@ -2161,6 +2372,11 @@ public:
   bool isRequestHandlerTrivial() const override final {
     return !_onRequest;
   }
+  // The server reads the URI when it compiles its routes, set it before
+  // the handler is added
+  AsyncCallbackWebHandler *_routable() override final {
+    return this;
+  }
 };
 
 #endif /* ASYNCWEBSERVERHANDLERIMPL_H_ */
@@ -2348,4 +2564,122 @@ public:
 
 #endif /* ASYNCWEBSERVERRESPONSEIMPL_H_ */
 
+// *** AsyncJson.h ***
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright 2016-2025 Hristo Gochkov, Mathieu Carbou, Emil Muratov
+
+#ifndef ASYNC_JSON_H_
+#define ASYNC_JSON_H_
+
+#if __has_include("ArduinoJson.h")
+#include <ArduinoJson.h>
+#if ARDUINOJSON_VERSION_MAJOR >= 5
+#define ASYNC_JSON_SUPPORT 1
+#else
+#define ASYNC_JSON_SUPPORT 0
+#endif  // ARDUINOJSON_VERSION_MAJOR >= 5
+#endif  // __has_include("ArduinoJson.h")
+
+#if ASYNC_JSON_SUPPORT == 1
+//#include "ChunkPrint.h"
+
+#if ARDUINOJSON_VERSION_MAJOR == 6
+#ifndef DYNAMIC_JSON_DOCUMENT_SIZE
+#define DYNAMIC_JSON_DOCUMENT_SIZE 1024
+#endif
+#endif
+
+class AsyncJsonResponse : public AsyncAbstractResponse {
+protected:
+#if ARDUINOJSON_VERSION_MAJOR == 5
+  DynamicJsonBuffer _jsonBuffer;
+#elif ARDUINOJSON_VERSION_MAJOR == 6
+  DynamicJsonDocument _jsonBuffer;
+#else
+  JsonDocument _jsonBuffer;
+#endif
+
+  JsonVariant _root;
+  bool _isValid;
+
+public:
+#if ARDUINOJSON_VERSION_MAJOR == 6
+  AsyncJsonResponse(bool isArray = false, size_t maxJsonBufferSize = DYNAMIC_JSON_DOCUMENT_SIZE);
+#else
+  AsyncJsonResponse(bool isArray = false);
+#endif
+  JsonVariant &getRoot() {
+    return _root;
+  }
+  bool _sourceValid() const {
+    return _isValid;
+  }
+  size_t setLength();
+  size_t getSize() const {
+    return _jsonBuffer.size();
+  }
+  size_t _fillBuffer(uint8_t *data, size_t len);
+#if ARDUINOJSON_VERSION_MAJOR >= 6
+  bool overflowed() const {
+    return _jsonBuffer.overflowed();
+  }
+#endif
+};
+
+class PrettyAsyncJsonResponse : public AsyncJsonResponse {
+public:
+#if ARDUINOJSON_VERSION_MAJOR == 6
+  PrettyAsyncJsonResponse(bool isArray = false, size_t maxJsonBufferSize = DYNAMIC_JSON_DOCUMENT_SIZE);
+#else
+  PrettyAsyncJsonResponse(bool isArray = false);
+#endif
+  size_t setLength();
+  size_t _fillBuffer(uint8_t *data, size_t len);
+};
+
+typedef std::function<void(AsyncWebServerRequest *request, JsonVariant &json)> ArJsonRequestHandlerFunction;
+
+class AsyncCallbackJsonWebHandler : public AsyncWebHandler {
+protected:
+  String _uri;
+  WebRequestMethodComposite _method;
+  ArJsonRequestHandlerFunction _onRequest;
+#if ARDUINOJSON_VERSION_MAJOR == 6
+  size_t maxJsonBufferSize;
+#endif
+  size_t _maxContentLength;
+
+public:
+#if ARDUINOJSON_VERSION_MAJOR == 6
+  AsyncCallbackJsonWebHandler(const String &uri, ArJsonRequestHandlerFunction onRequest = nullptr, size_t maxJsonBufferSize = DYNAMIC_JSON_DOCUMENT_SIZE);
+#else
+  AsyncCallbackJsonWebHandler(const String &uri, ArJsonRequestHandlerFunction onRequest = nullptr);
+#endif
+
+  void setMethod(WebRequestMethodComposite method) {
+    _method = method;
+  }
+  void setMaxContentLength(int maxContentLength) {
+    _maxContentLength = maxContentLength;
+  }
+  void onRequest(ArJsonRequestHandlerFunction fn) {
+    _onRequest = fn;
+  }
+
+  bool canHandle(AsyncWebServerRequest *request) const override final;
+  void handleRequest(AsyncWebServerRequest *request) override final;
+  void handleUpload(
+    __unused AsyncWebServerRequest *request, __unused const String &filename, __unused size_t index, __unused uint8_t *data, __unused size_t len,
+    __unused bool final
+  ) override final {}
+  void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) override final;
+  bool isRequestHandlerTrivial() const override final {
+    return !_onRequest;
+  }
+};
+
+#endif  // ASYNC_JSON_SUPPORT == 1
+
+#endif  // ASYNC_JSON_H_
+
 #endif /* _AsyncWebServer_H_ */
@@ -169,6 +169,9 @@ void setup() {
 
   // Create WebDav-Server to SD-Card
   dav = new AsyncWebdav("/dav", SD_MMC);
+  // Other request headers than these and the ones the server reads are dropped
+  server.addInterestingHeader("Depth");
+  server.addInterestingHeader("Destination");
 
   // Start Camera config
   camera_cfg(&server);
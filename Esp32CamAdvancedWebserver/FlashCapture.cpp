@@ -0,0 +1,90 @@
+#include "FlashCapture.h"
+#include "esp_timer.h"
+
+FlashCapture flashCapture;
+
+bool FlashCapture::begin(void (*led)(bool on)) {
+  if (_task) {
+    return false;
+  }
+  _led = led;
+  // Below the camera producer it waits for
+  if (xTaskCreate(_captureTask, "flash_capture", CAPTURE_STACK_SIZE, this, 3, &_task) != pdPASS) {
+    log_e("Failed to start flash capture");
+    _task = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void FlashCapture::capture(AsyncWebServerRequest *request, capture_send_t send) {
+  if (!_task) {
+    send(request, frameBroker.latest());
+    return;
+  }
+
+  request->pause();
+  request->onDisconnect([this, request]() {
+    std::lock_guard<std::mutex> lock(_lock);
+    _waiters.remove_if([request](const Waiter &w) {
+      return w.request == request;
+    });
+  });
+
+  std::lock_guard<std::mutex> lock(_lock);
+  _waiters.push_back({request, send});
+  _wake.notify_one();
+}
+
+void FlashCapture::_captureTask(void *arg) {
+  static_cast<FlashCapture *>(arg)->_run();
+}
+
+void FlashCapture::_run() {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(_lock);
+      _wake.wait(lock, [this] {
+        return !_waiters.empty();
+      });
+    }
+
+    FrameLease frame = _flashFrame();
+    if (!frame) {
+      log_e("Camera capture failed");
+    }
+
+    // Everyone who asked before the frame was in gets it
+    std::lock_guard<std::mutex> lock(_lock);
+    for (Waiter &w : _waiters) {
+      w.send(w.request, frame);
+    }
+    _waiters.clear();
+  }
+}
+
+FrameLease FlashCapture::_flashFrame() {
+  int64_t on = esp_timer_get_time();
+  _led(true);
+
+  // Frames already in the pipeline were exposed without the flash, skip
+  // them by their start of frame timestamp (esp_timer time)
+  int64_t settled = on + CAPTURE_FLASH_SETTLE_MS * 1000LL;
+  uint32_t seq = frameBroker.sequence();
+  FrameLease frame;
+  while (esp_timer_get_time() - on < CAPTURE_TIMEOUT_MS * 1000LL) {
+    FrameLease next = frameBroker.wait(seq, CAPTURE_TIMEOUT_MS);
+    if (!next) {
+      break;
+    }
+    seq = next->seq;
+    const struct timeval &ts = next->fb->timestamp;
+    if ((int64_t)ts.tv_sec * 1000000 + ts.tv_usec >= settled) {
+      frame = next;
+      break;
+    }
+  }
+
+  _led(false);
+  return frame;
+}
@@ -0,0 +1,63 @@
+#ifndef FLASH_CAPTURE_H
+#define FLASH_CAPTURE_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <list>
+#include <mutex>
+#include <condition_variable>
+#include "FrameBroker.h"
+
+// A frame is taken once its exposure started this long after the flash was
+// switched on. The frame timestamp marks the start of readout, the margin
+// covers the exposure time before it and the AEC catching up with the light.
+#ifndef CAPTURE_FLASH_SETTLE_MS
+#define CAPTURE_FLASH_SETTLE_MS 100
+#endif
+// Waiting requests get an empty lease if no such frame arrives in time.
+#ifndef CAPTURE_TIMEOUT_MS
+#define CAPTURE_TIMEOUT_MS 2000
+#endif
+#ifndef CAPTURE_STACK_SIZE
+#define CAPTURE_STACK_SIZE 6144
+#endif
+
+// Called with the resumed request on the capture task, frame is empty if the
+// capture failed.
+typedef void (*capture_send_t)(AsyncWebServerRequest *request, FrameLease frame);
+
+// Flash snapshots without blocking async_tcp. capture() pauses the request
+// and hands it to a task that switches the flash on, waits for the first
+// frame exposed with it (judged by the frame timestamp) and switches it off
+// again. Requests arriving before that frame is in share it, so concurrent
+// snapshots cost one flash.
+class FlashCapture {
+public:
+  // led switches the flash, it is called from the capture task.
+  bool begin(void (*led)(bool on));
+
+  void capture(AsyncWebServerRequest *request, capture_send_t send);
+
+private:
+  struct Waiter {
+    AsyncWebServerRequest *request;
+    capture_send_t send;
+  };
+
+  static void _captureTask(void *arg);
+  void _run();
+  FrameLease _flashFrame();
+
+  void (*_led)(bool on) = nullptr;
+  TaskHandle_t _task = nullptr;
+
+  // Also held while the waiters are resumed, so a disconnect cannot delete a
+  // request that is being sent to
+  std::mutex _lock;
+  std::condition_variable _wake;
+  std::list<Waiter> _waiters;
+};
+
+extern FlashCapture flashCapture;
+
+#endif
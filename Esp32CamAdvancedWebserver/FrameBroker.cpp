@@ -0,0 +1,251 @@
+#include "FrameBroker.h"
+#include "esp_timer.h"
+#include "CameraMetrics.h"
+
+FrameBroker frameBroker;
+
+#if defined(CAMERA_SIMULATOR)
+#include "CameraSimulator.h"
+
+static camera_fb_t *camera_fb_get() {
+  return cameraSimulator.active() ? cameraSimulator.get() : esp_camera_fb_get();
+}
+
+static void camera_fb_return(camera_fb_t *fb) {
+  if (cameraSimulator.active()) {
+    cameraSimulator.put(fb);
+  } else {
+    esp_camera_fb_return(fb);
+  }
+}
+#else
+#define camera_fb_get esp_camera_fb_get
+#define camera_fb_return esp_camera_fb_return
+#endif
+
+void FrameBroker::begin(size_t fbCount, int quality) {
+  _fbCount = fbCount ? fbCount : 1;
+  _baseQuality = quality;
+}
+
+bool FrameBroker::startProducer(uint8_t fps) {
+  if (_task) {
+    return true;
+  }
+  if (_fbCount < 2) {
+    log_e("Camera producer needs at least two frame buffers");
+    return false;
+  }
+  setFrameRate(fps);
+  if (xTaskCreatePinnedToCore(_producerTask, "camera", CAMERA_PRODUCER_STACK_SIZE, this, CAMERA_PRODUCER_PRIORITY, &_task, CAMERA_PRODUCER_CORE) != pdPASS) {
+    log_e("Failed to start camera producer");
+    _task = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void FrameBroker::setFrameRate(uint8_t fps) {
+  _fps = fps;
+}
+
+FrameLease FrameBroker::acquire(uint32_t after, uint32_t maxAgeMs) {
+  std::lock_guard<std::mutex> lock(_lock);
+
+  if (_task) {
+    if (_latest && _latest->seq > after) {
+      return _latest;
+    }
+    return FrameLease();
+  }
+
+  FrameLease newest = _newest.lock();
+  if (newest && newest->seq > after && (esp_timer_get_time() - newest->grabbed) <= (int64_t)maxAgeMs * 1000) {
+    return newest;
+  }
+
+  // All driver buffers are leased out, esp_camera_fb_get() would block until
+  // one of them is returned. Hand out the newest frame if the caller has not
+  // seen it yet, otherwise let the caller try again later.
+  if (_held >= _fbCount) {
+    if (newest && newest->seq > after) {
+      return newest;
+    }
+    return FrameLease();
+  }
+
+  newest.reset();
+  return _grab();
+}
+
+FrameLease FrameBroker::wait(uint32_t after, uint32_t timeoutMs) {
+  if (!_task) {
+    return acquire(after, 0);
+  }
+
+  std::unique_lock<std::mutex> lock(_lock);
+  _published.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, after]() {
+    return _latest && _latest->seq > after;
+  });
+  if (_latest && _latest->seq > after) {
+    return _latest;
+  }
+  return FrameLease();
+}
+
+void FrameBroker::setQuality(int quality) {
+  _baseQuality = quality;
+  _degrade = 0xFF;
+}
+
+void FrameBroker::requestDegrade(uint8_t from, uint8_t to) {
+  if (from > CAMERA_DEGRADE_STEPS || to > CAMERA_DEGRADE_STEPS || from == to) {
+    return;
+  }
+  if (from) {
+    _degradeVotes[from]--;
+  }
+  if (to) {
+    _degradeVotes[to]++;
+  }
+}
+
+void FrameBroker::subscribe(FrameListener *listener) {
+  std::lock_guard<std::mutex> lock(_listenersLock);
+  _listeners.push_back(listener);
+}
+
+void FrameBroker::unsubscribe(FrameListener *listener) {
+  std::lock_guard<std::mutex> lock(_listenersLock);
+  _listeners.remove(listener);
+}
+
+void FrameBroker::configure(std::function<void(sensor_t *)> fn) {
+  if (!_task) {
+    fn(esp_camera_sensor_get());
+    return;
+  }
+  std::lock_guard<std::mutex> lock(_lock);
+  _configure.push_back(std::move(fn));
+}
+
+void FrameBroker::_applyQuality(sensor_t *s) {
+  uint8_t step = 0;
+  for (uint8_t i = CAMERA_DEGRADE_STEPS; i > 0; i--) {
+    if (_degradeVotes[i]) {
+      step = i;
+      break;
+    }
+  }
+  if (step == _degrade || !s || s->pixformat != PIXFORMAT_JPEG) {
+    return;
+  }
+
+  int quality = _baseQuality + step * CAMERA_QUALITY_STEP;
+  if (quality > 63) {
+    quality = 63;
+  }
+  if (step != 0 || _degrade != 0xFF) {
+    log_i("Stream quality step %u -> JPEG quality %d", step, quality);
+  }
+  s->set_quality(s, quality);
+  _degrade = step;
+}
+
+FrameLease FrameBroker::_grab() {
+  sensor_t *s = esp_camera_sensor_get();
+  _applyQuality(s);
+
+  int64_t start = esp_timer_get_time();
+  camera_fb_t *fb = camera_fb_get();
+  if (!fb) {
+    log_e("Camera capture failed");
+    return FrameLease();
+  }
+  int64_t grabbed = esp_timer_get_time();
+  metrics_record(METRIC_GRAB_MS, (grabbed - start) / 1000);
+  metrics_record(METRIC_JPEG_SIZE, fb->len);
+
+  uint32_t seq = _seq + 1;
+  if (!seq) {
+    seq = 1;
+  }
+  CameraFrame *frame = new (std::nothrow) CameraFrame{fb, seq, grabbed, (uint8_t)(s ? s->status.quality : 0)};
+  if (!frame) {
+    camera_fb_return(fb);
+    log_e("Failed to allocate");
+    return FrameLease();
+  }
+  _seq = seq;
+
+  _held++;
+  FrameLease lease(frame, [this](const CameraFrame *f) {
+    camera_fb_return(f->fb);
+    _held--;
+    if (_task) {
+      xTaskNotifyGive(_task);  // a buffer is free again
+    }
+    delete f;
+  });
+  _newest = lease;
+  return lease;
+}
+
+void FrameBroker::_producerTask(void *arg) {
+  static_cast<FrameBroker *>(arg)->_produce();
+}
+
+void FrameBroker::_produce() {
+  TickType_t last = xTaskGetTickCount();
+
+  for (;;) {
+    uint8_t fps = _fps;
+    if (fps) {
+      vTaskDelayUntil(&last, pdMS_TO_TICKS(1000 / fps));
+    } else {
+      last = xTaskGetTickCount();
+    }
+
+    // The driver needs a free buffer to capture into. If nobody but us still
+    // reads the published frame, let it go, otherwise wait for a consumer to
+    // return one.
+    while (_held >= _fbCount) {
+      {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (_latest && _latest.use_count() == 1) {
+          _latest.reset();
+          continue;
+        }
+      }
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    }
+
+    FrameLease frame = _grab();
+
+    // Also when the grab failed, a new setting may be what fixes it
+    std::list<std::function<void(sensor_t *)>> configure;
+    {
+      std::lock_guard<std::mutex> lock(_lock);
+      configure.swap(_configure);
+    }
+    for (const std::function<void(sensor_t *)> &fn : configure) {
+      fn(esp_camera_sensor_get());
+    }
+
+    if (!frame) {
+      vTaskDelay(pdMS_TO_TICKS(100));
+      continue;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(_lock);
+      _latest = std::move(frame);
+    }
+    _published.notify_all();
+
+    std::lock_guard<std::mutex> lock(_listenersLock);
+    for (FrameListener *listener : _listeners) {
+      listener->onFrame();
+    }
+  }
+}
@@ -0,0 +1,150 @@
+#ifndef FRAME_BROKER_H
+#define FRAME_BROKER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include "esp_camera.h"
+
+// Core and priority of the camera producer task. Core 1 keeps it away from
+// the WiFi stack, async_tcp runs unpinned.
+#ifndef CAMERA_PRODUCER_CORE
+#define CAMERA_PRODUCER_CORE 1
+#endif
+#ifndef CAMERA_PRODUCER_PRIORITY
+#define CAMERA_PRODUCER_PRIORITY 4
+#endif
+#ifndef CAMERA_PRODUCER_STACK_SIZE
+#define CAMERA_PRODUCER_STACK_SIZE 4096
+#endif
+
+// Stream clients that cannot keep up may ask for up to CAMERA_DEGRADE_STEPS
+// steps of lower JPEG quality, each step adds CAMERA_QUALITY_STEP to the
+// quality value (higher value = stronger compression).
+#ifndef CAMERA_DEGRADE_STEPS
+#define CAMERA_DEGRADE_STEPS 3
+#endif
+#ifndef CAMERA_QUALITY_STEP
+#define CAMERA_QUALITY_STEP 8
+#endif
+
+// One grabbed camera frame. The buffer goes back to the driver when the last
+// FrameLease referencing it is dropped.
+struct CameraFrame {
+  camera_fb_t *fb;
+  uint32_t seq;      // monotonically increasing, 0 is never used
+  int64_t grabbed;   // esp_timer_get_time() when the frame was grabbed
+  uint8_t quality;   // JPEG quality the sensor was set to
+};
+
+typedef std::shared_ptr<const CameraFrame> FrameLease;
+
+// Notified from the producer task whenever a new frame was published.
+// Implementations must not block, the next grab waits for them.
+class FrameListener {
+public:
+  virtual ~FrameListener() {}
+  virtual void onFrame() = 0;
+};
+
+// Hands out shared leases on camera frames so that several consumers
+// (stream clients, capture requests) are served from one esp_camera_fb_get().
+//
+// Without a producer task frames are grabbed on demand by the first consumer
+// that needs a new one. With startProducer() a dedicated task grabs
+// continuously and consumers only ever take the newest completed frame.
+class FrameBroker {
+public:
+  // fbCount must match camera_config_t::fb_count, the broker never holds more
+  // leases than the driver has buffers (otherwise esp_camera_fb_get() blocks).
+  void begin(size_t fbCount, int quality);
+
+  // Starts the producer task. Needs at least two frame buffers, one for the
+  // published frame and one for the driver to fill. fps = 0 means sensor rate.
+  bool startProducer(uint8_t fps = 0);
+  void setFrameRate(uint8_t fps);
+  uint8_t frameRate() const {
+    return _fps;
+  }
+
+  // Returns a lease on a frame with a sequence number greater than `after`,
+  // or an empty lease if there is none right now.
+  // On demand the newest frame is shared if it is still leased by someone else
+  // and not older than maxAgeMs, otherwise a new frame is grabbed. With the
+  // producer running this never blocks and maxAgeMs is ignored.
+  FrameLease acquire(uint32_t after = 0, uint32_t maxAgeMs = 100);
+
+  // Like acquire(), but waits up to timeoutMs for the producer to publish a
+  // frame newer than `after`.
+  FrameLease wait(uint32_t after, uint32_t timeoutMs);
+
+  // Newest completed frame, waits for the first one if needed.
+  FrameLease latest() {
+    return wait(0, 1000);
+  }
+
+  // JPEG quality chosen by the user, the producer encodes with this plus the
+  // degradation requested by struggling stream clients.
+  void setQuality(int quality);
+
+  // A stream client moves its vote from one degradation step to another,
+  // the strongest vote wins. Step 0 is full quality.
+  void requestDegrade(uint8_t from, uint8_t to);
+
+  // Queues fn to run on the producer task right after the next grab, so that
+  // a batch of sensor settings is written in one go between two frames.
+  // Returns without waiting for it, fn reports back itself. Without the
+  // producer fn runs right away on the calling task.
+  void configure(std::function<void(sensor_t *)> fn);
+
+  void subscribe(FrameListener *listener);
+  void unsubscribe(FrameListener *listener);
+
+  // Sequence number of the newest frame grabbed so far.
+  uint32_t sequence() const {
+    return _seq;
+  }
+
+  // Number of frame buffers currently leased out.
+  size_t held() const {
+    return _held;
+  }
+
+  bool producing() const {
+    return _task != nullptr;
+  }
+
+private:
+  FrameLease _grab();
+  void _applyQuality(sensor_t *s);
+  void _produce();
+  static void _producerTask(void *arg);
+
+  std::mutex _lock;
+  std::condition_variable _published;
+  std::weak_ptr<const CameraFrame> _newest;
+  FrameLease _latest;  // only used by the producer, keeps the newest frame alive
+  volatile uint32_t _seq = 0;
+  size_t _fbCount = 1;
+  std::atomic<size_t> _held{0};
+
+  volatile int _baseQuality = 12;
+  uint8_t _degrade = 0xFF;  // step currently applied to the sensor, 0xFF = apply again
+  std::atomic<uint16_t> _degradeVotes[CAMERA_DEGRADE_STEPS + 1] = {};
+
+  TaskHandle_t _task = nullptr;
+  volatile uint8_t _fps = 0;
+
+  std::list<std::function<void(sensor_t *)>> _configure;  // waiting for the producer
+
+  std::mutex _listenersLock;
+  std::list<FrameListener *> _listeners;
+};
+
+extern FrameBroker frameBroker;
+
+#endif
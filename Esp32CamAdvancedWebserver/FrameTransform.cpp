@@ -0,0 +1,261 @@
+#include "FrameTransform.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+// Larger boxes are sampled with a 16x16 box, far beyond anything the
+// thumbnails and crops here need
+#define FRAME_TRANSFORM_MAX_BOX 16
+
+// RGB565 frames are big endian
+static inline uint16_t load565(const uint8_t *p) {
+  return (p[0] << 8) | p[1];
+}
+
+static inline void store565(uint8_t *p, uint32_t r, uint32_t g, uint32_t b) {
+  uint16_t v = (r << 11) | (g << 5) | b;
+  p[0] = v >> 8;
+  p[1] = v;
+}
+
+FrameTransform::~FrameTransform() {
+  free(_strip);
+}
+
+bool FrameTransform::begin(const uint8_t *src, uint16_t width, uint16_t height, pixformat_t format, const TransformParams &params) {
+  free(_strip);
+  _strip = nullptr;
+  _stripY = -1;
+
+  if (format == PIXFORMAT_RGB565) {
+    _bpp = 2;
+  } else if (format == PIXFORMAT_GRAYSCALE) {
+    _bpp = 1;
+  } else {
+    return false;
+  }
+
+  if (params.cropX >= width || params.cropY >= height) {
+    return false;
+  }
+  uint16_t cw = params.cropWidth ? params.cropWidth : width - params.cropX;
+  uint16_t ch = params.cropHeight ? params.cropHeight : height - params.cropY;
+  if (params.cropX + cw > width || params.cropY + ch > height) {
+    return false;
+  }
+
+  bool swap = params.rotation == 90 || params.rotation == 270;
+  if (!swap && params.rotation != 0 && params.rotation != 180) {
+    return false;
+  }
+  // Crop size after rotation
+  uint16_t rw = swap ? ch : cw;
+  uint16_t rh = swap ? cw : ch;
+
+  uint16_t ow = params.width;
+  uint16_t oh = params.height;
+  if (!ow && !oh) {
+    ow = rw;
+    oh = rh;
+  } else if (!ow) {
+    ow = std::max(1, rw * oh / rh);
+  } else if (!oh) {
+    oh = std::max(1, rh * ow / rw);
+  }
+  if (ow > rw || oh > rh) {
+    return false;
+  }
+
+  _src = src;
+  _srcWidth = width;
+  _format = format;
+  _width = ow;
+  _height = oh;
+  _bilinear = params.bilinear;
+  _left = params.cropX;
+  _top = params.cropY;
+  _right = params.cropX + cw;
+  _bottom = params.cropY + ch;
+
+  // Output pixel size in the rotated crop
+  int32_t stepX = ((int32_t)rw << 16) / ow;
+  int32_t stepY = ((int32_t)rh << 16) / oh;
+  int32_t left = (int32_t)_left << 16;
+  int32_t top = (int32_t)_top << 16;
+  int32_t right = (int32_t)_right << 16;
+  int32_t bottom = (int32_t)_bottom << 16;
+
+  switch (params.rotation) {
+    case 0:
+      _x0 = left + stepX / 2;
+      _y0 = top + stepY / 2;
+      _dxCol = stepX;
+      _dyCol = 0;
+      _dxRow = 0;
+      _dyRow = stepY;
+      break;
+    case 90:  // output (0, 0) is the bottom left source pixel
+      _x0 = left + stepY / 2;
+      _y0 = bottom - stepX / 2;
+      _dxCol = 0;
+      _dyCol = -stepX;
+      _dxRow = stepY;
+      _dyRow = 0;
+      break;
+    case 180:
+      _x0 = right - stepX / 2;
+      _y0 = bottom - stepY / 2;
+      _dxCol = -stepX;
+      _dyCol = 0;
+      _dxRow = 0;
+      _dyRow = -stepY;
+      break;
+    case 270:  // output (0, 0) is the top right source pixel
+      _x0 = right - stepY / 2;
+      _y0 = top + stepX / 2;
+      _dxCol = 0;
+      _dyCol = stepX;
+      _dxRow = -stepY;
+      _dyRow = 0;
+      break;
+  }
+
+  int32_t boxX = swap ? stepY : stepX;
+  int32_t boxY = swap ? stepX : stepY;
+  _boxWidth = std::min<int32_t>(std::max<int32_t>((boxX + 0x8000) >> 16, 1), FRAME_TRANSFORM_MAX_BOX);
+  _boxHeight = std::min<int32_t>(std::max<int32_t>((boxY + 0x8000) >> 16, 1), FRAME_TRANSFORM_MAX_BOX);
+  _boxScale = 65536 / (_boxWidth * _boxHeight);
+  return true;
+}
+
+template<int BPP, bool BILINEAR>
+void FrameTransform::_renderRow(int32_t x, int32_t y, uint16_t count, uint8_t *out) const {
+  size_t stride = (size_t)_srcWidth * BPP;
+
+  for (uint16_t i = 0; i < count; i++, x += _dxCol, y += _dyCol, out += BPP) {
+    if (BILINEAR) {
+      // Four neighbours of the centre, weights in 1/256
+      int32_t px = x - 0x8000;
+      int32_t py = y - 0x8000;
+      int x0 = px >> 16;
+      int y0 = py >> 16;
+      uint32_t fx = (px >> 8) & 0xFF;
+      uint32_t fy = (py >> 8) & 0xFF;
+      if (x0 < _left) {
+        x0 = _left;
+        fx = 0;
+      }
+      if (y0 < _top) {
+        y0 = _top;
+        fy = 0;
+      }
+      int x1 = std::min(x0 + 1, _right - 1);
+      int y1 = std::min(y0 + 1, _bottom - 1);
+      x0 = std::min(x0, x1);
+      y0 = std::min(y0, y1);
+
+      uint32_t w00 = (256 - fx) * (256 - fy);
+      uint32_t w01 = fx * (256 - fy);
+      uint32_t w10 = (256 - fx) * fy;
+      uint32_t w11 = fx * fy;
+      const uint8_t *r0 = _src + y0 * stride;
+      const uint8_t *r1 = _src + y1 * stride;
+
+      if (BPP == 1) {
+        out[0] = (r0[x0] * w00 + r0[x1] * w01 + r1[x0] * w10 + r1[x1] * w11 + 0x8000) >> 16;
+      } else {
+        uint16_t a = load565(r0 + x0 * 2);
+        uint16_t b = load565(r0 + x1 * 2);
+        uint16_t c = load565(r1 + x0 * 2);
+        uint16_t d = load565(r1 + x1 * 2);
+        uint32_t r = ((a >> 11) * w00 + (b >> 11) * w01 + (c >> 11) * w10 + (d >> 11) * w11 + 0x8000) >> 16;
+        uint32_t g = (((a >> 5) & 63) * w00 + ((b >> 5) & 63) * w01 + ((c >> 5) & 63) * w10 + ((d >> 5) & 63) * w11 + 0x8000) >> 16;
+        uint32_t bl = ((a & 31) * w00 + (b & 31) * w01 + (c & 31) * w10 + (d & 31) * w11 + 0x8000) >> 16;
+        store565(out, r, g, bl);
+      }
+    } else {
+      // Box around the centre, kept inside the crop
+      int bx = (x - _boxWidth * 0x8000 + 0x8000) >> 16;
+      int by = (y - _boxHeight * 0x8000 + 0x8000) >> 16;
+      bx = std::min(std::max(bx, (int)_left), _right - _boxWidth);
+      by = std::min(std::max(by, (int)_top), _bottom - _boxHeight);
+
+      const uint8_t *p = _src + by * stride + bx * BPP;
+      if (BPP == 1) {
+        uint32_t sum = 0;
+        for (int j = 0; j < _boxHeight; j++, p += stride) {
+          for (int k = 0; k < _boxWidth; k++) {
+            sum += p[k];
+          }
+        }
+        out[0] = (sum * _boxScale + 0x8000) >> 16;
+      } else {
+        uint32_t r = 0, g = 0, b = 0;
+        for (int j = 0; j < _boxHeight; j++, p += stride) {
+          for (int k = 0; k < _boxWidth; k++) {
+            uint16_t v = load565(p + k * 2);
+            r += v >> 11;
+            g += (v >> 5) & 63;
+            b += v & 31;
+          }
+        }
+        store565(out, (r * _boxScale + 0x8000) >> 16, (g * _boxScale + 0x8000) >> 16, (b * _boxScale + 0x8000) >> 16);
+      }
+    }
+  }
+}
+
+void FrameTransform::render(uint16_t y, uint16_t lines, uint8_t *dst) const {
+  size_t stride = (size_t)_width * _bpp;
+
+  // Tile by tile, all rows of a tile before moving right
+  for (uint16_t tx = 0; tx < _width; tx += FRAME_TRANSFORM_TILE) {
+    uint16_t count = std::min<uint16_t>(FRAME_TRANSFORM_TILE, _width - tx);
+    for (uint16_t oy = y; oy < y + lines; oy++) {
+      int32_t sx = _x0 + tx * _dxCol + oy * _dxRow;
+      int32_t sy = _y0 + tx * _dyCol + oy * _dyRow;
+      uint8_t *out = dst + (oy - y) * stride + tx * _bpp;
+
+      if (_bpp == 1) {
+        _bilinear ? _renderRow<1, true>(sx, sy, count, out) : _renderRow<1, false>(sx, sy, count, out);
+      } else {
+        _bilinear ? _renderRow<2, true>(sx, sy, count, out) : _renderRow<2, false>(sx, sy, count, out);
+      }
+    }
+  }
+}
+
+const uint8_t *FrameTransform::row(uint16_t y) {
+  size_t stride = (size_t)_width * _bpp;
+  if (!_strip) {
+    _strip = (uint8_t *)malloc(stride * FRAME_TRANSFORM_STRIP);
+    if (!_strip) {
+      return nullptr;
+    }
+  }
+
+  int32_t start = y - y % FRAME_TRANSFORM_STRIP;
+  if (start != _stripY) {
+    render(start, std::min<int32_t>(FRAME_TRANSFORM_STRIP, _height - start), _strip);
+    _stripY = start;
+  }
+  return _strip + (y - start) * stride;
+}
+
+size_t FrameTransform::read(uint8_t *buf, size_t len, size_t index) {
+  size_t stride = (size_t)_width * _bpp;
+  size_t n = 0;
+
+  while (n < len && index < size()) {
+    const uint8_t *r = row(index / stride);
+    if (!r) {
+      break;
+    }
+    size_t offset = index % stride;
+    size_t count = std::min(stride - offset, len - n);
+    memcpy(buf + n, r + offset, count);
+    n += count;
+    index += count;
+  }
+  return n;
+}
@@ -0,0 +1,107 @@
+#ifndef FRAME_TRANSFORM_H
+#define FRAME_TRANSFORM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_camera.h"
+
+// Output columns rendered per pass. Together with the strip height this is
+// the output tile, small enough that the source pixels it touches stay in
+// cache even when rotating, where output rows run along source columns.
+#ifndef FRAME_TRANSFORM_TILE
+#define FRAME_TRANSFORM_TILE 32
+#endif
+
+// Output rows rendered at a time, one MCU row of the JPEG encoder
+#define FRAME_TRANSFORM_STRIP 16
+
+struct TransformParams {
+  uint16_t cropX = 0;
+  uint16_t cropY = 0;
+  uint16_t cropWidth = 0;   // 0 = to the right edge
+  uint16_t cropHeight = 0;  // 0 = to the bottom edge
+  uint16_t rotation = 0;    // clockwise, 0, 90, 180 or 270
+  uint16_t width = 0;       // output size after rotation, 0 = keep the aspect
+  uint16_t height = 0;      // ratio or, if both are 0, the size of the crop
+  bool bilinear = false;    // box filter otherwise
+};
+
+// Per request crop, rotation and downscale of an RGB565 or greyscale frame.
+// Output pixels are in the source format. Nothing is rendered up front: the
+// output is produced one strip of rows at a time, tile by tile, when row()
+// or read() reach it, so the working set is one strip instead of a frame.
+//
+// Every output pixel is an affine function of its position, rotation just
+// swaps and mirrors the axes. The box filter averages the source pixels one
+// output pixel covers, bilinear samples at its centre.
+class FrameTransform {
+public:
+  FrameTransform() {}
+  FrameTransform(const FrameTransform &) = delete;
+  FrameTransform &operator=(const FrameTransform &) = delete;
+  ~FrameTransform();
+
+  // Returns false for other formats, crops outside the frame and for
+  // output sizes larger than the (rotated) crop.
+  bool begin(const uint8_t *src, uint16_t width, uint16_t height, pixformat_t format, const TransformParams &params);
+
+  uint16_t width() const {
+    return _width;
+  }
+  uint16_t height() const {
+    return _height;
+  }
+  pixformat_t format() const {
+    return _format;
+  }
+  size_t size() const {
+    return (size_t)_width * _height * _bpp;
+  }
+
+  // Output row y, rendered with its strip on first access. The pointer is
+  // valid until a row of another strip is requested. nullptr if out of memory.
+  const uint8_t *row(uint16_t y);
+
+  // Copies up to len bytes of the output starting at index, returns the count.
+  size_t read(uint8_t *buf, size_t len, size_t index);
+
+  // Renders output rows [y, y + lines) to dst, rows are width() pixels apart.
+  void render(uint16_t y, uint16_t lines, uint8_t *dst) const;
+
+private:
+  template<int BPP, bool BILINEAR>
+  void _renderRow(int32_t x, int32_t y, uint16_t count, uint8_t *out) const;
+
+  const uint8_t *_src = nullptr;
+  uint16_t _srcWidth = 0;
+  pixformat_t _format;
+  uint8_t _bpp = 0;
+  uint16_t _width = 0;
+  uint16_t _height = 0;
+  bool _bilinear = false;
+
+  // Source window, pixels outside are never read
+  int16_t _left = 0;
+  int16_t _top = 0;
+  int16_t _right = 0;   // exclusive
+  int16_t _bottom = 0;  // exclusive
+
+  // Source position of the centre of output pixel (0, 0) and its change per
+  // output column and row, 16.16 fixed point
+  int32_t _x0 = 0;
+  int32_t _y0 = 0;
+  int32_t _dxCol = 0;
+  int32_t _dyCol = 0;
+  int32_t _dxRow = 0;
+  int32_t _dyRow = 0;
+
+  // Box filter size in source pixels
+  uint8_t _boxWidth = 1;
+  uint8_t _boxHeight = 1;
+  uint32_t _boxScale = 0;  // 65536 / pixels in the box
+
+  uint8_t *_strip = nullptr;
+  int32_t _stripY = -1;
+};
+
+#endif
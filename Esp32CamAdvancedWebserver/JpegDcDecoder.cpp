@@ -0,0 +1,363 @@
+#include "JpegDcDecoder.h"
+#include <string.h>
+
+static uint16_t be16(const uint8_t *p) {
+  return (p[0] << 8) | p[1];
+}
+
+bool JpegDcDecoder::decode(const uint8_t *jpeg, size_t len) {
+  const uint8_t *p = jpeg;
+  const uint8_t *end = jpeg + len;
+
+  if (len < 4 || p[0] != 0xFF || p[1] != 0xD8) {
+    return false;
+  }
+  p += 2;
+
+  for (int i = 0; i < 4; i++) {
+    _dc[i].defined = false;
+    _ac[i].defined = false;
+    _dcQuant[i] = 1;
+  }
+  _compCount = 0;
+  _restartInterval = 0;
+
+  while (p + 4 <= end) {
+    if (p[0] != 0xFF) {
+      return false;
+    }
+    uint8_t marker = p[1];
+    if (marker == 0xFF) {  // fill byte
+      p++;
+      continue;
+    }
+    if (marker == 0xD9) {
+      return false;  // EOI before SOS
+    }
+    size_t segment = be16(p + 2);
+    if (segment < 2 || p + 2 + segment > end) {
+      return false;
+    }
+    const uint8_t *body = p + 4;
+    size_t bodyLen = segment - 2;
+
+    switch (marker) {
+      case 0xC0:  // baseline
+      case 0xC1:  // extended sequential, Huffman
+        if (!_parseSof(body, bodyLen)) {
+          return false;
+        }
+        break;
+      case 0xC2:
+      case 0xC3:
+      case 0xC5:
+      case 0xC6:
+      case 0xC7:
+      case 0xC9:
+      case 0xCA:
+      case 0xCB:
+      case 0xCD:
+      case 0xCE:
+      case 0xCF:
+        return false;  // progressive, lossless or arithmetic coding
+      case 0xC4:
+        if (!_parseDht(body, bodyLen)) {
+          return false;
+        }
+        break;
+      case 0xDB:
+        if (!_parseDqt(body, bodyLen)) {
+          return false;
+        }
+        break;
+      case 0xDD:
+        if (bodyLen < 2) {
+          return false;
+        }
+        _restartInterval = be16(body);
+        break;
+      case 0xDA:
+        return _decodeScan(body, bodyLen, body + bodyLen, end);
+      default:
+        break;
+    }
+    p += 2 + segment;
+  }
+  return false;
+}
+
+bool JpegDcDecoder::_parseSof(const uint8_t *p, size_t len) {
+  if (len < 6 || p[0] != 8) {
+    return false;
+  }
+  _height = be16(p + 1);
+  _width = be16(p + 3);
+  _compCount = p[5];
+  if (!_width || !_height || !_compCount || _compCount > 4 || len < 6 + 3 * (size_t)_compCount) {
+    return false;
+  }
+  for (uint8_t i = 0; i < _compCount; i++) {
+    const uint8_t *c = p + 6 + 3 * i;
+    _comp[i].id = c[0];
+    _comp[i].h = c[1] >> 4;
+    _comp[i].v = c[1] & 15;
+    _comp[i].tq = c[2] & 3;
+    if (!_comp[i].h || !_comp[i].v || _comp[i].h > 4 || _comp[i].v > 4) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool JpegDcDecoder::_parseDqt(const uint8_t *p, size_t len) {
+  while (len) {
+    uint8_t precision = p[0] >> 4;
+    uint8_t id = p[0] & 3;
+    size_t size = 1 + 64 * (precision ? 2 : 1);
+    if (len < size) {
+      return false;
+    }
+    // Only the first (DC) entry is needed
+    _dcQuant[id] = precision ? be16(p + 1) : p[1];
+    p += size;
+    len -= size;
+  }
+  return true;
+}
+
+bool JpegDcDecoder::_parseDht(const uint8_t *p, size_t len) {
+  while (len >= 17) {
+    uint8_t cls = p[0] >> 4;
+    uint8_t id = p[0] & 3;
+    if (cls > 1) {
+      return false;
+    }
+    Huffman &h = cls ? _ac[id] : _dc[id];
+    const uint8_t *counts = p + 1;
+    size_t total = 0;
+    for (int i = 0; i < 16; i++) {
+      total += counts[i];
+    }
+    if (total > 256 || len < 17 + total) {
+      return false;
+    }
+    memcpy(h.values, p + 17, total);
+    memset(h.fastLen, 0, sizeof(h.fastLen));
+
+    // Canonical codes, JPEG spec F.2.2.3
+    uint32_t code = 0;
+    size_t k = 0;
+    for (int l = 1; l <= 16; l++) {
+      h.valPtr[l] = k;
+      h.minCode[l] = code;
+      for (int i = 0; i < counts[l - 1]; i++, k++, code++) {
+        if (l <= 8) {
+          uint8_t shift = 8 - l;
+          for (uint32_t j = 0; j < (1u << shift); j++) {
+            h.fastLen[(code << shift) | j] = l;
+            h.fastVal[(code << shift) | j] = h.values[k];
+          }
+        }
+      }
+      h.maxCode[l] = counts[l - 1] ? (int32_t)code - 1 : -1;
+      if (code > (1u << l)) {
+        return false;
+      }
+      code <<= 1;
+    }
+    h.maxCode[17] = INT32_MAX;
+    h.defined = true;
+
+    p += 17 + total;
+    len -= 17 + total;
+  }
+  return len == 0;
+}
+
+void JpegDcDecoder::_fill() {
+  while (_accBits <= 24) {
+    uint32_t byte = 0;
+    if (_p < _end) {
+      if (_p[0] != 0xFF) {
+        byte = *_p++;
+      } else if (_p + 1 < _end && _p[1] == 0x00) {
+        byte = 0xFF;
+        _p += 2;
+      }
+      // Any other marker ends the data, feed zeros until a restart
+    }
+    _acc |= byte << (24 - _accBits);
+    _accBits += 8;
+  }
+}
+
+uint32_t JpegDcDecoder::_bits(uint8_t n) {
+  if (!n) {
+    return 0;
+  }
+  _fill();
+  uint32_t v = _acc >> (32 - n);
+  _acc <<= n;
+  _accBits -= n;
+  return v;
+}
+
+int JpegDcDecoder::_decode(const Huffman &h) {
+  _fill();
+  uint8_t l = h.fastLen[_acc >> 24];
+  if (l) {
+    int v = h.fastVal[_acc >> 24];
+    _acc <<= l;
+    _accBits -= l;
+    return v;
+  }
+  for (l = 9; l <= 16; l++) {
+    int32_t code = _acc >> (32 - l);
+    if (code <= h.maxCode[l]) {
+      _acc <<= l;
+      _accBits -= l;
+      return h.values[h.valPtr[l] + code - h.minCode[l]];
+    }
+  }
+  _error = true;
+  return 0;
+}
+
+bool JpegDcDecoder::_skipBlock(int &pred, const Huffman &dc, const Huffman &ac) {
+  int s = _decode(dc);
+  if (s > 11) {
+    _error = true;
+    return false;
+  }
+  if (s) {
+    int v = _bits(s);
+    if (v < (1 << (s - 1))) {
+      v -= (1 << s) - 1;
+    }
+    pred += v;
+  }
+
+  for (int k = 1; k < 64;) {
+    int rs = _decode(ac);
+    int r = rs >> 4;
+    s = rs & 15;
+    if (!s) {
+      if (r != 15) {
+        break;  // end of block
+      }
+      k += 16;
+    } else {
+      k += r + 1;
+      _bits(s);
+    }
+  }
+  return !_error;
+}
+
+void JpegDcDecoder::_restart() {
+  _acc = 0;
+  _accBits = 0;
+  if (_p + 1 < _end && _p[0] == 0xFF && (_p[1] & 0xF8) == 0xD0) {
+    _p += 2;
+  }
+}
+
+bool JpegDcDecoder::_decodeScan(const uint8_t *p, size_t len, const uint8_t *data, const uint8_t *end) {
+  if (!_compCount || len < 1) {
+    return false;
+  }
+  uint8_t ns = p[0];
+  if (!ns || ns > _compCount || len < 1 + 2 * (size_t)ns + 3) {
+    return false;
+  }
+
+  uint8_t scan[4];
+  for (uint8_t i = 0; i < ns; i++) {
+    uint8_t id = p[1 + 2 * i];
+    uint8_t c = 0;
+    while (c < _compCount && _comp[c].id != id) {
+      c++;
+    }
+    if (c == _compCount) {
+      return false;
+    }
+    _comp[c].td = p[2 + 2 * i] >> 4 & 3;
+    _comp[c].ta = p[2 + 2 * i] & 3;
+    if (!_dc[_comp[c].td].defined || !_ac[_comp[c].ta].defined) {
+      return false;
+    }
+    scan[i] = c;
+  }
+  // The luma component is the first one of the frame and must be in this scan
+  if (scan[0] != 0) {
+    return false;
+  }
+
+  uint8_t hMax = 1, vMax = 1;
+  for (uint8_t i = 0; i < _compCount; i++) {
+    hMax = _comp[i].h > hMax ? _comp[i].h : hMax;
+    vMax = _comp[i].v > vMax ? _comp[i].v : vMax;
+  }
+
+  _mapWidth = (_width + 7) / 8;
+  _mapHeight = (_height + 7) / 8;
+  _map.assign((size_t)_mapWidth * _mapHeight, 0);
+
+  // A single component scan is not interleaved and covers the luma plane block by block
+  uint32_t mcusX, mcusY;
+  if (ns == 1) {
+    mcusX = (((uint32_t)_width * _comp[0].h + hMax - 1) / hMax + 7) / 8;
+    mcusY = (((uint32_t)_height * _comp[0].v + vMax - 1) / vMax + 7) / 8;
+  } else {
+    mcusX = (_width + 8 * hMax - 1) / (8 * hMax);
+    mcusY = (_height + 8 * vMax - 1) / (8 * vMax);
+  }
+
+  _p = data;
+  _end = end;
+  _acc = 0;
+  _accBits = 0;
+  _error = false;
+
+  int pred[4] = {0, 0, 0, 0};
+  uint32_t restarts = _restartInterval;
+  const Component &y = _comp[0];
+  uint16_t q = _dcQuant[y.tq];
+
+  for (uint32_t my = 0; my < mcusY; my++) {
+    for (uint32_t mx = 0; mx < mcusX; mx++) {
+      if (_restartInterval) {
+        if (!restarts) {
+          _restart();
+          memset(pred, 0, sizeof(pred));
+          restarts = _restartInterval;
+        }
+        restarts--;
+      }
+
+      for (uint8_t i = 0; i < ns; i++) {
+        const Component &c = _comp[scan[i]];
+        uint8_t bh = ns == 1 ? 1 : c.h;
+        uint8_t bv = ns == 1 ? 1 : c.v;
+        for (uint8_t v = 0; v < bv; v++) {
+          for (uint8_t h = 0; h < bh; h++) {
+            if (!_skipBlock(pred[i], _dc[c.td], _ac[c.ta])) {
+              return false;
+            }
+            if (i) {
+              continue;
+            }
+            uint32_t bx = mx * bh + h;
+            uint32_t by = my * bv + v;
+            if (bx < _mapWidth && by < _mapHeight) {
+              // DC = 8 x block mean, level shifted by 128
+              int luma = pred[0] * q / 8 + 128;
+              _map[by * _mapWidth + bx] = luma < 0 ? 0 : luma > 255 ? 255 : luma;
+            }
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,84 @@
+#ifndef JPEG_DC_DECODER_H
+#define JPEG_DC_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Reads the luma DC coefficient of every 8x8 block of a baseline JPEG. AC
+// coefficients are Huffman decoded only to find the block boundaries, there
+// is no dequantisation of AC terms and no IDCT, so the result is a 1/8 x 1/8
+// scale greyscale image (the mean of each block) at a fraction of the cost of
+// a full decode.
+class JpegDcDecoder {
+public:
+  bool decode(const uint8_t *jpeg, size_t len);
+
+  // One byte per luma block, valid after a successful decode().
+  const uint8_t *map() const {
+    return _map.data();
+  }
+  uint16_t mapWidth() const {
+    return _mapWidth;
+  }
+  uint16_t mapHeight() const {
+    return _mapHeight;
+  }
+  uint16_t width() const {
+    return _width;
+  }
+  uint16_t height() const {
+    return _height;
+  }
+
+private:
+  struct Huffman {
+    uint8_t fastLen[256];  // code length for codes of up to 8 bits, 0 = longer
+    uint8_t fastVal[256];
+    int32_t maxCode[18];   // largest code of each length, -1 if none
+    int32_t valPtr[17];    // index into values of the first code of each length
+    uint16_t minCode[17];
+    uint8_t values[256];
+    bool defined;
+  };
+
+  struct Component {
+    uint8_t id;
+    uint8_t h, v;
+    uint8_t tq;
+    uint8_t td, ta;
+  };
+
+  bool _parseDht(const uint8_t *p, size_t len);
+  bool _parseDqt(const uint8_t *p, size_t len);
+  bool _parseSof(const uint8_t *p, size_t len);
+  bool _decodeScan(const uint8_t *p, size_t len, const uint8_t *data, const uint8_t *end);
+
+  // Entropy coded data reader
+  void _fill();
+  uint32_t _bits(uint8_t n);
+  int _decode(const Huffman &h);
+  bool _skipBlock(int &pred, const Huffman &dc, const Huffman &ac);
+  void _restart();
+
+  Huffman _dc[4];
+  Huffman _ac[4];
+  uint16_t _dcQuant[4];
+  Component _comp[4];
+  uint8_t _compCount = 0;
+  uint16_t _restartInterval = 0;
+  uint16_t _width = 0;
+  uint16_t _height = 0;
+
+  const uint8_t *_p = nullptr;
+  const uint8_t *_end = nullptr;
+  uint32_t _acc = 0;
+  int _accBits = 0;
+  bool _error = false;
+
+  uint16_t _mapWidth = 0;
+  uint16_t _mapHeight = 0;
+  std::vector<uint8_t> _map;
+};
+
+#endif
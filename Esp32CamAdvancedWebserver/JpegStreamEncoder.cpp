@@ -0,0 +1,537 @@
+#include "JpegStreamEncoder.h"
+#include <string.h>
+
+// Tables from ITU T.81 annex K
+static const uint8_t zigzag[64] = {
+  0, 1, 8, 16, 9, 2, 3, 10,
+  17, 24, 32, 25, 18, 11, 4, 5,
+  12, 19, 26, 33, 40, 48, 41, 34,
+  27, 20, 13, 6, 7, 14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36,
+  29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46,
+  53, 60, 61, 54, 47, 55, 62, 63
+};
+
+static const uint8_t lumaQuant[64] = {
+  16, 11, 10, 16, 24, 40, 51, 61,
+  12, 12, 14, 19, 26, 58, 60, 55,
+  14, 13, 16, 24, 40, 57, 69, 56,
+  14, 17, 22, 29, 51, 87, 80, 62,
+  18, 22, 37, 56, 68, 109, 103, 77,
+  24, 35, 55, 64, 81, 104, 113, 92,
+  49, 64, 78, 87, 103, 121, 120, 101,
+  72, 92, 95, 98, 112, 100, 103, 99
+};
+
+static const uint8_t chromaQuant[64] = {
+  17, 18, 24, 47, 99, 99, 99, 99,
+  18, 21, 26, 66, 99, 99, 99, 99,
+  24, 26, 56, 99, 99, 99, 99, 99,
+  47, 66, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99,
+  99, 99, 99, 99, 99, 99, 99, 99
+};
+
+static const uint8_t dcLumaBits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t dcChromaBits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const uint8_t dcValues[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const uint8_t acLumaBits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+static const uint8_t acLumaValues[162] = {
+  0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+  0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+  0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+  0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+  0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+  0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+  0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+  0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+  0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+  0xf9, 0xfa
+};
+
+static const uint8_t acChromaBits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const uint8_t acChromaValues[162] = {
+  0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+  0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+  0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+  0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+  0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+  0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+  0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+  0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+  0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+  0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+  0xf9, 0xfa
+};
+
+struct HuffmanCodes {
+  uint16_t code[256];
+  uint8_t size[256];
+
+  HuffmanCodes(const uint8_t *bits, const uint8_t *values) {
+    memset(size, 0, sizeof(size));
+    uint16_t c = 0;
+    int k = 0;
+    for (int len = 1; len <= 16; len++) {
+      for (int i = 0; i < bits[len - 1]; i++) {
+        code[values[k]] = c++;
+        size[values[k]] = len;
+        k++;
+      }
+      c <<= 1;
+    }
+  }
+};
+
+// dc luma, ac luma, dc chroma, ac chroma. Built on first use, the static
+// initialisation is thread safe.
+static const HuffmanCodes *huffmanCodes() {
+  static const HuffmanCodes codes[4] = {
+    HuffmanCodes(dcLumaBits, dcValues),
+    HuffmanCodes(acLumaBits, acLumaValues),
+    HuffmanCodes(dcChromaBits, dcValues),
+    HuffmanCodes(acChromaBits, acChromaValues),
+  };
+  return codes;
+}
+
+// Integer forward DCT, the LLM algorithm as in libjpeg's jfdctint.c. The
+// output is scaled up by 8.
+#define CONST_BITS 13
+#define PASS1_BITS 2
+#define DESCALE(x, n) (((x) + (1 << ((n)-1))) >> (n))
+
+#define FIX_0_298631336 2446
+#define FIX_0_390180644 3196
+#define FIX_0_541196100 4433
+#define FIX_0_765366865 6270
+#define FIX_0_899976223 7373
+#define FIX_1_175875602 9633
+#define FIX_1_501321110 12299
+#define FIX_1_847759065 15137
+#define FIX_1_961570560 16069
+#define FIX_2_053119869 16819
+#define FIX_2_562915447 20995
+#define FIX_3_072711026 25172
+
+static void fdct(int32_t *data) {
+  for (int pass = 0; pass < 2; pass++) {
+    // Rows first, then columns
+    int step = pass ? 8 : 1;
+    int next = pass ? 1 : 8;
+    int shift = pass ? CONST_BITS + PASS1_BITS : CONST_BITS - PASS1_BITS;
+
+    for (int i = 0; i < 8; i++) {
+      int32_t *d = data + i * next;
+
+      int32_t tmp0 = d[0 * step] + d[7 * step];
+      int32_t tmp7 = d[0 * step] - d[7 * step];
+      int32_t tmp1 = d[1 * step] + d[6 * step];
+      int32_t tmp6 = d[1 * step] - d[6 * step];
+      int32_t tmp2 = d[2 * step] + d[5 * step];
+      int32_t tmp5 = d[2 * step] - d[5 * step];
+      int32_t tmp3 = d[3 * step] + d[4 * step];
+      int32_t tmp4 = d[3 * step] - d[4 * step];
+
+      // Even part
+      int32_t tmp10 = tmp0 + tmp3;
+      int32_t tmp13 = tmp0 - tmp3;
+      int32_t tmp11 = tmp1 + tmp2;
+      int32_t tmp12 = tmp1 - tmp2;
+
+      if (pass) {
+        d[0 * step] = DESCALE(tmp10 + tmp11, PASS1_BITS);
+        d[4 * step] = DESCALE(tmp10 - tmp11, PASS1_BITS);
+      } else {
+        // Multiplied, a left shift of a negative value is undefined
+        d[0 * step] = (tmp10 + tmp11) * (1 << PASS1_BITS);
+        d[4 * step] = (tmp10 - tmp11) * (1 << PASS1_BITS);
+      }
+
+      int32_t z1 = (tmp12 + tmp13) * FIX_0_541196100;
+      d[2 * step] = DESCALE(z1 + tmp13 * FIX_0_765366865, shift);
+      d[6 * step] = DESCALE(z1 - tmp12 * FIX_1_847759065, shift);
+
+      // Odd part
+      z1 = tmp4 + tmp7;
+      int32_t z2 = tmp5 + tmp6;
+      int32_t z3 = tmp4 + tmp6;
+      int32_t z4 = tmp5 + tmp7;
+      int32_t z5 = (z3 + z4) * FIX_1_175875602;
+
+      tmp4 *= FIX_0_298631336;
+      tmp5 *= FIX_2_053119869;
+      tmp6 *= FIX_3_072711026;
+      tmp7 *= FIX_1_501321110;
+      z1 *= -FIX_0_899976223;
+      z2 *= -FIX_2_562915447;
+      z3 = z3 * -FIX_1_961570560 + z5;
+      z4 = z4 * -FIX_0_390180644 + z5;
+
+      d[7 * step] = DESCALE(tmp4 + z1 + z3, shift);
+      d[5 * step] = DESCALE(tmp5 + z2 + z4, shift);
+      d[3 * step] = DESCALE(tmp6 + z2 + z3, shift);
+      d[1 * step] = DESCALE(tmp7 + z1 + z4, shift);
+    }
+  }
+}
+
+static inline uint8_t magnitude(int v) {
+  if (v < 0) {
+    v = -v;
+  }
+  return v ? 32 - __builtin_clz(v) : 0;
+}
+
+bool JpegStreamEncoder::begin(const uint8_t *src, uint16_t width, uint16_t height, pixformat_t format, uint8_t quality) {
+  _state = DONE;
+  _outLen = 0;
+  _outPos = 0;
+
+  switch (format) {
+    case PIXFORMAT_GRAYSCALE:
+      _mcuSize = 8;
+      _blocks = 1;
+      break;
+    case PIXFORMAT_RGB565:
+    case PIXFORMAT_RGB888:
+    case PIXFORMAT_YUV422:
+      _mcuSize = 16;
+      _blocks = 6;
+      break;
+    default:
+      return false;
+  }
+  // YUV422 pixel pairs share their chroma, an odd width has half a pair
+  if (!width || !height || (format == PIXFORMAT_YUV422 && (width & 1))) {
+    return false;
+  }
+
+  _src = src;
+  _transform = nullptr;
+  _srcBpp = format == PIXFORMAT_GRAYSCALE ? 1 : format == PIXFORMAT_RGB888 ? 3 : 2;
+  _format = format;
+  _width = width;
+  _height = height;
+  _mcuX = 0;
+  _mcuY = 0;
+  _block = 0;
+  _lastDc[0] = _lastDc[1] = _lastDc[2] = 0;
+  _bitBuffer = 0;
+  _bitCount = 0;
+
+  _header(quality);
+  _state = DATA;
+  return true;
+}
+
+bool JpegStreamEncoder::begin(FrameTransform *transform, uint8_t quality) {
+  // The first row allocates the transform's strip buffer
+  if (!transform->row(0) || !begin(nullptr, transform->width(), transform->height(), transform->format(), quality)) {
+    return false;
+  }
+  _transform = transform;
+  return true;
+}
+
+const uint8_t *JpegStreamEncoder::_row(int y) const {
+  return _transform ? _transform->row(y) : _src + y * _width * _srcBpp;
+}
+
+void JpegStreamEncoder::_header(uint8_t quality) {
+  if (quality < 1) quality = 1;
+  if (quality > 100) quality = 100;
+  int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+  for (int i = 0; i < 64; i++) {
+    int l = (lumaQuant[i] * scale + 50) / 100;
+    int c = (chromaQuant[i] * scale + 50) / 100;
+    _quant[0][i] = l < 1 ? 1 : l > 255 ? 255 : l;
+    _quant[1][i] = c < 1 ? 1 : c > 255 ? 255 : c;
+  }
+
+  bool color = _blocks > 1;
+  int components = color ? 3 : 1;
+  int tables = color ? 2 : 1;
+
+  _put16(0xFFD8);  // SOI
+
+  static const uint8_t app0[] = { 0xFF, 0xE0, 0, 16, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+  memcpy(_out + _outLen, app0, sizeof(app0));
+  _outLen += sizeof(app0);
+
+  _put16(0xFFDB);  // DQT
+  _put16(2 + tables * 65);
+  for (int t = 0; t < tables; t++) {
+    _put8(t);
+    for (int i = 0; i < 64; i++) {
+      _put8(_quant[t][zigzag[i]]);
+    }
+  }
+
+  _put16(0xFFC0);  // SOF0
+  _put16(8 + components * 3);
+  _put8(8);
+  _put16(_height);
+  _put16(_width);
+  _put8(components);
+  for (int c = 0; c < components; c++) {
+    _put8(c + 1);
+    _put8(c == 0 && color ? 0x22 : 0x11);
+    _put8(c == 0 ? 0 : 1);
+  }
+
+  static const struct {
+    uint8_t id;
+    const uint8_t *bits;
+    const uint8_t *values;
+  } dht[4] = {
+    { 0x00, dcLumaBits, dcValues },
+    { 0x10, acLumaBits, acLumaValues },
+    { 0x01, dcChromaBits, dcValues },
+    { 0x11, acChromaBits, acChromaValues },
+  };
+  int dhtLen = 2;
+  for (int t = 0; t < tables * 2; t++) {
+    dhtLen += 17;
+    for (int i = 0; i < 16; i++) {
+      dhtLen += dht[t].bits[i];
+    }
+  }
+  _put16(0xFFC4);  // DHT
+  _put16(dhtLen);
+  for (int t = 0; t < tables * 2; t++) {
+    _put8(dht[t].id);
+    int count = 0;
+    for (int i = 0; i < 16; i++) {
+      _put8(dht[t].bits[i]);
+      count += dht[t].bits[i];
+    }
+    memcpy(_out + _outLen, dht[t].values, count);
+    _outLen += count;
+  }
+
+  _put16(0xFFDA);  // SOS
+  _put16(6 + components * 2);
+  _put8(components);
+  for (int c = 0; c < components; c++) {
+    _put8(c + 1);
+    _put8(c == 0 ? 0x00 : 0x11);
+  }
+  _put8(0);
+  _put8(63);
+  _put8(0);
+}
+
+void JpegStreamEncoder::_loadMcu() {
+  int x0 = _mcuX * _mcuSize;
+  int y0 = _mcuY * _mcuSize;
+
+  // Pixels past the right and bottom edge repeat the last column and row
+  for (int y = 0; y < _mcuSize; y++) {
+    int sy = y0 + y;
+    if (sy >= _height) sy = _height - 1;
+
+    if (_format == PIXFORMAT_GRAYSCALE) {
+      const uint8_t *row = _row(sy);
+      for (int x = 0; x < 8; x++) {
+        int sx = x0 + x;
+        if (sx >= _width) sx = _width - 1;
+        _y[y * 16 + x] = row[sx];
+      }
+      continue;
+    }
+
+    // Chroma is summed over 2x2 pixels, the first row of a pair clears it
+    bool first = !(y & 1);
+    int c = (y >> 1) * 8;
+
+    if (_format == PIXFORMAT_YUV422) {
+      // Y0 U Y1 V, the chroma is already shared by each pixel pair
+      const uint8_t *row = _row(sy);
+      for (int x = 0; x < 16; x += 2) {
+        int sx = x0 + x;
+        if (sx >= _width) sx = _width - 1;
+        int sx1 = sx + 1 < _width ? sx + 1 : sx;
+        const uint8_t *pair = row + (sx & ~1) * 2;
+        _y[y * 16 + x] = row[sx * 2];
+        _y[y * 16 + x + 1] = row[sx1 * 2];
+        int u = pair[1];
+        int v = pair[3];
+        if (first) {
+          _cb[c + x / 2] = u;
+          _cr[c + x / 2] = v;
+        } else {
+          _cb[c + x / 2] = (_cb[c + x / 2] + u + 1) >> 1;
+          _cr[c + x / 2] = (_cr[c + x / 2] + v + 1) >> 1;
+        }
+      }
+      continue;
+    }
+
+    int bpp = _srcBpp;
+    const uint8_t *row = _row(sy);
+    for (int x = 0; x < 16; x += 2) {
+      int r = 0, g = 0, b = 0;
+      for (int i = 0; i < 2; i++) {
+        int sx = x0 + x + i;
+        if (sx >= _width) sx = _width - 1;
+        const uint8_t *p = row + sx * bpp;
+        int pr, pg, pb;
+        if (bpp == 2) {
+          // Big endian RGB565
+          pr = p[0] & 0xF8;
+          pg = ((p[0] & 0x07) << 5) | ((p[1] & 0xE0) >> 3);
+          pb = (p[1] & 0x1F) << 3;
+        } else {
+          // RGB888 is stored as BGR
+          pb = p[0];
+          pg = p[1];
+          pr = p[2];
+        }
+        _y[y * 16 + x + i] = (19595 * pr + 38470 * pg + 7471 * pb + 32768) >> 16;
+        r += pr;
+        g += pg;
+        b += pb;
+      }
+      // Chroma of the pixel pair, averaged with the pair in the row above
+      int u = ((-11059 * r - 21709 * g + 32768 * b + 65536) >> 17) + 128;
+      int v = ((32768 * r - 27439 * g - 5329 * b + 65536) >> 17) + 128;
+      if (first) {
+        _cb[c + x / 2] = u;
+        _cr[c + x / 2] = v;
+      } else {
+        _cb[c + x / 2] = (_cb[c + x / 2] + u + 1) >> 1;
+        _cr[c + x / 2] = (_cr[c + x / 2] + v + 1) >> 1;
+      }
+    }
+  }
+}
+
+void JpegStreamEncoder::_bits(uint32_t code, uint8_t size) {
+  _bitBuffer = (_bitBuffer << size) | (code & ((1 << size) - 1));
+  _bitCount += size;
+  while (_bitCount >= 8) {
+    uint8_t b = _bitBuffer >> (_bitCount - 8);
+    _put8(b);
+    if (b == 0xFF) {
+      _put8(0);  // byte stuffing
+    }
+    _bitCount -= 8;
+  }
+}
+
+void JpegStreamEncoder::_flushBits() {
+  if (_bitCount) {
+    _bits(0x7F, 8 - _bitCount);  // pad with ones
+  }
+}
+
+void JpegStreamEncoder::_encodeBlock(const uint8_t *samples, int stride, int component) {
+  int32_t data[64];
+  for (int y = 0; y < 8; y++) {
+    for (int x = 0; x < 8; x++) {
+      data[y * 8 + x] = samples[y * stride + x] - 128;
+    }
+  }
+  fdct(data);
+
+  int table = component ? 1 : 0;
+  const uint8_t *quant = _quant[table];
+  const HuffmanCodes &dc = huffmanCodes()[table * 2];
+  const HuffmanCodes &ac = huffmanCodes()[table * 2 + 1];
+
+  int16_t coef[64];
+  for (int i = 0; i < 64; i++) {
+    int n = zigzag[i];
+    int32_t div = quant[n] << 3;  // undo the DCT scaling as well
+    int32_t v = data[n];
+    coef[i] = v < 0 ? -((-v + (div >> 1)) / div) : (v + (div >> 1)) / div;
+  }
+
+  int diff = coef[0] - _lastDc[component];
+  _lastDc[component] = coef[0];
+  uint8_t size = magnitude(diff);
+  _bits(dc.code[size], dc.size[size]);
+  _bits(diff < 0 ? diff - 1 : diff, size);
+
+  int run = 0;
+  for (int i = 1; i < 64; i++) {
+    int v = coef[i];
+    if (!v) {
+      run++;
+      continue;
+    }
+    while (run > 15) {
+      _bits(ac.code[0xF0], ac.size[0xF0]);  // ZRL
+      run -= 16;
+    }
+    size = magnitude(v);
+    uint8_t symbol = (run << 4) | size;
+    _bits(ac.code[symbol], ac.size[symbol]);
+    _bits(v < 0 ? v - 1 : v, size);
+    run = 0;
+  }
+  if (run) {
+    _bits(ac.code[0x00], ac.size[0x00]);  // EOB
+  }
+}
+
+void JpegStreamEncoder::_step() {
+  if (_block == 0) {
+    _loadMcu();
+  }
+
+  if (_block < 4 && _blocks > 1) {
+    _encodeBlock(_y + (_block >> 1) * 8 * 16 + (_block & 1) * 8, 16, 0);
+  } else if (_blocks == 1) {
+    _encodeBlock(_y, 16, 0);
+  } else {
+    _encodeBlock(_block == 4 ? _cb : _cr, 8, _block - 3);
+  }
+
+  if (++_block < _blocks) {
+    return;
+  }
+  _block = 0;
+  if (++_mcuX * _mcuSize < _width) {
+    return;
+  }
+  _mcuX = 0;
+  if (++_mcuY * _mcuSize < _height) {
+    return;
+  }
+
+  _flushBits();
+  _put16(0xFFD9);  // EOI
+  _state = DONE;
+}
+
+size_t JpegStreamEncoder::read(uint8_t *buf, size_t len) {
+  size_t total = 0;
+  while (total < len) {
+    if (_outPos == _outLen) {
+      if (_state == DONE) {
+        break;
+      }
+      // Encode blocks until the next one might not fit
+      _outPos = _outLen = 0;
+      while (_state == DATA && _outLen + BLOCK_MAX <= sizeof(_out)) {
+        _step();
+      }
+    }
+
+    size_t n = _outLen - _outPos;
+    if (n > len - total) {
+      n = len - total;
+    }
+    memcpy(buf + total, _out + _outPos, n);
+    _outPos += n;
+    total += n;
+  }
+  return total;
+}
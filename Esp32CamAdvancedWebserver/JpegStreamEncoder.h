@@ -0,0 +1,92 @@
+#ifndef JPEG_STREAM_ENCODER_H
+#define JPEG_STREAM_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_camera.h"
+#include "FrameTransform.h"
+
+// Baseline JPEG encoder that produces its output on demand. The source is
+// read one MCU (16x16 pixels, 4:2:0, or 8x8 for greyscale) at a time and the
+// entropy coded data is handed out through read(), so a response filler can
+// encode straight into the TCP send buffer. Nothing is allocated, the whole
+// working set is the object itself (about 1.5 KB), and the source buffer has
+// to stay valid until read() returned 0.
+//
+// Supported sources are PIXFORMAT_RGB565, PIXFORMAT_RGB888, PIXFORMAT_YUV422
+// and PIXFORMAT_GRAYSCALE in the byte order of esp32-camera. YUV422 needs an
+// even width.
+class JpegStreamEncoder {
+public:
+  // quality 1..100 as for frame2jpg(). Returns false for unsupported formats
+  // and sizes.
+  bool begin(const uint8_t *src, uint16_t width, uint16_t height, pixformat_t format, uint8_t quality);
+
+  // Encodes the output of a transform, its strips are rendered as the MCU
+  // rows reach them. The transform has to stay valid until read() returned 0.
+  bool begin(FrameTransform *transform, uint8_t quality);
+
+  // Copies up to len bytes of the JPEG to buf and returns the count, 0 once
+  // the image is complete.
+  size_t read(uint8_t *buf, size_t len);
+
+  bool done() const {
+    return _state == DONE && _outPos == _outLen;
+  }
+
+private:
+  enum State {
+    DATA,
+    DONE,
+  };
+
+  // Largest entropy coded block: 11 + 11 bits DC, 63 * (16 + 10) bits AC,
+  // every byte stuffed, plus the padding and EOI after the last one.
+  static const size_t BLOCK_MAX = 424;
+
+  void _header(uint8_t quality);
+  const uint8_t *_row(int y) const;
+  void _loadMcu();
+  void _step();
+  void _encodeBlock(const uint8_t *samples, int stride, int component);
+  void _bits(uint32_t code, uint8_t size);
+  void _flushBits();
+
+  void _put8(uint8_t v) {
+    _out[_outLen++] = v;
+  }
+  void _put16(uint16_t v) {
+    _out[_outLen++] = v >> 8;
+    _out[_outLen++] = v;
+  }
+
+  const uint8_t *_src = nullptr;
+  FrameTransform *_transform = nullptr;
+  uint8_t _srcBpp = 2;
+  pixformat_t _format;
+  uint16_t _width = 0;
+  uint16_t _height = 0;
+  uint8_t _mcuSize = 16;
+  uint8_t _blocks = 6;  // blocks per MCU
+
+  uint16_t _mcuX = 0;
+  uint16_t _mcuY = 0;
+  uint8_t _block = 0;
+  State _state = DONE;
+
+  uint8_t _quant[2][64];  // natural order
+  int16_t _lastDc[3];
+  uint32_t _bitBuffer = 0;
+  uint8_t _bitCount = 0;
+
+  // Samples of the current MCU
+  uint8_t _y[256];
+  uint8_t _cb[64];
+  uint8_t _cr[64];
+
+  uint8_t _out[1024];
+  size_t _outLen = 0;
+  size_t _outPos = 0;
+};
+
+#endif
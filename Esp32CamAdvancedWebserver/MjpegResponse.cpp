@@ -0,0 +1,277 @@
+#include "MjpegResponse.h"
+#include "ClientWake.h"
+#include "esp_timer.h"
+
+static const char *_STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" MJPEG_PART_BOUNDARY;
+static const char *_STREAM_BOUNDARY = "\r\n--" MJPEG_PART_BOUNDARY "\r\n";
+static const char *_STREAM_PART =
+  "Content-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %lld.%06ld\r\nX-Stream-Level: %u\r\nX-Quality: %u\r\n\r\n";
+
+// Rate control levels, from full rate to the strongest throttling. `skip` is
+// the number of frames left out between two sent frames, `degrade` the
+// quality step requested from the producer.
+static const struct {
+  uint8_t skip;
+  uint8_t degrade;
+} _levels[] = {{0, 0}, {1, 0}, {2, 0}, {2, 1}, {3, 2}, {4, 3}};
+static const uint8_t _maxLevel = sizeof(_levels) / sizeof(_levels[0]) - 1;
+
+// Minimum time between two level changes, going back up takes longer so a
+// client does not oscillate around the target.
+#define MJPEG_LEVEL_DOWN_HOLD_MS 1000
+#define MJPEG_LEVEL_UP_HOLD_MS   3000
+
+uint32_t AsyncMjpegResponse::_latencyTarget = MJPEG_LATENCY_TARGET_MS;
+uint16_t AsyncMjpegResponse::_staticTolerance = MJPEG_STATIC_TOLERANCE;
+uint32_t AsyncMjpegResponse::_staticRefresh = MJPEG_STATIC_REFRESH_MS;
+
+// Start of the entropy coded data, right after the SOS segment. nullptr if
+// the markers before it do not parse.
+static const uint8_t *scan_data(const uint8_t *p, const uint8_t *end) {
+  if (end - p < 4 || p[0] != 0xFF || p[1] != 0xD8) {
+    return nullptr;
+  }
+  p += 2;
+  while (end - p >= 4 && p[0] == 0xFF) {
+    if (p[1] == 0xFF) {  // fill byte
+      p++;
+      continue;
+    }
+    size_t segment = (p[2] << 8) | p[3];
+    if (p[1] == 0xDA) {
+      return segment + 2 <= (size_t)(end - p) ? p + 2 + segment : nullptr;
+    }
+    p += 2 + segment;
+  }
+  return nullptr;
+}
+
+// FNV-1a over 64 words spread across the entropy coded data. The headers are
+// left out, their quantisation tables change with the stream quality, and so
+// are the zero bytes stuffed after each 0xFF.
+static uint32_t sample_hash(const camera_fb_t *fb) {
+  const uint8_t *end = fb->buf + fb->len;
+  const uint8_t *data = scan_data(fb->buf, end);
+  if (!data) {
+    data = fb->buf;
+  }
+  size_t len = end - data;
+  uint32_t hash = 2166136261;
+  size_t step = len / 64 > 4 ? len / 64 : 4;
+  for (size_t i = 0; i + 4 <= len; i += step) {
+    for (size_t k = i; k < i + 4; k++) {
+      if (data[k] == 0 && k && data[k - 1] == 0xFF) {
+        continue;
+      }
+      hash = (hash ^ data[k]) * 16777619;
+    }
+  }
+  return hash;
+}
+
+AsyncMjpegResponse::AsyncMjpegResponse() {
+  _code = 200;
+  _contentType = _STREAM_CONTENT_TYPE;
+  _sendContentLength = false;
+}
+
+AsyncMjpegResponse::~AsyncMjpegResponse() {
+  frameBroker.unsubscribe(this);
+  frameBroker.requestDegrade(_levels[_stats.level].degrade, 0);
+  metrics_unregister(&_stats);
+  // Frame data was handed to TCP by reference. If the connection is still up
+  // while we drop the leases, make sure the stack forgets about it first.
+  if (_client && _client->connected() && _ackedLength < _writtenLength) {
+    _client->abort();
+  }
+}
+
+void AsyncMjpegResponse::_respond(AsyncWebServerRequest *request) {
+  _client = request->client();
+  addHeader("Connection", "close", false);
+  _assembleHead(_head, request->version());
+  _state = RESPONSE_CONTENT;
+  metrics_register(&_stats);
+  if (frameBroker.producing()) {
+    frameBroker.subscribe(this);
+  }
+  _ack(request, 0, 0);
+}
+
+void AsyncMjpegResponse::onFrame() {
+  // The frame is taken by _ack() when async_tcp handles the poll
+  if (_waiting.exchange(false)) {
+    async_client_wake(_client);
+  }
+}
+
+size_t AsyncMjpegResponse::_ack(AsyncWebServerRequest *request, size_t len, uint32_t time) {
+  (void)time;
+  _ackedLength += len;
+
+  // give frames back to the broker once all of their bytes are acked
+  size_t done = 0;
+  if (_inFlightCount && _inFlight[0].end <= _ackedLength) {
+    int64_t now = esp_timer_get_time();
+    while (done < _inFlightCount && _inFlight[done].end <= _ackedLength) {
+      metrics_record(METRIC_ACK_MS, (now - _inFlight[done].sent) / 1000);
+      metrics_frame_done(&_stats, (now - _inFlight[done].frame->grabbed) / 1000);
+      done++;
+    }
+    _adapt();
+  }
+  if (done) {
+    for (size_t i = 0; i < _inFlightCount; i++) {
+      _inFlight[i] = i + done < _inFlightCount ? std::move(_inFlight[i + done]) : InFlight();
+    }
+    _inFlightCount -= done;
+  }
+
+  if (_state != RESPONSE_CONTENT) {
+    return 0;
+  }
+  return _send(request->client());
+}
+
+size_t AsyncMjpegResponse::_send(AsyncClient *client) {
+  size_t written = 0;
+
+  while (_state == RESPONSE_CONTENT) {
+    size_t space = client->space();
+    if (!space) {
+      break;
+    }
+
+    size_t n;
+    if (_headSent < _head.length()) {
+      n = client->add(_head.c_str() + _headSent, std::min(space, _head.length() - _headSent));
+      _headSent += n;
+    } else if (_partSent < _partLen) {
+      n = client->add(_part + _partSent, std::min(space, _partLen - _partSent));
+      _partSent += n;
+    } else if (_frame) {
+      // No copy flag: the lease in _inFlight keeps fb->buf valid until the bytes are acked.
+      // Note that IDF's lwIP (LWIP_NETIF_TX_SINGLE_PBUF) still copies once into its own pbuf,
+      // which is the only copy left on this path.
+      camera_fb_t *fb = _frame->fb;
+      n = client->add((const char *)fb->buf + _bodySent, std::min(space, fb->len - _bodySent), 0);
+      _bodySent += n;
+      if (_bodySent == fb->len) {
+        int64_t now = esp_timer_get_time();
+        metrics_record(METRIC_SEND_MS, (now - _frameStarted) / 1000);
+        _inFlight[_inFlightCount].frame = std::move(_frame);
+        _inFlight[_inFlightCount].end = _writtenLength + written + n;
+        _inFlight[_inFlightCount].sent = now;
+        _inFlightCount++;
+      }
+    } else if (_inFlightCount < MJPEG_FRAMES_IN_FLIGHT && _nextFrame()) {
+      continue;
+    } else {
+      break;
+    }
+
+    if (!n) {
+      break;
+    }
+    written += n;
+  }
+
+  if (written) {
+    _writtenLength += written;
+    client->send();
+  }
+  return written;
+}
+
+void AsyncMjpegResponse::_adapt() {
+  uint32_t now = millis();
+  uint32_t latency = _stats.latency;
+  uint8_t level = _stats.level;
+  if (latency > _latencyTarget && level < _maxLevel && now - _levelChanged >= MJPEG_LEVEL_DOWN_HOLD_MS) {
+    level++;
+  } else if (latency < _latencyTarget / 2 && level > 0 && now - _levelChanged >= MJPEG_LEVEL_UP_HOLD_MS) {
+    level--;
+  }
+  if (level == _stats.level) {
+    return;
+  }
+
+  log_d("Stream level %u -> %u (%ums)", _stats.level, level, latency);
+  frameBroker.requestDegrade(_levels[_stats.level].degrade, _levels[level].degrade);
+  _stats.level = level;
+  _levelChanged = now;
+}
+
+bool AsyncMjpegResponse::_nextFrame() {
+  // Waiting is flagged before asking, so a frame published in between is
+  // not missed by onFrame(). Frames are left out by asking for a later
+  // sequence number.
+  _waiting = true;
+  FrameLease frame = frameBroker.acquire(_seq ? _seq + _levels[_stats.level].skip : 0);
+  if (!frame) {
+    if (frameBroker.producing() || frameBroker.held()) {
+      return false;  // no new frame yet or all buffers are leased out
+    }
+    log_e("Camera capture failed");
+    _state = RESPONSE_FAILED;
+    _client->close();
+    return false;
+  }
+  _waiting = false;
+
+  camera_fb_t *fb = frame->fb;
+  if (fb->format != PIXFORMAT_JPEG) {
+    log_e("Stream needs a JPEG frame");
+    _state = RESPONSE_FAILED;
+    _client->close();
+    return false;
+  }
+
+  if (_seq && frame->seq > _seq + 1) {
+    _stats.dropped += frame->seq - _seq - 1;
+    metrics_dropped(frame->seq - _seq - 1);
+  }
+  _seq = frame->seq;
+
+  int64_t now = esp_timer_get_time();
+  size_t blen = strlen(_STREAM_BOUNDARY);
+  memcpy(_part, _STREAM_BOUNDARY, blen);
+  _partSent = 0;
+
+  if (_isStatic(*frame, now)) {
+    _stats.suppressed++;
+    _stats.saved += fb->len;
+    _waiting = true;
+    _partLen = 0;
+    return false;
+  }
+
+  _partLen = blen + snprintf(_part + blen, sizeof(_part) - blen, _STREAM_PART, fb->len, fb->timestamp.tv_sec, fb->timestamp.tv_usec, _stats.level, frame->quality);
+  _bodySent = 0;
+  _frameStarted = now;
+  if (_staticTolerance) {
+    _refLen = fb->len;
+    _refHash = sample_hash(fb);
+    _refSent = now;
+  }
+  _frame = std::move(frame);
+  return true;
+}
+
+// A frame counts as unchanged if its size is close to the last sent frame
+// and the sampled entropy coded bytes match it. Both compare with the sent
+// reference, not the previous frame, so a slow change adds up until the
+// frame goes out.
+bool AsyncMjpegResponse::_isStatic(const CameraFrame &frame, int64_t now) {
+  uint16_t tolerance = _staticTolerance;
+  if (!tolerance || !_refLen || now - _refSent >= (int64_t)_staticRefresh * 1000) {
+    return false;
+  }
+
+  size_t len = frame.fb->len;
+  size_t diff = len > _refLen ? len - _refLen : _refLen - len;
+  if (diff * 1000 > (size_t)tolerance * _refLen) {
+    return false;
+  }
+  return sample_hash(frame.fb) == _refHash;
+}
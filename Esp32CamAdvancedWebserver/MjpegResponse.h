@@ -0,0 +1,123 @@
+#ifndef MJPEG_RESPONSE_H
+#define MJPEG_RESPONSE_H
+
+#include <AsyncTCP.h>
+#include <atomic>
+#include <ESPAsyncWebServer.h>
+#include "FrameBroker.h"
+#include "CameraMetrics.h"
+
+#define MJPEG_PART_BOUNDARY "123456789000000000000987654321"
+
+// Frames handed to TCP but not yet acked by this client, the next frame is
+// only taken from the broker once one of these slots is free again.
+#ifndef MJPEG_FRAMES_IN_FLIGHT
+#define MJPEG_FRAMES_IN_FLIGHT 2
+#endif
+
+// Default glass-to-ack latency a stream client should stay under, adjustable
+// at runtime with /cam/control?var=latency&val=<ms>.
+#ifndef MJPEG_LATENCY_TARGET_MS
+#define MJPEG_LATENCY_TARGET_MS 500
+#endif
+
+// Static scene suppression: a frame whose JPEG size is within this many per
+// mille of the last sent frame and that looks the same (see _isStatic()) is
+// not sent. 0 disables it, adjustable with /cam/control?var=static&val=<n>.
+#ifndef MJPEG_STATIC_TOLERANCE
+#define MJPEG_STATIC_TOLERANCE 0
+#endif
+// A suppressed stream still sends a full frame this often, which also keeps
+// clients and proxies with read timeouts on the connection. Adjustable in
+// seconds with /cam/control?var=static_refresh&val=<s>.
+#ifndef MJPEG_STATIC_REFRESH_MS
+#define MJPEG_STATIC_REFRESH_MS 10000
+#endif
+
+// multipart/x-mixed-replace response that feeds JPEG frames from the broker
+// straight to the AsyncClient. Frame data is passed to the socket as slices
+// of the camera frame buffer (no fill buffer, no per-ack allocation), each
+// frame's lease is kept until TCP has acked its last byte.
+//
+// Sending is driven by acks and polls on the async_tcp task. A client that has
+// caught up with the producer is woken by onFrame(), which only queues a poll
+// for it, the producer task never writes to the AsyncClient.
+//
+// Each client runs its own rate control: the time from grab to the ack of a
+// frame's last byte is compared with the latency target. A client that falls
+// behind first skips frames, then asks the producer for stronger compression.
+// The level in use is sent with every frame as X-Stream-Level.
+class AsyncMjpegResponse : public AsyncWebServerResponse, public FrameListener {
+public:
+  AsyncMjpegResponse();
+  ~AsyncMjpegResponse();
+
+  bool _sourceValid() const override {
+    return true;
+  }
+  void _respond(AsyncWebServerRequest *request) override;
+  size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time) override;
+  void onFrame() override;
+
+  static void setLatencyTarget(uint32_t ms) {
+    _latencyTarget = ms;
+  }
+  static uint32_t latencyTarget() {
+    return _latencyTarget;
+  }
+  static void setStaticTolerance(uint16_t perMille) {
+    _staticTolerance = perMille;
+  }
+  static uint16_t staticTolerance() {
+    return _staticTolerance;
+  }
+  static void setStaticRefresh(uint32_t ms) {
+    _staticRefresh = ms;
+  }
+  static uint32_t staticRefresh() {
+    return _staticRefresh;
+  }
+
+private:
+  struct InFlight {
+    FrameLease frame;
+    size_t end;    // _writtenLength after the last byte of the frame
+    int64_t sent;  // when the last byte was handed to TCP
+  };
+
+  size_t _send(AsyncClient *client);
+  bool _nextFrame();
+  bool _isStatic(const CameraFrame &frame, int64_t now);
+  void _adapt();
+
+  static uint32_t _latencyTarget;
+  static uint16_t _staticTolerance;
+  static uint32_t _staticRefresh;
+
+  AsyncClient *_client = nullptr;
+  std::atomic<bool> _waiting{false};  // caught up, nothing to send until the next frame
+  String _head;
+  size_t _headSent = 0;
+
+  char _part[192];  // boundary and part header of the current frame
+  size_t _partLen = 0;
+  size_t _partSent = 0;
+
+  FrameLease _frame;  // frame currently being written
+  size_t _bodySent = 0;
+  int64_t _frameStarted = 0;
+  uint32_t _seq = 0;  // sequence of the last frame taken from the broker
+
+  InFlight _inFlight[MJPEG_FRAMES_IN_FLIGHT];
+  size_t _inFlightCount = 0;
+
+  StreamStats _stats;  // also holds the rate control level and latency
+  uint32_t _levelChanged = 0;
+
+  // Last frame that was sent in full, the reference for suppression
+  size_t _refLen = 0;
+  uint32_t _refHash = 0;
+  int64_t _refSent = 0;
+};
+
+#endif
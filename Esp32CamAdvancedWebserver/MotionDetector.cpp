@@ -0,0 +1,88 @@
+#include "MotionDetector.h"
+#include "CameraMetrics.h"
+#include "FrameBroker.h"
+#include "PreEventRing.h"
+#include "esp_timer.h"
+
+MotionDetector motionDetector;
+AsyncEventSource motionEvents("/cam/events");
+
+bool MotionDetector::begin(uint8_t fps) {
+  if (_task || !fps) {
+    return false;
+  }
+  _fps = fps;
+  // Below the producer and the SD writers, detection may lag behind
+  if (xTaskCreate(_motionTask, "motion", MOTION_STACK_SIZE, this, 1, &_task) != pdPASS) {
+    log_e("Failed to start motion detection");
+    _task = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void MotionDetector::_motionTask(void *arg) {
+  static_cast<MotionDetector *>(arg)->_run();
+}
+
+void MotionDetector::_run() {
+  uint32_t seq = 0;
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;) {
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(1000 / _fps));
+
+    FrameLease frame = frameBroker.wait(seq, 1000);
+    if (!frame || frame->fb->format != PIXFORMAT_JPEG) {
+      continue;
+    }
+    seq = frame->seq;
+    _process(frame->fb->buf, frame->fb->len, frame->grabbed);
+  }
+}
+
+void MotionDetector::_process(const uint8_t *jpeg, size_t len, int64_t grabbed) {
+  int64_t start = esp_timer_get_time();
+  if (!_decoder.decode(jpeg, len)) {
+    return;
+  }
+
+  const uint8_t *map = _decoder.map();
+  size_t blocks = (size_t)_decoder.mapWidth() * _decoder.mapHeight();
+  if (_decoder.mapWidth() != _mapWidth || _decoder.mapHeight() != _mapHeight) {
+    // New framesize, start learning again
+    _mapWidth = _decoder.mapWidth();
+    _mapHeight = _decoder.mapHeight();
+    _background.resize(blocks);
+    for (size_t i = 0; i < blocks; i++) {
+      _background[i] = map[i] << 4;
+    }
+    _score = 0;
+    return;
+  }
+
+  size_t changed = 0;
+  for (size_t i = 0; i < blocks; i++) {
+    int32_t diff = (map[i] << 4) - _background[i];
+    if (abs(diff) > MOTION_BLOCK_THRESHOLD << 4) {
+      changed++;
+    }
+    _background[i] += diff >> MOTION_LEARN_SHIFT;
+  }
+  uint16_t score = blocks ? changed * 1000 / blocks : 0;
+  _score = score;
+
+  bool event = false;
+  if (_trigger && score >= _trigger && grabbed - _lastEvent >= MOTION_HOLDOFF_MS * 1000LL) {
+    _lastEvent = grabbed;
+    _events++;
+    event = true;
+    preEventRing.trigger();
+
+    char json[48];
+    snprintf(json, sizeof(json), "{\"score\":%u,\"events\":%u}", score, _events);
+    motionEvents.send(json, "motion", millis());
+  }
+
+  metrics_record(METRIC_MOTION_US, esp_timer_get_time() - start);
+  metrics_motion(score, event);
+}
@@ -0,0 +1,78 @@
+#ifndef MOTION_DETECTOR_H
+#define MOTION_DETECTOR_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <vector>
+#include "JpegDcDecoder.h"
+
+#ifndef MOTION_FPS
+#define MOTION_FPS 5
+#endif
+// A block counts as changed when its mean luma differs this much from the background.
+#ifndef MOTION_BLOCK_THRESHOLD
+#define MOTION_BLOCK_THRESHOLD 16
+#endif
+// Changed blocks in per mille of the image that make an event, 0 disables events.
+#ifndef MOTION_TRIGGER
+#define MOTION_TRIGGER 20
+#endif
+// Background adapts by 1/2^MOTION_LEARN_SHIFT of the difference per frame.
+#ifndef MOTION_LEARN_SHIFT
+#define MOTION_LEARN_SHIFT 3
+#endif
+// Minimum time between two motion events.
+#ifndef MOTION_HOLDOFF_MS
+#define MOTION_HOLDOFF_MS 2000
+#endif
+#ifndef MOTION_STACK_SIZE
+#define MOTION_STACK_SIZE 4096
+#endif
+
+// Compares the DC luma map of each JPEG frame against a running background.
+// Runs in its own low priority task on frames from the broker, the JPEG is
+// never fully decoded. Events go to the pre-event ring and to the
+// "motion" server-sent event on /cam/events.
+class MotionDetector {
+public:
+  bool begin(uint8_t fps = MOTION_FPS);
+
+  // Per mille of changed blocks that trigger an event, 0 = only measure.
+  void setTrigger(uint16_t trigger) {
+    _trigger = trigger;
+  }
+  uint16_t trigger() const {
+    return _trigger;
+  }
+  bool running() const {
+    return _task != nullptr;
+  }
+  uint16_t score() const {
+    return _score;
+  }
+  uint32_t events() const {
+    return _events;
+  }
+
+private:
+  static void _motionTask(void *arg);
+  void _run();
+  void _process(const uint8_t *jpeg, size_t len, int64_t grabbed);
+
+  TaskHandle_t _task = nullptr;
+  uint8_t _fps = MOTION_FPS;
+  volatile uint16_t _trigger = MOTION_TRIGGER;
+  volatile uint16_t _score = 0;  // changed blocks of the last frame, per mille
+  volatile uint32_t _events = 0;
+  int64_t _lastEvent = 0;
+
+  JpegDcDecoder _decoder;
+  std::vector<uint16_t> _background;  // luma << 4
+  uint16_t _mapWidth = 0;
+  uint16_t _mapHeight = 0;
+};
+
+extern MotionDetector motionDetector;
+extern AsyncEventSource motionEvents;
+
+#endif
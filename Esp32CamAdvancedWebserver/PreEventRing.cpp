@@ -0,0 +1,249 @@
+#include "PreEventRing.h"
+#include "SD_MMC.h"
+#include "AviRecorder.h"
+#include "esp_heap_caps.h"
+#include <time.h>
+
+#ifndef PRE_EVENT_WRITER_STACK_SIZE
+#define PRE_EVENT_WRITER_STACK_SIZE 6144
+#endif
+
+PreEventRing preEventRing;
+
+bool PreEventRing::begin(uint8_t preSeconds, uint8_t postSeconds, uint8_t fps) {
+  std::lock_guard<std::mutex> lock(_lock);
+
+  if (_dumping) {
+    return false;
+  }
+  sensor_t *s = esp_camera_sensor_get();
+  if (PRE_EVENT_RING_BYTES == 0 || !s || s->pixformat != PIXFORMAT_JPEG || !psramFound() || !fps) {
+    return false;
+  }
+
+  size_t slotSize = ((size_t)resolution[s->status.framesize].width * resolution[s->status.framesize].height / PRE_EVENT_SLOT_RATIO + 31) & ~31;
+  size_t slotCount = std::min((size_t)preSeconds * fps, (size_t)PRE_EVENT_RING_BYTES / slotSize);
+  if (!slotCount) {
+    log_e("Pre-event ring: framesize too large for the PSRAM budget");
+    return false;
+  }
+
+  if (_slab) {
+    heap_caps_free(_slab);
+    _slab = nullptr;
+  }
+  free(_slots);
+  _slots = nullptr;
+  _slotCount = 0;
+
+  _slab = (uint8_t *)heap_caps_malloc(slotCount * slotSize, MALLOC_CAP_SPIRAM);
+  _slots = (Slot *)calloc(slotCount, sizeof(Slot));
+  if (!_slab || !_slots) {
+    log_e("Failed to allocate");
+    if (_slab) {
+      heap_caps_free(_slab);
+      _slab = nullptr;
+    }
+    free(_slots);
+    _slots = nullptr;
+    return false;
+  }
+
+  _slotCount = slotCount;
+  _slotSize = slotSize;
+  _width = resolution[s->status.framesize].width;
+  _height = resolution[s->status.framesize].height;
+  _tail = 0;
+  _count = 0;
+  _preSeconds = preSeconds;
+  _postSeconds = postSeconds;
+  _fps = fps;
+  log_i("Pre-event ring: %u slots of %u bytes", (unsigned)slotCount, (unsigned)slotSize);
+
+  if (!_writer) {
+    if (xTaskCreate(_writerTask, "event_writer", PRE_EVENT_WRITER_STACK_SIZE, this, 2, &_writer) != pdPASS) {
+      log_e("Failed to start event writer");
+      _writer = nullptr;
+      return false;
+    }
+    frameBroker.subscribe(this);
+  }
+  return true;
+}
+
+void IRAM_ATTR PreEventRing::trigger() {
+  _triggered = true;
+}
+
+void PreEventRing::onFrame() {
+  FrameLease frame = frameBroker.acquire(_seq);
+  if (!frame) {
+    return;
+  }
+  _seq = frame->seq;
+
+  if (_triggered) {
+    _triggered = false;
+    _postUntil = frame->grabbed + (int64_t)_postSeconds * 1000000;
+    if (!_dumping) {
+      _postDone = false;
+      _dumping = true;
+      xTaskNotifyGive(_writer);
+    }
+  }
+
+  if (_dumping && !_postDone && frame->grabbed > _postUntil) {
+    _endSeq = _queuedSeq;
+    _postDone = true;
+    xTaskNotifyGive(_writer);
+  }
+
+  if (frame->grabbed - _lastQueued < 1000000 / _fps) {
+    return;
+  }
+  _queuedSeq = frame->seq;
+  _lastQueued = frame->grabbed;
+  {
+    std::lock_guard<std::mutex> lock(_pendingLock);
+    if (_pending) {
+      _overruns++;  // the writer did not get to the previous one
+    }
+    _pending = std::move(frame);
+  }
+  xTaskNotifyGive(_writer);
+}
+
+void PreEventRing::_storePending() {
+  FrameLease frame;
+  {
+    std::lock_guard<std::mutex> lock(_pendingLock);
+    frame = std::move(_pending);
+  }
+  if (frame) {
+    _store(frame);
+  }
+}
+
+void PreEventRing::_store(const FrameLease &frame) {
+  camera_fb_t *fb = frame->fb;
+  if (fb->format != PIXFORMAT_JPEG) {
+    return;
+  }
+  if (fb->len > _slotSize) {
+    _oversize++;
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(_lock);
+  if (!_slab) {
+    return;
+  }
+  if (_count == _slotCount) {
+    // Full: overwrite the oldest frame, unless it still has to go to the SD card
+    if (_dumping) {
+      _overruns++;
+      return;
+    }
+    _tail = (_tail + 1) % _slotCount;
+    _count--;
+  }
+
+  size_t index = (_tail + _count) % _slotCount;
+  memcpy(_slab + index * _slotSize, fb->buf, fb->len);
+  _slots[index].len = fb->len;
+  _slots[index].seq = frame->seq;
+  _slots[index].timestamp = fb->timestamp;
+  _count++;
+}
+
+void PreEventRing::_writerTask(void *arg) {
+  PreEventRing *ring = static_cast<PreEventRing *>(arg);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    ring->_storePending();
+    if (ring->_dumping) {
+      ring->_write();
+    }
+  }
+}
+
+void PreEventRing::_write() {
+  time_t now;
+  struct tm tm;
+  time(&now);
+  localtime_r(&now, &tm);
+  SD_MMC.mkdir(PRE_EVENT_DIR);
+  strftime(_file, sizeof(_file), PRE_EVENT_DIR "/event-%Y%m%d-%H%M%S.avi", &tm);
+
+  AviFile avi;
+  if (avi.open(SD_MMC, _file)) {
+    log_i("Writing event to %s", _file);
+  }
+
+  _written = 0;
+  for (;;) {
+    // Read before taking the pending frame: once the post-roll is done,
+    // every frame up to _endSeq has been handed over
+    bool postDone = _postDone;
+    _storePending();
+
+    Slot slot = {};
+    size_t index = 0;
+    {
+      std::lock_guard<std::mutex> lock(_lock);
+      if (_count && !(postDone && _slots[_tail].seq > _endSeq)) {
+        index = _tail;
+        slot = _slots[index];
+      } else if (postDone) {
+        break;
+      }
+    }
+    if (!slot.len) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+      continue;
+    }
+
+    // Slots are only filled by this task, and never overwritten while dumping
+    int64_t timestamp = (int64_t)slot.timestamp.tv_sec * 1000000 + slot.timestamp.tv_usec;
+    if (avi.addFrame(_slab + index * _slotSize, slot.len, _width, _height, timestamp)) {
+      _written++;
+    }
+
+    std::lock_guard<std::mutex> lock(_lock);
+    _tail = (_tail + 1) % _slotCount;
+    _count--;
+  }
+
+  avi.close();
+  log_i("Event written: %u frames", _written);
+  _dumping = false;
+}
+
+void PreEventRing::status(Print &out) {
+  std::lock_guard<std::mutex> lock(_lock);
+  out.printf(
+    "{\"slots\":%u,\"slot_size\":%u,\"frames\":%u,\"pre\":%u,\"post\":%u,\"fps\":%u,\"dumping\":%s,\"written\":%u,\"oversize\":%u,\"overruns\":%u,\"file\":\"%s\"}",
+    (unsigned)_slotCount, (unsigned)_slotSize, (unsigned)_count, _preSeconds, _postSeconds, _fps, _dumping ? "true" : "false", _written, _oversize, _overruns.load(), _file
+  );
+}
+
+void event_handler(AsyncWebServerRequest *request) {
+  if (request->hasParam("pre") || request->hasParam("post") || request->hasParam("fps")) {
+    int pre = request->hasParam("pre") ? request->getParam("pre")->value().toInt() : PRE_EVENT_SECONDS;
+    int post = request->hasParam("post") ? request->getParam("post")->value().toInt() : POST_EVENT_SECONDS;
+    int fps = request->hasParam("fps") ? request->getParam("fps")->value().toInt() : PRE_EVENT_FPS;
+    if (pre < 0 || pre > 255 || post < 0 || post > 255 || fps <= 0 || fps > 60 || !preEventRing.begin(pre, post, fps)) {
+      request->send(500, "text/plain", "Pre-event ring not configured.");
+      return;
+    }
+  }
+
+  if (request->hasParam("trigger")) {
+    preEventRing.trigger();
+  }
+
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  preEventRing.status(*response);
+  request->send(response);
+}
@@ -0,0 +1,99 @@
+#ifndef PRE_EVENT_RING_H
+#define PRE_EVENT_RING_H
+
+#include <Arduino.h>
+#include <mutex>
+#include <ESPAsyncWebServer.h>
+#include "FrameBroker.h"
+
+// PSRAM budget for the ring, 0 disables it.
+#ifndef PRE_EVENT_RING_BYTES
+#define PRE_EVENT_RING_BYTES (1024 * 1024)
+#endif
+#ifndef PRE_EVENT_SECONDS
+#define PRE_EVENT_SECONDS 5
+#endif
+#ifndef POST_EVENT_SECONDS
+#define POST_EVENT_SECONDS 5
+#endif
+#ifndef PRE_EVENT_FPS
+#define PRE_EVENT_FPS 5
+#endif
+// Slot size as a fraction of width * height, frames that do not fit are skipped.
+#ifndef PRE_EVENT_SLOT_RATIO
+#define PRE_EVENT_SLOT_RATIO 8
+#endif
+#ifndef PRE_EVENT_DIR
+#define PRE_EVENT_DIR "/events"
+#endif
+
+// Keeps the last few seconds of JPEG frames in a slab of fixed-size PSRAM
+// slots, fed by the camera producer. A trigger writes the pre-roll plus the
+// following seconds to one AVI file on the SD card, frames are appended in
+// order by a writer task while the producer keeps feeding the ring.
+//
+// The producer only hands the frame lease over, the copy into the slab is
+// done by the writer task between two SD writes.
+class PreEventRing : public FrameListener {
+public:
+  // Allocates the slab for the current framesize. Can be called again to
+  // change the timing, not while a dump is running.
+  bool begin(uint8_t preSeconds = PRE_EVENT_SECONDS, uint8_t postSeconds = POST_EVENT_SECONDS, uint8_t fps = PRE_EVENT_FPS);
+
+  // Safe to call from an ISR. The dump starts with the next frame, triggers
+  // during a dump extend the post-roll.
+  void trigger();
+
+  void onFrame() override;
+  void status(Print &out);
+
+private:
+  struct Slot {
+    uint32_t len;
+    uint32_t seq;
+    struct timeval timestamp;
+  };
+
+  void _storePending();
+  void _store(const FrameLease &frame);
+  void _write();
+  static void _writerTask(void *arg);
+
+  std::mutex _lock;
+  uint8_t *_slab = nullptr;
+  Slot *_slots = nullptr;
+  size_t _slotCount = 0;
+  size_t _slotSize = 0;
+  size_t _tail = 0;   // oldest stored frame
+  size_t _count = 0;  // frames stored
+  uint16_t _width = 0;
+  uint16_t _height = 0;
+
+  uint8_t _fps = PRE_EVENT_FPS;
+  uint8_t _preSeconds = PRE_EVENT_SECONDS;
+  uint8_t _postSeconds = POST_EVENT_SECONDS;
+  uint32_t _seq = 0;         // last frame seen
+  uint32_t _queuedSeq = 0;   // last frame handed to the writer
+  int64_t _lastQueued = 0;
+
+  std::mutex _pendingLock;   // only held to swap the lease
+  FrameLease _pending;       // waiting to be copied by the writer
+
+  volatile bool _triggered = false;
+  volatile bool _dumping = false;   // from the trigger until the writer closed the file
+  volatile bool _postDone = false;  // the post-roll is complete, nothing after _endSeq belongs to the dump
+  uint32_t _endSeq = 0;
+  int64_t _postUntil = 0;
+  TaskHandle_t _writer = nullptr;
+
+  uint32_t _oversize = 0;  // frames larger than a slot
+  std::atomic<uint32_t> _overruns{0};  // frames lost because the writer or SD card fell behind
+  uint32_t _written = 0;   // frames written by the last dump
+  char _file[48] = "";
+};
+
+extern PreEventRing preEventRing;
+
+void event_handler(AsyncWebServerRequest *request);
+
+#endif
@@ -0,0 +1,76 @@
+#include "RegisterShadow.h"
+
+RegisterShadow registerShadow;
+
+void RegisterShadow::_add(uint16_t reg, uint32_t mask) {
+  if (_count < REGISTER_SHADOW_SIZE) {
+    _entries[_count++] = {reg, mask, 0};
+  }
+}
+
+void RegisterShadow::begin(sensor_t *s) {
+  _count = 0;
+  _valid = false;
+
+  if (s->id.PID == OV5640_PID || s->id.PID == OV3660_PID) {
+    for (int reg = 0x3400; reg < 0x3406; reg += 2) {
+      _add(reg, 0xFFF);  //12 bit
+    }
+    _add(0x3406, 0xFF);
+
+    _add(0x3500, 0xFFFF0);  //16 bit
+    _add(0x3503, 0xFF);
+    _add(0x350a, 0x3FF);   //10 bit
+    _add(0x350c, 0xFFFF);  //16 bit
+
+    for (int reg = 0x5480; reg <= 0x5490; reg++) {
+      _add(reg, 0xFF);
+    }
+
+    for (int reg = 0x5380; reg <= 0x538b; reg++) {
+      _add(reg, 0xFF);
+    }
+
+    for (int reg = 0x5580; reg < 0x558a; reg++) {
+      _add(reg, 0xFF);
+    }
+    _add(0x558a, 0x1FF);  //9 bit
+  } else if (s->id.PID == OV2640_PID) {
+    _add(0xd3, 0xFF);
+    _add(0x111, 0xFF);
+    _add(0x132, 0xFF);
+  }
+}
+
+void RegisterShadow::written(uint16_t reg, uint32_t mask, int value) {
+  for (size_t i = 0; i < _count; i++) {
+    if (_entries[i].reg == reg && _entries[i].mask == mask) {
+      if (_entries[i].value != (int)(value & mask)) {
+        _entries[i].value = value & mask;
+        _generation++;
+      }
+      return;
+    }
+  }
+  // Multi byte entries overlap neighbouring registers, don't guess
+  _valid = false;
+}
+
+bool RegisterShadow::refresh(sensor_t *s) {
+  if (_valid && millis() - _readAt < REGISTER_SHADOW_MAX_AGE_MS) {
+    return false;
+  }
+
+  bool changed = !_valid;
+  for (size_t i = 0; i < _count; i++) {
+    int value = s->get_reg(s, _entries[i].reg, _entries[i].mask);
+    changed |= value != _entries[i].value;
+    _entries[i].value = value;
+  }
+  _valid = true;
+  _readAt = millis();
+  if (changed) {
+    _generation++;
+  }
+  return changed;
+}
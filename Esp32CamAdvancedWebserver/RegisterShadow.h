@@ -0,0 +1,71 @@
+#ifndef REGISTER_SHADOW_H
+#define REGISTER_SHADOW_H
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+// Registers change on their own while AEC/AGC run, the shadow is re-read
+// after this long even without writes.
+#ifndef REGISTER_SHADOW_MAX_AGE_MS
+#define REGISTER_SHADOW_MAX_AGE_MS 5000
+#endif
+
+#define REGISTER_SHADOW_SIZE 48
+
+// Copy of the sensor registers reported by /cam/status, so polling the
+// status does not go out on the SCCB bus each time. Writers through the HTTP
+// handlers update or invalidate it, everything else is picked up by the
+// periodic re-read in refresh().
+class RegisterShadow {
+public:
+  // Selects the register set for the sensor model.
+  void begin(sensor_t *s);
+
+  void invalidate() {
+    _valid = false;
+  }
+  // False after a write the shadow could not follow, until the next refresh().
+  bool valid() const {
+    return _valid;
+  }
+  // A register was written through set_reg(), updates the entry if it is
+  // shadowed with the same mask, otherwise invalidates the shadow.
+  void written(uint16_t reg, uint32_t mask, int value);
+
+  // Re-reads the registers if the shadow is invalid or too old. Returns true
+  // if any value changed since the last read.
+  bool refresh(sensor_t *s);
+
+  size_t size() const {
+    return _count;
+  }
+  uint16_t reg(size_t i) const {
+    return _entries[i].reg;
+  }
+  int value(size_t i) const {
+    return _entries[i].value;
+  }
+  // Counts changes of any value, for callers that cache what they built from it.
+  uint32_t generation() const {
+    return _generation;
+  }
+
+private:
+  struct Entry {
+    uint16_t reg;
+    uint32_t mask;
+    int value;
+  };
+
+  void _add(uint16_t reg, uint32_t mask);
+
+  Entry _entries[REGISTER_SHADOW_SIZE];
+  size_t _count = 0;
+  bool _valid = false;
+  uint32_t _readAt = 0;
+  uint32_t _generation = 0;
+};
+
+extern RegisterShadow registerShadow;
+
+#endif
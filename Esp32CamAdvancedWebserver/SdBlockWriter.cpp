@@ -0,0 +1,56 @@
+#include "SdBlockWriter.h"
+#include "esp_heap_caps.h"
+
+bool SdBlockWriter::begin(File &file) {
+  end();
+  _block = (uint8_t *)heap_caps_malloc(SD_BLOCK_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+  if (!_block) {
+    log_e("Failed to allocate");
+    return false;
+  }
+  _file = &file;
+  _used = 0;
+  _position = file.position();
+  _failed = false;
+  return true;
+}
+
+size_t SdBlockWriter::write(const uint8_t *data, size_t len) {
+  if (!_block || _failed) {
+    return 0;
+  }
+
+  size_t done = 0;
+  while (done < len) {
+    size_t n = std::min(len - done, (size_t)SD_BLOCK_SIZE - _used);
+    memcpy(_block + _used, data + done, n);
+    _used += n;
+    done += n;
+    if (_used == SD_BLOCK_SIZE && !flush()) {
+      break;
+    }
+  }
+  _position += done;
+  return done;
+}
+
+bool SdBlockWriter::flush() {
+  if (!_block || !_used) {
+    return !_failed;
+  }
+  if (_file->write(_block, _used) != _used) {
+    log_e("SD write failed");
+    _failed = true;
+  }
+  _used = 0;
+  return !_failed;
+}
+
+void SdBlockWriter::end() {
+  if (_block) {
+    flush();
+    heap_caps_free(_block);
+    _block = nullptr;
+  }
+  _file = nullptr;
+}
@@ -0,0 +1,41 @@
+#ifndef SD_BLOCK_WRITER_H
+#define SD_BLOCK_WRITER_H
+
+#include <Arduino.h>
+#include "FS.h"
+
+#ifndef SD_BLOCK_SIZE
+#define SD_BLOCK_SIZE (16 * 1024)
+#endif
+
+// Appends to a file in SD_BLOCK_SIZE blocks staged in DMA capable internal
+// RAM. The SD/MMC driver cannot DMA from PSRAM and falls back to one sector
+// per transfer for such buffers, so frame data is always copied through here.
+class SdBlockWriter {
+public:
+  ~SdBlockWriter() {
+    end();
+  }
+
+  bool begin(File &file);
+  size_t write(const uint8_t *data, size_t len);
+  bool flush();
+  void end();
+
+  // Bytes written so far, including the ones still staged.
+  size_t position() const {
+    return _position;
+  }
+  bool failed() const {
+    return _failed;
+  }
+
+private:
+  File *_file = nullptr;
+  uint8_t *_block = nullptr;
+  size_t _used = 0;
+  size_t _position = 0;
+  bool _failed = false;
+};
+
+#endif
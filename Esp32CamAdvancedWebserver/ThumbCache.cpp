@@ -0,0 +1,201 @@
+#include "ThumbCache.h"
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include "FrameBroker.h"
+#include "esp_heap_caps.h"
+#include "img_converters.h"
+
+struct Thumbnail {
+  uint32_t seq = 0;
+  uint8_t *buf = nullptr;
+  size_t len = 0;
+  struct timeval timestamp;
+
+  ~Thumbnail() {
+    free(buf);
+  }
+};
+
+struct ThumbWaiter {
+  AsyncWebServerRequest *request;
+  jpg_scale_t scale;
+};
+
+// Only held to swap the cached pointers, encodes run without it
+static std::mutex thumbs_lock;
+static std::shared_ptr<const Thumbnail> thumbs[JPG_SCALE_MAX];
+
+// Also held while the waiters are sent to, so a disconnect cannot delete a
+// request that is being sent to
+static std::mutex waiters_lock;
+static std::condition_variable waiters_wake;
+static std::list<ThumbWaiter> waiters;
+static TaskHandle_t thumb_task_handle = nullptr;
+
+static std::shared_ptr<const Thumbnail> thumb_encode(const FrameLease &frame, jpg_scale_t scale) {
+  camera_fb_t *fb = frame->fb;
+  uint16_t width = (fb->width + (1 << scale) - 1) >> scale;
+  uint16_t height = (fb->height + (1 << scale) - 1) >> scale;
+  size_t rgbLen = (size_t)width * height * 2;
+
+  uint8_t *rgb = (uint8_t *)heap_caps_malloc(rgbLen, MALLOC_CAP_SPIRAM);
+  if (!rgb) {
+    rgb = (uint8_t *)malloc(rgbLen);
+  }
+  if (!rgb) {
+    log_e("Failed to allocate");
+    return nullptr;
+  }
+
+  std::shared_ptr<Thumbnail> thumb = std::make_shared<Thumbnail>();
+  thumb->seq = frame->seq;
+  thumb->timestamp = fb->timestamp;
+
+  bool ok = jpg2rgb565(fb->buf, fb->len, rgb, scale) && fmt2jpg(rgb, rgbLen, width, height, PIXFORMAT_RGB565, THUMB_QUALITY, &thumb->buf, &thumb->len);
+  free(rgb);
+  if (!ok) {
+    log_e("Thumbnail conversion failed");
+    return nullptr;
+  }
+  return thumb;
+}
+
+static void thumb_send(AsyncWebServerRequest *request, std::shared_ptr<const Thumbnail> thumb) {
+  if (!thumb) {
+    request->send(500, "text/plain", "Thumbnail conversion failed");
+    return;
+  }
+
+  char ts[32];
+  snprintf(ts, sizeof(ts), "%lld.%06ld", (long long)thumb->timestamp.tv_sec, (long)thumb->timestamp.tv_usec);
+
+  AsyncWebServerResponse *response = request->beginResponse("image/jpeg", thumb->len, [thumb](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+    size_t len = thumb->len - index;
+    if (len > maxLen) len = maxLen;
+    memcpy(buffer, thumb->buf + index, len);
+    return len;
+  });
+  response->addHeader("Content-Disposition", "inline; filename=thumb.jpg");
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  response->addHeader("X-Timestamp", ts);
+  request->send(response);
+}
+
+// The cached thumbnail if it is of frame, otherwise a new one
+static std::shared_ptr<const Thumbnail> thumb_get(const FrameLease &frame, jpg_scale_t scale) {
+  {
+    std::lock_guard<std::mutex> lock(thumbs_lock);
+    const std::shared_ptr<const Thumbnail> &thumb = thumbs[scale - 1];
+    if (thumb && thumb->seq == frame->seq) {
+      return thumb;
+    }
+  }
+  std::shared_ptr<const Thumbnail> thumb = thumb_encode(frame, scale);
+  if (thumb) {
+    std::lock_guard<std::mutex> lock(thumbs_lock);
+    thumbs[scale - 1] = thumb;
+  }
+  return thumb;
+}
+
+static void thumb_task(void *) {
+  for (;;) {
+    bool wanted[JPG_SCALE_MAX] = {};
+    {
+      std::unique_lock<std::mutex> lock(waiters_lock);
+      waiters_wake.wait(lock, [] {
+        return !waiters.empty();
+      });
+      for (const ThumbWaiter &w : waiters) {
+        wanted[w.scale - 1] = true;
+      }
+    }
+
+    // One encode per scale for everyone waiting on it
+    std::shared_ptr<const Thumbnail> encoded[JPG_SCALE_MAX];
+    FrameLease frame = frameBroker.latest();
+    for (int i = 0; i < JPG_SCALE_MAX; i++) {
+      if (wanted[i] && frame && frame->fb->format == PIXFORMAT_JPEG) {
+        encoded[i] = thumb_get(frame, (jpg_scale_t)(i + 1));
+      }
+    }
+    frame.reset();
+
+    std::lock_guard<std::mutex> lock(waiters_lock);
+    waiters.remove_if([&](const ThumbWaiter &w) {
+      if (!wanted[w.scale - 1]) {
+        return false;  // came in during the encode, next round
+      }
+      thumb_send(w.request, encoded[w.scale - 1]);
+      return true;
+    });
+  }
+}
+
+bool thumb_begin() {
+  if (thumb_task_handle) {
+    return false;
+  }
+  if (xTaskCreate(thumb_task, "thumb", THUMB_STACK_SIZE, nullptr, 2, &thumb_task_handle) != pdPASS) {
+    log_e("Failed to start thumbnail task");
+    thumb_task_handle = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void thumb_handler(AsyncWebServerRequest *request) {
+  jpg_scale_t scale = JPG_SCALE_4X;
+  if (request->hasParam("scale")) {
+    const String &value = request->getParam("scale")->value();
+    if (value == "1/2") {
+      scale = JPG_SCALE_2X;
+    } else if (value == "1/4") {
+      scale = JPG_SCALE_4X;
+    } else if (value == "1/8") {
+      scale = JPG_SCALE_8X;
+    } else {
+      request->send(400, "text/plain", "scale must be 1/2, 1/4 or 1/8");
+      return;
+    }
+  }
+
+  FrameLease frame = frameBroker.latest();
+  if (!frame || frame->fb->format != PIXFORMAT_JPEG) {
+    log_e("Camera capture failed");
+    request->send(500, "text/plain", "No JPEG frame");
+    return;
+  }
+
+  std::shared_ptr<const Thumbnail> thumb;
+  {
+    std::lock_guard<std::mutex> lock(thumbs_lock);
+    thumb = thumbs[scale - 1];
+  }
+  if (thumb && thumb->seq == frame->seq) {
+    frame.reset();
+    thumb_send(request, thumb);
+    return;
+  }
+  if (!thumb_task_handle) {
+    thumb = thumb_get(frame, scale);
+    frame.reset();
+    thumb_send(request, thumb);
+    return;
+  }
+  frame.reset();
+
+  request->pause();
+  request->onDisconnect([request]() {
+    std::lock_guard<std::mutex> lock(waiters_lock);
+    waiters.remove_if([request](const ThumbWaiter &w) {
+      return w.request == request;
+    });
+  });
+
+  std::lock_guard<std::mutex> lock(waiters_lock);
+  waiters.push_back({request, scale});
+  waiters_wake.notify_one();
+}
@@ -0,0 +1,27 @@
+#ifndef THUMB_CACHE_H
+#define THUMB_CACHE_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#ifndef THUMB_QUALITY
+#define THUMB_QUALITY 60
+#endif
+#ifndef THUMB_STACK_SIZE
+#define THUMB_STACK_SIZE 6144
+#endif
+
+// GET /cam/thumb?scale=1/2|1/4|1/8 (default 1/4)
+//
+// Serves a small JPEG of the newest frame. The frame is decoded at reduced
+// size by the JPEG decoder itself (only the low frequency DCT coefficients
+// are used) and then re-encoded, the sensor framesize is left alone. The
+// last thumbnail of each scale is kept, so requests for the same frame share
+// one encode. A cached thumbnail of the newest frame is sent right away,
+// otherwise the request is paused and the encode runs on the thumbnail task.
+void thumb_handler(AsyncWebServerRequest *request);
+
+// Starts the thumbnail task, without it thumbnails are encoded on async_tcp.
+bool thumb_begin();
+
+#endif
@@ -0,0 +1,98 @@
+#include "WsStream.h"
+#include "CameraMetrics.h"
+
+WsStream wsStream;
+
+WsStream::WsStream() : _ws("/cam/ws") {}
+
+void WsStream::begin(AsyncWebServer *server) {
+  _ws.onEvent([this](AsyncWebSocket *, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+    _onEvent(client, type, arg, data, len);
+  });
+  server->addHandler(&_ws);
+  if (frameBroker.producing()) {
+    frameBroker.subscribe(this);
+  }
+}
+
+void WsStream::_onEvent(AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+  if (type == WS_EVT_CONNECT) {
+    // A full queue must not close the client from inside onFrame(), the
+    // disconnect event would wait for _lock. Frames are skipped instead.
+    client->setCloseClientOnQueueFull(false);
+    std::lock_guard<std::mutex> lock(_lock);
+    _clients.push_back({client, WS_STREAM_INITIAL_CREDITS});
+  } else if (type == WS_EVT_DISCONNECT) {
+    std::lock_guard<std::mutex> lock(_lock);
+    _clients.remove_if([client](const Client &c) {
+      return c.client == client;
+    });
+  } else if (type == WS_EVT_DATA) {
+    AwsFrameInfo *info = (AwsFrameInfo *)arg;
+    if (!info->final || info->index || info->len != len || info->opcode != WS_TEXT || len > 8) {
+      return;
+    }
+    char value[9];
+    memcpy(value, data, len);
+    value[len] = 0;
+    int credits = atoi(value);
+    if (credits <= 0) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(_lock);
+    for (Client &c : _clients) {
+      if (c.client == client) {
+        c.credits = std::min<uint32_t>(c.credits + credits, WS_STREAM_MAX_CREDITS);
+      }
+    }
+  }
+}
+
+void WsStream::onFrame() {
+  std::lock_guard<std::mutex> lock(_lock);
+  if (_clients.empty()) {
+    return;
+  }
+
+  FrameLease frame = frameBroker.acquire(_seq);
+  if (!frame) {
+    return;
+  }
+  _seq = frame->seq;
+
+  AsyncWebSocketSharedBuffer buffer;
+  for (Client &c : _clients) {
+    if (!c.credits || c.client->queueIsFull()) {
+      metrics_dropped(1);
+      continue;
+    }
+
+    if (!buffer) {
+      camera_fb_t *fb = frame->fb;
+      WsFrameHeader header;
+      header.magic = WS_FRAME_MAGIC;
+      header.headerSize = sizeof(header);
+      header.width = fb->width;
+      header.height = fb->height;
+      header.format = fb->format;
+      header.quality = frame->quality;
+      header.seq = frame->seq;
+      header.timestamp = (uint64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+
+      // The one copy per frame, every client queues the same buffer
+      buffer = std::make_shared<std::vector<uint8_t>>(sizeof(header) + fb->len);
+      if (!buffer || buffer->size() != sizeof(header) + fb->len) {
+        log_e("Failed to allocate");
+        return;
+      }
+      memcpy(buffer->data(), &header, sizeof(header));
+      memcpy(buffer->data() + sizeof(header), fb->buf, fb->len);
+      frame.reset();
+    }
+
+    if (c.client->binary(buffer)) {
+      c.credits--;
+    }
+  }
+}
@@ -0,0 +1,65 @@
+#ifndef WS_STREAM_H
+#define WS_STREAM_H
+
+#include <ESPAsyncWebServer.h>
+#include <list>
+#include <mutex>
+#include "FrameBroker.h"
+
+// Credits a client starts with and may hold at most.
+#ifndef WS_STREAM_INITIAL_CREDITS
+#define WS_STREAM_INITIAL_CREDITS 2
+#endif
+#ifndef WS_STREAM_MAX_CREDITS
+#define WS_STREAM_MAX_CREDITS 8
+#endif
+
+#define WS_FRAME_MAGIC 0x464D4143  // "CAMF"
+
+// Prepended to every binary message on /cam/ws, little endian.
+struct __attribute__((packed)) WsFrameHeader {
+  uint32_t magic;
+  uint16_t headerSize;  // offset of the image data
+  uint16_t width;
+  uint16_t height;
+  uint8_t format;       // pixformat_t, PIXFORMAT_JPEG = 4
+  uint8_t quality;      // JPEG quality the sensor was set to
+  uint32_t seq;         // frame sequence number, gaps are dropped frames
+  uint64_t timestamp;   // capture time in microseconds
+};
+
+// Binary WebSocket stream on /cam/ws, an alternative to the multipart stream.
+//
+// Each frame is one binary message: WsFrameHeader followed by the JPEG. The
+// message is built once per frame and the same shared buffer is queued to
+// every client. Flow control is credit based: a client only gets a frame
+// while it has credits, each frame costs one, and the client returns credits
+// by sending a text message with the number of frames it can take, e.g. "1"
+// after it has displayed a frame. Clients without credits skip frames.
+class WsStream : public FrameListener {
+public:
+  WsStream();
+
+  // Registers the socket and, if the producer runs, subscribes to frames.
+  void begin(AsyncWebServer *server);
+  void onFrame() override;
+
+private:
+  struct Client {
+    AsyncWebSocketClient *client;
+    uint32_t credits;
+  };
+
+  void _onEvent(AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
+
+  AsyncWebSocket _ws;
+  // Guards _clients. The disconnect event takes it too, so a client is not
+  // destroyed while a frame is queued to it.
+  std::mutex _lock;
+  std::list<Client> _clients;
+  uint32_t _seq = 0;
+};
+
+extern WsStream wsStream;
+
+#endif
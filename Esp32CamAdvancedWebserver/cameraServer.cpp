@@ -8,11 +8,39 @@
 #include "sdkconfig.h"
 #include "FS.h"
 #include "SD_MMC.h"
-
+#include "FrameBroker.h"
+#include "MjpegResponse.h"
+#include "CameraMetrics.h"
+#include "PreEventRing.h"
+#include "AviRecorder.h"
+#include "MotionDetector.h"
+#include "ThumbCache.h"
+#include "WsStream.h"
+#include "RegisterShadow.h"
+#include "CameraProperties.h"
+#include "JpegStreamEncoder.h"
+#include "BmpStream.h"
+#include "FrameTransform.h"
+#include "FlashCapture.h"
+#include "BurstCapture.h"
+#include "CameraSimulator.h"
+#include "scpi.h"
+
+
+// Frame rate of the camera producer task, 0 = as fast as the sensor delivers.
+// Can be changed at runtime with /cam/control?var=fps&val=...
+#ifndef CAMERA_PRODUCER_FPS
+#define CAMERA_PRODUCER_FPS 0
+#endif
 
 void startCameraServer(AsyncWebServer *server);
 void setupLedFlash();
 
+static void IRAM_ATTR event_trigger(int pin) {
+  (void)pin;
+  preEventRing.trigger();
+}
+
 void camera_cfg(AsyncWebServer *server) {
   camera_config_t config;
   config.ledc_channel = LEDC_CHANNEL_0;
@@ -47,7 +75,7 @@ void camera_cfg(AsyncWebServer *server) {
   if (config.pixel_format == PIXFORMAT_JPEG) {
     if (psramFound()) {
       config.jpeg_quality = 10;
-      config.fb_count = 2;
+      config.fb_count = 3;  // stream clients may lag a frame behind each other, keep one buffer for the driver
       config.grab_mode = CAMERA_GRAB_LATEST;
     } else {
       // Limit the frame size when PSRAM is not available
@@ -74,6 +102,14 @@ void camera_cfg(AsyncWebServer *server) {
     return;
   }
 
+#if defined(CAMERA_SIMULATOR)
+  cameraSimulator.begin(SD_MMC, CAMERA_SIM_DIR, CAMERA_SIM_FPS, config.fb_count);
+#endif
+  frameBroker.begin(config.fb_count, config.jpeg_quality);
+  if (config.fb_count > 1) {
+    frameBroker.startProducer(CAMERA_PRODUCER_FPS);  // grab in the background, HTTP only takes finished frames
+  }
+
   sensor_t *s = esp_camera_sensor_get();
   // initial sensors are flipped vertically and colors are a bit saturated
   if (s->id.PID == OV3660_PID) {
@@ -85,6 +121,7 @@ void camera_cfg(AsyncWebServer *server) {
   if (config.pixel_format == PIXFORMAT_JPEG) {
     s->set_framesize(s, FRAMESIZE_QVGA);
   }
+  registerShadow.begin(s);
 
 #if defined(CAMERA_MODEL_M5STACK_WIDE) || defined(CAMERA_MODEL_M5STACK_ESP32CAM)
   s->set_vflip(s, 1);
@@ -95,6 +132,13 @@ void camera_cfg(AsyncWebServer *server) {
   s->set_vflip(s, 1);
 #endif
 
+  // Slots are sized for the initial framesize, /cam/event?pre= resizes them
+  if (frameBroker.producing()) {
+    preEventRing.begin();
+    motionDetector.begin();
+    scpi_setTriggerHandler(event_trigger);
+  }
+
 // Setup LED FLash if LED pin is defined in camera_pins.h
 #if defined(LED_GPIO_NUM)
   setupLedFlash();
@@ -200,46 +244,6 @@ bool isStreaming = false;
 
 #endif
 
-typedef struct {
-  size_t size;   //number of values used for filtering
-  size_t index;  //current value index
-  size_t count;  //value count
-  int sum;
-  int *values;  //array to be filled with values
-} ra_filter_t;
-
-static ra_filter_t ra_filter;
-
-static ra_filter_t *ra_filter_init(ra_filter_t *filter, size_t sample_size) {
-  memset(filter, 0, sizeof(ra_filter_t));
-
-  filter->values = (int *)malloc(sample_size * sizeof(int));
-  if (!filter->values) {
-    return NULL;
-  }
-  memset(filter->values, 0, sample_size * sizeof(int));
-
-  filter->size = sample_size;
-  return filter;
-}
-
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-static int ra_filter_run(ra_filter_t *filter, int value) {
-  if (!filter->values) {
-    return value;
-  }
-  filter->sum -= filter->values[filter->index];
-  filter->values[filter->index] = value;
-  filter->sum += filter->values[filter->index];
-  filter->index++;
-  filter->index = filter->index % filter->size;
-  if (filter->count < filter->size) {
-    filter->count++;
-  }
-  return filter->sum / filter->count;
-}
-#endif
-
 #if defined(LED_GPIO_NUM)
 void enable_led(bool en) {  // Turn LED On or Off
   int duty = en ? led_duty : 0;
@@ -255,45 +259,6 @@ void enable_led(bool en) {  // Turn LED On or Off
 
 /*
 
-static esp_err_t bmp_handler(httpd_req_t *req) {
-  camera_fb_t *fb = NULL;
-  esp_err_t res = ESP_OK;
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-  uint64_t fr_start = esp_timer_get_time();
-#endif
-  fb = esp_camera_fb_get();
-  if (!fb) {
-    log_e("Camera capture failed");
-    httpd_resp_send_500(req);
-    return ESP_FAIL;
-  }
-
-  httpd_resp_set_type(req, "image/x-windows-bmp");
-  httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=capture.bmp");
-  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-
-  char ts[32];
-  snprintf(ts, 32, "%lld.%06ld", fb->timestamp.tv_sec, fb->timestamp.tv_usec);
-  httpd_resp_set_hdr(req, "X-Timestamp", (const char *)ts);
-
-  uint8_t *buf = NULL;
-  size_t buf_len = 0;
-  bool converted = frame2bmp(fb, &buf, &buf_len);
-  esp_camera_fb_return(fb);
-  if (!converted) {
-    log_e("BMP Conversion failed");
-    httpd_resp_send_500(req);
-    return ESP_FAIL;
-  }
-  res = httpd_resp_send(req, (const char *)buf, buf_len);
-  free(buf);
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-  uint64_t fr_end = esp_timer_get_time();
-#endif
-  log_i("BMP: %llums, %uB", (uint64_t)((fr_end - fr_start) / 1000), buf_len);
-  return res;
-}
-
 static size_t jpg_encode_stream(void *arg, size_t index, const void *data, size_t len) {
   jpg_chunking_t *j = (jpg_chunking_t *)arg;
   if (!index) {
@@ -306,79 +271,224 @@ static size_t jpg_encode_stream(void *arg, size_t index, const void *data, size_
   return len;
 }
 */
-void capture_handler(AsyncWebServerRequest *request) {
-  camera_fb_t *fb = NULL;
-  esp_err_t res = ESP_OK;
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-  int64_t fr_start = esp_timer_get_time();
+
+int parse_get_var(AsyncWebServerRequest *request, const char *key, int def) {
+  if (request->hasParam(key)) {
+    return (request->getParam(key)->value().toInt());
+  } else {
+    return (def);
+  }
+}
+
+// Per request transform of /cam/capture and /cam/capture.raw:
+// cx, cy, cw, ch (crop), rotate (90, 180, 270), w, h (output size) and
+// filter=bilinear. Returns false if none is given.
+static bool parse_transform(AsyncWebServerRequest *request, TransformParams &params) {
+  static const char *keys[] = {"cx", "cy", "cw", "ch", "rotate", "w", "h", "filter"};
+  bool any = false;
+  for (const char *key : keys) {
+    any |= request->hasParam(key);
+  }
+
+  params.cropX = parse_get_var(request, "cx", 0);
+  params.cropY = parse_get_var(request, "cy", 0);
+  params.cropWidth = parse_get_var(request, "cw", 0);
+  params.cropHeight = parse_get_var(request, "ch", 0);
+  params.rotation = parse_get_var(request, "rotate", 0);
+  params.width = parse_get_var(request, "w", 0);
+  params.height = parse_get_var(request, "h", 0);
+  params.bilinear = request->hasParam("filter") && request->getParam("filter")->value() == "bilinear";
+  return any;
+}
+
+#if defined(LED_GPIO_NUM)
+// Flash for single captures, a running stream keeps its light
+static void capture_led(bool on) {
+  enable_led(on || isStreaming);
+}
 #endif
 
+// Calls send with the frame for a single capture. With a flash the request
+// is paused and resumed from the flash capture task, async_tcp never waits
+// for the exposure.
+static void capture_frame(AsyncWebServerRequest *request, capture_send_t send) {
 #if defined(LED_GPIO_NUM)
-  enable_led(true);
-  vTaskDelay(150 / portTICK_PERIOD_MS);  // The LED needs to be turned on ~150ms before the call to esp_camera_fb_get()
-  fb = esp_camera_fb_get();              // or it won't be visible in the frame. A better way to do this is needed.
-  enable_led(false);
+  flashCapture.capture(request, send);
 #else
-  fb = esp_camera_fb_get();
+  send(request, frameBroker.latest());
 #endif
+}
 
-  if (!fb) {
+static void capture_send(AsyncWebServerRequest *request, FrameLease frame) {
+  if (!frame) {
     log_e("Camera capture failed");
-    request->send_P(500, "text/html", "<html><body>Camera capture failed!</body></html>");
+    request->send(500, "text/html", "<html><body>Camera capture failed!</body></html>");
     return;
   }
 
-  if (fb->format == PIXFORMAT_JPEG) {
-    AsyncWebServerResponse *response = request->beginResponse_P(
-      200,
-      "image/jpeg",
-      fb->buf,
-      fb->len);
+  camera_fb_t *fb = frame->fb;
+  char ts[32];
+  snprintf(ts, sizeof(ts), "%lld.%06ld", (long long)fb->timestamp.tv_sec, (long)fb->timestamp.tv_usec);
+
+  TransformParams params;
+  bool transformed = parse_transform(request, params);
+
+  if (fb->format == PIXFORMAT_JPEG && !transformed) {
+    // The lease travels with the response, the frame buffer is returned once the last byte has been sent
+    AsyncWebServerResponse *response = request->beginResponse("image/jpeg", fb->len,
+      [frame](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        size_t len = frame->fb->len - index;
+        if (len > maxLen) len = maxLen;
+        memcpy(buffer, frame->fb->buf + index, len);
+        return len;
+      });
 
     response->addHeader("Content-Disposition", "inline; filename=capture.jpg");
     response->addHeader("Access-Control-Allow-Origin", "*");
-
-    char ts[32];
-    snprintf(ts, sizeof(ts), "%lld.%06ld", fb->timestamp.tv_sec, fb->timestamp.tv_usec);
     response->addHeader("X-Timestamp", ts);
 
     request->send(response);
-    esp_camera_fb_return(fb);
   } else {
+    // Encoded while sending, straight into the TCP buffer. The lease keeps
+    // the frame buffer alive until the encoder has read the last MCU.
+    std::shared_ptr<FrameTransform> transform;
+    if (transformed) {
+      transform = std::make_shared<FrameTransform>();
+      if (!transform->begin(fb->buf, fb->width, fb->height, fb->format, params)) {
+        request->send(400, "text/plain", "Transform needs an RGB565 or grayscale frame and a crop inside it");
+        return;
+      }
+    }
 
-    // Umwandlung in JPEG
-    uint8_t *jpg_buf = NULL;
-    size_t jpg_len = 0;
-
-    if (!frame2jpg(fb, 80, &jpg_buf, &jpg_len)) {
-      esp_camera_fb_return(fb);
+    std::shared_ptr<JpegStreamEncoder> encoder = std::make_shared<JpegStreamEncoder>();
+    bool started = transform ? encoder->begin(transform.get(), 80) : encoder->begin(fb->buf, fb->width, fb->height, fb->format, 80);
+    if (!started) {
       request->send(500, "text/plain", "JPEG-Konvertierung fehlgeschlagen");
       return;
     }
 
-    esp_camera_fb_return(fb);  // Frame zurückgeben, Puffer wurde dupliziert
-
-    // Stream-Response erzeugen
-    AsyncResponseStream *response = request->beginResponseStream("image/jpeg", jpg_len);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("image/jpeg",
+      [frame, transform, encoder](uint8_t *buffer, size_t maxLen, size_t) -> size_t {
+        return encoder->read(buffer, maxLen);
+      });
     response->addHeader("Content-Disposition", "inline; filename=capture.jpg");
     response->addHeader("Access-Control-Allow-Origin", "*");
-
-    char ts[32];
-    gettimeofday(&fb->timestamp, nullptr);  // fallback für Timestamp
-    snprintf(ts, sizeof(ts), "%lld.%06ld", fb->timestamp.tv_sec, fb->timestamp.tv_usec);
     response->addHeader("X-Timestamp", ts);
 
-    response->write(jpg_buf, jpg_len);
-    free(jpg_buf);  // nicht vergessen!
-
     request->send(response);
   }
 }
 
 
+void capture_handler(AsyncWebServerRequest *request) {
+  capture_frame(request, capture_send);
+}
+
+// GET /cam/capture.bmp
+//
+// The frame as BMP, converted row by row while sending. Needs a raw pixel
+// format, JPEG frames are not decoded here.
+static void bmp_send(AsyncWebServerRequest *request, FrameLease frame) {
+  if (!frame) {
+    log_e("Camera capture failed");
+    request->send(500, "text/plain", "Camera capture failed");
+    return;
+  }
+
+  BmpStream bmp;
+  if (!bmp.begin(frame->fb)) {
+    request->send(409, "text/plain", "BMP needs a raw pixel format");
+    return;
+  }
+
+  char ts[32];
+  snprintf(ts, sizeof(ts), "%lld.%06ld", (long long)frame->fb->timestamp.tv_sec, (long)frame->fb->timestamp.tv_usec);
+
+  AsyncWebServerResponse *response = request->beginResponse("image/x-windows-bmp", bmp.size(),
+    [frame, bmp](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      return bmp.read(buffer, maxLen, index);
+    });
+  response->addHeader("Content-Disposition", "inline; filename=capture.bmp");
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  response->addHeader("X-Timestamp", ts);
+  request->send(response);
+}
+
+void bmp_handler(AsyncWebServerRequest *request) {
+  capture_frame(request, bmp_send);
+}
+
+static const char *pixformat_name(pixformat_t format) {
+  switch (format) {
+    case PIXFORMAT_RGB565: return "rgb565";
+    case PIXFORMAT_YUV422: return "yuv422";
+    case PIXFORMAT_YUV420: return "yuv420";
+    case PIXFORMAT_GRAYSCALE: return "grayscale";
+    case PIXFORMAT_JPEG: return "jpeg";
+    case PIXFORMAT_RGB888: return "rgb888";
+    case PIXFORMAT_RAW: return "raw";
+    case PIXFORMAT_RGB444: return "rgb444";
+    case PIXFORMAT_RGB555: return "rgb555";
+    default: return "unknown";
+  }
+}
+
+// GET /cam/capture.raw
+//
+// The frame buffer as it came from the driver, sent in place. Geometry and
+// format are in X-Width, X-Height and X-Pixel-Format. RGB565 is big endian,
+// RGB888 is stored B G R and YUV422 as Y0 U Y1 V. RGB565 and grayscale
+// frames take the transform parameters of parse_transform().
+static void raw_send(AsyncWebServerRequest *request, FrameLease frame) {
+  if (!frame) {
+    log_e("Camera capture failed");
+    request->send(500, "text/plain", "Camera capture failed");
+    return;
+  }
+
+  camera_fb_t *fb = frame->fb;
+  char ts[32];
+  snprintf(ts, sizeof(ts), "%lld.%06ld", (long long)fb->timestamp.tv_sec, (long)fb->timestamp.tv_usec);
+
+  AsyncWebServerResponse *response;
+  TransformParams params;
+  if (parse_transform(request, params)) {
+    // Rendered strip by strip while sending
+    std::shared_ptr<FrameTransform> transform = std::make_shared<FrameTransform>();
+    if (!transform->begin(fb->buf, fb->width, fb->height, fb->format, params)) {
+      request->send(400, "text/plain", "Transform needs an RGB565 or grayscale frame and a crop inside it");
+      return;
+    }
+    response = request->beginResponse("application/octet-stream", transform->size(),
+      [frame, transform](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        return transform->read(buffer, maxLen, index);
+      });
+    response->addHeader("X-Width", String(transform->width()));
+    response->addHeader("X-Height", String(transform->height()));
+  } else {
+    response = request->beginResponse("application/octet-stream", fb->len,
+      [frame](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        size_t len = frame->fb->len - index;
+        if (len > maxLen) len = maxLen;
+        memcpy(buffer, frame->fb->buf + index, len);
+        return len;
+      });
+    response->addHeader("X-Width", String(fb->width));
+    response->addHeader("X-Height", String(fb->height));
+  }
+  response->addHeader("Content-Disposition", "inline; filename=capture.raw");
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  response->addHeader("X-Timestamp", ts);
+  response->addHeader("X-Pixel-Format", pixformat_name(fb->format));
+  request->send(response);
+}
+
+void raw_handler(AsyncWebServerRequest *request) {
+  capture_frame(request, raw_send);
+}
+
 
 void control_handler(AsyncWebServerRequest *request) {
-  char *buf = NULL;
   char variable[32];
   char value[32];
 
@@ -395,162 +505,207 @@ void control_handler(AsyncWebServerRequest *request) {
 
   log_i("%s = %d", variable, val);
   sensor_t *s = esp_camera_sensor_get();
-  int res = 0;
+  int res = camera_property_set(s, variable, val);
 
-  if (!strcmp(variable, "framesize")) {
-    if (s->pixformat == PIXFORMAT_JPEG) {
-      res = s->set_framesize(s, (framesize_t)val);
-    }
-  } else if (!strcmp(variable, "quality")) {
-    res = s->set_quality(s, val);
-  } else if (!strcmp(variable, "contrast")) {
-    res = s->set_contrast(s, val);
-  } else if (!strcmp(variable, "brightness")) {
-    res = s->set_brightness(s, val);
-  } else if (!strcmp(variable, "saturation")) {
-    res = s->set_saturation(s, val);
-  } else if (!strcmp(variable, "gainceiling")) {
-    res = s->set_gainceiling(s, (gainceiling_t)val);
-  } else if (!strcmp(variable, "colorbar")) {
-    res = s->set_colorbar(s, val);
-  } else if (!strcmp(variable, "awb")) {
-    res = s->set_whitebal(s, val);
-  } else if (!strcmp(variable, "agc")) {
-    res = s->set_gain_ctrl(s, val);
-  } else if (!strcmp(variable, "aec")) {
-    res = s->set_exposure_ctrl(s, val);
-  } else if (!strcmp(variable, "hmirror")) {
-    res = s->set_hmirror(s, val);
-  } else if (!strcmp(variable, "vflip")) {
-    res = s->set_vflip(s, val);
-  } else if (!strcmp(variable, "awb_gain")) {
-    res = s->set_awb_gain(s, val);
-  } else if (!strcmp(variable, "agc_gain")) {
-    res = s->set_agc_gain(s, val);
-  } else if (!strcmp(variable, "aec_value")) {
-    res = s->set_aec_value(s, val);
-  } else if (!strcmp(variable, "aec2")) {
-    res = s->set_aec2(s, val);
-  } else if (!strcmp(variable, "dcw")) {
-    res = s->set_dcw(s, val);
-  } else if (!strcmp(variable, "bpc")) {
-    res = s->set_bpc(s, val);
-  } else if (!strcmp(variable, "wpc")) {
-    res = s->set_wpc(s, val);
-  } else if (!strcmp(variable, "raw_gma")) {
-    res = s->set_raw_gma(s, val);
-  } else if (!strcmp(variable, "lenc")) {
-    res = s->set_lenc(s, val);
-  } else if (!strcmp(variable, "special_effect")) {
-    res = s->set_special_effect(s, val);
-  } else if (!strcmp(variable, "wb_mode")) {
-    res = s->set_wb_mode(s, val);
-  } else if (!strcmp(variable, "ae_level")) {
-    res = s->set_ae_level(s, val);
-  }
-#if defined(LED_GPIO_NUM)
-  else if (!strcmp(variable, "led_intensity")) {
-    led_duty = val;
-    if (isStreaming) {
-      enable_led(true);
-    }
-  }
-#endif
-  else {
-    log_i("Unknown command: %s", variable);
-    res = -1;
+  // Most sensor settings touch several registers
+  const CameraProperty *property = camera_property_find(variable);
+  if (property && !property->local) {
+    registerShadow.invalidate();
   }
 
   if (res < 0) {
     request->send(500, "text/html", "Unknown command.");
+    return;
   }
 
   request->send(200, "text/html", "Control ok.");
 }
 
+#if ASYNC_JSON_SUPPORT == 1
+#define CONTROL_BATCH_MAX 32
+
+struct ControlBatch {
+  AsyncWebServerRequest *request;  // nullptr once the client is gone
+  struct {
+    const CameraProperty *property;
+    int val;
+  } settings[CONTROL_BATCH_MAX];
+  size_t count = 0;
+};
+
+// Held while a batch answers its request, so a disconnect cannot delete it
+// in between
+static std::mutex controlBatchLock;
+
+static void control_batch_apply(ControlBatch &batch, sensor_t *s) {
+  const char *failed[CONTROL_BATCH_MAX];
+  size_t failures = 0;
+  bool sensor = false;
+  for (size_t i = 0; i < batch.count; i++) {
+    const CameraProperty *property = batch.settings[i].property;
+    if (camera_property_set(s, property->name, batch.settings[i].val) < 0) {
+      failed[failures++] = property->name;
+    }
+    sensor |= !property->local;
+  }
+  if (sensor) {
+    registerShadow.invalidate();
+  }
 
-static int print_reg(char *p, sensor_t *s, uint16_t reg, uint32_t mask) {
-  return sprintf(p, "\"0x%x\":%u,", reg, s->get_reg(s, reg, mask));
+  std::lock_guard<std::mutex> lock(controlBatchLock);
+  AsyncWebServerRequest *request = batch.request;
+  if (!request) {
+    return;
+  }
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->setCode(failures ? 500 : 200);
+  response->addHeader("Access-Control-Allow-Origin", "*");
+  response->printf("{\"applied\":%u,\"failed\":[", batch.count - failures);
+  for (size_t i = 0; i < failures; i++) {
+    response->printf("%s\"%s\"", i ? "," : "", failed[i]);
+  }
+  response->print("]}");
+  request->send(response);
 }
 
-void status_handler(AsyncWebServerRequest *request) {
-  static char json_response[1024];
+// POST /cam/control with a JSON object of var: value pairs, e.g.
+// {"framesize":8,"quality":10,"awb":1}. All names and ranges are checked first, then the
+// request is paused and the whole batch is written on the producer task between two
+// frames (framesize first, since other settings depend on it), which also sends the
+// response.
+void control_batch_handler(AsyncWebServerRequest *request, JsonVariant &json) {
+  std::shared_ptr<ControlBatch> batch = std::make_shared<ControlBatch>();
+  batch->request = request;
+
+  JsonObject object = json.as<JsonObject>();
+  if (object.isNull()) {
+    request->send(400, "text/plain", "JSON object expected.");
+    return;
+  }
+  for (JsonPair kv : object) {
+    const char *name = kv.key().c_str();
+    JsonVariant value = kv.value();
+    const CameraProperty *property = camera_property_find(name);
+    if (!property || !property->set || !(value.is<int>() || value.is<bool>()) || batch->count == CONTROL_BATCH_MAX) {
+      String message = String("Invalid setting: ") + name;
+      request->send(400, "text/plain", message);
+      return;
+    }
+    int val = value.is<bool>() ? value.as<bool>() : value.as<int>();
+    if (val < property->min || val > property->max) {
+      String message = String("Out of range: ") + name;
+      request->send(400, "text/plain", message);
+      return;
+    }
+    if (!strcmp(name, "framesize")) {
+      // Applied first
+      memmove(&batch->settings[1], &batch->settings[0], batch->count * sizeof(batch->settings[0]));
+      batch->settings[0] = {property, val};
+    } else {
+      batch->settings[batch->count] = {property, val};
+    }
+    batch->count++;
+  }
 
-  sensor_t *s = esp_camera_sensor_get();
-  char *p = json_response;
-  *p++ = '{';
+  request->pause();
+  request->onDisconnect([batch]() {
+    std::lock_guard<std::mutex> lock(controlBatchLock);
+    batch->request = nullptr;
+  });
+  frameBroker.configure([batch](sensor_t *s) {
+    control_batch_apply(*batch, s);
+  });
+}
+#endif
 
-  if (s->id.PID == OV5640_PID || s->id.PID == OV3660_PID) {
-    for (int reg = 0x3400; reg < 0x3406; reg += 2) {
-      p += print_reg(p, s, reg, 0xFFF);  //12 bit
-    }
-    p += print_reg(p, s, 0x3406, 0xFF);
+// FNV-1a, used to notice status changes and as the ETag
+static uint32_t status_hash(uint32_t hash, const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  while (len--) {
+    hash = (hash ^ *p++) * 16777619;
+  }
+  return hash;
+}
 
-    p += print_reg(p, s, 0x3500, 0xFFFF0);  //16 bit
-    p += print_reg(p, s, 0x3503, 0xFF);
-    p += print_reg(p, s, 0x350a, 0x3FF);   //10 bit
-    p += print_reg(p, s, 0x350c, 0xFFFF);  //16 bit
+// GET /cam/status, JSON or MessagePack if the client asks for
+// application/msgpack in Accept or with ?format=msgpack.
+void status_handler(AsyncWebServerRequest *request) {
+  struct StatusCache {
+    std::shared_ptr<uint8_t> body;  // shared with responses still being sent
+    size_t len;
+    uint32_t fingerprint;
+    char etag[12];
+  };
+  static StatusCache caches[2] = {};
 
-    for (int reg = 0x5480; reg <= 0x5490; reg++) {
-      p += print_reg(p, s, reg, 0xFF);
-    }
+  status_format_t format = STATUS_JSON;
+  if ((request->hasParam("format") && request->getParam("format")->value() == "msgpack")
+      || (request->hasHeader(AsyncWebHeader::Id::Accept) && request->header(AsyncWebHeader::Id::Accept).indexOf("application/msgpack") >= 0)) {
+    format = STATUS_MSGPACK;
+  }
+  StatusCache &cache = caches[format];
 
-    for (int reg = 0x5380; reg <= 0x538b; reg++) {
-      p += print_reg(p, s, reg, 0xFF);
-    }
+  sensor_t *s = esp_camera_sensor_get();
 
-    for (int reg = 0x5580; reg < 0x558a; reg++) {
-      p += print_reg(p, s, reg, 0xFF);
-    }
-    p += print_reg(p, s, 0x558a, 0x1FF);  //9 bit
-  } else if (s->id.PID == OV2640_PID) {
-    p += print_reg(p, s, 0xd3, 0xFF);
-    p += print_reg(p, s, 0x111, 0xFF);
-    p += print_reg(p, s, 0x132, 0xFF);
-  }
-
-  p += sprintf(p, "\"xclk\":%u,", s->xclk_freq_hz / 1000000);
-  p += sprintf(p, "\"pixformat\":%u,", s->pixformat);
-  p += sprintf(p, "\"framesize\":%u,", s->status.framesize);
-  p += sprintf(p, "\"quality\":%u,", s->status.quality);
-  p += sprintf(p, "\"brightness\":%d,", s->status.brightness);
-  p += sprintf(p, "\"contrast\":%d,", s->status.contrast);
-  p += sprintf(p, "\"saturation\":%d,", s->status.saturation);
-  p += sprintf(p, "\"sharpness\":%d,", s->status.sharpness);
-  p += sprintf(p, "\"special_effect\":%u,", s->status.special_effect);
-  p += sprintf(p, "\"wb_mode\":%u,", s->status.wb_mode);
-  p += sprintf(p, "\"awb\":%u,", s->status.awb);
-  p += sprintf(p, "\"awb_gain\":%u,", s->status.awb_gain);
-  p += sprintf(p, "\"aec\":%u,", s->status.aec);
-  p += sprintf(p, "\"aec2\":%u,", s->status.aec2);
-  p += sprintf(p, "\"ae_level\":%d,", s->status.ae_level);
-  p += sprintf(p, "\"aec_value\":%u,", s->status.aec_value);
-  p += sprintf(p, "\"agc\":%u,", s->status.agc);
-  p += sprintf(p, "\"agc_gain\":%u,", s->status.agc_gain);
-  p += sprintf(p, "\"gainceiling\":%u,", s->status.gainceiling);
-  p += sprintf(p, "\"bpc\":%u,", s->status.bpc);
-  p += sprintf(p, "\"wpc\":%u,", s->status.wpc);
-  p += sprintf(p, "\"raw_gma\":%u,", s->status.raw_gma);
-  p += sprintf(p, "\"lenc\":%u,", s->status.lenc);
-  p += sprintf(p, "\"hmirror\":%u,", s->status.hmirror);
-  p += sprintf(p, "\"vflip\":%u,", s->status.vflip);
-  p += sprintf(p, "\"dcw\":%u,", s->status.dcw);
-  p += sprintf(p, "\"colorbar\":%u", s->status.colorbar);
+  // A client that has the cached body gets a 304 without the registers
+  // being re-read, unless a write through /cam/control invalidated them.
+  // Registers drifting under AEC/AGC show up on the next plain request.
+  bool revalidate = request->hasHeader(AsyncWebHeader::Id::IfNoneMatch) && request->header(AsyncWebHeader::Id::IfNoneMatch) == cache.etag;
+  if (!revalidate || !registerShadow.valid()) {
+    registerShadow.refresh(s);
+  }
+
+  // Everything but the registers is in memory, the body is only rebuilt if
+  // one of these values or a shadowed register changed
+  uint32_t values[] = {
+    registerShadow.generation(), (uint32_t)s->xclk_freq_hz, s->pixformat, frameBroker.frameRate(), AsyncMjpegResponse::latencyTarget(), motionDetector.trigger(),
+    AsyncMjpegResponse::staticTolerance(), AsyncMjpegResponse::staticRefresh(),
 #if defined(LED_GPIO_NUM)
-  p += sprintf(p, ",\"led_intensity\":%u", led_duty);
-#else
-  p += sprintf(p, ",\"led_intensity\":%d", -1);
+    (uint32_t)led_duty,
 #endif
-  *p++ = '}';
-  *p++ = 0;
+  };
+  uint32_t hash = status_hash(2166136261, &s->status, sizeof(s->status));
+  hash = status_hash(hash, values, sizeof(values));
+
+  if (!cache.body || hash != cache.fingerprint) {
+    size_t len = camera_status_serialize(s, format, nullptr, 0);
+    uint8_t *body = (uint8_t *)malloc(len);
+    if (!body) {
+      log_e("Failed to allocate");
+      request->send(500, "text/plain", "Out of memory");
+      return;
+    }
+    camera_status_serialize(s, format, body, len);
+    cache.body = std::shared_ptr<uint8_t>(body, free);
+    cache.len = len;
+    cache.fingerprint = hash;
+    snprintf(cache.etag, sizeof(cache.etag), "\"%08x\"", status_hash(2166136261, body, len));
+  }
+
+  if (revalidate && request->header(AsyncWebHeader::Id::IfNoneMatch) == cache.etag) {
+    AsyncWebServerResponse *response = request->beginResponse(304);
+    response->addHeader("ETag", cache.etag);
+    request->send(response);
+    return;
+  }
 
-  //String result(json_response, strlen(json_response));
-  //request->send_P(200, "application/json", json_response, strlen(json_response));
-  request->send_P(200, "application/json", (const uint8_t *)json_response, strlen(json_response));
+  std::shared_ptr<uint8_t> body = cache.body;
+  size_t len = cache.len;
+  AsyncWebServerResponse *response = request->beginResponse(
+    format == STATUS_MSGPACK ? "application/msgpack" : "application/json", len,
+    [body, len](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      size_t n = len - index;
+      if (n > maxLen) n = maxLen;
+      memcpy(buffer, body.get() + index, n);
+      return n;
+    });
+  response->addHeader("ETag", cache.etag);
+  response->addHeader("Cache-Control", "no-cache");
+  response->addHeader("Vary", "Accept");
+  request->send(response);
 }
 
 void xclk_handler(AsyncWebServerRequest *request) {
-  char *buf = NULL;
   char _xclk[32];
 
   if (!request->hasParam("xclk")) {
@@ -594,6 +749,11 @@ void reg_handler(AsyncWebServerRequest *request) {
 
   sensor_t *s = esp_camera_sensor_get();
   int res = s->set_reg(s, reg, mask, val);
+  if (!res) {
+    registerShadow.written(reg, mask, val);
+  } else {
+    registerShadow.invalidate();
+  }
 
   if (res) {
     request->send(500, "text/html", "Set reg failed.");
@@ -603,7 +763,6 @@ void reg_handler(AsyncWebServerRequest *request) {
 }
 
 void greg_handler(AsyncWebServerRequest *request) {
-  char *buf = NULL;
   char _reg[32];
   char _mask[32];
 
@@ -627,7 +786,7 @@ void greg_handler(AsyncWebServerRequest *request) {
   } else {
     log_i("Get Register: reg: 0x%02x, mask: 0x%02x, value: 0x%02x", reg, mask, res);
     char buffer[20];
-    const char *val = itoa(res, buffer, 10);
+    itoa(res, buffer, 10);
     request->send(200, "text/html", (const uint8_t *)buffer, strlen(buffer));
   }
 }
@@ -669,14 +828,6 @@ static esp_err_t pll_handler(httpd_req_t *req) {
   return httpd_resp_send(req, NULL, 0);
 }
 */
-int parse_get_var(AsyncWebServerRequest *request, const char *key, int def) {
-  if (request->hasParam("val")) {
-    return (request->getParam("val")->value().toInt());
-  } else {
-    return (def);
-  }
-}
-
 void resolution_handler(AsyncWebServerRequest *request) {
 
   int startX = parse_get_var(request, "sx", 0);
@@ -698,6 +849,7 @@ void resolution_handler(AsyncWebServerRequest *request) {
   );
   sensor_t *s = esp_camera_sensor_get();
   int res = s->set_res_raw(s, startX, startY, endX, endY, offsetX, offsetY, totalX, totalY, outputX, outputY, scale, binning);  // codespell:ignore totaly
+  registerShadow.invalidate();
   if (res) {
     request->send(500, "text/html", "Set resolution failed.");
   } else {
@@ -719,118 +871,66 @@ void index_handler(AsyncWebServerRequest *request) {
     }
   } else {
     log_e("Camera sensor not found");
-    request->send_P(200, "text/html", "<html><body>Camera sensor not found!</body></html>");
+    request->send(200, "text/html", "<html><body>Camera sensor not found!</body></html>");
   }
 }
 
 
-#define PART_BOUNDARY "123456789000000000000987654321"
-static const char *_STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
-static const char *_STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
-static const char *_STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %d.%06d\r\n\r\n";
-
+#if defined(LED_GPIO_NUM)
+static size_t streamClients = 0;  // the LED stays on while at least one stream is open
+#endif
 
 void stream_handler(AsyncWebServerRequest *request) {
   Serial.println("[stream_handler] MJPEG-Stream wird gestartet...");
 
-  static camera_fb_t *fb = NULL;
-  static size_t bytes_sent = 0;
-  static size_t state = 0;
-  static char header_buf[128];
-  static size_t header_len = 0;
-  static bool frame_ready = false;
-
-  #if defined(LED_GPIO_NUM)
+#if defined(LED_GPIO_NUM)
+  if (!streamClients++) {
     isStreaming = true;
     enable_led(true);
-  #endif
-
-  AsyncWebServerResponse *response = request->beginChunkedResponse(_STREAM_CONTENT_TYPE,
-    [](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
-      if (!frame_ready) {
-        if (fb) {
-          esp_camera_fb_return(fb);
-        }
-
-
-        fb = esp_camera_fb_get();
-        if (!fb || fb->format != PIXFORMAT_JPEG) {
-          Serial.println("[stream_handler] ❌ Kein JPEG-Frame verfügbar.");
-          #if defined(LED_GPIO_NUM)
-            isStreaming = false;
-            enable_led(false);
-          #endif
-          return 0;
-        }
-
-        size_t blen = strlen(_STREAM_BOUNDARY);
-        memcpy(buffer, _STREAM_BOUNDARY, blen);
-        bytes_sent = 0;
-
-        // Header vorbereiten
-        header_len = snprintf(header_buf, sizeof(header_buf), _STREAM_PART,
-                              fb->len, fb->timestamp.tv_sec, fb->timestamp.tv_usec);
-
-        state = 0;
-        frame_ready = true;
-
-       // Serial.printf("[stream_handler] 📸 Frame vorbereitet: %u Bytes JPEG\n", fb->len);
-        return blen;  // Erst nur Boundary senden
-      }
-
-      size_t bytes_left = 0;
-
-      if (state == 0) {  // Header senden
-        bytes_left = header_len - bytes_sent;
-        if (bytes_left > maxLen) bytes_left = maxLen;
-        memcpy(buffer, header_buf + bytes_sent, bytes_left);
-        bytes_sent += bytes_left;
-        if (bytes_sent == header_len) {
-          state = 1;
-          bytes_sent = 0;
-        }
-        return bytes_left;
-      }
-
-      if (state == 1) {  // JPEG-Daten senden
-        bytes_left = fb->len - bytes_sent;
-        if (bytes_left > maxLen) bytes_left = maxLen;
-        memcpy(buffer, fb->buf + bytes_sent, bytes_left);
-        bytes_sent += bytes_left;
-
-        if (bytes_sent == fb->len) {
-          state = 2;
-          frame_ready = false;
-        }
-        return bytes_left;
-      }
-
-
-      #if defined(LED_GPIO_NUM)
-        isStreaming = false;
-        enable_led(false);
-      #endif
-
-      return 0;
-    });
+  }
+  request->onDisconnect([]() {
+    if (!--streamClients) {
+      isStreaming = false;
+      enable_led(false);
+    }
+  });
+#endif
 
+  AsyncWebServerResponse *response = new AsyncMjpegResponse();
   response->addHeader("Access-Control-Allow-Origin", "*");
   request->send(response);
- // Serial.println("[stream_handler] Antwort wurde gesendet.");
 }
 
 void startCameraServer(AsyncWebServer *server) {
 
-  ra_filter_init(&ra_filter, 20);
+  metrics_init();
 
   server->on("/cam/", HTTP_GET, index_handler);
+#if defined(LED_GPIO_NUM)
+  flashCapture.begin(capture_led);
+#endif
   server->on("/cam/capture", HTTP_GET, capture_handler);
+  server->on("/cam/capture.bmp", HTTP_GET, bmp_handler);
+  server->on("/cam/capture.raw", HTTP_GET, raw_handler);
+  server->on("/cam/burst", HTTP_GET, burst_handler);
+  thumb_begin();
+  server->on("/cam/thumb", HTTP_GET, thumb_handler);
   server->on("/cam/status", HTTP_GET, status_handler);
   server->on("/cam/control", HTTP_GET, control_handler);
+#if ASYNC_JSON_SUPPORT == 1
+  AsyncCallbackJsonWebHandler *controlBatch = new AsyncCallbackJsonWebHandler("/cam/control", control_batch_handler);
+  controlBatch->setMethod(HTTP_POST);
+  server->addHandler(controlBatch);
+#endif
   server->on("/cam/reg", HTTP_GET, reg_handler);
   server->on("/cam/greg", HTTP_GET, greg_handler);
   server->on("/cam/resolution", HTTP_GET, resolution_handler);
   server->on("/cam/stream", HTTP_GET, stream_handler);
+  server->on("/cam/metrics", HTTP_GET, metrics_handler);
+  server->on("/cam/event", HTTP_GET, event_handler);
+  server->on("/cam/record", HTTP_GET, record_handler);
+  server->addHandler(&motionEvents);
+  wsStream.begin(server);
 }
 
 void setupLedFlash() {
@@ -73,6 +73,9 @@ static constexpr const char *T_retry_after = "retry-after";
 static constexpr const char *T_nn = "\n\n";
 static constexpr const char *T_rn = "\r\n";
 static constexpr const char *T_rnrn = "\r\n\r\n";
+static constexpr const char *T_Sec_WS_Key = "sec-websocket-key";
+static constexpr const char *T_Sec_WS_Protocol = "sec-websocket-protocol";
+static constexpr const char *T_Sec_WS_Version = "sec-websocket-version";
 static constexpr const char *T_Server = "server";
 static constexpr const char *T_Transfer_Encoding = "transfer-encoding";
 static constexpr const char *T_TRUE = "true";
@@ -198,4 +201,10 @@ static constexpr const uint8_t T_only_once_headers_len = 11;
 static constexpr const char *T_only_once_headers[] = {T_Content_Length,    T_Content_Type,     T_Date,   T_ETag,    T_Last_Modified, T_LOCATION, T_retry_after,
                                                       T_Transfer_Encoding, T_Content_Location, T_Server, T_WWW_AUTH};
 
+// Request headers interned by AsyncWebHeader::intern(), index is the Id
+static constexpr const uint8_t T_known_headers_len = 17;
+static constexpr const char *T_known_headers[] = {empty,        T_Host,    T_Content_Type, T_Content_Length, T_EXPECT, T_AUTH,
+                                                  T_Connection, T_UPGRADE, T_ACCEPT,       T_Cookie,         T_CORS_O, T_IMS,
+                                                  T_INM,        T_Last_Event_ID, T_Sec_WS_Key, T_Sec_WS_Version, T_Sec_WS_Protocol};
+
 }  // namespace asyncsrv
@@ -23,6 +23,8 @@ SemaphoreHandle_t servoMutex = xSemaphoreCreateMutex();
 // Servo array
 Servo* servos[6] = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
 
+static scpi_trigger_handler_t triggerHandler = nullptr;
+
 static String scpi_handleCommand2(char* cmdLine);
 static String handleCommand_I2C(const char* subcmd);
 static String handleCommand_SPI(const char* subcmd);
@@ -40,9 +42,20 @@ String getHelp() {
   result += "I2C:SCAN?                  - I2C-Bus nach Geräten durchsuchen\r\n";
   result += "SPI:WRITE <bytes>          - SPI-Daten schreiben/lesen (hex)\r\n";
   result += "SPI:READ? <count>          - SPI-Daten lesen\r\n";
+  result += "GPIO:TRIGGER <pin> <RISING|FALLING|CHANGE|OFF> - Flanke löst ein Kamera-Event aus\r\n";
   return result;
 }
 
+void scpi_setTriggerHandler(scpi_trigger_handler_t handler) {
+  triggerHandler = handler;
+}
+
+static void IRAM_ATTR scpi_triggerISR(void* arg) {
+  if (triggerHandler) {
+    triggerHandler((int)(intptr_t)arg);
+  }
+}
+
 String scpi_handleCommand(String cmdLine) {
   return (scpi_handleCommand2((char*)cmdLine.c_str()));
 }
@@ -206,6 +219,37 @@ static String handleCommand_GPIO(const char* subcmd) {
       result += "Fehler: ANALOG:READ? <pin>";
     }
   }
+  // TRIGGER
+  else if (strncasecmp(subcmd, "TRIGGER", 7) == 0) {
+    const char* params = subcmd + 7;
+    while (*params == ' ') params++;
+
+    int pin = atoi(params);
+    while (*params && *params != ' ') params++;
+    while (*params == ' ') params++;
+
+    int mode = -1;
+    if (strncasecmp(params, "RISING", 6) == 0) {
+      mode = RISING;
+    } else if (strncasecmp(params, "FALLING", 7) == 0) {
+      mode = FALLING;
+    } else if (strncasecmp(params, "CHANGE", 6) == 0) {
+      mode = CHANGE;
+    } else if (strncasecmp(params, "OFF", 3) == 0) {
+      mode = 0;
+    }
+
+    if (mode < 0) {
+      result += "Fehler: GPIO:TRIGGER <pin> <RISING|FALLING|CHANGE|OFF>\r\n";
+    } else if (mode == 0) {
+      detachInterrupt(pin);
+      result += "GPIO " + String(pin) + " trigger off\r\n";
+    } else {
+      pinMode(pin, INPUT_PULLUP);
+      attachInterruptArg(pin, scpi_triggerISR, (void*)(intptr_t)pin, mode);
+      result += "GPIO " + String(pin) + " trigger armed\r\n";
+    }
+  }
   // Unbekannter Befehl
   else {
     result += "Unbekannter GPIO-Befehl: " + String(subcmd);
@@ -11,4 +11,8 @@
 
 String scpi_handleCommand(String cmdLine);
 
+// Called from the GPIO interrupt armed with GPIO:TRIGGER, must be IRAM safe.
+typedef void (*scpi_trigger_handler_t)(int pin);
+void scpi_setTriggerHandler(scpi_trigger_handler_t handler);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef HOST_BENCH_H
+#define HOST_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+// Runs fn `iterations` times and returns the mean time per run in
+// microseconds. Benchmarks take the iteration count as their first
+// argument, ctest runs them with a small one as a smoke test.
+template <typename Fn> double bench_us(int iterations, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    fn();
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (iterations ? iterations : 1);
+}
+
+inline int bench_iterations(int argc, char **argv, int def) {
+  return argc > 1 ? atoi(argv[1]) : def;
+}
+
+#endif
@@ -0,0 +1,119 @@
+// FrameTransform read out in TCP sized pieces against the straightforward
+// way: rotate the crop into a frame sized buffer, then scale that into the
+// output buffer and send from there. Reports time per frame and peak heap.
+//
+//   frame_transform_bench [iterations]
+#include "FrameTransform.h"
+#include "bench.h"
+#include "heap_track.h"
+#include "jpeg_samples.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Rotated crop, then box filter with the box rounded like FrameTransform's
+static size_t naive_transform(const uint8_t *src, int width, int bpp, const TransformParams &p, int outWidth, int outHeight, uint8_t *&out) {
+  bool swap = p.rotation == 90 || p.rotation == 270;
+  int rw = swap ? p.cropHeight : p.cropWidth;
+  int rh = swap ? p.cropWidth : p.cropHeight;
+
+  uint8_t *rotated = (uint8_t *)malloc((size_t)rw * rh * bpp);
+  for (int y = 0; y < rh; y++) {
+    for (int x = 0; x < rw; x++) {
+      int sx, sy;
+      switch (p.rotation) {
+        case 90: sx = y; sy = p.cropHeight - 1 - x; break;
+        case 180: sx = p.cropWidth - 1 - x; sy = p.cropHeight - 1 - y; break;
+        case 270: sx = p.cropWidth - 1 - y; sy = x; break;
+        default: sx = x; sy = y; break;
+      }
+      memcpy(rotated + ((size_t)y * rw + x) * bpp, src + ((size_t)(p.cropY + sy) * width + p.cropX + sx) * bpp, bpp);
+    }
+  }
+
+  out = (uint8_t *)malloc((size_t)outWidth * outHeight * bpp);
+  int boxW = std::max(1, (rw + outWidth / 2) / outWidth);
+  int boxH = std::max(1, (rh + outHeight / 2) / outHeight);
+  for (int y = 0; y < outHeight; y++) {
+    for (int x = 0; x < outWidth; x++) {
+      int x0 = std::min(x * rw / outWidth, rw - boxW);
+      int y0 = std::min(y * rh / outHeight, rh - boxH);
+      uint32_t sum[3] = {};
+      for (int by = 0; by < boxH; by++) {
+        for (int bx = 0; bx < boxW; bx++) {
+          const uint8_t *s = rotated + ((size_t)(y0 + by) * rw + x0 + bx) * bpp;
+          if (bpp == 1) {
+            sum[0] += s[0];
+          } else {
+            uint16_t v = (s[0] << 8) | s[1];
+            sum[0] += v >> 11;
+            sum[1] += (v >> 5) & 63;
+            sum[2] += v & 31;
+          }
+        }
+      }
+      uint8_t *d = out + ((size_t)y * outWidth + x) * bpp;
+      int n = boxW * boxH;
+      if (bpp == 1) {
+        d[0] = sum[0] / n;
+      } else {
+        uint16_t v = (sum[0] / n) << 11 | (sum[1] / n) << 5 | (sum[2] / n);
+        d[0] = v >> 8;
+        d[1] = v;
+      }
+    }
+  }
+  free(rotated);
+  return (size_t)outWidth * outHeight * bpp;
+}
+
+int main(int argc, char **argv) {
+  int iterations = bench_iterations(argc, argv, 20);
+  const struct {
+    const char *name;
+    int width, height;
+    pixformat_t format;
+    TransformParams params;
+  } cases[] = {
+    {"SVGA rot90", 800, 600, PIXFORMAT_RGB565, {0, 0, 800, 600, 90, 0, 0, false}},
+    {"UXGA 1/4", 1600, 1200, PIXFORMAT_RGB565, {0, 0, 1600, 1200, 0, 400, 300, false}},
+    {"UXGA crop rot270", 1600, 1200, PIXFORMAT_RGB565, {600, 400, 640, 480, 270, 0, 0, false}},
+    {"UXGA grey 1/2", 1600, 1200, PIXFORMAT_GRAYSCALE, {0, 0, 1600, 1200, 0, 800, 600, false}},
+  };
+
+  printf("%-18s %-8s %10s %10s\n", "case", "method", "us/frame", "peak heap");
+  for (const auto &c : cases) {
+    std::vector<uint8_t> src = camera_pixels(sample_rgb(c.width, c.height), c.width, c.height, c.format);
+    int bpp = c.format == PIXFORMAT_RGB565 ? 2 : 1;
+
+    FrameTransform probe;
+    probe.begin(src.data(), c.width, c.height, c.format, c.params);
+    int outWidth = probe.width(), outHeight = probe.height();
+
+    heap_reset_peak();
+    size_t base = heap_in_use();
+    double us = bench_us(iterations, [&]() {
+      FrameTransform transform;
+      transform.begin(src.data(), c.width, c.height, c.format, c.params);
+      uint8_t buf[1460];
+      size_t index = 0, n;
+      while ((n = transform.read(buf, sizeof(buf), index)) > 0) {
+        index += n;
+      }
+    });
+    printf("%-18s %-8s %10.0f %10zu\n", c.name, "strips", us, heap_peak() - base);
+
+    heap_reset_peak();
+    base = heap_in_use();
+    us = bench_us(iterations, [&]() {
+      uint8_t *out = nullptr;
+      size_t len = naive_transform(src.data(), c.width, bpp, c.params, outWidth, outHeight, out);
+      uint8_t buf[1460];
+      for (size_t index = 0; index < len; index += sizeof(buf)) {
+        memcpy(buf, out + index, std::min(sizeof(buf), len - index));
+      }
+      free(out);
+    });
+    printf("%-18s %-8s %10.0f %10zu\n", c.name, "naive", us, heap_peak() - base);
+  }
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include "heap_track.h"
+#include <malloc.h>
+#include <atomic>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *p);
+}
+
+static std::atomic<size_t> inUse{0};
+static std::atomic<size_t> peak{0};
+static std::atomic<size_t> allocations{0};
+
+static void *counted(void *p) {
+  if (p) {
+    allocations++;
+    size_t now = inUse += malloc_usable_size(p);
+    size_t high = peak;
+    while (now > high && !peak.compare_exchange_weak(high, now)) {
+    }
+  }
+  return p;
+}
+
+static void uncount(void *p) {
+  if (p) {
+    inUse -= malloc_usable_size(p);
+  }
+}
+
+extern "C" {
+void *malloc(size_t size) {
+  return counted(__libc_malloc(size));
+}
+
+void *calloc(size_t n, size_t size) {
+  return counted(__libc_calloc(n, size));
+}
+
+void *realloc(void *p, size_t size) {
+  uncount(p);
+  void *q = __libc_realloc(p, size);
+  if (!q && size) {
+    // p is still valid
+    return counted(p);
+  }
+  return counted(q);
+}
+
+void *memalign(size_t alignment, size_t size) {
+  return counted(__libc_memalign(alignment, size));
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  return counted(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size) {
+  void *p = counted(__libc_memalign(alignment, size));
+  if (!p) {
+    return 12;  // ENOMEM
+  }
+  *out = p;
+  return 0;
+}
+
+void free(void *p) {
+  uncount(p);
+  __libc_free(p);
+}
+}
+
+size_t heap_in_use() {
+  return inUse;
+}
+
+size_t heap_peak() {
+  return peak;
+}
+
+size_t heap_allocations() {
+  return allocations;
+}
+
+void heap_reset_peak() {
+  peak = inUse.load();
+}
@@ -0,0 +1,21 @@
+#ifndef HOST_HEAP_TRACK_H
+#define HOST_HEAP_TRACK_H
+
+#include <stddef.h>
+
+// Linking heap_track.cpp replaces malloc and friends (and with them operator
+// new and libjpeg's allocations) by counting wrappers around glibc's.
+
+// Bytes currently allocated.
+size_t heap_in_use();
+
+// Highest heap_in_use() since the last heap_reset_peak().
+size_t heap_peak();
+
+// Allocations (malloc, realloc, operator new, ...) made so far.
+size_t heap_allocations();
+
+// Starts a new measurement at the current use.
+void heap_reset_peak();
+
+#endif
@@ -0,0 +1,188 @@
+// Request parsing in the sketch's ESPAsyncWebServer on the Linux platform.
+// A browser-like request (query parameters, a dozen headers of which the
+// server keeps a few) goes to it over one persistent loopback connection:
+// reports requests per second and heap allocations per request, for a
+// handler that only answers and for one that reads a parameter and a header.
+// Then connections are parked in streams that wait for a frame, like
+// /cam/stream holds them, and the heap each of them keeps is reported.
+//
+//   http_parser_bench [requests]
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "bench.h"
+#include "heap_track.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+static const char headers[] =
+  " HTTP/1.1\r\n"
+  "Host: 192.168.4.1\r\n"
+  "Connection: keep-alive\r\n"
+  "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/126.0.0.0 Safari/537.36\r\n"
+  "Accept: image/avif,image/webp,image/apng,image/svg+xml,image/*,*/*;q=0.8\r\n"
+  "Referer: http://192.168.4.1/\r\n"
+  "Accept-Encoding: gzip, deflate\r\n"
+  "Accept-Language: en-US,en;q=0.9,de;q=0.8\r\n"
+  "Cookie: session=4f2a9c1e77d04b1b9a3e; theme=dark\r\n"
+  "If-None-Match: \"5f3e-1a2b3c\"\r\n"
+  "Sec-Fetch-Dest: image\r\n"
+  "Sec-Fetch-Mode: no-cors\r\n"
+  "Sec-Fetch-Site: same-origin\r\n"
+  "\r\n";
+
+static std::atomic<int> parked{0};
+
+static uint16_t free_port() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  socklen_t len = sizeof(addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, (sockaddr *)&addr, sizeof(addr));
+  getsockname(fd, (sockaddr *)&addr, &len);
+  close(fd);
+  return ntohs(addr.sin_port);
+}
+
+static int connect_to(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  timeval timeout = {2, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  int on = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Reads one response with a Content-Length into buf, no allocation. close
+// is set when the server ends the connection after it.
+static bool read_response(int fd, std::vector<char> &buf, bool &close) {
+  size_t have = 0;
+  for (;;) {
+    ssize_t n = recv(fd, buf.data() + have, buf.size() - have, 0);
+    if (n <= 0) {
+      return false;
+    }
+    have += n;
+    const char *end = (const char *)memmem(buf.data(), have, "\r\n\r\n", 4);
+    if (!end) {
+      continue;
+    }
+    const char *length = (const char *)memmem(buf.data(), end - buf.data(), "content-length: ", 16);
+    if (!length) {
+      return false;
+    }
+    if (have >= (size_t)(end + 4 - buf.data()) + strtoul(length + 16, nullptr, 10)) {
+      close = memmem(buf.data(), end - buf.data(), "connection: close", 17) != nullptr;
+      return true;
+    }
+  }
+}
+
+// Requests one after the other on a persistent connection, a new one when
+// the server closes it after ASYNCWEBSERVER_KEEPALIVE_MAX requests
+static bool run(uint16_t port, const std::string &request, int requests, double &us, double &allocations) {
+  int fd = connect_to(port);
+  std::vector<char> buf(4096);
+  bool ok = fd >= 0;
+  size_t before = heap_allocations();
+  us = bench_us(requests, [&]() {
+    bool closed = false;
+    ok = ok && send(fd, request.data(), request.size(), MSG_NOSIGNAL) == (ssize_t)request.size() && read_response(fd, buf, closed);
+    if (ok && closed) {
+      close(fd);
+      fd = connect_to(port);
+      ok = fd >= 0;
+    }
+  });
+  allocations = (double)(heap_allocations() - before) / (requests ? requests : 1);
+  close(fd);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  int requests = bench_iterations(argc, argv, 20000);
+  uint16_t port = free_port();
+  AsyncWebServer &server = *new AsyncWebServer(port);
+  server.on("/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", "ok");
+  });
+  server.on("/cam/capture", HTTP_GET, [](AsyncWebServerRequest *request) {
+    int quality = request->hasParam("quality") ? request->getParam("quality")->value().toInt() : 10;
+    bool cached = request->hasHeader("If-None-Match");
+    request->send(quality > 0 && !cached ? 500 : 200, "text/plain", "ok");
+  });
+  server.on("/cam/stream", HTTP_GET, [](AsyncWebServerRequest *request) {
+    // held like a stream waiting for its first frame, until the client goes
+    AsyncWebServerResponse *response = request->beginChunkedResponse("multipart/x-mixed-replace", [](uint8_t *, size_t, size_t) -> size_t {
+      return RESPONSE_TRY_AGAIN;
+    });
+    response->addHeader("Connection", "close");
+    request->send(response);
+    parked++;
+  });
+  server.begin();
+
+  printf("%zu byte request head, %d requests per run\n", sizeof(headers) - 1 + strlen("GET /cam/capture?framesize=10&quality=12"), requests);
+  printf("handler                 us/request  requests/s  allocations/request\n");
+  bool ok = true;
+  static const struct {
+    const char *name;
+    const char *url;
+  } runs[] = {
+    {"answer only", "/status?framesize=10&quality=12"},
+    {"read param and header", "/cam/capture?framesize=10&quality=12"},
+  };
+  for (const auto &r : runs) {
+    std::string request = std::string("GET ") + r.url + headers;
+    double us, allocations;
+    run(port, request, requests / 10 + 1, us, allocations);  // warm up
+    bool done = run(port, request, requests, us, allocations);
+    printf("%-22s  %10.1f  %10.0f  %19.1f%s\n", r.name, us, 1e6 / us, allocations, done ? "" : "  FAILED");
+    ok = ok && done;
+  }
+
+  // The heap a parked connection holds, client and request included
+  const int connections = 32;
+  std::string request = std::string("GET /cam/stream?framesize=10&quality=12") + headers;
+  std::vector<int> fds;
+  delay(100);  // the runs' connections are gone
+  size_t base = heap_in_use();
+  for (int i = 0; i < connections; i++) {
+    int fd = connect_to(port);
+    if (fd < 0 || send(fd, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size()) {
+      ok = false;
+      break;
+    }
+    fds.push_back(fd);
+  }
+  for (int wait = 0; parked < (int)fds.size() && wait < 200; wait++) {
+    delay(10);
+  }
+  size_t held = heap_in_use() - base;
+  printf("parked connection       %zu bytes each (%d connections)%s\n", held / connections, connections, parked == connections ? "" : "  FAILED");
+  ok = ok && parked == connections;
+  for (int fd : fds) {
+    close(fd);
+  }
+
+  // The sketch's tasks still run, skip the static destructors under them
+  fflush(stdout);
+  _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,36 @@
+// Time to get the 1/8 scale luma map of a camera sized JPEG: JpegDcDecoder
+// against libjpeg decoding at 1/8 scale (DC only) and at full size.
+//
+//   jpeg_dc_bench [iterations]
+#include "JpegDcDecoder.h"
+#include "bench.h"
+#include "jpeg_samples.h"
+
+int main(int argc, char **argv) {
+  int iterations = bench_iterations(argc, argv, 50);
+  const struct {
+    const char *name;
+    int width, height;
+  } sizes[] = {{"VGA", 640, 480}, {"SVGA", 800, 600}, {"UXGA", 1600, 1200}};
+
+  printf("%-5s %8s %12s %12s %12s\n", "size", "jpeg", "dc us", "libjpeg/8 us", "libjpeg us");
+  for (const auto &size : sizes) {
+    std::vector<uint8_t> rgb = sample_rgb(size.width, size.height);
+    std::vector<uint8_t> jpeg = encode_jpeg(rgb.data(), size.width, size.height, 80, Subsampling::S422);
+
+    JpegDcDecoder dc;
+    double dcUs = bench_us(iterations, [&]() {
+      dc.decode(jpeg.data(), jpeg.size());
+    });
+    std::vector<uint8_t> out;
+    int w, h;
+    double scaledUs = bench_us(iterations, [&]() {
+      decode_jpeg(jpeg, out, w, h, true, 8);
+    });
+    double fullUs = bench_us(iterations, [&]() {
+      decode_jpeg(jpeg, out, w, h, true, 1);
+    });
+    printf("%-5s %8zu %12.0f %12.0f %12.0f\n", size.name, jpeg.size(), dcUs, scaledUs, fullUs);
+  }
+  return 0;
+}
@@ -0,0 +1,85 @@
+// Encoding an RGB565 camera frame at quality 80, 4:2:0: JpegStreamEncoder
+// against libjpeg and, if the build was pointed at esp32-camera with
+// -DESP32_CAMERA_DIR, against its frame2jpg(). Reports time per frame,
+// output size and peak heap during the encode.
+//
+//   jpeg_encoder_bench [iterations]
+#include "JpegStreamEncoder.h"
+#include "bench.h"
+#include "heap_track.h"
+#include "jpeg_samples.h"
+#if defined(BENCH_FRAME2JPG)
+#include "img_converters.h"
+#endif
+
+#define QUALITY 80
+
+struct Result {
+  double us;
+  size_t len;
+  size_t heap;
+};
+
+template <typename Fn> static Result measure(int iterations, Fn encode) {
+  Result r;
+  heap_reset_peak();
+  size_t base = heap_in_use();
+  r.us = bench_us(iterations, [&]() {
+    r.len = encode();
+  });
+  r.heap = heap_peak() - base;
+  return r;
+}
+
+static void print(const char *size, const char *encoder, const Result &r) {
+  printf("%-5s %-12s %10.0f %9zu %10zu\n", size, encoder, r.us, r.len, r.heap);
+}
+
+int main(int argc, char **argv) {
+  int iterations = bench_iterations(argc, argv, 20);
+  const struct {
+    const char *name;
+    int width, height;
+  } sizes[] = {{"VGA", 640, 480}, {"SVGA", 800, 600}, {"UXGA", 1600, 1200}};
+
+  printf("%-5s %-12s %10s %9s %10s\n", "size", "encoder", "us/frame", "bytes", "peak heap");
+  for (const auto &size : sizes) {
+    std::vector<uint8_t> rgb = sample_rgb(size.width, size.height);
+    std::vector<uint8_t> rgb565 = camera_pixels(rgb, size.width, size.height, PIXFORMAT_RGB565);
+
+    print(size.name, "stream", measure(iterations, [&]() {
+      // On the stack as in a response filler, the TCP window as buffer
+      JpegStreamEncoder encoder;
+      uint8_t buf[1460];
+      size_t len = 0, n;
+      encoder.begin(rgb565.data(), size.width, size.height, PIXFORMAT_RGB565, QUALITY);
+      while ((n = encoder.read(buf, sizeof(buf))) > 0) {
+        len += n;
+      }
+      return len;
+    }));
+
+    // libjpeg gets RGB888 rows, it has no RGB565 input
+    print(size.name, "libjpeg", measure(iterations, [&]() {
+      return encode_jpeg(rgb.data(), size.width, size.height, QUALITY, Subsampling::S420).size();
+    }));
+
+#if defined(BENCH_FRAME2JPG)
+    print(size.name, "frame2jpg", measure(iterations, [&]() {
+      camera_fb_t fb = {};
+      fb.buf = rgb565.data();
+      fb.len = rgb565.size();
+      fb.width = size.width;
+      fb.height = size.height;
+      fb.format = PIXFORMAT_RGB565;
+      uint8_t *out = nullptr;
+      size_t len = 0;
+      if (frame2jpg(&fb, QUALITY, &out, &len)) {
+        free(out);
+      }
+      return len;
+    }));
+#endif
+  }
+  return 0;
+}
@@ -0,0 +1,248 @@
+// /cam/stream on the Linux platform: the CameraSimulator replays JPEG files,
+// the sketch's web server runs on the POSIX socket AsyncTCP and 1 to 16
+// clients read the stream over loopback. Reports frames per second per
+// client, bytes per second over all clients, the latency from capture
+// (X-Timestamp) to the last byte of the frame and the peak heap.
+//
+//   stream_bench [seconds per run] [--fps N] [--size WxH] [--dir DIR]
+//
+// Without --dir the frames are generated at --size (default 640x480).
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <SD_MMC.h>
+#include "esp_timer.h"
+#include "CameraSimulator.h"
+#include "cameraServer.h"
+#include "heap_track.h"
+#include "jpeg_samples.h"
+#include "scpi.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+// cameraServer.cpp arms the GPIO trigger through the SCPI module, which
+// needs the servo library
+void scpi_setTriggerHandler(scpi_trigger_handler_t handler) {
+  (void)handler;
+}
+
+struct ClientStats {
+  size_t frames = 0;
+  size_t bytes = 0;
+  int64_t latencySum = 0;  // us
+  int64_t latencyMax = 0;
+  bool ok = false;
+};
+
+static uint16_t free_port() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  socklen_t len = sizeof(addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, (sockaddr *)&addr, sizeof(addr));
+  getsockname(fd, (sockaddr *)&addr, &len);
+  close(fd);
+  return ntohs(addr.sin_port);
+}
+
+// Reads the multipart stream until the deadline. The buffer is allocated
+// before the heap measurement starts, parsing does not allocate.
+static void stream_client(uint16_t port, int64_t deadline, std::vector<char> &buf, ClientStats &stats) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  timeval timeout = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return;
+  }
+  static const char request[] = "GET /cam/stream HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  if (send(fd, request, sizeof(request) - 1, 0) < 0) {
+    close(fd);
+    return;
+  }
+
+  size_t have = 0;
+  size_t skip = 0;  // JPEG bytes still to come
+  int64_t timestamp = 0;
+  bool head = true;
+  while (esp_timer_get_time() < deadline) {
+    ssize_t n = recv(fd, buf.data() + have, buf.size() - have, 0);
+    if (n <= 0) {
+      break;
+    }
+    stats.bytes += n;
+    have += n;
+
+    size_t pos = 0;
+    for (;;) {
+      if (skip) {
+        size_t take = std::min(skip, have - pos);
+        pos += take;
+        skip -= take;
+        if (skip) {
+          break;
+        }
+        int64_t latency = esp_timer_get_time() - timestamp;
+        stats.frames++;
+        stats.latencySum += latency;
+        stats.latencyMax = std::max(stats.latencyMax, latency);
+      }
+      // The response head, then a part head per frame
+      const char *start = buf.data() + pos;
+      const char *end = (const char *)memmem(start, have - pos, "\r\n\r\n", 4);
+      if (!end) {
+        break;
+      }
+      if (head) {
+        stats.ok = !strncmp(start, "HTTP/1.1 200", 12);
+        head = false;
+      } else {
+        const char *length = (const char *)memmem(start, end - start, "Content-Length: ", 16);
+        const char *stamp = (const char *)memmem(start, end - start, "X-Timestamp: ", 13);
+        if (!length || !stamp) {
+          stats.ok = false;
+          break;
+        }
+        char *dot;
+        timestamp = strtoll(stamp + 13, &dot, 10) * 1000000 + strtol(dot + 1, nullptr, 10);
+        skip = strtoul(length + 16, nullptr, 10);
+      }
+      pos = end + 4 - buf.data();
+    }
+    memmove(buf.data(), buf.data() + pos, have - pos);
+    have -= pos;
+    if (have == buf.size()) {
+      stats.ok = false;  // a part head longer than the buffer
+      break;
+    }
+  }
+  close(fd);
+}
+
+static bool write_frames(const std::string &dir, int width, int height, int count) {
+  for (int i = 0; i < count; i++) {
+    std::vector<uint8_t> rgb = sample_rgb(width, height, i);
+    std::vector<uint8_t> jpeg = encode_jpeg(rgb.data(), width, height, 80, Subsampling::S422);
+    char name[32];
+    snprintf(name, sizeof(name), "/frame%03d.jpg", i);
+    FILE *f = fopen((dir + name).c_str(), "wb");
+    if (!f || fwrite(jpeg.data(), 1, jpeg.size(), f) != jpeg.size()) {
+      return false;
+    }
+    fclose(f);
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int seconds = 3;
+  int fps = 25;
+  int width = 640;
+  int height = 480;
+  const char *dir = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--fps") && i + 1 < argc) {
+      fps = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--size") && i + 1 < argc) {
+      sscanf(argv[++i], "%dx%d", &width, &height);
+    } else if (!strcmp(argv[i], "--dir") && i + 1 < argc) {
+      dir = argv[++i];
+    } else {
+      seconds = atoi(argv[i]);
+    }
+  }
+
+  // The card is a temporary directory, the frames are in its CAMERA_SIM_DIR
+  char root[] = "/tmp/stream_bench.XXXXXX";
+  if (!mkdtemp(root)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  std::string sim = std::string(root) + CAMERA_SIM_DIR;
+  if (dir) {
+    char *real = realpath(dir, nullptr);
+    bool linked = real && symlink(real, sim.c_str()) == 0;
+    free(real);
+    if (!linked) {
+      fprintf(stderr, "stream_bench: cannot use %s\n", dir);
+      return 1;
+    }
+  } else if (mkdir(sim.c_str(), 0755) < 0 || !write_frames(sim, width, height, 16)) {
+    fprintf(stderr, "stream_bench: cannot write frames to %s\n", sim.c_str());
+    return 1;
+  }
+  SD_MMC.begin(root);
+
+  uint16_t port = free_port();
+  // Never destroyed, like the sketch's: it would delete handlers such as
+  // motionEvents that are globals
+  AsyncWebServer &server = *new AsyncWebServer(port);
+  camera_cfg(&server);
+  if (!cameraSimulator.active()) {
+    fprintf(stderr, "stream_bench: no frames in %s\n", sim.c_str());
+    return 1;
+  }
+  cameraSimulator.setFps(fps);
+  server.begin();
+  printf("127.0.0.1:%u/cam/' to connect\n", port);  // camera_cfg() printed the start
+
+  printf("%s at %d fps, %d s per run\n", dir ? dir : (std::to_string(width) + "x" + std::to_string(height)).c_str(), fps, seconds);
+  printf("clients  fps/client  MB/s total  latency mean/max ms  peak heap KB\n");
+  bool ok = true;
+  for (int clients : {1, 2, 4, 8, 16}) {
+    std::vector<std::vector<char>> bufs(clients, std::vector<char>(64 * 1024));
+    std::vector<ClientStats> stats(clients);
+    std::vector<std::thread> threads;
+    threads.reserve(clients);
+    heap_reset_peak();
+    size_t base = heap_in_use();
+    int64_t start = esp_timer_get_time();
+    int64_t deadline = start + seconds * 1000000LL;
+    for (int i = 0; i < clients; i++) {
+      threads.emplace_back(stream_client, port, deadline, std::ref(bufs[i]), std::ref(stats[i]));
+    }
+    for (std::thread &t : threads) {
+      t.join();
+    }
+    double elapsed = (esp_timer_get_time() - start) / 1e6;
+    size_t peak = heap_peak() - base;
+
+    ClientStats total;
+    total.ok = true;
+    for (const ClientStats &s : stats) {
+      total.frames += s.frames;
+      total.bytes += s.bytes;
+      total.latencySum += s.latencySum;
+      total.latencyMax = std::max(total.latencyMax, s.latencyMax);
+      total.ok = total.ok && s.ok && s.frames;
+    }
+    printf("%7d  %10.1f  %10.2f  %8.1f / %-8.1f  %12zu%s\n", clients, total.frames / elapsed / clients, total.bytes / elapsed / 1e6,
+           total.frames ? total.latencySum / 1000.0 / total.frames : 0.0, total.latencyMax / 1000.0, peak / 1024, total.ok ? "" : "  FAILED");
+    ok = ok && total.ok;
+    delay(300);  // the server notices the closed streams
+  }
+
+  server.end();
+  std::string cleanup = std::string("rm -rf ") + root;
+  if (system(cleanup.c_str()) != 0) {
+    fprintf(stderr, "stream_bench: could not remove %s\n", root);
+  }
+  // The sketch's tasks still run, skip the static destructors under them
+  fflush(stdout);
+  _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,129 @@
+// Matching a request against a URI with path parameters and reading them,
+// on the sketch's ESPAsyncWebServer on the Linux platform. The compiled
+// template ("/cam/{id}/capture") against the regex URI it replaces
+// ("^\/cam\/([^\/]+)\/capture$"): as regex URIs were matched before
+// templates, with the std::regex built for every request, and with it
+// built once. Times are per match on the request the server parsed,
+// allocations include reading every parameter as a String.
+//
+//   uri_template_bench [iterations]
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "bench.h"
+#include "heap_track.h"
+#include "http_client.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <list>
+#include <regex>
+#include <string>
+
+struct Case {
+  const char *uri;
+  const char *regex;
+  const char *url;
+};
+
+static const Case cases[] = {
+  {"/cam/{id}/capture", "^\\/cam\\/([^\\/]+)\\/capture$", "/cam/front/capture"},
+  {"/cam/{id}/capture", "^\\/cam\\/([^\\/]+)\\/capture$", "/cam/front/stream"},
+  {"/sensor/{type}/{id}", "^\\/sensor\\/([^\\/]+)\\/([^\\/]+)$", "/sensor/temperature/17"},
+  {"/dav/*path", "^\\/dav\\/(.*)$", "/dav/sd/www/img/logo.png"},
+};
+
+static int iterations;
+static size_t sink;
+
+struct Result {
+  double us;
+  double allocations;
+};
+
+template <typename Fn> static Result measure(Fn fn) {
+  fn();  // warm up
+  size_t before = heap_allocations();
+  double us = bench_us(iterations, fn);
+  return {us, (double)(heap_allocations() - before) / (iterations ? iterations : 1)};
+}
+
+// The regex path as it was: the groups are copied into Strings the handler
+// reads with pathArg()
+static void regex_match(const std::regex &pattern, AsyncWebServerRequest *request) {
+  std::smatch matches;
+  std::string s(request->url().c_str());
+  if (std::regex_search(s, matches, pattern)) {
+    std::list<String> params;
+    for (size_t i = 1; i < matches.size(); ++i) {
+      params.emplace_back(matches[i].str().c_str());
+    }
+    for (const String &param : params) {
+      sink += param.length();
+    }
+  }
+}
+
+static void run(AsyncWebServerRequest *request) {
+  const Case *c = nullptr;
+  for (const Case &candidate : cases) {
+    if (request->url() == candidate.url) {
+      c = &candidate;
+    }
+  }
+  if (!c) {
+    request->send(404);
+    return;
+  }
+
+  AsyncCallbackWebHandler handler;
+  handler.setUri(c->uri);
+  handler.onRequest([](AsyncWebServerRequest *) {});
+  bool matched = handler.canHandle(request);
+  Result compiled = measure([&]() {
+    if (handler.canHandle(request)) {
+      for (size_t i = 0; !request->pathArg(i).isEmpty(); i++) {
+        sink += request->pathArg(i).length();
+      }
+    }
+  });
+  Result perRequest = measure([&]() {
+    std::regex pattern(c->regex);
+    regex_match(pattern, request);
+  });
+  std::regex pattern(c->regex);
+  Result prebuilt = measure([&]() {
+    regex_match(pattern, request);
+  });
+
+  char line[200];
+  snprintf(line, sizeof(line), "%-24s %-5s %10.3f %6.1f %10.3f %6.1f %10.3f %6.1f", c->url, matched ? "yes" : "no", compiled.us, compiled.allocations,
+           perRequest.us, perRequest.allocations, prebuilt.us, prebuilt.allocations);
+  request->send(200, "text/plain", line);
+}
+
+int main(int argc, char **argv) {
+  iterations = bench_iterations(argc, argv, 100000);
+  uint16_t port = http_free_port();
+  AsyncWebServer &server = *new AsyncWebServer(port);
+  server.onNotFound(run);
+  server.begin();
+
+  printf("%d matches per run, us and allocations per match\n", iterations);
+  printf("%-24s %-5s %17s %17s %17s\n", "", "", "template", "regex per request", "regex built once");
+  printf("%-24s %-5s %10s %6s %10s %6s %10s %6s\n", "url", "match", "us", "allocs", "us", "allocs", "us", "allocs");
+  bool ok = true;
+  for (const Case &c : cases) {
+    // The server measures while the request waits for its answer
+    int fd = http_connect(port, 600000);
+    HttpResponse response;
+    bool done = fd >= 0 && http_send(fd, std::string("GET ") + c.url + " HTTP/1.1\r\nHost: localhost\r\n\r\n") && http_read_response(fd, response)
+                && response.status == 200;
+    printf("%s%s\n", done ? response.body.c_str() : c.url, done ? "" : "  FAILED");
+    ok = ok && done;
+    close(fd);
+  }
+
+  // The sketch's tasks still run, skip the static destructors under them
+  fflush(stdout);
+  _exit(ok && sink ? 0 : 1);
+}
@@ -0,0 +1,170 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// The parts of the arduino-esp32 core the sketch uses, for the Linux build.
+// Time comes from the monotonic clock, GPIO and LEDC calls do nothing, the
+// heap getters report the process heap.
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/time.h>
+#include <time.h>
+#include <algorithm>
+
+#include "esp_idf_version.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp32-hal-log.h"
+#include "esp32-hal-ledc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#ifndef __unused
+#define __unused __attribute__((unused))  // newlib's sys/cdefs.h
+#endif
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper *>(p))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define snprintf_P snprintf
+#define sprintf_P sprintf
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+
+#define _min(a, b) ((a) < (b) ? (a) : (b))
+#define _max(a, b) ((a) > (b) ? (a) : (b))
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+bool psramFound();
+void *ps_malloc(size_t size);
+void *ps_calloc(size_t n, size_t size);
+void *ps_realloc(void *p, size_t size);
+
+char *itoa(int value, char *str, int base);
+char *ltoa(long value, char *str, int base);
+char *utoa(unsigned value, char *str, int base);
+char *ultoa(unsigned long value, char *str, int base);
+
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 38)
+extern "C" size_t strlcpy(char *dst, const char *src, size_t size);
+extern "C" size_t strlcat(char *dst, const char *src, size_t size);
+#endif
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char *server1, const char *server2 = nullptr, const char *server3 = nullptr);
+bool getLocalTime(struct tm *info, uint32_t ms = 5000);
+
+class IPAddress : public Printable {
+public:
+  IPAddress() : _address(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address(a | b << 8 | c << 16 | (uint32_t)d << 24) {}
+  IPAddress(uint32_t address) : _address(address) {}
+
+  bool fromString(const char *address);
+  bool fromString(const String &address) {
+    return fromString(address.c_str());
+  }
+  operator uint32_t() const {
+    return _address;
+  }
+  bool operator==(const IPAddress &addr) const {
+    return _address == addr._address;
+  }
+  bool operator!=(const IPAddress &addr) const {
+    return _address != addr._address;
+  }
+  uint8_t operator[](int index) const {
+    return _address >> (8 * index);
+  }
+  String toString() const;
+  size_t printTo(Print &p) const override;
+
+private:
+  uint32_t _address;  // network order, like lwIP
+};
+
+// Writes to stdout
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) {
+    (void)baud;
+  }
+  void setDebugOutput(bool enable) {
+    (void)enable;
+  }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  int available() override {
+    return 0;
+  }
+  int read() override {
+    return -1;
+  }
+  int peek() override {
+    return -1;
+  }
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+  void restart();
+  uint32_t getHeapSize();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getPsramSize();
+  uint32_t getFreePsram();
+  uint32_t getMinFreePsram();
+  uint32_t getMaxAllocPsram();
+};
+
+extern EspClass ESP;
+
+#endif
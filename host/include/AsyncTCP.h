@@ -0,0 +1,187 @@
+#ifndef HOST_ASYNCTCP_H
+#define HOST_ASYNCTCP_H
+
+// AsyncTCP's AsyncServer / AsyncClient on non-blocking POSIX sockets. One
+// "async_tcp" thread polls all sockets and runs the callbacks, like the
+// async_tcp task on the target. Bytes count as acknowledged once the peer
+// has acked them (the kernel's send queue shrank), and space() is limited to
+// lwIP's default send buffer, so responses see the same back pressure.
+
+#include <functional>
+#include <string>
+#include "Arduino.h"
+#include "lwip/tcpbase.h"
+
+#define ASYNC_WRITE_FLAG_COPY 0x01
+#define ASYNC_WRITE_FLAG_MORE 0x02
+
+#ifndef CONFIG_LWIP_TCP_SND_BUF_DEFAULT
+#define CONFIG_LWIP_TCP_SND_BUF_DEFAULT 5744
+#endif
+#ifndef CONFIG_LWIP_TCP_MSS
+#define CONFIG_LWIP_TCP_MSS 1436
+#endif
+#ifndef ASYNC_MAX_ACK_TIME
+#define ASYNC_MAX_ACK_TIME 5000
+#endif
+#define ASYNC_POLL_INTERVAL_MS 500  // lwIP's tcp_poll interval of 1
+
+class AsyncClient;
+
+typedef std::function<void(void *, AsyncClient *)> AcConnectHandler;
+typedef std::function<void(void *, AsyncClient *, size_t len, uint32_t time)> AcAckHandler;
+typedef std::function<void(void *, AsyncClient *, int8_t error)> AcErrorHandler;
+typedef std::function<void(void *, AsyncClient *, void *data, size_t len)> AcDataHandler;
+typedef std::function<void(void *, AsyncClient *, uint32_t time)> AcTimeoutHandler;
+
+class AsyncClient {
+public:
+  // Takes ownership of a connected socket
+  AsyncClient(int fd = -1);
+  ~AsyncClient();
+
+  bool connected() const;
+  bool disconnecting() const;
+  bool freeable() const;
+  uint8_t state() const;
+  const char *stateToString() const;
+
+  // Copies up to space() bytes into the send buffer, send() pushes them out
+  size_t add(const char *data, size_t size, uint8_t apiflags = ASYNC_WRITE_FLAG_COPY);
+  bool send();
+  size_t write(const char *data);
+  size_t write(const char *data, size_t size, uint8_t apiflags = ASYNC_WRITE_FLAG_COPY);
+  size_t space() const;
+  bool canSend() const {
+    return space() > 0;
+  }
+
+  // Sends what was added, then closes; onDisconnect runs before this returns
+  void close(bool now = false);
+  void stop() {
+    close(false);
+  }
+  // Resets the connection; onError and onDisconnect run from the async_tcp
+  // thread afterwards
+  int8_t abort();
+
+  void setRxTimeout(uint32_t timeout) {
+    _rxTimeout = timeout;
+  }
+  uint32_t getRxTimeout() const {
+    return _rxTimeout;
+  }
+  void setAckTimeout(uint32_t timeout) {
+    _ackTimeout = timeout;
+  }
+  uint32_t getAckTimeout() const {
+    return _ackTimeout;
+  }
+  void setNoDelay(bool nodelay);
+  bool getNoDelay();
+  void setKeepAlive(uint32_t ms, uint8_t cnt) {
+    (void)ms;
+    (void)cnt;
+  }
+  uint16_t getMss() const {
+    return CONFIG_LWIP_TCP_MSS;
+  }
+
+  uint32_t getRemoteAddress() const;
+  uint16_t getRemotePort() const;
+  uint32_t getLocalAddress() const;
+  uint16_t getLocalPort() const;
+  IPAddress remoteIP() const {
+    return IPAddress(getRemoteAddress());
+  }
+  uint16_t remotePort() const {
+    return getRemotePort();
+  }
+  IPAddress localIP() const {
+    return IPAddress(getLocalAddress());
+  }
+  uint16_t localPort() const {
+    return getLocalPort();
+  }
+
+  void onConnect(AcConnectHandler cb, void *arg = 0);
+  void onDisconnect(AcConnectHandler cb, void *arg = 0);
+  void onAck(AcAckHandler cb, void *arg = 0);
+  void onError(AcErrorHandler cb, void *arg = 0);
+  void onData(AcDataHandler cb, void *arg = 0);
+  void onTimeout(AcTimeoutHandler cb, void *arg = 0);
+  void onPoll(AcConnectHandler cb, void *arg = 0);
+
+  // Received data is always acked at once
+  size_t ack(size_t len) {
+    return len;
+  }
+  void ackLater() {}
+
+private:
+  friend struct AsyncTcpService;
+
+  void _flush();
+  bool _shutdown(int8_t error);
+  void _closed(int8_t error);
+  void _close(int8_t error);
+  void _recv(uint32_t now);
+  void _sent(uint32_t now);
+  void _poll(uint32_t now);
+
+  int _fd;
+  tcp_state _state;
+  bool _wake = false;
+  std::string _tx;       // added, not yet taken by the kernel
+  size_t _unacked = 0;   // taken by the kernel, not yet acked by the peer
+  uint32_t _rxTimeout = 0;  // s
+  uint32_t _ackTimeout = ASYNC_MAX_ACK_TIME;
+  uint32_t _rxLastPacket;
+  uint32_t _txLastPacket = 0;
+  uint32_t _lastPoll;
+
+  AcConnectHandler _connectCb;
+  void *_connectCbArg = nullptr;
+  AcConnectHandler _discardCb;
+  void *_discardCbArg = nullptr;
+  AcAckHandler _sentCb;
+  void *_sentCbArg = nullptr;
+  AcErrorHandler _errorCb;
+  void *_errorCbArg = nullptr;
+  AcDataHandler _recvCb;
+  void *_recvCbArg = nullptr;
+  AcTimeoutHandler _timeoutCb;
+  void *_timeoutCbArg = nullptr;
+  AcConnectHandler _pollCb;
+  void *_pollCbArg = nullptr;
+};
+
+class AsyncServer {
+public:
+  AsyncServer(uint16_t port);
+  ~AsyncServer();
+
+  void onClient(AcConnectHandler cb, void *arg);
+  void begin();
+  void end();
+  void setNoDelay(bool nodelay) {
+    _noDelay = nodelay;
+  }
+  bool getNoDelay() {
+    return _noDelay;
+  }
+  uint8_t status() const;
+
+private:
+  friend struct AsyncTcpService;
+
+  void _accept();
+
+  int _fd = -1;
+  uint16_t _port;
+  bool _noDelay = false;
+  AcConnectHandler _connectCb;
+  void *_connectCbArg = nullptr;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef HOST_MD5BUILDER_H
+#define HOST_MD5BUILDER_H
+
+#include "Arduino.h"
+
+class MD5Builder {
+public:
+  void begin(void);
+  void add(const uint8_t *data, size_t len);
+  void add(const char *data) {
+    add((const uint8_t *)data, strlen(data));
+  }
+  void add(const String &data) {
+    add((const uint8_t *)data.c_str(), data.length());
+  }
+  void calculate(void);
+  void getBytes(uint8_t *output);
+  void getChars(char *output);
+  String toString(void);
+
+private:
+  void _transform(const uint8_t *block);
+
+  uint32_t _state[4];
+  uint64_t _count;
+  uint8_t _buffer[64];
+  uint8_t _digest[16];
+};
+
+#endif
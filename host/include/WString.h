@@ -0,0 +1,173 @@
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+// Arduino's String on top of std::string, which has a similar small string
+// buffer, so allocation counts stay comparable to the ESP32 core.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class String {
+public:
+  String(const char *cstr = "");
+  String(const char *cstr, unsigned int length);
+  String(const uint8_t *cstr, unsigned int length) : String((const char *)cstr, length) {}
+  String(const String &str) = default;
+  String(String &&rval) = default;
+  String(const __FlashStringHelper *str) : String(reinterpret_cast<const char *>(str)) {}
+  explicit String(char c);
+  explicit String(unsigned char, unsigned char base = 10);
+  explicit String(int, unsigned char base = 10);
+  explicit String(unsigned int, unsigned char base = 10);
+  explicit String(long, unsigned char base = 10);
+  explicit String(unsigned long, unsigned char base = 10);
+  explicit String(long long, unsigned char base = 10);
+  explicit String(unsigned long long, unsigned char base = 10);
+  explicit String(float, unsigned int decimalPlaces = 2);
+  explicit String(double, unsigned int decimalPlaces = 2);
+
+  bool reserve(unsigned int size);
+  unsigned int length() const {
+    return _s.size();
+  }
+  bool isEmpty() const {
+    return _s.empty();
+  }
+  void clear() {
+    _s.clear();
+  }
+
+  String &operator=(const String &rhs) = default;
+  String &operator=(String &&rval) = default;
+  String &operator=(const char *cstr);
+  String &operator=(const __FlashStringHelper *str) {
+    return *this = reinterpret_cast<const char *>(str);
+  }
+  // Numbers assign their decimal text
+  template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type> String &operator=(T n) {
+    return *this = String(n);
+  }
+
+  bool concat(const String &str);
+  bool concat(const char *cstr);
+  bool concat(const char *cstr, unsigned int length);
+  bool concat(const uint8_t *cstr, unsigned int length) {
+    return concat((const char *)cstr, length);
+  }
+  bool concat(char c);
+  bool concat(unsigned char num);
+  bool concat(int num);
+  bool concat(unsigned int num);
+  bool concat(long num);
+  bool concat(unsigned long num);
+  bool concat(long long num);
+  bool concat(unsigned long long num);
+  bool concat(float num);
+  bool concat(double num);
+  bool concat(const __FlashStringHelper *str) {
+    return concat(reinterpret_cast<const char *>(str));
+  }
+
+  template<typename T> String &operator+=(const T &rhs) {
+    concat(rhs);
+    return *this;
+  }
+
+  explicit operator bool() const {
+    return true;
+  }
+
+  int compareTo(const String &s) const;
+  bool equals(const String &s) const {
+    return _s == s._s;
+  }
+  bool equals(const char *cstr) const;
+  bool operator==(const String &rhs) const {
+    return equals(rhs);
+  }
+  bool operator==(const char *cstr) const {
+    return equals(cstr);
+  }
+  bool operator!=(const String &rhs) const {
+    return !equals(rhs);
+  }
+  bool operator!=(const char *cstr) const {
+    return !equals(cstr);
+  }
+  bool operator<(const String &rhs) const {
+    return compareTo(rhs) < 0;
+  }
+  bool operator>(const String &rhs) const {
+    return compareTo(rhs) > 0;
+  }
+  bool equalsIgnoreCase(const String &s) const;
+  bool equalsConstantTime(const String &s) const;
+  bool startsWith(const String &prefix) const;
+  bool startsWith(const String &prefix, unsigned int offset) const;
+  bool endsWith(const String &suffix) const;
+
+  char charAt(unsigned int index) const;
+  void setCharAt(unsigned int index, char c);
+  char operator[](unsigned int index) const;
+  char &operator[](unsigned int index);
+  void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+  void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const {
+    getBytes((unsigned char *)buf, bufsize, index);
+  }
+  const char *c_str() const {
+    return _s.c_str();
+  }
+  char *begin() {
+    return &_s[0];
+  }
+  char *end() {
+    return begin() + _s.size();
+  }
+  const char *begin() const {
+    return c_str();
+  }
+  const char *end() const {
+    return c_str() + _s.size();
+  }
+
+  int indexOf(char ch) const;
+  int indexOf(char ch, unsigned int fromIndex) const;
+  int indexOf(const String &str) const;
+  int indexOf(const String &str, unsigned int fromIndex) const;
+  int lastIndexOf(char ch) const;
+  int lastIndexOf(char ch, unsigned int fromIndex) const;
+  int lastIndexOf(const String &str) const;
+  int lastIndexOf(const String &str, unsigned int fromIndex) const;
+  String substring(unsigned int beginIndex) const;
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(char find, char replace);
+  void replace(const String &find, const String &replace);
+  void remove(unsigned int index);
+  void remove(unsigned int index, unsigned int count);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+
+private:
+  std::string _s;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
+String operator+(const String &lhs, const __FlashStringHelper *rhs);
+
+extern const String emptyString;
+
+#endif
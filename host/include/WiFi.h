@@ -0,0 +1,24 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include "Arduino.h"
+
+#define WL_CONNECTED 3
+
+// The host is always connected, on the loopback interface
+class WiFiClass {
+public:
+  IPAddress localIP() {
+    return IPAddress(127, 0, 0, 1);
+  }
+  int status() {
+    return WL_CONNECTED;
+  }
+  int8_t RSSI() {
+    return 0;
+  }
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+// No I2C bus on the host, only what scpi.h needs to be declared
+
+class TwoWire {};
+
+#endif
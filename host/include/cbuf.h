@@ -0,0 +1,44 @@
+#ifndef HOST_CBUF_H
+#define HOST_CBUF_H
+
+#include <stddef.h>
+
+// arduino-esp32's ring buffer, one byte of the allocation stays unused
+class cbuf {
+public:
+  cbuf(size_t size);
+  ~cbuf();
+
+  size_t resizeAdd(size_t addSize);
+  size_t resize(size_t newSize);
+  size_t available() const;
+  size_t size();
+  size_t room() const;
+  bool empty() const {
+    return _begin == _end;
+  }
+  bool full() const {
+    return room() == 0;
+  }
+  int peek();
+  size_t peek(char *dst, size_t size);
+  int read();
+  size_t read(char *dst, size_t size);
+  size_t write(char c);
+  size_t write(const char *src, size_t size);
+  void flush();
+  size_t remove(size_t size);
+
+private:
+  char *wrap_if_bufend(char *ptr) const {
+    return (ptr == _bufend) ? _buf : ptr;
+  }
+
+  size_t _size;
+  char *_buf;
+  const char *_bufend;
+  char *_begin;
+  char *_end;
+};
+
+#endif
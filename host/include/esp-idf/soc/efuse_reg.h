@@ -0,0 +1 @@
+// Included by esp32-camera, nothing of it is used on the host.
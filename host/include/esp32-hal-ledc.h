@@ -0,0 +1,9 @@
+#ifndef HOST_ESP32_HAL_LEDC_H
+#define HOST_ESP32_HAL_LEDC_H
+
+#include <stdint.h>
+
+bool ledcAttach(uint8_t pin, uint32_t freq, uint8_t resolution);
+bool ledcWrite(uint8_t pin, uint32_t duty);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HOST_ESP32_HAL_LOG_H
+#define HOST_ESP32_HAL_LOG_H
+
+#include <stdio.h>
+
+#define ARDUHAL_LOG_LEVEL_NONE 0
+#define ARDUHAL_LOG_LEVEL_ERROR 1
+#define ARDUHAL_LOG_LEVEL_WARN 2
+#define ARDUHAL_LOG_LEVEL_INFO 3
+#define ARDUHAL_LOG_LEVEL_DEBUG 4
+#define ARDUHAL_LOG_LEVEL_VERBOSE 5
+
+#ifndef ARDUHAL_LOG_LEVEL
+#define ARDUHAL_LOG_LEVEL ARDUHAL_LOG_LEVEL_WARN
+#endif
+
+#define log_e(format, ...) ((void)(ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_ERROR && fprintf(stderr, "[E] " format "\n", ##__VA_ARGS__)))
+#define log_w(format, ...) ((void)(ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_WARN && fprintf(stderr, "[W] " format "\n", ##__VA_ARGS__)))
+#define log_i(format, ...) ((void)(ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO && fprintf(stderr, "[I] " format "\n", ##__VA_ARGS__)))
+#define log_d(format, ...) ((void)(ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_DEBUG && fprintf(stderr, "[D] " format "\n", ##__VA_ARGS__)))
+#define log_v(format, ...) ((void)(ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_VERBOSE && fprintf(stderr, "[V] " format "\n", ##__VA_ARGS__)))
+
+#endif
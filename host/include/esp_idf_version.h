@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_IDF_VERSION_H
+#define HOST_ESP_IDF_VERSION_H
+
+// arduino-esp32 2.x, ESPAsyncWebServer then brings its own SHA1Builder
+#define ESP_IDF_VERSION_MAJOR 4
+#define ESP_IDF_VERSION_MINOR 4
+#define ESP_IDF_VERSION_PATCH 7
+
+#endif
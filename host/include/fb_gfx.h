@@ -0,0 +1,4 @@
+#ifndef HOST_FB_GFX_H
+#define HOST_FB_GFX_H
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "FreeRTOS.h"
+
+// Queues are not used by the sketch's host build, only the handle type
+typedef struct QueueDefinition *QueueHandle_t;
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef HOST_ETS_SYS_H
+#define HOST_ETS_SYS_H
+
+#include <stdio.h>
+
+#define ets_printf printf
+
+#endif
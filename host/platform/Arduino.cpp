@@ -0,0 +1,385 @@
+#include "Arduino.h"
+#include "WiFi.h"
+#include "esp_timer.h"
+
+#include <malloc.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+
+int64_t esp_timer_get_time() {
+  static const auto boot = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - boot).count();
+}
+
+unsigned long millis() {
+  return esp_timer_get_time() / 1000;
+}
+
+unsigned long micros() {
+  return esp_timer_get_time();
+}
+
+void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() {
+  std::this_thread::yield();
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  (void)pin;
+  (void)val;
+}
+
+int digitalRead(uint8_t pin) {
+  (void)pin;
+  return LOW;
+}
+
+uint16_t analogRead(uint8_t pin) {
+  (void)pin;
+  return 0;
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode) {
+  (void)pin;
+  (void)handler;
+  (void)arg;
+  (void)mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  (void)pin;
+}
+
+bool ledcAttach(uint8_t pin, uint32_t freq, uint8_t resolution) {
+  (void)pin;
+  (void)freq;
+  (void)resolution;
+  return true;
+}
+
+bool ledcWrite(uint8_t pin, uint32_t duty) {
+  (void)pin;
+  (void)duty;
+  return true;
+}
+
+bool psramFound() {
+  return true;
+}
+
+void *ps_malloc(size_t size) {
+  return malloc(size);
+}
+
+void *ps_calloc(size_t n, size_t size) {
+  return calloc(n, size);
+}
+
+void *ps_realloc(void *p, size_t size) {
+  return realloc(p, size);
+}
+
+static std::atomic<size_t> minimumFree{SIZE_MAX};
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+  (void)caps;
+  size_t free = mallinfo2().fordblks;
+  size_t minimum = minimumFree.load();
+  while (free < minimum && !minimumFree.compare_exchange_weak(minimum, free)) {
+  }
+  return free;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+  size_t free = heap_caps_get_free_size(caps);
+  return std::min(free, minimumFree.load());
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+  return heap_caps_get_free_size(caps);
+}
+
+static char *convert(unsigned long value, bool negative, char *str, int base) {
+  String s(value, (unsigned char)base);
+  char *p = str;
+  if (negative) {
+    *p++ = '-';
+  }
+  strcpy(p, s.c_str());
+  return str;
+}
+
+char *itoa(int value, char *str, int base) {
+  return ltoa(value, str, base);
+}
+
+char *ltoa(long value, char *str, int base) {
+  bool negative = value < 0 && base == 10;
+  return convert(negative ? -(unsigned long)value : (unsigned long)value, negative, str, base);
+}
+
+char *utoa(unsigned value, char *str, int base) {
+  return convert(value, false, str, base);
+}
+
+char *ultoa(unsigned long value, char *str, int base) {
+  return convert(value, false, str, base);
+}
+
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 38)
+extern "C" size_t strlcpy(char *dst, const char *src, size_t size) {
+  size_t len = strlen(src);
+  if (size) {
+    size_t n = std::min(len, size - 1);
+    memcpy(dst, src, n);
+    dst[n] = 0;
+  }
+  return len;
+}
+
+extern "C" size_t strlcat(char *dst, const char *src, size_t size) {
+  size_t used = strnlen(dst, size);
+  if (used == size) {
+    return size + strlen(src);
+  }
+  return used + strlcpy(dst + used, src, size - used);
+}
+#endif
+
+// The host clock is already set
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char *server1, const char *server2, const char *server3) {
+  (void)gmtOffset_sec;
+  (void)daylightOffset_sec;
+  (void)server1;
+  (void)server2;
+  (void)server3;
+}
+
+bool getLocalTime(struct tm *info, uint32_t ms) {
+  (void)ms;
+  time_t now = time(NULL);
+  localtime_r(&now, info);
+  return true;
+}
+
+bool IPAddress::fromString(const char *address) {
+  uint32_t parts[4];
+  char end;
+  if (sscanf(address, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &end) != 4) {
+    return false;
+  }
+  for (uint32_t part : parts) {
+    if (part > 255) {
+      return false;
+    }
+  }
+  *this = IPAddress(parts[0], parts[1], parts[2], parts[3]);
+  return true;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(buf);
+}
+
+size_t IPAddress::printTo(Print &p) const {
+  return p.print(toString());
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
+
+void EspClass::restart() {
+  fprintf(stderr, "ESP.restart()\n");
+  exit(1);
+}
+
+uint32_t EspClass::getHeapSize() {
+  return mallinfo2().arena;
+}
+
+uint32_t EspClass::getFreeHeap() {
+  return heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+  return heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+  return heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+}
+
+uint32_t EspClass::getPsramSize() {
+  return getHeapSize();
+}
+
+uint32_t EspClass::getFreePsram() {
+  return getFreeHeap();
+}
+
+uint32_t EspClass::getMinFreePsram() {
+  return getMinFreeHeap();
+}
+
+uint32_t EspClass::getMaxAllocPsram() {
+  return getMaxAllocHeap();
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size-- && write(*buffer++)) {
+    n++;
+  }
+  return n;
+}
+
+size_t Print::write(const char *str) {
+  return str ? write((const uint8_t *)str, strlen(str)) : 0;
+}
+
+size_t Print::printf(const char *format, ...) {
+  char small[64];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(small, sizeof(small), format, args);
+  va_end(args);
+  if (len < 0) {
+    return 0;
+  }
+  if ((size_t)len < sizeof(small)) {
+    return write((const uint8_t *)small, len);
+  }
+  std::string big(len + 1, 0);
+  va_start(args, format);
+  vsnprintf(&big[0], big.size(), format, args);
+  va_end(args);
+  return write((const uint8_t *)big.data(), len);
+}
+
+size_t Print::print(const __FlashStringHelper *s) {
+  return write(reinterpret_cast<const char *>(s));
+}
+
+size_t Print::print(const String &s) {
+  return write(s.c_str(), s.length());
+}
+
+size_t Print::print(const char str[]) {
+  return write(str);
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char n, int base) {
+  return print(String(n, (unsigned char)base));
+}
+
+size_t Print::print(int n, int base) {
+  return print(String(n, (unsigned char)base));
+}
+
+size_t Print::print(unsigned int n, int base) {
+  return print(String(n, (unsigned char)base));
+}
+
+size_t Print::print(long n, int base) {
+  return print(String(n, (unsigned char)base));
+}
+
+size_t Print::print(unsigned long n, int base) {
+  return print(String(n, (unsigned char)base));
+}
+
+size_t Print::print(long long n, int base) {
+  return print(String(n, (unsigned char)base));
+}
+
+size_t Print::print(unsigned long long n, int base) {
+  return print(String(n, (unsigned char)base));
+}
+
+size_t Print::print(double n, int digits) {
+  return print(String(n, (unsigned int)digits));
+}
+
+size_t Print::print(const Printable &x) {
+  return x.printTo(*this);
+}
+
+size_t Print::println(void) {
+  return print("\r\n");
+}
+
+#define PRINTLN(type)                       \
+  size_t Print::println(type arg) {         \
+    size_t n = print(arg);                  \
+    return n + println();                   \
+  }
+
+PRINTLN(const __FlashStringHelper *)
+PRINTLN(const String &)
+PRINTLN(const char *)
+PRINTLN(char)
+PRINTLN(const Printable &)
+
+#define PRINTLN_BASE(type)                  \
+  size_t Print::println(type arg, int base) { \
+    size_t n = print(arg, base);            \
+    return n + println();                   \
+  }
+
+PRINTLN_BASE(unsigned char)
+PRINTLN_BASE(int)
+PRINTLN_BASE(unsigned int)
+PRINTLN_BASE(long)
+PRINTLN_BASE(unsigned long)
+PRINTLN_BASE(long long)
+PRINTLN_BASE(unsigned long long)
+PRINTLN_BASE(double)
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t n = 0;
+  unsigned long start = millis();
+  while (n < length && millis() - start < _timeout) {
+    int c = read();
+    if (c < 0) {
+      yield();
+      continue;
+    }
+    buffer[n++] = c;
+  }
+  return n;
+}
+
+String Stream::readString() {
+  String s;
+  char buf[256];
+  size_t n;
+  while ((n = readBytes(buf, sizeof(buf))) > 0) {
+    s.concat(buf, n);
+  }
+  return s;
+}
@@ -0,0 +1,572 @@
+#include "AsyncTCP.h"
+#include "ClientWake.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <list>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#define ERR_ABRT -13
+#define ERR_RST -14
+
+static const char *const tcp_state_names[] = {"Closed",      "Listen",      "SYN Sent", "SYN Received", "Established", "FIN Wait 1",
+                                              "FIN Wait 2",  "Close Wait",  "Closing",  "Last ACK",     "Time Wait"};
+
+// State shared by the async_tcp thread and the tasks that write to clients.
+// The lock stands in for lwIP's core lock, no callback runs while it is held.
+struct AsyncTcpService {
+  struct Lingering {
+    int fd;
+    std::string tx;
+    uint32_t since;
+  };
+
+  static std::mutex lock;
+  static std::set<AsyncClient *> clients;  // open connections
+  static std::set<AsyncServer *> servers;  // listening
+  static std::list<Lingering> lingering;   // closed, still sending
+  static std::list<AsyncClient *> aborted; // callbacks still to run
+  static int wakeFds[2];
+
+  static void start();
+  static void wake();
+  static void wake(AsyncClient *client);
+  static void run(void *);
+  static bool alive(AsyncClient *client);
+};
+
+std::mutex AsyncTcpService::lock;
+std::set<AsyncClient *> AsyncTcpService::clients;
+std::set<AsyncServer *> AsyncTcpService::servers;
+std::list<AsyncTcpService::Lingering> AsyncTcpService::lingering;
+std::list<AsyncClient *> AsyncTcpService::aborted;
+int AsyncTcpService::wakeFds[2] = {-1, -1};
+
+void AsyncTcpService::start() {
+  static std::once_flag started;
+  std::call_once(started, []() {
+    if (pipe2(wakeFds, O_NONBLOCK | O_CLOEXEC) < 0) {
+      log_e("async_tcp: pipe failed");
+      abort();
+    }
+    xTaskCreatePinnedToCore(run, "async_tcp", 8192, NULL, 3, NULL, tskNO_AFFINITY);
+  });
+}
+
+void AsyncTcpService::wake() {
+  if (wakeFds[1] >= 0) {
+    char c = 0;
+    (void)!::write(wakeFds[1], &c, 1);
+  }
+}
+
+bool AsyncTcpService::alive(AsyncClient *client) {
+  std::lock_guard<std::mutex> guard(lock);
+  return clients.count(client);
+}
+
+void AsyncTcpService::run(void *) {
+  std::vector<pollfd> fds;
+  std::vector<AsyncServer *> listening;
+  std::vector<AsyncClient *> open;
+  for (;;) {
+    fds.clear();
+    listening.clear();
+    open.clear();
+    fds.push_back({wakeFds[0], POLLIN, 0});
+    int timeout = ASYNC_POLL_INTERVAL_MS / 10;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      for (AsyncServer *server : servers) {
+        fds.push_back({server->_fd, POLLIN, 0});
+        listening.push_back(server);
+      }
+      for (AsyncClient *client : clients) {
+        fds.push_back({client->_fd, (short)(POLLIN | (client->_tx.empty() ? 0 : POLLOUT)), 0});
+        open.push_back(client);
+        if (client->_unacked) {
+          timeout = 1;  // acks do not wake poll(), look again soon
+        }
+      }
+      if (!lingering.empty()) {
+        timeout = 1;
+      }
+      if (!aborted.empty()) {
+        timeout = 0;
+      }
+    }
+
+    if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR) {
+      log_e("async_tcp: poll failed: %d", errno);
+      abort();
+    }
+    char drain[64];
+    while (::read(wakeFds[0], drain, sizeof(drain)) > 0) {
+    }
+
+    // One at a time, a callback may delete another aborted client
+    for (;;) {
+      AsyncClient *client;
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        if (aborted.empty()) {
+          break;
+        }
+        client = aborted.front();
+        aborted.pop_front();
+      }
+      client->_closed(ERR_ABRT);  // may delete the client
+    }
+
+    uint32_t now = millis();
+    for (size_t i = 0; i < listening.size(); i++) {
+      if (fds[1 + i].revents) {
+        bool stillListening;
+        {
+          std::lock_guard<std::mutex> guard(lock);
+          stillListening = servers.count(listening[i]);
+        }
+        if (stillListening) {
+          listening[i]->_accept();
+        }
+      }
+    }
+    for (size_t i = 0; i < open.size(); i++) {
+      short revents = fds[1 + listening.size() + i].revents;
+      AsyncClient *client = open[i];
+      if (!revents || !alive(client)) {
+        continue;
+      }
+      if (revents & POLLOUT) {
+        std::lock_guard<std::mutex> guard(lock);
+        client->_flush();
+      }
+      if (revents & (POLLIN | POLLHUP | POLLERR)) {
+        // lwIP handles the ack a segment carries before its data, the next
+        // request on a persistent connection finds the response done
+        client->_sent(now);
+        if (alive(client)) {
+          client->_recv(now);  // may delete the client
+        }
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      for (auto it = lingering.begin(); it != lingering.end();) {
+        ssize_t n = ::send(it->fd, it->tx.data(), it->tx.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+          it->tx.erase(0, n);
+        }
+        if (it->tx.empty() || (n < 0 && errno != EAGAIN) || now - it->since > 10000) {
+          ::close(it->fd);
+          it = lingering.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      open.assign(clients.begin(), clients.end());  // with the ones accepted above
+    }
+    now = millis();  // not before their _rxLastPacket, now - it would wrap
+    for (AsyncClient *client : open) {
+      if (!alive(client)) {
+        continue;
+      }
+      client->_sent(now);
+      if (!alive(client)) {
+        continue;
+      }
+      if (client->_wake || now - client->_lastPoll >= ASYNC_POLL_INTERVAL_MS) {
+        client->_poll(now);
+      }
+    }
+  }
+}
+
+void AsyncTcpService::wake(AsyncClient *client) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!clients.count(client)) {
+      return;
+    }
+    client->_wake = true;
+  }
+  wake();
+}
+
+void async_client_wake(AsyncClient *client) {
+  AsyncTcpService::wake(client);
+}
+
+AsyncClient::AsyncClient(int fd) : _fd(fd), _state(fd >= 0 ? ESTABLISHED : CLOSED) {
+  _rxLastPacket = _lastPoll = millis();
+  if (fd >= 0) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    AsyncTcpService::start();
+    {
+      std::lock_guard<std::mutex> guard(AsyncTcpService::lock);
+      AsyncTcpService::clients.insert(this);
+    }
+    AsyncTcpService::wake();
+  }
+}
+
+AsyncClient::~AsyncClient() {
+  std::lock_guard<std::mutex> guard(AsyncTcpService::lock);
+  AsyncTcpService::clients.erase(this);
+  AsyncTcpService::aborted.remove(this);
+  if (_fd >= 0) {
+    ::close(_fd);
+  }
+}
+
+bool AsyncClient::connected() const {
+  return _state == ESTABLISHED;
+}
+
+bool AsyncClient::disconnecting() const {
+  return false;
+}
+
+bool AsyncClient::freeable() const {
+  return _state == CLOSED;
+}
+
+uint8_t AsyncClient::state() const {
+  return _state;
+}
+
+const char *AsyncClient::stateToString() const {
+  return tcp_state_names[_state];
+}
+
+// Called with the lock held
+void AsyncClient::_flush() {
+  while (!_tx.empty()) {
+    ssize_t n = ::send(_fd, _tx.data(), _tx.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n <= 0) {
+      break;  // full, or an error poll() reports
+    }
+    if (!_unacked) {
+      _txLastPacket = millis();
+    }
+    _tx.erase(0, n);
+    _unacked += n;
+  }
+}
+
+size_t AsyncClient::space() const {
+  std::lock_guard<std::mutex> guard(AsyncTcpService::lock);
+  if (_state != ESTABLISHED) {
+    return 0;
+  }
+  size_t used = _tx.size() + _unacked;
+  return used < CONFIG_LWIP_TCP_SND_BUF_DEFAULT ? CONFIG_LWIP_TCP_SND_BUF_DEFAULT - used : 0;
+}
+
+size_t AsyncClient::add(const char *data, size_t size, uint8_t apiflags) {
+  (void)apiflags;
+  size_t room = space();
+  if (!data || !size || !room) {
+    return 0;
+  }
+  size_t n = std::min(size, room);
+  std::lock_guard<std::mutex> guard(AsyncTcpService::lock);
+  _tx.append(data, n);
+  return n;
+}
+
+bool AsyncClient::send() {
+  bool wakeLoop;
+  {
+    std::lock_guard<std::mutex> guard(AsyncTcpService::lock);
+    if (_state != ESTABLISHED) {
+      return false;
+    }
+    _flush();
+    wakeLoop = !_tx.empty() || _unacked;
+  }
+  if (wakeLoop) {
+    AsyncTcpService::wake();  // to wait for POLLOUT or acks
+  }
+  return true;
+}
+
+size_t AsyncClient::write(const char *data) {
+  return data ? write(data, strlen(data)) : 0;
+}
+
+size_t AsyncClient::write(const char *data, size_t size, uint8_t apiflags) {
+  size_t n = add(data, size, apiflags);
+  if (!n || !send()) {
+    return 0;
+  }
+  return n;
+}
+
+// error 0 is an orderly close, anything else resets the connection. False
+// if it was closed already.
+bool AsyncClient::_shutdown(int8_t error) {
+  {
+    std::lock_guard<std::mutex> guard(AsyncTcpService::lock);
+    if (_fd < 0) {
+      return false;
+    }
+    AsyncTcpService::clients.erase(this);
+    if (error) {
+      struct linger reset = {1, 0};
+      setsockopt(_fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+      ::close(_fd);
+    } else if (!_tx.empty()) {
+      AsyncTcpService::lingering.push_back({_fd, std::move(_tx), (uint32_t)millis()});
+    } else {
+      ::close(_fd);  // the kernel still sends what it holds
+    }
+    _fd = -1;
+    _state = CLOSED;
+    _tx.clear();
+    _unacked = 0;
+    if (error == ERR_ABRT) {
+      AsyncTcpService::aborted.push_back(this);
+    }
+  }
+  AsyncTcpService::wake();
+  return true;
+}
+
+void AsyncClient::_closed(int8_t error) {
+  if (error && _errorCb) {
+    _errorCb(_errorCbArg, this, error);
+  }
+  if (_discardCb) {
+    _discardCb(_discardCbArg, this);  // usually deletes this
+  }
+}
+
+void AsyncClient::_close(int8_t error) {
+  if (_shutdown(error)) {
+    _closed(error);
+  }
+}
+
+void AsyncClient::close(bool now) {
+  (void)now;  // lwIP also sends the queued data on tcp_close()
+  _close(0);
+}
+
+// lwIP reports the abort through the error callback, which AsyncTCP queues,
+// so the callbacks run after the caller is done with the client
+int8_t AsyncClient::abort() {
+  _shutdown(ERR_ABRT);
+  return ERR_ABRT;
+}
+
+void AsyncClient::_recv(uint32_t now) {
+  char buf[CONFIG_LWIP_TCP_MSS];
+  ssize_t n = ::recv(_fd, buf, sizeof(buf), MSG_DONTWAIT);
+  if (n > 0) {
+    _rxLastPacket = now;
+    if (_recvCb) {
+      _recvCb(_recvCbArg, this, buf, n);
+    }
+  } else if (n == 0) {
+    _close(0);  // remote closed
+  } else if (errno != EAGAIN && errno != EINTR) {
+    _close(ERR_RST);
+  }
+}
+
+void AsyncClient::_sent(uint32_t now) {
+  size_t acked = 0;
+  {
+    std::lock_guard<std::mutex> guard(AsyncTcpService::lock);
+    if (_unacked) {
+      int queued = 0;
+      if (ioctl(_fd, SIOCOUTQ, &queued) == 0 && (size_t)queued < _unacked) {
+        acked = _unacked - queued;
+        _unacked = queued;
+      }
+    }
+  }
+  if (acked) {
+    uint32_t rtt = now - _txLastPacket;
+    _rxLastPacket = _txLastPacket = now;
+    if (_sentCb) {
+      _sentCb(_sentCbArg, this, acked, rtt);
+    }
+  }
+}
+
+void AsyncClient::_poll(uint32_t now) {
+  _wake = false;
+  _lastPoll = now;
+  if (_unacked && _ackTimeout && now - _txLastPacket >= _ackTimeout) {
+    _txLastPacket = now;
+    if (_timeoutCb) {
+      _timeoutCb(_timeoutCbArg, this, _ackTimeout);
+      return;
+    }
+  }
+  if (_rxTimeout && now - _rxLastPacket >= _rxTimeout * 1000) {
+    _close(0);
+    return;
+  }
+  if (_pollCb) {
+    _pollCb(_pollCbArg, this);
+  }
+}
+
+void AsyncClient::setNoDelay(bool nodelay) {
+  int flag = nodelay;
+  setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+bool AsyncClient::getNoDelay() {
+  int flag = 0;
+  socklen_t len = sizeof(flag);
+  getsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &flag, &len);
+  return flag;
+}
+
+static bool socket_address(int fd, bool peer, sockaddr_in &addr) {
+  socklen_t len = sizeof(addr);
+  memset(&addr, 0, sizeof(addr));
+  return fd >= 0 && (peer ? getpeername(fd, (sockaddr *)&addr, &len) : getsockname(fd, (sockaddr *)&addr, &len)) == 0;
+}
+
+uint32_t AsyncClient::getRemoteAddress() const {
+  sockaddr_in addr;
+  return socket_address(_fd, true, addr) ? addr.sin_addr.s_addr : 0;
+}
+
+uint16_t AsyncClient::getRemotePort() const {
+  sockaddr_in addr;
+  return socket_address(_fd, true, addr) ? ntohs(addr.sin_port) : 0;
+}
+
+uint32_t AsyncClient::getLocalAddress() const {
+  sockaddr_in addr;
+  return socket_address(_fd, false, addr) ? addr.sin_addr.s_addr : 0;
+}
+
+uint16_t AsyncClient::getLocalPort() const {
+  sockaddr_in addr;
+  return socket_address(_fd, false, addr) ? ntohs(addr.sin_port) : 0;
+}
+
+void AsyncClient::onConnect(AcConnectHandler cb, void *arg) {
+  _connectCb = cb;
+  _connectCbArg = arg;
+}
+
+void AsyncClient::onDisconnect(AcConnectHandler cb, void *arg) {
+  _discardCb = cb;
+  _discardCbArg = arg;
+}
+
+void AsyncClient::onAck(AcAckHandler cb, void *arg) {
+  _sentCb = cb;
+  _sentCbArg = arg;
+}
+
+void AsyncClient::onError(AcErrorHandler cb, void *arg) {
+  _errorCb = cb;
+  _errorCbArg = arg;
+}
+
+void AsyncClient::onData(AcDataHandler cb, void *arg) {
+  _recvCb = cb;
+  _recvCbArg = arg;
+}
+
+void AsyncClient::onTimeout(AcTimeoutHandler cb, void *arg) {
+  _timeoutCb = cb;
+  _timeoutCbArg = arg;
+}
+
+void AsyncClient::onPoll(AcConnectHandler cb, void *arg) {
+  _pollCb = cb;
+  _pollCbArg = arg;
+}
+
+AsyncServer::AsyncServer(uint16_t port) : _port(port) {}
+
+AsyncServer::~AsyncServer() {
+  end();
+}
+
+void AsyncServer::onClient(AcConnectHandler cb, void *arg) {
+  _connectCb = cb;
+  _connectCbArg = arg;
+}
+
+void AsyncServer::begin() {
+  if (_fd >= 0) {
+    return;
+  }
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(_port);
+  if (bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+    log_e("AsyncServer: port %u: %s", _port, strerror(errno));
+    ::close(fd);
+    return;
+  }
+  AsyncTcpService::start();
+  {
+    std::lock_guard<std::mutex> guard(AsyncTcpService::lock);
+    _fd = fd;
+    AsyncTcpService::servers.insert(this);
+  }
+  AsyncTcpService::wake();
+}
+
+void AsyncServer::end() {
+  std::lock_guard<std::mutex> guard(AsyncTcpService::lock);
+  if (_fd >= 0) {
+    AsyncTcpService::servers.erase(this);
+    ::close(_fd);
+    _fd = -1;
+  }
+}
+
+uint8_t AsyncServer::status() const {
+  return _fd >= 0 ? LISTEN : CLOSED;
+}
+
+void AsyncServer::_accept() {
+  for (;;) {
+    int fd = accept4(_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) {
+      return;
+    }
+    if (_noDelay) {
+      int on = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    AsyncClient *client = new AsyncClient(fd);
+    if (_connectCb) {
+      _connectCb(_connectCbArg, client);
+    } else {
+      delete client;
+    }
+  }
+}
@@ -0,0 +1,250 @@
+#include "FS.h"
+#include "SD_MMC.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#include <string>
+
+SDMMCFS SD_MMC;
+
+namespace fs {
+
+class FileImpl {
+public:
+  ~FileImpl() {
+    close();
+  }
+
+  void close() {
+    if (file) {
+      fclose(file);
+      file = nullptr;
+    }
+    if (dir) {
+      closedir(dir);
+      dir = nullptr;
+    }
+  }
+
+  std::string root;
+  std::string path;  // as the sketch sees it, from the card's root
+  FILE *file = nullptr;
+  DIR *dir = nullptr;
+};
+
+static std::string host_path(const String &root, const char *path) {
+  std::string p = root.c_str();
+  if (path[0] != '/') {
+    p += '/';
+  }
+  return p + path;
+}
+
+static FileImplPtr open_impl(const std::string &root, const std::string &path, const char *mode) {
+  std::string full = root + path;
+  struct stat st;
+  FileImplPtr impl = std::make_shared<FileImpl>();
+  impl->root = root;
+  impl->path = path;
+  if (stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    impl->dir = opendir(full.c_str());
+    return impl->dir ? impl : FileImplPtr();
+  }
+  impl->file = fopen(full.c_str(), mode);
+  return impl->file ? impl : FileImplPtr();
+}
+
+size_t File::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buf, size_t size) {
+  return _p && _p->file ? fwrite(buf, 1, size, _p->file) : 0;
+}
+
+int File::available() {
+  if (!_p || !_p->file) {
+    return 0;
+  }
+  return size() - position();
+}
+
+int File::read() {
+  return _p && _p->file ? fgetc(_p->file) : -1;
+}
+
+int File::peek() {
+  if (!_p || !_p->file) {
+    return -1;
+  }
+  int c = fgetc(_p->file);
+  if (c >= 0) {
+    ungetc(c, _p->file);
+  }
+  return c;
+}
+
+void File::flush() {
+  if (_p && _p->file) {
+    fflush(_p->file);
+  }
+}
+
+size_t File::read(uint8_t *buf, size_t size) {
+  return _p && _p->file ? fread(buf, 1, size, _p->file) : 0;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  static const int whence[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+  return _p && _p->file && fseek(_p->file, pos, whence[mode]) == 0;
+}
+
+size_t File::position() const {
+  return _p && _p->file ? ftell(_p->file) : 0;
+}
+
+size_t File::size() const {
+  struct stat st;
+  if (!_p || !_p->file) {
+    return 0;
+  }
+  fflush(_p->file);
+  return fstat(fileno(_p->file), &st) == 0 ? st.st_size : 0;
+}
+
+bool File::setBufferSize(size_t size) {
+  return _p && _p->file && setvbuf(_p->file, nullptr, _IOFBF, size) == 0;
+}
+
+void File::close() {
+  _p.reset();
+}
+
+File::operator bool() const {
+  return _p != nullptr;
+}
+
+time_t File::getLastWrite() {
+  struct stat st;
+  if (!_p || stat((_p->root + _p->path).c_str(), &st) != 0) {
+    return 0;
+  }
+  return st.st_mtime;
+}
+
+const char *File::path() const {
+  return _p ? _p->path.c_str() : nullptr;
+}
+
+const char *File::name() const {
+  if (!_p) {
+    return nullptr;
+  }
+  size_t slash = _p->path.rfind('/');
+  return _p->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+bool File::isDirectory(void) {
+  return _p && _p->dir;
+}
+
+File File::openNextFile(const char *mode) {
+  if (!_p || !_p->dir) {
+    return File();
+  }
+  while (struct dirent *entry = readdir(_p->dir)) {
+    if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+      continue;
+    }
+    std::string path = _p->path;
+    if (path.empty() || path.back() != '/') {
+      path += '/';
+    }
+    return File(open_impl(_p->root, path + entry->d_name, mode));
+  }
+  return File();
+}
+
+String File::getNextFileName(void) {
+  File next = openNextFile();
+  return next ? String(next.path()) : String();
+}
+
+void File::rewindDirectory(void) {
+  if (_p && _p->dir) {
+    rewinddir(_p->dir);
+  }
+}
+
+File FS::open(const char *path, const char *mode, const bool create) {
+  (void)create;
+  std::string p = path;
+  if (p.empty() || p[0] != '/') {
+    p = "/" + p;
+  }
+  return File(open_impl(_root.c_str(), p, mode));
+}
+
+bool FS::exists(const char *path) {
+  struct stat st;
+  return stat(host_path(_root, path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path) {
+  return unlink(host_path(_root, path).c_str()) == 0;
+}
+
+bool FS::rename(const char *pathFrom, const char *pathTo) {
+  return ::rename(host_path(_root, pathFrom).c_str(), host_path(_root, pathTo).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+  return ::mkdir(host_path(_root, path).c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+bool FS::rmdir(const char *path) {
+  return ::rmdir(host_path(_root, path).c_str()) == 0;
+}
+
+}  // namespace fs
+
+bool SDMMCFS::begin(const char *mountpoint, bool mode1bit, bool format_if_mount_failed, int sdmmc_frequency, uint8_t maxOpenFiles) {
+  (void)mode1bit;
+  (void)format_if_mount_failed;
+  (void)sdmmc_frequency;
+  (void)maxOpenFiles;
+  struct stat st;
+  if (stat(mountpoint, &st) != 0 || !S_ISDIR(st.st_mode)) {
+    return false;
+  }
+  _root = mountpoint;
+  while (_root.endsWith("/")) {
+    _root.remove(_root.length() - 1);
+  }
+  return true;
+}
+
+void SDMMCFS::end() {
+  _root = String();
+}
+
+sdcard_type_t SDMMCFS::cardType() {
+  return _root.isEmpty() ? CARD_NONE : CARD_SDHC;
+}
+
+uint64_t SDMMCFS::cardSize() {
+  return totalBytes();
+}
+
+uint64_t SDMMCFS::totalBytes() {
+  struct statvfs vfs;
+  return statvfs(_root.c_str(), &vfs) == 0 ? (uint64_t)vfs.f_blocks * vfs.f_frsize : 0;
+}
+
+uint64_t SDMMCFS::usedBytes() {
+  struct statvfs vfs;
+  return statvfs(_root.c_str(), &vfs) == 0 ? (uint64_t)(vfs.f_blocks - vfs.f_bfree) * vfs.f_frsize : 0;
+}
@@ -0,0 +1,354 @@
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+const String emptyString;
+
+static std::string number(unsigned long long value, bool negative, unsigned char base) {
+  if (base < 2 || base > 36) {
+    base = 10;
+  }
+  char buf[8 * sizeof(value) + 2];
+  char *p = buf + sizeof(buf);
+  *--p = 0;
+  do {
+    unsigned digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  if (negative) {
+    *--p = '-';
+  }
+  return p;
+}
+
+static std::string signed_number(long long value, unsigned char base) {
+  // Like the core, only base 10 prints a sign, other bases the two's complement
+  if (base == 10 && value < 0) {
+    return number(-(unsigned long long)value, true, base);
+  }
+  return number((unsigned long long)value, false, base);
+}
+
+static std::string decimal(double value, unsigned int decimalPlaces) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+  return buf;
+}
+
+String::String(const char *cstr) : _s(cstr ? cstr : "") {}
+
+String::String(const char *cstr, unsigned int length) : _s(cstr ? std::string(cstr, length) : std::string()) {}
+
+String::String(char c) : _s(1, c) {}
+
+String::String(unsigned char value, unsigned char base) : _s(number(value, false, base)) {}
+
+String::String(int value, unsigned char base) : _s(base == 10 ? signed_number(value, base) : number((unsigned int)value, false, base)) {}
+
+String::String(unsigned int value, unsigned char base) : _s(number(value, false, base)) {}
+
+String::String(long value, unsigned char base) : _s(base == 10 ? signed_number(value, base) : number((unsigned long)value, false, base)) {}
+
+String::String(unsigned long value, unsigned char base) : _s(number(value, false, base)) {}
+
+String::String(long long value, unsigned char base) : _s(signed_number(value, base)) {}
+
+String::String(unsigned long long value, unsigned char base) : _s(number(value, false, base)) {}
+
+String::String(float value, unsigned int decimalPlaces) : _s(decimal(value, decimalPlaces)) {}
+
+String::String(double value, unsigned int decimalPlaces) : _s(decimal(value, decimalPlaces)) {}
+
+bool String::reserve(unsigned int size) {
+  _s.reserve(size);
+  return true;
+}
+
+String &String::operator=(const char *cstr) {
+  _s = cstr ? cstr : "";
+  return *this;
+}
+
+bool String::concat(const String &str) {
+  _s += str._s;
+  return true;
+}
+
+bool String::concat(const char *cstr) {
+  if (!cstr) {
+    return false;
+  }
+  _s += cstr;
+  return true;
+}
+
+bool String::concat(const char *cstr, unsigned int length) {
+  if (!cstr) {
+    return false;
+  }
+  _s.append(cstr, length);
+  return true;
+}
+
+bool String::concat(char c) {
+  _s += c;
+  return true;
+}
+
+bool String::concat(unsigned char num) {
+  return concat(String(num));
+}
+
+bool String::concat(int num) {
+  return concat(String(num));
+}
+
+bool String::concat(unsigned int num) {
+  return concat(String(num));
+}
+
+bool String::concat(long num) {
+  return concat(String(num));
+}
+
+bool String::concat(unsigned long num) {
+  return concat(String(num));
+}
+
+bool String::concat(long long num) {
+  return concat(String(num));
+}
+
+bool String::concat(unsigned long long num) {
+  return concat(String(num));
+}
+
+bool String::concat(float num) {
+  return concat(String(num));
+}
+
+bool String::concat(double num) {
+  return concat(String(num));
+}
+
+int String::compareTo(const String &s) const {
+  return _s.compare(s._s);
+}
+
+bool String::equals(const char *cstr) const {
+  return _s == (cstr ? cstr : "");
+}
+
+bool String::equalsIgnoreCase(const String &s) const {
+  return _s.size() == s._s.size() && strcasecmp(c_str(), s.c_str()) == 0;
+}
+
+bool String::equalsConstantTime(const String &s) const {
+  if (_s.size() != s._s.size()) {
+    return false;
+  }
+  unsigned char diff = 0;
+  for (size_t i = 0; i < _s.size(); i++) {
+    diff |= _s[i] ^ s._s[i];
+  }
+  return diff == 0;
+}
+
+bool String::startsWith(const String &prefix) const {
+  return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+  return offset <= _s.size() && _s.compare(offset, prefix._s.size(), prefix._s) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+  return suffix._s.size() <= _s.size() && _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+  return operator[](index);
+}
+
+void String::setCharAt(unsigned int index, char c) {
+  if (index < _s.size()) {
+    _s[index] = c;
+  }
+}
+
+char String::operator[](unsigned int index) const {
+  return index < _s.size() ? _s[index] : 0;
+}
+
+char &String::operator[](unsigned int index) {
+  static char dummy;
+  if (index >= _s.size()) {
+    dummy = 0;
+    return dummy;
+  }
+  return _s[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const {
+  if (!bufsize || !buf) {
+    return;
+  }
+  if (index >= _s.size()) {
+    buf[0] = 0;
+    return;
+  }
+  size_t n = std::min<size_t>(bufsize - 1, _s.size() - index);
+  memcpy(buf, _s.data() + index, n);
+  buf[n] = 0;
+}
+
+static int found(size_t pos) {
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(char ch) const {
+  return found(_s.find(ch));
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+  return found(_s.find(ch, fromIndex));
+}
+
+int String::indexOf(const String &str) const {
+  return found(_s.find(str._s));
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const {
+  return found(_s.find(str._s, fromIndex));
+}
+
+int String::lastIndexOf(char ch) const {
+  return found(_s.rfind(ch));
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const {
+  return found(_s.rfind(ch, fromIndex));
+}
+
+int String::lastIndexOf(const String &str) const {
+  return found(_s.rfind(str._s));
+}
+
+int String::lastIndexOf(const String &str, unsigned int fromIndex) const {
+  return found(_s.rfind(str._s, fromIndex));
+}
+
+String String::substring(unsigned int beginIndex) const {
+  return substring(beginIndex, _s.size());
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+  if (beginIndex > endIndex) {
+    std::swap(beginIndex, endIndex);
+  }
+  if (beginIndex >= _s.size()) {
+    return String();
+  }
+  endIndex = std::min<unsigned int>(endIndex, _s.size());
+  return String(_s.data() + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(char find, char replace) {
+  for (char &c : _s) {
+    if (c == find) {
+      c = replace;
+    }
+  }
+}
+
+void String::replace(const String &find, const String &replace) {
+  if (find._s.empty()) {
+    return;
+  }
+  size_t pos = 0;
+  while ((pos = _s.find(find._s, pos)) != std::string::npos) {
+    _s.replace(pos, find._s.size(), replace._s);
+    pos += replace._s.size();
+  }
+}
+
+void String::remove(unsigned int index) {
+  remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index < _s.size()) {
+    _s.erase(index, count);
+  }
+}
+
+void String::toLowerCase() {
+  for (char &c : _s) {
+    c = tolower((unsigned char)c);
+  }
+}
+
+void String::toUpperCase() {
+  for (char &c : _s) {
+    c = toupper((unsigned char)c);
+  }
+}
+
+void String::trim() {
+  size_t begin = 0;
+  size_t end = _s.size();
+  while (begin < end && isspace((unsigned char)_s[begin])) {
+    begin++;
+  }
+  while (end > begin && isspace((unsigned char)_s[end - 1])) {
+    end--;
+  }
+  _s = _s.substr(begin, end - begin);
+}
+
+long String::toInt() const {
+  return atol(c_str());
+}
+
+float String::toFloat() const {
+  return atof(c_str());
+}
+
+double String::toDouble() const {
+  return atof(c_str());
+}
+
+String operator+(const String &lhs, const String &rhs) {
+  String s(lhs);
+  s.concat(rhs);
+  return s;
+}
+
+String operator+(const String &lhs, const char *rhs) {
+  String s(lhs);
+  s.concat(rhs);
+  return s;
+}
+
+String operator+(const char *lhs, const String &rhs) {
+  String s(lhs);
+  s.concat(rhs);
+  return s;
+}
+
+String operator+(const String &lhs, char rhs) {
+  String s(lhs);
+  s.concat(rhs);
+  return s;
+}
+
+String operator+(const String &lhs, const __FlashStringHelper *rhs) {
+  String s(lhs);
+  s.concat(rhs);
+  return s;
+}
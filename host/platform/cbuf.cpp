@@ -0,0 +1,133 @@
+#include "cbuf.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+cbuf::cbuf(size_t size) : _size(size), _buf(new char[size]), _bufend(_buf + size), _begin(_buf), _end(_begin) {}
+
+cbuf::~cbuf() {
+  delete[] _buf;
+}
+
+size_t cbuf::resizeAdd(size_t addSize) {
+  return resize(_size + addSize);
+}
+
+size_t cbuf::resize(size_t newSize) {
+  size_t bytes_available = available();
+  if (newSize < bytes_available || newSize == _size) {
+    return _size;
+  }
+  char *newbuf = new char[newSize];
+  peek(newbuf, bytes_available);
+  delete[] _buf;
+  _buf = newbuf;
+  _size = newSize;
+  _bufend = _buf + _size;
+  _begin = _buf;
+  _end = _begin + bytes_available;
+  return _size;
+}
+
+size_t cbuf::available() const {
+  if (_end >= _begin) {
+    return _end - _begin;
+  }
+  return _size - (_begin - _end);
+}
+
+size_t cbuf::size() {
+  return _size;
+}
+
+size_t cbuf::room() const {
+  if (_end >= _begin) {
+    return _size - (_end - _begin) - 1;
+  }
+  return _begin - _end - 1;
+}
+
+int cbuf::peek() {
+  if (empty()) {
+    return -1;
+  }
+  return static_cast<unsigned char>(*_begin);
+}
+
+size_t cbuf::peek(char *dst, size_t size) {
+  size_t bytes_available = available();
+  size_t size_to_read = std::min(size, bytes_available);
+  size_t size_read = size_to_read;
+  const char *begin = _begin;
+  if (_end < _begin && size_to_read > (size_t)(_bufend - _begin)) {
+    size_t top_size = _bufend - _begin;
+    memcpy(dst, _begin, top_size);
+    begin = _buf;
+    size_to_read -= top_size;
+    dst += top_size;
+  }
+  memcpy(dst, begin, size_to_read);
+  return size_read;
+}
+
+int cbuf::read() {
+  if (empty()) {
+    return -1;
+  }
+  char result = *_begin;
+  _begin = wrap_if_bufend(_begin + 1);
+  return static_cast<unsigned char>(result);
+}
+
+size_t cbuf::read(char *dst, size_t size) {
+  size_t size_read = peek(dst, size);
+  remove(size_read);
+  return size_read;
+}
+
+size_t cbuf::write(char c) {
+  if (full()) {
+    return 0;
+  }
+  *_end = c;
+  _end = wrap_if_bufend(_end + 1);
+  return 1;
+}
+
+size_t cbuf::write(const char *src, size_t size) {
+  size_t bytes_available = room();
+  size_t size_to_write = std::min(size, bytes_available);
+  size_t size_written = size_to_write;
+  if (_end >= _begin && size_to_write > (size_t)(_bufend - _end)) {
+    size_t top_size = _bufend - _end;
+    memcpy(_end, src, top_size);
+    _end = _buf;
+    size_to_write -= top_size;
+    src += top_size;
+  }
+  memcpy(_end, src, size_to_write);
+  _end = wrap_if_bufend(_end + size_to_write);
+  return size_written;
+}
+
+void cbuf::flush() {
+  _begin = _buf;
+  _end = _buf;
+}
+
+size_t cbuf::remove(size_t size) {
+  size_t bytes_available = available();
+  if (size >= bytes_available) {
+    flush();
+    return 0;
+  }
+  size_t size_to_remove = std::min(size, bytes_available);
+  if (_end < _begin && size_to_remove > (size_t)(_bufend - _begin)) {
+    size_t top_size = _bufend - _begin;
+    _begin = _buf;
+    size_to_remove -= top_size;
+  }
+  _begin = wrap_if_bufend(_begin + size_to_remove);
+  return available();
+}
@@ -0,0 +1,191 @@
+#include "esp_camera.h"
+
+#include <string.h>
+
+// An OV2640 without a lens: settings land in the status and the register
+// file, frames come from the CameraSimulator only.
+
+// Sizes from esp32-camera's sensor.c, the aspect ratio is its enum value
+const resolution_info_t resolution[FRAMESIZE_INVALID] = {
+  {96, 96, 7},      // 96x96
+  {160, 120, 0},    // QQVGA
+  {176, 144, 6},    // QCIF
+  {240, 176, 1},    // HQVGA
+  {240, 240, 7},    // 240x240
+  {320, 240, 0},    // QVGA
+  {400, 296, 0},    // CIF
+  {480, 320, 1},    // HVGA
+  {640, 480, 0},    // VGA
+  {800, 600, 0},    // SVGA
+  {1024, 768, 0},   // XGA
+  {1280, 720, 4},   // HD
+  {1280, 1024, 6},  // SXGA
+  {1600, 1200, 0},  // UXGA
+  {1920, 1080, 4},  // FHD
+  {720, 1280, 8},   // P_HD
+  {864, 1536, 8},   // P_3MP
+  {2048, 1536, 0},  // QXGA
+  {2560, 1440, 4},  // QHD
+  {2560, 1600, 2},  // WQXGA
+  {1080, 1920, 8},  // P_FHD
+  {2560, 1920, 0},  // QSXGA
+};
+
+static sensor_t sensor;
+static uint8_t registers[0x10000];
+static bool initialized;
+
+#define STATUS_SETTER(name, field)             \
+  static int name(sensor_t *s, int value) {    \
+    s->status.field = value;                   \
+    return 0;                                  \
+  }
+
+STATUS_SETTER(set_contrast, contrast)
+STATUS_SETTER(set_brightness, brightness)
+STATUS_SETTER(set_saturation, saturation)
+STATUS_SETTER(set_sharpness, sharpness)
+STATUS_SETTER(set_denoise, denoise)
+STATUS_SETTER(set_quality, quality)
+STATUS_SETTER(set_colorbar, colorbar)
+STATUS_SETTER(set_whitebal, awb)
+STATUS_SETTER(set_gain_ctrl, agc)
+STATUS_SETTER(set_exposure_ctrl, aec)
+STATUS_SETTER(set_hmirror, hmirror)
+STATUS_SETTER(set_vflip, vflip)
+STATUS_SETTER(set_aec2, aec2)
+STATUS_SETTER(set_awb_gain, awb_gain)
+STATUS_SETTER(set_agc_gain, agc_gain)
+STATUS_SETTER(set_aec_value, aec_value)
+STATUS_SETTER(set_special_effect, special_effect)
+STATUS_SETTER(set_wb_mode, wb_mode)
+STATUS_SETTER(set_ae_level, ae_level)
+STATUS_SETTER(set_dcw, dcw)
+STATUS_SETTER(set_bpc, bpc)
+STATUS_SETTER(set_wpc, wpc)
+STATUS_SETTER(set_raw_gma, raw_gma)
+STATUS_SETTER(set_lenc, lenc)
+
+static int set_pixformat(sensor_t *s, pixformat_t pixformat) {
+  s->pixformat = pixformat;
+  return 0;
+}
+
+static int set_framesize(sensor_t *s, framesize_t framesize) {
+  if (framesize >= FRAMESIZE_INVALID) {
+    return -1;
+  }
+  s->status.framesize = framesize;
+  return 0;
+}
+
+static int set_gainceiling(sensor_t *s, gainceiling_t gainceiling) {
+  s->status.gainceiling = gainceiling;
+  return 0;
+}
+
+static int get_reg(sensor_t *s, int reg, int mask) {
+  (void)s;
+  return registers[reg & 0xffff] & mask;
+}
+
+static int set_reg(sensor_t *s, int reg, int mask, int value) {
+  (void)s;
+  uint8_t &r = registers[reg & 0xffff];
+  r = (r & ~mask) | (value & mask);
+  return 0;
+}
+
+static int set_res_raw(sensor_t *s, int startX, int startY, int endX, int endY, int offsetX, int offsetY, int totalX, int totalY, int outputX, int outputY, bool scale, bool binning) {
+  (void)s, (void)startX, (void)startY, (void)endX, (void)endY, (void)offsetX, (void)offsetY;
+  (void)totalX, (void)totalY, (void)outputX, (void)outputY, (void)scale, (void)binning;
+  return 0;
+}
+
+static int set_pll(sensor_t *s, int bypass, int mul, int sys, int root, int pre, int seld5, int pclken, int pclk) {
+  (void)s, (void)bypass, (void)mul, (void)sys, (void)root, (void)pre, (void)seld5, (void)pclken, (void)pclk;
+  return 0;
+}
+
+static int set_xclk(sensor_t *s, int timer, int xclk) {
+  (void)timer;
+  s->xclk_freq_hz = xclk * 1000000;
+  return 0;
+}
+
+esp_err_t esp_camera_init(const camera_config_t *config) {
+  memset(&sensor, 0, sizeof(sensor));
+  sensor.id.PID = OV2640_PID;
+  sensor.slv_addr = 0x30;
+  sensor.pixformat = config->pixel_format;
+  sensor.xclk_freq_hz = config->xclk_freq_hz;
+  sensor.status.framesize = config->frame_size;
+  sensor.status.quality = config->jpeg_quality;
+  sensor.status.awb = 1;
+  sensor.status.awb_gain = 1;
+  sensor.status.aec = 1;
+  sensor.status.agc = 1;
+  sensor.status.bpc = 0;
+  sensor.status.wpc = 1;
+  sensor.status.raw_gma = 1;
+  sensor.status.lenc = 1;
+  sensor.status.dcw = 1;
+
+  sensor.init_status = [](sensor_t *) {
+    return 0;
+  };
+  sensor.reset = [](sensor_t *) {
+    return 0;
+  };
+  sensor.set_pixformat = set_pixformat;
+  sensor.set_framesize = set_framesize;
+  sensor.set_contrast = set_contrast;
+  sensor.set_brightness = set_brightness;
+  sensor.set_saturation = set_saturation;
+  sensor.set_sharpness = set_sharpness;
+  sensor.set_denoise = set_denoise;
+  sensor.set_gainceiling = set_gainceiling;
+  sensor.set_quality = set_quality;
+  sensor.set_colorbar = set_colorbar;
+  sensor.set_whitebal = set_whitebal;
+  sensor.set_gain_ctrl = set_gain_ctrl;
+  sensor.set_exposure_ctrl = set_exposure_ctrl;
+  sensor.set_hmirror = set_hmirror;
+  sensor.set_vflip = set_vflip;
+  sensor.set_aec2 = set_aec2;
+  sensor.set_awb_gain = set_awb_gain;
+  sensor.set_agc_gain = set_agc_gain;
+  sensor.set_aec_value = set_aec_value;
+  sensor.set_special_effect = set_special_effect;
+  sensor.set_wb_mode = set_wb_mode;
+  sensor.set_ae_level = set_ae_level;
+  sensor.set_dcw = set_dcw;
+  sensor.set_bpc = set_bpc;
+  sensor.set_wpc = set_wpc;
+  sensor.set_raw_gma = set_raw_gma;
+  sensor.set_lenc = set_lenc;
+  sensor.get_reg = get_reg;
+  sensor.set_reg = set_reg;
+  sensor.set_res_raw = set_res_raw;
+  sensor.set_pll = set_pll;
+  sensor.set_xclk = set_xclk;
+  initialized = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_camera_deinit() {
+  initialized = false;
+  return ESP_OK;
+}
+
+camera_fb_t *esp_camera_fb_get() {
+  return nullptr;  // no sensor, use the CameraSimulator
+}
+
+void esp_camera_fb_return(camera_fb_t *fb) {
+  (void)fb;
+}
+
+sensor_t *esp_camera_sensor_get() {
+  return initialized ? &sensor : nullptr;
+}
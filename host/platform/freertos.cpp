@@ -0,0 +1,158 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+#include <pthread.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct tskTaskControlBlock {
+  TaskFunction_t code;
+  void *parameters;
+  std::string name;
+  std::mutex lock;
+  std::condition_variable notified;
+  uint32_t notifications = 0;
+};
+
+struct QueueDefinition {
+  std::mutex lock;
+  std::condition_variable given;
+  UBaseType_t count;
+  UBaseType_t max;
+};
+
+static thread_local TaskHandle_t current = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth, void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pvCreatedTask, BaseType_t xCoreID) {
+  (void)usStackDepth;
+  (void)uxPriority;
+  (void)xCoreID;
+  // Never freed, like a task the sketch deletes while others may still notify it
+  TaskHandle_t task = new tskTaskControlBlock;
+  task->code = pvTaskCode;
+  task->parameters = pvParameters;
+  task->name = pcName ? pcName : "";
+  if (pvCreatedTask) {
+    *pvCreatedTask = task;
+  }
+  std::thread([task]() {
+    current = task;
+    pthread_setname_np(pthread_self(), task->name.substr(0, 15).c_str());
+    task->code(task->parameters);
+  }).detach();
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+  if (xTaskToDelete && xTaskToDelete != current) {
+    fprintf(stderr, "vTaskDelete: only the calling task can be deleted on the host\n");
+    abort();
+  }
+  pthread_exit(nullptr);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (!current) {
+    current = new tskTaskControlBlock;  // a thread the host started, e.g. main
+  }
+  return current;
+}
+
+TickType_t xTaskGetTickCount() {
+  return esp_timer_get_time() / 1000;
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(xTicksToDelay));
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement) {
+  *pxPreviousWakeTime += xTimeIncrement;
+  int32_t ahead = *pxPreviousWakeTime - xTaskGetTickCount();
+  if (ahead <= 0) {
+    return pdFALSE;
+  }
+  vTaskDelay(ahead);
+  return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> guard(task->lock);
+  auto pending = [task]() {
+    return task->notifications > 0;
+  };
+  if (xTicksToWait == portMAX_DELAY) {
+    task->notified.wait(guard, pending);
+  } else {
+    task->notified.wait_for(guard, std::chrono::milliseconds(xTicksToWait), pending);
+  }
+  uint32_t value = task->notifications;
+  if (value) {
+    task->notifications = xClearCountOnExit ? 0 : value - 1;
+  }
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+  {
+    std::lock_guard<std::mutex> guard(xTaskToNotify->lock);
+    xTaskToNotify->notifications++;
+  }
+  xTaskToNotify->notified.notify_one();
+  return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount) {
+  SemaphoreHandle_t semaphore = new QueueDefinition;
+  semaphore->count = uxInitialCount;
+  semaphore->max = uxMaxCount;
+  return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime) {
+  std::unique_lock<std::mutex> guard(xSemaphore->lock);
+  auto available = [xSemaphore]() {
+    return xSemaphore->count > 0;
+  };
+  if (xBlockTime == portMAX_DELAY) {
+    xSemaphore->given.wait(guard, available);
+  } else if (!xSemaphore->given.wait_for(guard, std::chrono::milliseconds(xBlockTime), available)) {
+    return pdFALSE;
+  }
+  xSemaphore->count--;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore) {
+  {
+    std::lock_guard<std::mutex> guard(xSemaphore->lock);
+    if (xSemaphore->count >= xSemaphore->max) {
+      return pdFALSE;
+    }
+    xSemaphore->count++;
+  }
+  xSemaphore->given.notify_one();
+  return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore) {
+  delete xSemaphore;
+}
+
+static std::recursive_mutex critical;
+
+void vPortEnterCritical(portMUX_TYPE *mux) {
+  (void)mux;
+  critical.lock();
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) {
+  (void)mux;
+  critical.unlock();
+}
@@ -0,0 +1,136 @@
+#include "img_converters.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <jpeglib.h>
+#include <setjmp.h>
+#include <vector>
+
+namespace {
+
+struct JpegError {
+  jpeg_error_mgr mgr;
+  jmp_buf jump;
+};
+
+void jpeg_error_exit(j_common_ptr cinfo) {
+  longjmp(reinterpret_cast<JpegError *>(cinfo->err)->jump, 1);
+}
+
+void jpeg_no_output(j_common_ptr cinfo) {
+  (void)cinfo;
+}
+
+// One line of the camera format as RGB
+void rgb_line(const uint8_t *src, size_t width, pixformat_t format, uint8_t *dst) {
+  for (size_t x = 0; x < width; x++, dst += 3) {
+    switch (format) {
+      case PIXFORMAT_RGB565:
+      {
+        uint16_t c = src[2 * x] << 8 | src[2 * x + 1];
+        dst[0] = (c >> 8) & 0xf8;
+        dst[1] = (c >> 3) & 0xfc;
+        dst[2] = (c << 3) & 0xf8;
+        break;
+      }
+      case PIXFORMAT_RGB888:
+        dst[0] = src[3 * x + 2];
+        dst[1] = src[3 * x + 1];
+        dst[2] = src[3 * x];
+        break;
+      default:  // PIXFORMAT_GRAYSCALE
+        dst[0] = dst[1] = dst[2] = src[x];
+        break;
+    }
+  }
+}
+
+}  // namespace
+
+bool fmt2jpg(uint8_t *src, size_t src_len, uint16_t width, uint16_t height, pixformat_t format, uint8_t quality, uint8_t **out, size_t *out_len) {
+  size_t bpp = format == PIXFORMAT_RGB565 ? 2 : format == PIXFORMAT_RGB888 ? 3 : format == PIXFORMAT_GRAYSCALE ? 1 : 0;
+  if (!bpp || src_len < (size_t)width * height * bpp) {
+    return false;
+  }
+
+  jpeg_compress_struct cinfo;
+  JpegError err;
+  unsigned char *buf = nullptr;
+  unsigned long len = 0;
+  std::vector<uint8_t> line(width * 3);
+  cinfo.err = jpeg_std_error(&err.mgr);
+  err.mgr.error_exit = jpeg_error_exit;
+  err.mgr.output_message = jpeg_no_output;
+  if (setjmp(err.jump)) {
+    jpeg_destroy_compress(&cinfo);
+    free(buf);
+    return false;
+  }
+  jpeg_create_compress(&cinfo);
+  jpeg_mem_dest(&cinfo, &buf, &len);
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < height) {
+    rgb_line(src + (size_t)cinfo.next_scanline * width * bpp, width, format, line.data());
+    JSAMPROW row = line.data();
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  *out = buf;
+  *out_len = len;
+  return true;
+}
+
+bool frame2jpg(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len) {
+  return fmt2jpg(fb->buf, fb->len, fb->width, fb->height, fb->format, quality, out, out_len);
+}
+
+bool jpg2rgb565(const uint8_t *src, size_t src_len, uint8_t *out, jpg_scale_t scale) {
+  jpeg_decompress_struct cinfo;
+  JpegError err;
+  std::vector<uint8_t> line;
+  cinfo.err = jpeg_std_error(&err.mgr);
+  err.mgr.error_exit = jpeg_error_exit;
+  err.mgr.output_message = jpeg_no_output;
+  if (setjmp(err.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, src, src_len);
+  jpeg_read_header(&cinfo, TRUE);
+  cinfo.out_color_space = JCS_RGB;
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = 1 << scale;
+  jpeg_start_decompress(&cinfo);
+
+  // The camera's decoder drops partial blocks, the caller sizes for that
+  size_t width = cinfo.image_width >> scale;
+  size_t height = cinfo.image_height >> scale;
+  line.resize(cinfo.output_width * 3);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    size_t y = cinfo.output_scanline;
+    JSAMPROW row = line.data();
+    jpeg_read_scanlines(&cinfo, &row, 1);
+    if (y >= height) {
+      continue;
+    }
+    uint8_t *dst = out + y * width * 2;
+    for (size_t x = 0; x < width; x++) {
+      const uint8_t *p = &line[3 * x];
+      uint16_t c = (p[0] & 0xf8) << 8 | (p[1] & 0xfc) << 3 | p[2] >> 3;
+      dst[2 * x] = c >> 8;
+      dst[2 * x + 1] = c;
+    }
+  }
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return true;
+}
@@ -0,0 +1,190 @@
+// Writes an AVI with AviMuxer the way AviFile does (placeholder header,
+// frames, index, header rewritten at 0) and walks the result like a player:
+// RIFF structure, stream headers, movi chunks and idx1 offsets. Every frame
+// found through the index is decoded with libjpeg.
+//
+//   avi_muxer_test [out.avi]   also writes the file, e.g. for ffplay
+#include "AviMuxer.h"
+#include "check.h"
+#include "jpeg_samples.h"
+#include <string.h>
+#include <string>
+
+static uint32_t u32(const std::vector<uint8_t> &f, size_t pos) {
+  return f[pos] | f[pos + 1] << 8 | f[pos + 2] << 16 | (uint32_t)f[pos + 3] << 24;
+}
+
+static uint16_t u16(const std::vector<uint8_t> &f, size_t pos) {
+  return f[pos] | f[pos + 1] << 8;
+}
+
+static bool fourcc(const std::vector<uint8_t> &f, size_t pos, const char *cc) {
+  return pos + 4 <= f.size() && !memcmp(&f[pos], cc, 4);
+}
+
+static std::vector<uint8_t> mux(const std::vector<std::vector<uint8_t>> &frames, int width, int height, int64_t interval) {
+  AviMuxer muxer;
+  muxer.begin(width, height);
+
+  std::vector<uint8_t> file(AVI_HEADER_SIZE);
+  muxer.header(file.data());
+  uint8_t chunk[AVI_CHUNK_HEADER_SIZE];
+  int64_t timestamp = 1000000;
+  for (const auto &frame : frames) {
+    muxer.frameHeader(frame.size(), timestamp, chunk);
+    file.insert(file.end(), chunk, chunk + sizeof(chunk));
+    file.insert(file.end(), frame.begin(), frame.end());
+    if (AviMuxer::padding(frame.size())) {
+      file.push_back(0);
+    }
+    timestamp += interval;
+  }
+  muxer.indexHeader(chunk);
+  file.insert(file.end(), chunk, chunk + sizeof(chunk));
+  for (size_t i = 0; i < muxer.frames(); i++) {
+    uint8_t entry[AVI_INDEX_ENTRY_SIZE];
+    muxer.indexEntry(i, entry);
+    file.insert(file.end(), entry, entry + sizeof(entry));
+  }
+  CHECK_EQ(file.size(), muxer.size());
+  muxer.header(file.data());
+  return file;
+}
+
+static void check_avi(const std::vector<uint8_t> &file, const std::vector<std::vector<uint8_t>> &frames, int width, int height, int64_t interval) {
+  CHECK(fourcc(file, 0, "RIFF"));
+  CHECK_EQ(u32(file, 4), file.size() - 8);
+  CHECK(fourcc(file, 8, "AVI "));
+
+  // Top level chunks must tile the file exactly
+  size_t hdrl = 0, movi = 0, idx1 = 0;
+  size_t pos = 12;
+  while (pos + 8 <= file.size()) {
+    uint32_t size = u32(file, pos + 4);
+    if (fourcc(file, pos, "LIST") && fourcc(file, pos + 8, "hdrl")) {
+      hdrl = pos;
+    } else if (fourcc(file, pos, "LIST") && fourcc(file, pos + 8, "movi")) {
+      movi = pos;
+    } else if (fourcc(file, pos, "idx1")) {
+      idx1 = pos;
+    } else {
+      CHECK(fourcc(file, pos, "JUNK"));
+    }
+    pos += 8 + size + (size & 1);
+  }
+  CHECK_EQ(pos, file.size());
+  CHECK(hdrl && movi && idx1);
+  if (!hdrl || !movi || !idx1) {
+    return;
+  }
+
+  // Main header
+  size_t avih = hdrl + 12;
+  CHECK(fourcc(file, avih, "avih"));
+  CHECK_EQ(u32(file, avih + 4), 56);
+  if (frames.size() > 1) {
+    CHECK_EQ(u32(file, avih + 8), interval);
+  }
+  CHECK(u32(file, avih + 20) & 0x10);  // AVIF_HASINDEX
+  CHECK_EQ(u32(file, avih + 24), frames.size());
+  CHECK_EQ(u32(file, avih + 32), 1);
+  CHECK_EQ(u32(file, avih + 40), width);
+  CHECK_EQ(u32(file, avih + 44), height);
+
+  // Stream header and format
+  size_t strl = avih + 8 + 56;
+  CHECK(fourcc(file, strl, "LIST") && fourcc(file, strl + 8, "strl"));
+  size_t strh = strl + 12;
+  CHECK(fourcc(file, strh, "strh"));
+  CHECK(fourcc(file, strh + 8, "vids"));
+  CHECK(fourcc(file, strh + 12, "MJPG"));
+  uint32_t scale = u32(file, strh + 28), rate = u32(file, strh + 32);
+  CHECK(scale && rate);
+  if (frames.size() > 1 && scale) {
+    CHECK_EQ((int64_t)scale * 1000000 / rate, interval);
+  }
+  CHECK_EQ(u32(file, strh + 40), frames.size());
+  CHECK_EQ(u16(file, strh + 60), width);
+  CHECK_EQ(u16(file, strh + 62), height);
+  size_t strf = strh + 8 + 56;
+  CHECK(fourcc(file, strf, "strf"));
+  CHECK_EQ(u32(file, strf + 12), width);
+  CHECK_EQ(u32(file, strf + 16), height);
+  CHECK(fourcc(file, strf + 24, "MJPG"));
+
+  // Frame data starts on a sector boundary
+  CHECK_EQ(movi + 12, AVI_HEADER_SIZE);
+
+  // movi: one 00dc chunk per frame, in order, word aligned
+  size_t moviEnd = movi + 8 + u32(file, movi + 4);
+  pos = movi + 12;
+  size_t n = 0;
+  while (pos < moviEnd) {
+    CHECK(fourcc(file, pos, "00dc"));
+    uint32_t size = u32(file, pos + 4);
+    CHECK(n < frames.size() && size == frames[n].size());
+    if (n < frames.size() && size == frames[n].size()) {
+      CHECK(!memcmp(&file[pos + 8], frames[n].data(), size));
+    }
+    pos += 8 + size + (size & 1);
+    n++;
+  }
+  CHECK_EQ(pos, moviEnd);
+  CHECK_EQ(n, frames.size());
+
+  // idx1: offsets relative to the 'movi' fourcc, every frame decodes
+  CHECK_EQ(u32(file, idx1 + 4), frames.size() * 16);
+  for (size_t i = 0; i < frames.size() && idx1 + 8 + (i + 1) * 16 <= file.size(); i++) {
+    size_t entry = idx1 + 8 + i * 16;
+    CHECK(fourcc(file, entry, "00dc"));
+    CHECK(u32(file, entry + 4) & 0x10);  // AVIIF_KEYFRAME
+    size_t chunk = movi + 8 + u32(file, entry + 8);
+    uint32_t size = u32(file, entry + 12);
+    CHECK(fourcc(file, chunk, "00dc"));
+    CHECK_EQ(u32(file, chunk + 4), size);
+    CHECK_EQ(size, frames[i].size());
+
+    std::vector<uint8_t> jpeg(file.begin() + chunk + 8, file.begin() + chunk + 8 + size);
+    std::vector<uint8_t> pixels;
+    int w = 0, h = 0;
+    CHECK(decode_jpeg(jpeg, pixels, w, h, true));
+    CHECK_EQ(w, width);
+    CHECK_EQ(h, height);
+  }
+}
+
+int main(int argc, char **argv) {
+  const int width = 320, height = 240;
+  const int64_t interval = 40000;
+
+  std::vector<std::vector<uint8_t>> frames;
+  for (int i = 0; i < 25; i++) {
+    std::vector<uint8_t> rgb = sample_rgb(width, height, i);
+    frames.push_back(encode_jpeg(rgb.data(), width, height, 70 + i % 5, Subsampling::S422));
+    if (frames.back().size() % 2 == 0 && i % 2) {
+      frames.back().push_back(0);  // odd length, needs a pad byte (data after EOI is ignored)
+    }
+  }
+
+  std::vector<uint8_t> file = mux(frames, width, height, interval);
+  check_avi(file, frames, width, height, interval);
+
+  if (argc > 1) {
+    FILE *f = fopen(argv[1], "wb");
+    if (f) {
+      fwrite(file.data(), 1, file.size(), f);
+      fclose(f);
+    }
+  }
+
+  // A recording that was stopped before its first frame is still a valid file
+  std::vector<std::vector<uint8_t>> none;
+  check_avi(mux(none, width, height, interval), none, width, height, interval);
+
+  if (check_failures()) {
+    fprintf(stderr, "%d checks failed\n", check_failures());
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef HOST_CHECK_H
+#define HOST_CHECK_H
+
+#include <stdio.h>
+
+// Minimal test assertions: a failed CHECK reports and counts, the test's
+// main() returns check_failures() != 0.
+inline int &check_failures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(cond)                                                  \
+  do {                                                               \
+    if (!(cond)) {                                                   \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      check_failures()++;                                            \
+    }                                                                \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                                                     \
+  do {                                                                                                     \
+    long long _a = (long long)(a), _b = (long long)(b);                                                    \
+    if (_a != _b) {                                                                                        \
+      fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+      check_failures()++;                                                                                  \
+    }                                                                                                      \
+  } while (0)
+
+#endif
@@ -0,0 +1,98 @@
+#include "http_client.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+uint16_t http_free_port() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  socklen_t len = sizeof(addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, (sockaddr *)&addr, sizeof(addr));
+  getsockname(fd, (sockaddr *)&addr, &len);
+  close(fd);
+  return ntohs(addr.sin_port);
+}
+
+int http_connect(uint16_t port, int timeoutMs) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  int on = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool http_send(int fd, const std::string &bytes) {
+  size_t sent = 0;
+  while (sent < bytes.size()) {
+    ssize_t n = send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return false;
+    }
+    sent += n;
+  }
+  return true;
+}
+
+// Reads byte by byte up to the end of the head, so that a second response
+// behind it stays in the socket for the next call
+bool http_read_response(int fd, HttpResponse &response) {
+  std::string head;
+  char c;
+  while (head.size() < 4 || head.compare(head.size() - 4, 4, "\r\n\r\n")) {
+    if (recv(fd, &c, 1, 0) != 1) {
+      return false;
+    }
+    head += c;
+  }
+  const char *cl = strcasestr(head.c_str(), "\r\nContent-Length: ");
+  if (strncmp(head.c_str(), "HTTP/1.", 7) || !cl) {
+    return false;
+  }
+  response.status = atoi(head.c_str() + 9);
+  response.persistent = !strcasestr(head.c_str(), "\r\nConnection: close");
+  response.body.resize(strtoul(cl + 18, nullptr, 10));
+  size_t have = 0;
+  while (have < response.body.size()) {
+    ssize_t n = recv(fd, &response.body[have], response.body.size() - have, 0);
+    if (n <= 0) {
+      return false;
+    }
+    have += n;
+  }
+  return true;
+}
+
+bool http_closed(int fd) {
+  char c;
+  return recv(fd, &c, 1, 0) == 0;
+}
+
+int http_get(uint16_t port, const std::string &path, std::string *body, const char *method) {
+  int fd = http_connect(port);
+  HttpResponse response;
+  bool ok = fd >= 0 && http_send(fd, std::string(method) + " " + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+            && http_read_response(fd, response);
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (ok && body) {
+    *body = response.body;
+  }
+  return ok ? response.status : 0;
+}
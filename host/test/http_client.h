@@ -0,0 +1,36 @@
+#ifndef HOST_HTTP_CLIENT_H
+#define HOST_HTTP_CLIENT_H
+
+#include <stdint.h>
+#include <string>
+
+// Blocking loopback HTTP client for the tests that run the sketch's web
+// server on the Linux platform.
+
+struct HttpResponse {
+  int status = 0;
+  bool persistent = false;  // no Connection: close
+  std::string body;
+};
+
+// A port nobody listens on right now
+uint16_t http_free_port();
+
+// Connects to 127.0.0.1:port with TCP_NODELAY, reads time out after
+// timeoutMs. Returns -1 if the connection fails.
+int http_connect(uint16_t port, int timeoutMs = 2000);
+
+// Sends all of bytes in one send() where the socket allows it
+bool http_send(int fd, const std::string &bytes);
+
+// Reads one response with a Content-Length. False on a timeout, a close
+// before the response is complete or a response without Content-Length.
+bool http_read_response(int fd, HttpResponse &response);
+
+// True if the server closes the connection before the read timeout
+bool http_closed(int fd);
+
+// One GET on a new connection, the status or 0 if there was no response
+int http_get(uint16_t port, const std::string &path, std::string *body = nullptr, const char *method = "GET");
+
+#endif
@@ -0,0 +1,387 @@
+// The request parser of the sketch's ESPAsyncWebServer, fed over loopback
+// like a browser would. Generated requests (encoded paths and query
+// parameters, kept and dropped headers, form bodies, LF or CRLF line ends)
+// arrive in random pieces on persistent connections, the handler dumps what
+// it parsed and the dump must match the request. Mutated requests (flipped,
+// inserted and dropped bytes, cut short, oversized) must not bring the
+// server down, a generated request after them must still get its answer.
+// A multipart form then checks that a parameter read during the upload
+// stays valid while the fields after it are added.
+//
+//   http_parser_test [requests] [--seed N]
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "check.h"
+#include "http_client.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::mt19937 rng;
+
+static int random_int(int n) {
+  return std::uniform_int_distribution<int>(0, n - 1)(rng);
+}
+
+struct Request {
+  std::string bytes;  // as sent
+  std::string dump;   // what the handler should answer
+};
+
+static const char unreserved[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-._~";
+
+// Encoded text and its decoded form, with %XX escapes and '+' for a space
+static void random_text(std::string &encoded, std::string &decoded, int maxLen) {
+  int len = 1 + random_int(maxLen);
+  for (int i = 0; i < len; i++) {
+    int kind = random_int(10);
+    if (kind == 0) {
+      char c = 1 + random_int(255);
+      char hex[4];
+      snprintf(hex, sizeof(hex), random_int(2) ? "%%%02X" : "%%%02x", (uint8_t)c);
+      encoded += hex;
+      decoded += c;
+    } else if (kind == 1) {
+      encoded += '+';
+      decoded += ' ';
+    } else {
+      char c = unreserved[random_int(sizeof(unreserved) - 1)];
+      encoded += c;
+      decoded += c;
+    }
+  }
+}
+
+static std::string random_case(const char *name) {
+  std::string s = name;
+  for (char &c : s) {
+    if (random_int(3) == 0) {
+      c = isupper((uint8_t)c) ? tolower(c) : toupper(c);
+    }
+  }
+  return s;
+}
+
+static Request generate(uint16_t port) {
+  static const struct {
+    const char *name;
+    bool kept;  // known to the server, or added as interesting
+  } pool[] = {
+    {"Accept", true},           {"Cookie", true},         {"Origin", true},  {"If-None-Match", true},
+    {"X-Keep", true},           {"User-Agent", false},    {"X-Drop", false}, {"Accept-Language", false},
+    {"Sec-Fetch-Mode", false},  {"Accept-Encoding", false},
+    // length and first letter of a known name
+    {"Accepx", false},          {"Origim", false},        {"Hosts", false},  {"If-None-Matcx", false},
+  };
+  Request r;
+  std::string eol = random_int(4) ? "\r\n" : "\n";
+  bool post = random_int(4) == 0;
+
+  std::string url, decodedUrl;
+  int segments = 1 + random_int(3);
+  for (int i = 0; i < segments; i++) {
+    url += '/';
+    decodedUrl += '/';
+    random_text(url, decodedUrl, 12);
+  }
+  std::string params;
+  std::string query;
+  int count = random_int(5);
+  for (int i = 0; i < count; i++) {
+    query += i ? "&" : "?";
+    if (random_int(8) == 0) {
+      continue;  // empty, skipped
+    }
+    std::string name, decodedName, value, decodedValue;
+    random_text(name, decodedName, 8);
+    int form = random_int(4);
+    if (form) {
+      if (form > 1) {
+        random_text(value, decodedValue, 16);
+      }
+      query += name + "=" + value;
+    } else {
+      query += name;
+    }
+    params += "P " + decodedName + "=" + decodedValue + " 0\n";
+  }
+
+  std::string body;
+  std::string bodyParams;
+  if (post) {
+    int fields = 1 + random_int(3);
+    for (int i = 0; i < fields; i++) {
+      std::string name, decodedName, value, decodedValue;
+      random_text(name, decodedName, 8);
+      random_text(value, decodedValue, 16);
+      body += (i ? "&" : "") + name + "=" + value;
+      bodyParams += "P " + decodedName + "=" + decodedValue + " 1\n";
+    }
+  }
+
+  r.bytes = std::string(post ? "POST " : "GET ") + url + query + " HTTP/1.1" + eol;
+  std::string headers;
+  std::string host;
+  if (random_int(4)) {
+    host = "camera.local:" + std::to_string(port);
+    std::string name = random_case("Host");
+    r.bytes += name + ": " + host + eol;
+    headers += "H " + name + ": " + host + "\n";
+  }
+  std::string contentType;
+  if (post) {
+    std::string value = "application/x-www-form-urlencoded";
+    contentType = value;
+    if (random_int(2)) {
+      value += "; charset=UTF-8";
+    }
+    std::string name = random_case("Content-Type");
+    r.bytes += name + ":" + value + eol;
+    headers += "H " + name + ": " + value + "\n";
+    name = random_case("Content-Length");
+    r.bytes += name + ": " + std::to_string(body.size()) + eol;
+    headers += "H " + name + ": " + std::to_string(body.size()) + "\n";
+  }
+  int lines = random_int(12);
+  for (int i = 0; i < lines; i++) {
+    const auto &h = pool[random_int(sizeof(pool) / sizeof(*pool))];
+    std::string name = random_case(h.name);
+    std::string value, decoded;
+    random_text(value, decoded, 40);
+    static const char *const spaces[] = {"", " ", "  ", "\t", " \t"};
+    r.bytes += name + ":" + spaces[random_int(5)] + value + spaces[random_int(5)] + eol;
+    if (h.kept) {
+      headers += "H " + name + ": " + value + "\n";
+    }
+  }
+  r.bytes += eol + body;
+
+  r.dump = std::string(post ? "M POST\n" : "M GET\n") + "U " + decodedUrl + "\n" + params + bodyParams + headers + "h " + host + "\n" + "c " + contentType
+           + "\n";
+  return r;
+}
+
+// Pieces of one to a few dozen bytes, often splitting a line or a line end
+static std::vector<size_t> random_splits(size_t len) {
+  std::vector<size_t> splits;
+  int pieces = random_int(4);
+  for (int i = 0; i < pieces; i++) {
+    splits.push_back(1 + random_int(len > 1 ? len - 1 : 1));
+  }
+  std::sort(splits.begin(), splits.end());
+  splits.push_back(len);
+  return splits;
+}
+
+static std::string mutate(const std::string &bytes) {
+  std::string s = bytes;
+  int mutations = 1 + random_int(4);
+  for (int i = 0; i < mutations && !s.empty(); i++) {
+    size_t pos = random_int(s.size());
+    switch (random_int(7)) {
+      case 0: s[pos] = random_int(256); break;
+      case 1: s.insert(pos, 1, "\r\n: %?&=\t\0"[random_int(10)]); break;
+      case 2: s.erase(pos, 1 + random_int(8)); break;
+      case 3: s.resize(pos); break;
+      case 4: s.insert(pos, std::string(random_int(3000), 'a' + random_int(26))); break;
+      case 5: s.insert(pos, s.substr(pos, random_int(64))); break;
+      default: s.insert(pos, "%" + std::string(1, "0fG%"[random_int(4)])); break;
+    }
+  }
+  return s;
+}
+
+static bool send_pieces(int fd, const std::string &bytes) {
+  size_t sent = 0;
+  for (size_t split : random_splits(bytes.size())) {
+    if (split > sent) {
+      if (send(fd, bytes.data() + sent, split - sent, MSG_NOSIGNAL) < 0) {
+        return false;
+      }
+      sent = split;
+      std::this_thread::sleep_for(std::chrono::microseconds(random_int(500)));
+    }
+  }
+  return true;
+}
+
+// What the handler sees, through the lookups that work on the parsed spans
+// first and then through the Strings built from them
+static void dump(AsyncWebServerRequest *request) {
+  String out;
+  String url(request->url());
+  String view;
+  view.concat(request->urlData(), request->urlLength());
+  if (view != url) {
+    out += "X urlData\n";
+  }
+
+  size_t params = request->params();
+  size_t headers = request->headers();
+  std::vector<const char *> names;
+  request->getHeaderNames(names);
+  if (names.size() != headers) {
+    out += "X getHeaderNames\n";
+  }
+  for (const char *name : names) {
+    if (!request->hasHeader(name)) {
+      out += "X hasHeader\n";
+    }
+  }
+
+  out += String("M ") + request->methodToString() + "\n";
+  out += "U " + url + "\n";
+  if (request->params() != params) {
+    out += "X params\n";
+  }
+  for (size_t i = 0; i < params; i++) {
+    const AsyncWebParameter *p = request->getParam(i);
+    out += "P " + p->name() + "=" + p->value() + (p->isPost() ? " 1\n" : " 0\n");
+    if (!request->hasParam(p->name(), p->isPost()) || !request->hasArg(p->name().c_str())) {
+      out += "X hasParam\n";
+    }
+  }
+  for (size_t i = 0; i < headers; i++) {
+    const AsyncWebHeader *h = request->getHeader(i);
+    out += "H " + h->name() + ": " + h->value() + "\n";
+    if (h->name() != names[i] || request->getHeader(names[i]) == nullptr) {
+      out += "X getHeader\n";
+    }
+    if (h->id() != AsyncWebHeader::intern(names[i], strlen(names[i])) || (h->id() != AsyncWebHeader::Id::Unknown && !request->hasHeader(h->id()))) {
+      out += "X id\n";
+    }
+  }
+  if (request->getHeaders().size() != headers) {
+    out += "X getHeaders\n";
+  }
+  out += "h " + request->host() + "\n";
+  out += "c " + request->contentType() + "\n";
+  request->send(200, "text/plain", out);
+}
+
+// Read on the upload of the file part, checked once all fields are in
+static const AsyncWebParameter *early;
+
+static void upload(AsyncWebServerRequest *request, const String &, size_t index, uint8_t *, size_t, bool) {
+  if (!index) {
+    early = request->getParam("a", true);
+  }
+}
+
+static void uploaded(AsyncWebServerRequest *request) {
+  bool ok = early && early->name() == "a" && early->value() == "1" && early == request->getParam("a", true);
+  request->send(200, "text/plain", String(ok ? "ok " : "moved ") + String((unsigned)request->params()));
+}
+
+static std::string show(const std::string &s) {
+  std::string out;
+  for (char c : s) {
+    if (c == '\r') {
+      out += "\\r";
+    } else if ((uint8_t)c < ' ' && c != '\n') {
+      char hex[8];
+      snprintf(hex, sizeof(hex), "\\x%02x", (uint8_t)c);
+      out += hex;
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+int main(int argc, char **argv) {
+  int requests = 2000;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else {
+      requests = atoi(argv[i]);
+    }
+  }
+  rng.seed(seed);
+
+  uint16_t port = http_free_port();
+  AsyncWebServer &server = *new AsyncWebServer(port);
+  server.addInterestingHeader("X-Keep");
+  server.on("/upload", HTTP_POST, uploaded, upload);
+  server.onNotFound(dump);
+  server.begin();
+
+  int fd = -1;
+  int answered = 0;
+  int mutated = 0;
+  for (int i = 0; i < requests && !check_failures(); i++) {
+    Request r = generate(port);
+    if (random_int(4) == 0) {
+      // A new connection for it, written and then shut, the server may
+      // answer or drop it
+      int m = http_connect(port);
+      CHECK(m >= 0);
+      std::string bytes = mutate(r.bytes);
+      if (send_pieces(m, bytes)) {
+        shutdown(m, SHUT_WR);
+        HttpResponse response;
+        while (http_read_response(m, response)) {
+        }
+      }
+      close(m);
+      mutated++;
+      continue;
+    }
+
+    if (fd < 0) {
+      fd = http_connect(port);
+      CHECK(fd >= 0);
+    }
+    HttpResponse response;
+    if (!send_pieces(fd, r.bytes) || !http_read_response(fd, response)) {
+      fprintf(stderr, "request %d: no response to\n%s\n", i, show(r.bytes).c_str());
+      CHECK(false);
+      break;
+    }
+    if (response.body != r.dump) {
+      fprintf(stderr, "request %d:\n%s\nparsed as\n%s\nexpected\n%s\n", i, show(r.bytes).c_str(), show(response.body).c_str(), show(r.dump).c_str());
+      CHECK(false);
+    }
+    answered++;
+    if (!response.persistent) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  printf("seed %u: %d requests answered, %d mutated ones sent\n", seed, answered, mutated);
+
+  std::string body = "--b\r\nContent-Disposition: form-data; name=\"a\"\r\n\r\n1\r\n"
+                     "--b\r\nContent-Disposition: form-data; name=\"f\"; filename=\"f.txt\"\r\n\r\nfile\r\n";
+  for (int i = 0; i < 40; i++) {
+    body += "--b\r\nContent-Disposition: form-data; name=\"b" + std::to_string(i) + "\"\r\n\r\nx\r\n";
+  }
+  body += "--b--\r\n";
+  fd = http_connect(port);
+  HttpResponse response;
+  CHECK(http_send(fd, "POST /upload?q=1 HTTP/1.1\r\nHost: localhost\r\nContent-Type: multipart/form-data; boundary=b\r\nContent-Length: "
+                        + std::to_string(body.size()) + "\r\n\r\n" + body)
+        && http_read_response(fd, response));
+  if (response.body != "ok 43") {
+    fprintf(stderr, "multipart: '%s'\n", response.body.c_str());
+    CHECK(false);
+  }
+  close(fd);
+
+  // The sketch's tasks still run, skip the static destructors under them
+  fflush(stdout);
+  _exit(check_failures() != 0);
+}
@@ -0,0 +1,83 @@
+// Requests that follow each other closely on one connection. The server
+// does not pipeline: bytes behind a request that arrive before its response
+// is done must either be answered or make the response close the
+// connection, never leave the client waiting for the read timeout.
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "check.h"
+#include "http_client.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+
+// Well below the server's rx timeout, a connection left open until then
+// counts as hanging
+static const int timeoutMs = 1000;
+
+// Sends bytes in one segment, the first response must be `first`, the
+// next one `second` or a close
+static void pipelined(uint16_t port, const char *name, const std::string &bytes, const char *first, const char *second) {
+  int fd = http_connect(port, timeoutMs);
+  CHECK(fd >= 0);
+  CHECK(http_send(fd, bytes));
+  HttpResponse response;
+  if (!http_read_response(fd, response)) {
+    fprintf(stderr, "%s: no first response\n", name);
+    CHECK(false);
+  } else if (response.body != first) {
+    fprintf(stderr, "%s: first response '%s'\n", name, response.body.c_str());
+    CHECK(false);
+  } else if (response.persistent) {
+    if (!http_read_response(fd, response) || response.body != second) {
+      fprintf(stderr, "%s: kept alive without answering the second request\n", name);
+      CHECK(false);
+    }
+  } else if (!http_closed(fd)) {
+    fprintf(stderr, "%s: Connection: close but the connection stays open\n", name);
+    CHECK(false);
+  }
+  close(fd);
+}
+
+int main() {
+  uint16_t port = http_free_port();
+  AsyncWebServer &server = *new AsyncWebServer(port);
+  server.on("/a", HTTP_GET, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", "a");
+  });
+  server.on("/b", HTTP_GET, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", "b");
+  });
+  server.on("/form", HTTP_POST, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", request->hasParam("x", true) ? request->getParam("x", true)->value() : String("none"));
+  });
+  server.begin();
+
+  const std::string a = "GET /a HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  const std::string b = "GET /b HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  const std::string form = "POST /form HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/x-www-form-urlencoded\r\nContent-Length: 3\r\n\r\nx=1";
+
+  // One after the other, both answered on the same connection
+  int fd = http_connect(port, timeoutMs);
+  HttpResponse response;
+  CHECK(http_send(fd, a) && http_read_response(fd, response) && response.body == "a" && response.persistent);
+  CHECK(http_send(fd, b) && http_read_response(fd, response) && response.body == "b" && response.persistent);
+  CHECK(http_send(fd, form) && http_read_response(fd, response) && response.body == "1" && response.persistent);
+  close(fd);
+
+  // Both in one segment, behind a head and behind a body
+  pipelined(port, "two GETs", a + b, "a", "b");
+  pipelined(port, "GET and a partial one", a + "GET /b HT", "a", "");
+  pipelined(port, "form and GET", form + b, "1", "b");
+  pipelined(port, "three GETs", a + b + a, "a", "b");
+
+  // The server still takes new connections
+  std::string body;
+  CHECK_EQ(http_get(port, "/b", &body), 200);
+  CHECK(body == "b");
+
+  // The sketch's tasks still run, skip the static destructors under them
+  fflush(stdout);
+  _exit(check_failures() != 0);
+}
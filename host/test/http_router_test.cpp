@@ -0,0 +1,159 @@
+// The radix tree AsyncWebServer routes callback handlers through. Every
+// answer names the route the tree chose and the one the linear dispatch it
+// replaced would have chosen: the first callback handler in registration
+// order whose canHandle() takes the request. Both must agree, for a table
+// of prefix, exact, overlapping, method filtered and template routes and
+// for random URLs, before and after handlers change at run time.
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "check.h"
+#include "http_client.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Named {
+  const char *name;
+  AsyncCallbackWebHandler *handler;
+};
+static std::vector<Named> routes;
+
+static String linear(AsyncWebServerRequest *request) {
+  for (const Named &r : routes) {
+    if (r.handler->filter(request) && r.handler->canHandle(request)) {
+      return r.name;
+    }
+  }
+  return "none";
+}
+
+static void route(AsyncWebServer &server, const char *uri, WebRequestMethodComposite method, const char *name) {
+  AsyncCallbackWebHandler &handler = server.on(uri, method, [name](AsyncWebServerRequest *request) {
+    request->send(200, "text/plain", String(name) + " " + linear(request));
+  });
+  routes.push_back({name, &handler});
+}
+
+static void unroute(AsyncWebServer &server, const char *name) {
+  for (auto r = routes.begin(); r != routes.end(); ++r) {
+    if (!strcmp(r->name, name)) {
+      CHECK(server.removeHandler(r->handler));
+      routes.erase(r);
+      return;
+    }
+  }
+}
+
+// The route that answers method url, "none" for a 404
+static std::string routed(uint16_t port, const char *method, const std::string &url) {
+  std::string body;
+  int status = http_get(port, url, &body, method);
+  std::string tree = body.substr(0, body.find(' '));
+  std::string reference = body.substr(body.find(' ') + 1);
+  if (!status || tree != reference) {
+    fprintf(stderr, "%s %s: status %d, tree '%s', linear '%s'\n", method, url.c_str(), status, tree.c_str(), reference.c_str());
+    CHECK(false);
+  }
+  return tree;
+}
+
+static void expect(uint16_t port, const char *method, const char *url, const char *name) {
+  std::string got = routed(port, method, url);
+  if (got != name) {
+    fprintf(stderr, "%s %s: routed to %s, expected %s\n", method, url, got.c_str(), name);
+    CHECK(false);
+  }
+}
+
+int main() {
+  uint16_t port = http_free_port();
+  AsyncWebServer &server = *new AsyncWebServer(port);
+  route(server, "/cam/capture", HTTP_GET, "capture");
+  route(server, "/cam/capture", HTTP_POST, "capture-post");
+  route(server, "/cam", HTTP_GET, "cam");
+  route(server, "/cam*", HTTP_GET, "cam-prefix");
+  route(server, "/c*", HTTP_ANY, "c-prefix");
+  route(server, "/dev/{id}/name", HTTP_GET, "dev-name");
+  route(server, "/dev*", HTTP_GET, "dev-prefix");
+  route(server, "/dev/{id}", HTTP_GET, "dev-id");
+  route(server, "/a/b", HTTP_GET, "ab");
+  route(server, "/a", HTTP_GET, "a");
+  route(server, "/abc", HTTP_GET, "abc");
+  route(server, "/item/{id}", HTTP_POST, "item-post");
+  route(server, "/item/{id}", HTTP_GET, "item-get");
+  server.onNotFound([](AsyncWebServerRequest *request) {
+    request->send(404, "text/plain", "none " + linear(request));
+  });
+  server.begin();
+
+  // Exact routes take their URL and everything below it, prefix routes
+  // every URL they start
+  expect(port, "GET", "/cam/capture", "capture");
+  expect(port, "GET", "/cam", "cam");
+  expect(port, "GET", "/cam/", "cam");
+  expect(port, "GET", "/cam/x/y", "cam");
+  expect(port, "GET", "/camera", "cam-prefix");
+  expect(port, "GET", "/abc", "abc");
+  expect(port, "GET", "/ab", "none");
+  expect(port, "GET", "/abcd", "none");
+  expect(port, "GET", "/a/x", "a");
+  expect(port, "GET", "/d", "none");
+
+  // Overlapping routes, the one registered first wins
+  expect(port, "GET", "/c", "c-prefix");
+  expect(port, "GET", "/a/b/c", "ab");
+  expect(port, "GET", "/dev/5", "dev-prefix");
+
+  // Methods
+  expect(port, "POST", "/cam/capture", "capture-post");
+  expect(port, "PUT", "/cam/capture", "c-prefix");
+  expect(port, "DELETE", "/camera", "c-prefix");
+  expect(port, "GET", "/item/7", "item-get");
+  expect(port, "POST", "/item/7", "item-post");
+
+  // A template that does not match falls back to the routes after it
+  expect(port, "GET", "/dev/5/name", "dev-name");
+  expect(port, "GET", "/dev/5/value", "dev-prefix");
+  expect(port, "GET", "/dev", "dev-prefix");
+  expect(port, "GET", "/item/7/x", "none");
+
+  // Random URLs made of the routes' pieces
+  static const char *pieces[] = {"/cam", "/capture", "era", "/", "/dev", "/5", "/name", "/a", "/b", "bc", "/item", "/x", "/c", "c"};
+  static const char *methods[] = {"GET", "POST", "PUT", "DELETE"};
+  std::mt19937 rng(1);
+  auto random_url = [&rng]() {
+    std::string url;
+    for (int n = 1 + rng() % 4; n; n--) {
+      url += pieces[rng() % (sizeof(pieces) / sizeof(pieces[0]))];
+    }
+    return url[0] == '/' ? url : "/" + url;
+  };
+  for (int i = 0; i < 200 && !check_failures(); i++) {
+    routed(port, methods[rng() % 4], random_url());
+  }
+
+  // Handlers added and removed after begin() rebuild the tree
+  expect(port, "GET", "/late", "none");
+  route(server, "/late", HTTP_GET, "late");
+  route(server, "/camera/{n}", HTTP_GET, "camera-n");
+  expect(port, "GET", "/late", "late");
+  expect(port, "GET", "/late/x", "late");
+  expect(port, "GET", "/camera/1", "cam-prefix");
+  unroute(server, "cam");
+  unroute(server, "cam-prefix");
+  expect(port, "GET", "/cam", "c-prefix");
+  expect(port, "GET", "/camera/1", "c-prefix");
+  unroute(server, "c-prefix");
+  expect(port, "GET", "/camera/1", "camera-n");
+  expect(port, "GET", "/cam/capture", "capture");
+  for (int i = 0; i < 200 && !check_failures(); i++) {
+    routed(port, methods[rng() % 4], random_url());
+  }
+
+  // The sketch's tasks still run, skip the static destructors under them
+  fflush(stdout);
+  _exit(check_failures() != 0);
+}
@@ -0,0 +1,89 @@
+// URI templates of callback handlers: "{name}" takes one non-empty segment,
+// "*name" the rest of the path, literal parts must match exactly and the
+// template the whole URL. Each route answers with its name and the path
+// parameters it got by name, which must be the same by index.
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "check.h"
+#include "http_client.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+static void route(AsyncWebServer &server, const char *uri, const char *name, std::initializer_list<const char *> params) {
+  std::vector<const char *> names(params);
+  AsyncCallbackWebHandler *handler = &server.on(uri, HTTP_GET, nullptr);
+  handler->onRequest([name, names, handler](AsyncWebServerRequest *request) {
+    String out(name);
+    for (const char *param : names) {
+      out += " " + request->pathArg(param);
+      if (request->pathArg(handler->pathArgIndex(param)) != request->pathArg(param)) {
+        out += "(by index: " + request->pathArg(handler->pathArgIndex(param)) + ")";
+      }
+    }
+    request->send(200, "text/plain", out);
+  });
+}
+
+static void expect(uint16_t port, const char *url, const char *answer) {
+  std::string body;
+  int status = http_get(port, url, &body);
+  if (body != answer) {
+    fprintf(stderr, "%s: %d '%s', expected '%s'\n", url, status, body.c_str(), answer);
+    CHECK(false);
+  }
+}
+
+int main() {
+  uint16_t port = http_free_port();
+  AsyncWebServer &server = *new AsyncWebServer(port);
+  route(server, "/cam/{id}", "cam", {"id"});
+  route(server, "/cam/{id}/capture", "capture", {"id"});
+  route(server, "/cam/{id}/set/{key}/", "set", {"id", "key"});
+  route(server, "/file/*path", "file", {"path"});
+  route(server, "/{a}/{b}/{c}/{d}/{e}/{f}/{g}/{h}/{i}", "nine", {"a", "b", "h", "i"});
+  route(server, "/open{", "open", {});
+  server.onNotFound([](AsyncWebServerRequest *request) {
+    request->send(404, "text/plain", "none");
+  });
+  server.begin();
+
+  // Literal segments and captures
+  expect(port, "/cam/5", "cam 5");
+  expect(port, "/cam/front/capture", "capture front");
+  expect(port, "/cam/5/set/quality/", "set 5 quality");
+  expect(port, "/cam/a%20b", "cam a b");
+  expect(port, "/file/a/b.jpg", "file a/b.jpg");
+  expect(port, "/file/", "file ");
+
+  // Trailing slashes are part of the URL the template must match
+  expect(port, "/cam/5/", "none");
+  expect(port, "/cam/5/capture/", "none");
+  expect(port, "/cam/5/set/quality", "none");
+
+  // No match
+  expect(port, "/cam", "none");
+  expect(port, "/cam/", "none");
+  expect(port, "/cam//capture", "none");
+  expect(port, "/cam/5/capturex", "none");
+  expect(port, "/cam/5/captur", "none");
+  expect(port, "/camera/5", "none");
+  expect(port, "/file", "none");
+  expect(port, "/1/2/3/4/5/6/7/8", "none");
+  expect(port, "/1/2/3/4/5/6/7/8/9/10", "none");
+
+  // Parameters past ASYNCWEBSERVER_MAX_PATH_PARAMS are matched, not captured
+  static_assert(ASYNCWEBSERVER_MAX_PATH_PARAMS == 8, "the nine parameter route expects 8");
+  expect(port, "/1/2/3/4/5/6/7/8/9", "nine 1 2 8 ");
+
+  // An unclosed brace is no template, the URI is plain
+  expect(port, "/open{", "open");
+  expect(port, "/open{/x", "open");
+  expect(port, "/openx", "none");
+
+  // The sketch's tasks still run, skip the static destructors under them
+  fflush(stdout);
+  _exit(check_failures() != 0);
+}
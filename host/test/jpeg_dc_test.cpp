@@ -0,0 +1,91 @@
+// JpegDcDecoder against libjpeg's 1/8 scaled decode, which reconstructs every
+// block from its DC coefficient alone. Covers the chroma layouts the camera
+// and other encoders produce, restart intervals and sizes that are not a
+// multiple of the MCU.
+#include "JpegDcDecoder.h"
+#include "check.h"
+#include "jpeg_samples.h"
+#include <stdlib.h>
+#include <algorithm>
+
+static const char *name(Subsampling sub) {
+  switch (sub) {
+    case Subsampling::S444: return "4:4:4";
+    case Subsampling::S422: return "4:2:2";
+    case Subsampling::S420: return "4:2:0";
+    default: return "grey";
+  }
+}
+
+static void check_dc(int width, int height, Subsampling sub, int restartInterval, int quality) {
+  std::vector<uint8_t> rgb = sample_rgb(width, height);
+  std::vector<uint8_t> jpeg = encode_jpeg(rgb.data(), width, height, quality, sub, restartInterval);
+
+  std::vector<uint8_t> reference;
+  int refWidth = 0, refHeight = 0;
+  if (!decode_jpeg(jpeg, reference, refWidth, refHeight, true, 8)) {
+    CHECK(!"libjpeg failed");
+    return;
+  }
+
+  JpegDcDecoder dc;
+  bool ok = dc.decode(jpeg.data(), jpeg.size());
+  CHECK(ok);
+  if (!ok) {
+    fprintf(stderr, "  %dx%d %s restart %d\n", width, height, name(sub), restartInterval);
+    return;
+  }
+  CHECK_EQ(dc.width(), width);
+  CHECK_EQ(dc.height(), height);
+  CHECK_EQ(dc.mapWidth(), refWidth);
+  CHECK_EQ(dc.mapHeight(), refHeight);
+  if (dc.mapWidth() != refWidth || dc.mapHeight() != refHeight) {
+    return;
+  }
+
+  int worst = 0;
+  for (size_t i = 0; i < reference.size(); i++) {
+    worst = std::max(worst, abs(dc.map()[i] - reference[i]));
+  }
+  if (worst > 1) {
+    fprintf(stderr, "  %dx%d %s restart %d: off by %d\n", width, height, name(sub), restartInterval, worst);
+  }
+  CHECK(worst <= 1);
+}
+
+int main() {
+  const Subsampling subs[] = {Subsampling::S420, Subsampling::S422, Subsampling::S444, Subsampling::Grey};
+  const int sizes[][2] = {{320, 240}, {800, 600}, {97, 61}, {17, 9}, {8, 8}, {1, 1}};
+
+  for (Subsampling sub : subs) {
+    for (const auto &size : sizes) {
+      for (int restart : {0, 1, 3}) {
+        check_dc(size[0], size[1], sub, restart, 80);
+      }
+    }
+    check_dc(640, 480, sub, 0, 10);
+    check_dc(640, 480, sub, 0, 100);
+  }
+
+  // Not a JPEG, truncated, progressive
+  JpegDcDecoder dc;
+  const uint8_t junk[] = {0x12, 0x34, 0x56, 0x78};
+  CHECK(!dc.decode(junk, sizeof(junk)));
+  std::vector<uint8_t> rgb = sample_rgb(64, 64);
+  std::vector<uint8_t> jpeg = encode_jpeg(rgb.data(), 64, 64, 80, Subsampling::S420);
+  CHECK(!dc.decode(jpeg.data(), 100));
+  for (size_t i = 0; i + 1 < jpeg.size(); i++) {
+    if (jpeg[i] == 0xFF && jpeg[i + 1] == 0xC0) {
+      jpeg[i + 1] = 0xC2;
+      break;
+    }
+  }
+  CHECK(!dc.decode(jpeg.data(), jpeg.size()));
+
+  if (check_failures()) {
+    fprintf(stderr, "%d checks failed\n", check_failures());
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,170 @@
+#include "jpeg_samples.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include <algorithm>
+#include <jpeglib.h>
+
+std::vector<uint8_t> sample_rgb(int width, int height, int frame) {
+  std::vector<uint8_t> rgb((size_t)width * height * 3);
+  uint32_t seed = 12345 + frame;
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      uint8_t *p = &rgb[((size_t)y * width + x) * 3];
+      int r = x * 255 / (width > 1 ? width - 1 : 1);
+      int g = y * 255 / (height > 1 ? height - 1 : 1);
+      int b = ((x / 16 + y / 16) & 1) ? 200 : 40;
+      int cx = (width / 3 + frame * 7) % (width ? width : 1), cy = height / 2;
+      if ((x - cx) * (x - cx) + (y - cy) * (y - cy) < (width * width) / 64) {
+        r = 250 - r / 4;
+        g = 30;
+        b = 90;
+      }
+      seed = seed * 1103515245 + 12345;
+      int noise = (int)((seed >> 16) & 15) - 8;
+      p[0] = (uint8_t)std::min(255, std::max(0, r + noise));
+      p[1] = (uint8_t)std::min(255, std::max(0, g + noise));
+      p[2] = (uint8_t)std::min(255, std::max(0, b + noise));
+    }
+  }
+  return rgb;
+}
+
+static uint8_t luma(const uint8_t *p) {
+  return (19595 * p[0] + 38470 * p[1] + 7471 * p[2] + 32768) >> 16;
+}
+
+std::vector<uint8_t> camera_pixels(const std::vector<uint8_t> &rgb, int width, int height, pixformat_t format) {
+  size_t pixels = (size_t)width * height;
+  std::vector<uint8_t> out;
+  switch (format) {
+    case PIXFORMAT_RGB565:
+      out.resize(pixels * 2);
+      for (size_t i = 0; i < pixels; i++) {
+        const uint8_t *p = &rgb[i * 3];
+        uint16_t v = ((p[0] & 0xF8) << 8) | ((p[1] & 0xFC) << 3) | (p[2] >> 3);
+        out[i * 2] = v >> 8;
+        out[i * 2 + 1] = v;
+      }
+      break;
+    case PIXFORMAT_RGB888:
+      out.resize(pixels * 3);
+      for (size_t i = 0; i < pixels; i++) {
+        out[i * 3] = rgb[i * 3 + 2];
+        out[i * 3 + 1] = rgb[i * 3 + 1];
+        out[i * 3 + 2] = rgb[i * 3];
+      }
+      break;
+    case PIXFORMAT_GRAYSCALE:
+      out.resize(pixels);
+      for (size_t i = 0; i < pixels; i++) {
+        out[i] = luma(&rgb[i * 3]);
+      }
+      break;
+    case PIXFORMAT_YUV422:
+      out.resize(pixels * 2);
+      for (size_t i = 0; i + 1 < pixels; i += 2) {
+        const uint8_t *p = &rgb[i * 3];
+        int r = p[0] + p[3], g = p[1] + p[4], b = p[2] + p[5];
+        out[i * 2] = luma(p);
+        out[i * 2 + 1] = std::min(255, std::max(0, ((-11059 * r - 21709 * g + 32768 * b + 65536) >> 17) + 128));
+        out[i * 2 + 2] = luma(p + 3);
+        out[i * 2 + 3] = std::min(255, std::max(0, ((32768 * r - 27439 * g - 5329 * b + 65536) >> 17) + 128));
+      }
+      break;
+    default:
+      break;
+  }
+  return out;
+}
+
+namespace {
+struct ErrorManager {
+  jpeg_error_mgr pub;
+  jmp_buf jump;
+};
+
+void error_exit(j_common_ptr cinfo) {
+  longjmp(reinterpret_cast<ErrorManager *>(cinfo->err)->jump, 1);
+}
+
+void quiet(j_common_ptr, int) {}
+}  // namespace
+
+std::vector<uint8_t> encode_jpeg(const uint8_t *rgb, int width, int height, int quality, Subsampling sub, int restartInterval) {
+  jpeg_compress_struct cinfo;
+  jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+
+  unsigned char *mem = nullptr;
+  unsigned long memLen = 0;
+  jpeg_mem_dest(&cinfo, &mem, &memLen);
+
+  bool grey = sub == Subsampling::Grey;
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = grey ? 1 : 3;
+  cinfo.in_color_space = grey ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+  cinfo.restart_interval = restartInterval;
+  if (!grey) {
+    int h = sub == Subsampling::S444 ? 1 : 2;
+    int v = sub == Subsampling::S420 ? 2 : 1;
+    cinfo.comp_info[0].h_samp_factor = h;
+    cinfo.comp_info[0].v_samp_factor = v;
+  }
+  jpeg_start_compress(&cinfo, TRUE);
+
+  std::vector<uint8_t> row((size_t)width * 3);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    const uint8_t *src = rgb + (size_t)cinfo.next_scanline * width * 3;
+    if (grey) {
+      for (int x = 0; x < width; x++) {
+        row[x] = (uint8_t)((src[x * 3] * 77 + src[x * 3 + 1] * 150 + src[x * 3 + 2] * 29) >> 8);
+      }
+    } else {
+      std::copy(src, src + (size_t)width * 3, row.begin());
+    }
+    JSAMPROW rows[1] = {row.data()};
+    jpeg_write_scanlines(&cinfo, rows, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+
+  std::vector<uint8_t> out(mem, mem + memLen);
+  jpeg_destroy_compress(&cinfo);
+  free(mem);
+  return out;
+}
+
+bool decode_jpeg(const std::vector<uint8_t> &jpeg, std::vector<uint8_t> &out, int &width, int &height, bool luma, int scaleDenom) {
+  jpeg_decompress_struct cinfo;
+  ErrorManager jerr;
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = error_exit;
+  jerr.pub.emit_message = quiet;
+  if (setjmp(jerr.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, jpeg.data(), jpeg.size());
+  jpeg_read_header(&cinfo, TRUE);
+  cinfo.out_color_space = luma ? JCS_GRAYSCALE : JCS_RGB;
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = scaleDenom;
+  jpeg_start_decompress(&cinfo);
+
+  width = cinfo.output_width;
+  height = cinfo.output_height;
+  size_t stride = (size_t)width * cinfo.output_components;
+  out.resize(stride * height);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW rows[1] = {out.data() + stride * cinfo.output_scanline};
+    jpeg_read_scanlines(&cinfo, rows, 1);
+  }
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return true;
+}
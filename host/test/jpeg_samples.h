@@ -0,0 +1,28 @@
+#ifndef HOST_JPEG_SAMPLES_H
+#define HOST_JPEG_SAMPLES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "esp_camera.h"
+
+// Sample images and libjpeg as the reference codec for host tests.
+
+enum class Subsampling { S444, S422, S420, Grey };
+
+// A synthetic scene (gradients, shapes, some noise) so that the entropy coded
+// data looks like a camera frame. frame shifts the shapes.
+std::vector<uint8_t> sample_rgb(int width, int height, int frame = 0);
+
+// The RGB image in a raw esp32-camera pixel format: RGB565 big endian, RGB888
+// as BGR, YUV422 as Y0 U Y1 V (even width) or GRAYSCALE.
+std::vector<uint8_t> camera_pixels(const std::vector<uint8_t> &rgb, int width, int height, pixformat_t format);
+
+std::vector<uint8_t> encode_jpeg(const uint8_t *rgb, int width, int height, int quality, Subsampling sub, int restartInterval = 0);
+
+// Decodes to one byte per pixel luma, or 3 bytes RGB, scaled down by
+// scaleDenom (1, 2, 4 or 8; 8 is the DC coefficient of every block). false if
+// libjpeg fails.
+bool decode_jpeg(const std::vector<uint8_t> &jpeg, std::vector<uint8_t> &out, int &width, int &height, bool luma, int scaleDenom = 1);
+
+#endif
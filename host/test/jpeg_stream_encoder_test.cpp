@@ -0,0 +1,99 @@
+// JpegStreamEncoder output decoded by libjpeg, for every source format and
+// sizes that are not a multiple of the MCU, read back in small pieces as a
+// response filler would.
+#include "JpegStreamEncoder.h"
+#include "check.h"
+#include "jpeg_samples.h"
+#include <stdlib.h>
+
+static const char *name(pixformat_t format) {
+  switch (format) {
+    case PIXFORMAT_RGB565: return "RGB565";
+    case PIXFORMAT_RGB888: return "RGB888";
+    case PIXFORMAT_YUV422: return "YUV422";
+    default: return "GRAYSCALE";
+  }
+}
+
+static std::vector<uint8_t> encode(JpegStreamEncoder &encoder, size_t chunk) {
+  std::vector<uint8_t> jpeg;
+  uint8_t buf[1460];
+  size_t n;
+  while ((n = encoder.read(buf, chunk)) > 0) {
+    jpeg.insert(jpeg.end(), buf, buf + n);
+  }
+  return jpeg;
+}
+
+static double mean_error(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+  long long error = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    error += abs(a[i] - b[i]);
+  }
+  return (double)error / a.size();
+}
+
+static void check_format(int width, int height, pixformat_t format, size_t chunk) {
+  std::vector<uint8_t> rgb = sample_rgb(width, height);
+  std::vector<uint8_t> src = camera_pixels(rgb, width, height, format);
+
+  JpegStreamEncoder encoder;
+  CHECK(encoder.begin(src.data(), width, height, format, 90));
+  std::vector<uint8_t> jpeg = encode(encoder, chunk);
+  CHECK(encoder.done());
+
+  bool grey = format == PIXFORMAT_GRAYSCALE;
+  std::vector<uint8_t> decoded;
+  int w = 0, h = 0;
+  bool ok = decode_jpeg(jpeg, decoded, w, h, grey);
+  CHECK(ok);
+  CHECK_EQ(w, width);
+  CHECK_EQ(h, height);
+  if (!ok || w != width || h != height) {
+    fprintf(stderr, "  %dx%d %s\n", width, height, name(format));
+    return;
+  }
+
+  // Mean error per channel against the source, compared with libjpeg at the
+  // same quality and subsampling. RGB565 loses up to 3 bits before encoding.
+  std::vector<uint8_t> expected = grey ? src : rgb;
+  std::vector<uint8_t> reference;
+  decode_jpeg(encode_jpeg(rgb.data(), width, height, 90, grey ? Subsampling::Grey : Subsampling::S420), reference, w, h, grey);
+  double error = mean_error(decoded, expected);
+  double limit = mean_error(reference, expected) * 1.25 + (format == PIXFORMAT_RGB565 ? 3 : 1);
+  if (error > limit) {
+    fprintf(stderr, "  %dx%d %s: mean error %.2f, limit %.2f\n", width, height, name(format), error, limit);
+  }
+  CHECK(error <= limit);
+}
+
+int main() {
+  const pixformat_t formats[] = {PIXFORMAT_RGB565, PIXFORMAT_RGB888, PIXFORMAT_GRAYSCALE, PIXFORMAT_YUV422};
+  const int sizes[][2] = {{320, 240}, {98, 61}, {18, 9}, {16, 16}, {2, 1}, {2, 2}};
+
+  for (pixformat_t format : formats) {
+    for (const auto &size : sizes) {
+      check_format(size[0], size[1], format, 1460);
+    }
+    check_format(64, 48, format, 1);
+  }
+  for (pixformat_t format : {PIXFORMAT_RGB565, PIXFORMAT_RGB888, PIXFORMAT_GRAYSCALE}) {
+    check_format(1, 1, format, 1460);
+    check_format(97, 61, format, 1460);
+  }
+
+  // Half a YUV422 pixel pair at the right edge, and unsupported formats
+  uint8_t pixels[4] = {};
+  JpegStreamEncoder encoder;
+  CHECK(!encoder.begin(pixels, 1, 1, PIXFORMAT_YUV422, 90));
+  CHECK(!encoder.begin(pixels, 3, 1, PIXFORMAT_YUV422, 90));
+  CHECK(!encoder.begin(pixels, 1, 1, PIXFORMAT_JPEG, 90));
+  CHECK(!encoder.begin(pixels, 0, 1, PIXFORMAT_RGB565, 90));
+
+  if (check_failures()) {
+    fprintf(stderr, "%d checks failed\n", check_failures());
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}